@@ -5,7 +5,10 @@
 #pragma link off all functions;
 
 //KFParticle
+#pragma link C++ class  KFPDaughterIds+;
 #pragma link C++ class  KFParticleBase+;
+#pragma read sourceClass="KFParticleBase" targetClass="KFParticleBase" version="[-3]" source="std::vector<int> fDaughtersIds" target="fDaughtersIds" \
+  code="{ fDaughtersIds.clear(); for(unsigned int i=0; i<onfile.fDaughtersIds.size(); i++) fDaughtersIds.push_back(onfile.fDaughtersIds[i]); }"
 #pragma link C++ class  KFParticle+;
 #pragma link C++ class  KFVertex+;
 #pragma link C++ class  KFPartEfficiencies+;
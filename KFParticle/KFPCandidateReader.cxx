@@ -0,0 +1,166 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "KFPCandidateReader.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+bool KFPCandidateReader::Open(const std::string& fileName)
+{
+  /** Maps the file into memory and checks the header, the trailer and the footer. Returns false if the file can not be 
+   ** opened or has a wrong format.
+   ** \param[in] fileName - name of the input file
+   **/
+  Close();
+  
+  const int fileDescriptor = open(fileName.data(), O_RDONLY);
+  if(fileDescriptor < 0) return false;
+  
+  struct stat fileStat;
+  if(fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size < 20)
+  {
+    close(fileDescriptor);
+    return false;
+  }
+  
+  void* data = mmap(0, fileStat.st_size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+  close(fileDescriptor);
+  if(data == MAP_FAILED) return false;
+  
+  fData = static_cast<const unsigned char*>(data);
+  fSize = fileStat.st_size;
+  
+  unsigned int header[2];
+  unsigned int trailer[3];
+  memcpy(header, fData, sizeof(header));
+  memcpy(trailer, fData + fSize - sizeof(trailer), sizeof(trailer));
+  const unsigned long long footerOffset = (static_cast<unsigned long long>(trailer[1]) << 32) | trailer[0];
+  
+  // the sizes are compared by subtraction and division, so the values from the file can not overflow them
+  bool isGood = (header[0] == KFPCandidateWriter::fMagic) && (header[1] == KFPCandidateWriter::fVersion) && 
+                (trailer[2] == KFPCandidateWriter::fMagic) && (footerOffset >= sizeof(header)) &&
+                (footerOffset <= fSize - 8 - sizeof(trailer)) && (footerOffset % 4 == 0);
+  if(isGood)
+  {
+    const unsigned int* footer = reinterpret_cast<const unsigned int*>(fData + footerOffset);
+    const unsigned long long indexSize = fSize - footerOffset - 8 - sizeof(trailer);
+    const unsigned long long blockIndexSize = 4ull*(3 + 5ull*footer[0]);
+    isGood = (footer[0] >= static_cast<unsigned int>(KFPCandidateWriter::kNColumns)) && (footer[1] <= 0x7fffffffu) &&
+             (indexSize % blockIndexSize == 0) && (indexSize / blockIndexSize == footer[1]);
+    if(isGood)
+    {
+      fNColumns = footer[0];
+      fNBlocks = footer[1];
+      fBlockIndex = footer + 2;
+    }
+  }
+  if(!isGood)
+  {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void KFPCandidateReader::Close()
+{
+  /** Unmaps the file. */
+  if(fData)
+    munmap(const_cast<unsigned char*>(fData), fSize);
+  fData = 0;
+  fSize = 0;
+  fNColumns = 0;
+  fBlockIndex = 0;
+  fNBlocks = 0;
+}
+
+bool KFPCandidateReader::ReadWords(const int iBlock, const int iColumn, unsigned int* words, const unsigned int nWords) const
+{
+  /** Decompresses the column "iColumn" of the block "iBlock" to the array "words".
+   ** \param[in] iBlock - index of the block
+   ** \param[in] iColumn - index of the column, see KFPCandidateWriter::Column
+   ** \param[out] words - output array
+   ** \param[in] nWords - size of the output array, should be equal to the number of values in the column
+   ** The index of the column should be checked with KFPCandidateReader::IsValidColumn() before.
+   **/
+  const unsigned int* columnIndex = BlockIndex(iBlock) + 3 + 5*iColumn;
+  const unsigned long long offset = (static_cast<unsigned long long>(columnIndex[1]) << 32) | columnIndex[0];
+  return KFPCandidateWriter::Decode(fData + offset, columnIndex[2], columnIndex[4], nWords, words);
+}
+
+bool KFPCandidateReader::IsValidColumn(const int iBlock, const int iColumn) const
+{
+  /** Checks the index of the column "iColumn" of the block "iBlock" against the mapped file before any memory is
+   ** allocated for it. The compressed data should lie between the header and the footer, the number of values 
+   ** should be consistent with the compressed size: a raw column has 4 bytes per value, with the zero-run 
+   ** encoding one byte of the compressed data gives at most 128 bytes of the byte planes.
+   ** \param[in] iBlock - index of the block
+   ** \param[in] iColumn - index of the column, see KFPCandidateWriter::Column
+   **/
+  if(!IsValidBlock(iBlock) || iColumn < 0 || iColumn >= KFPCandidateWriter::kNColumns) return false;
+  
+  const unsigned int* columnIndex = BlockIndex(iBlock) + 3 + 5*iColumn;
+  const unsigned long long offset = (static_cast<unsigned long long>(columnIndex[1]) << 32) | columnIndex[0];
+  const unsigned long long nBytes = columnIndex[2];
+  const unsigned long long nWords = columnIndex[3];
+  const unsigned long long footerOffset = reinterpret_cast<const unsigned char*>(fBlockIndex) - fData - 8;
+  if(offset < 8 || offset > footerOffset || nBytes > footerOffset - offset) return false;
+  
+  if(columnIndex[4] == KFPCandidateWriter::kRaw)
+    return nBytes == 4*nWords;
+  if(columnIndex[4] == KFPCandidateWriter::kXorPlaneRLE)
+    return 4*nWords <= 128*nBytes;
+  return false;
+}
+
+bool KFPCandidateReader::ReadColumn(const int iBlock, const int iColumn, std::vector<float>& values) const
+{
+  /** Reads the float column "iColumn" of the block "iBlock". Returns false if the indices are out of range or the data are corrupted.
+   ** \param[in] iBlock - index of the block
+   ** \param[in] iColumn - index of the column, see KFPCandidateWriter::Column
+   ** \param[out] values - values of the column
+   **/
+  values.clear();
+  if(!IsValidColumn(iBlock, iColumn)) return false;
+  
+  values.resize(GetNValues(iBlock, iColumn));
+  if(values.empty()) return true;
+  return ReadWords(iBlock, iColumn, reinterpret_cast<unsigned int*>(&values[0]), values.size());
+}
+
+bool KFPCandidateReader::ReadColumn(const int iBlock, const int iColumn, std::vector<int>& values) const
+{
+  /** Reads the integer column "iColumn" of the block "iBlock". Returns false if the indices are out of range or the data are corrupted.
+   ** \param[in] iBlock - index of the block
+   ** \param[in] iColumn - index of the column, see KFPCandidateWriter::Column
+   ** \param[out] values - values of the column
+   **/
+  values.clear();
+  if(!IsValidColumn(iBlock, iColumn)) return false;
+  
+  values.resize(GetNValues(iBlock, iColumn));
+  if(values.empty()) return true;
+  return ReadWords(iBlock, iColumn, reinterpret_cast<unsigned int*>(&values[0]), values.size());
+}
@@ -0,0 +1,80 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KFPCandidateReader_H
+#define KFPCandidateReader_H
+
+#include "KFPCandidateWriter.h"
+
+#include <vector>
+#include <string>
+
+/** @class KFPCandidateReader
+ ** @brief A class to read the columnar files with candidates written by KFPCandidateWriter.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** The file is mapped into memory, only the footer is parsed at opening. Each column of each block is decompressed
+ ** on request, so the candidates can be filtered column by column without reading the full file.
+ ** Indices of the columns are defined by KFPCandidateWriter::Column.
+ **/
+
+class KFPCandidateReader
+{
+ public:
+  KFPCandidateReader(): fData(0), fSize(0), fNColumns(0), fBlockIndex(0), fNBlocks(0) { }
+  ~KFPCandidateReader() { Close(); }
+  
+  bool Open(const std::string& fileName);
+  void Close();
+  
+  bool IsOpen() const { return fData != 0; } ///< Returns true if the file is mapped.
+  int GetNBlocks() const { return fNBlocks; } ///< Returns number of blocks in the file.
+  /** Returns number of candidates in the block "iBlock", -1 if the block does not exist. */
+  int GetNRows(const int iBlock) const { return IsValidBlock(iBlock) ? int(BlockIndex(iBlock)[0]) : -1; }
+  /** Returns index of the first event of the block "iBlock", -1 if the block does not exist. */
+  int GetFirstEvent(const int iBlock) const { return IsValidBlock(iBlock) ? int(BlockIndex(iBlock)[1]) : -1; }
+  /** Returns number of events in the block "iBlock", -1 if the block does not exist. */
+  int GetNEvents(const int iBlock) const { return IsValidBlock(iBlock) ? int(BlockIndex(iBlock)[2]) : -1; }
+  
+  bool ReadColumn(const int iBlock, const int iColumn, std::vector<float>& values) const;
+  bool ReadColumn(const int iBlock, const int iColumn, std::vector<int>& values) const;
+  
+ private:
+  KFPCandidateReader(const KFPCandidateReader&);
+  KFPCandidateReader& operator=(const KFPCandidateReader&);
+  
+  bool IsValidBlock(const int iBlock) const { return IsOpen() && iBlock >= 0 && iBlock < fNBlocks; } ///< Returns true if the block "iBlock" exists.
+  bool IsValidColumn(const int iBlock, const int iColumn) const;
+  /** Returns a pointer to the index of the block "iBlock", see KFPCandidateWriter::fBlockIndex. */
+  const unsigned int* BlockIndex(const int iBlock) const { return fBlockIndex + static_cast<unsigned long long>(iBlock)*(3 + 5ull*fNColumns); }
+  bool ReadWords(const int iBlock, const int iColumn, unsigned int* words, const unsigned int nWords) const;
+  unsigned int GetNValues(const int iBlock, const int iColumn) const { return BlockIndex(iBlock)[3 + 5*iColumn + 3]; } ///< Returns number of values in the column.
+  
+  const unsigned char* fData;     ///< Pointer to the mapped file.
+  unsigned long long fSize;       ///< Size of the mapped file.
+  unsigned int fNColumns;         ///< Number of columns in the file.
+  const unsigned int* fBlockIndex; ///< Pointer to the index of the blocks in the footer.
+  int fNBlocks;                   ///< Number of blocks in the file.
+};
+
+#endif
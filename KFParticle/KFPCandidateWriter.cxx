@@ -0,0 +1,294 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "KFPCandidateWriter.h"
+#include "KFParticle.h"
+
+#include <cstring>
+
+bool KFPCandidateWriter::Open(const std::string& fileName, const int blockSize)
+{
+  /** Opens a new file, if another file is open it is closed first. Returns false if the file can not be opened.
+   ** \param[in] fileName - name of the output file
+   ** \param[in] blockSize - minimal number of candidates in a block, a block always contains complete events
+   **/
+  Close();
+  
+  fFile.open(fileName.data(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!fFile.is_open()) return false;
+  
+  fBlockSize = blockSize;
+  fNEvents = 0;
+  fBlockFirstEvent = 0;
+  fBlockNEvents = 0;
+  fBlockIndex.clear();
+  for(int iColumn=0; iColumn<kNColumns; iColumn++)
+    fColumns[iColumn].clear();
+  
+  const unsigned int header[2] = {fMagic, fVersion};
+  fFile.write(reinterpret_cast<const char*>(header), sizeof(header));
+  fOffset = sizeof(header);
+  return true;
+}
+
+void KFPCandidateWriter::AddValue(const int iColumn, const float value)
+{
+  /** Adds a float value to the column "iColumn", the bit pattern is stored.
+   ** \param[in] iColumn - index of the column
+   ** \param[in] value - value to be stored
+   **/
+  unsigned int word;
+  memcpy(&word, &value, sizeof(float));
+  fColumns[iColumn].push_back(word);
+}
+
+void KFPCandidateWriter::AddEvent(const std::vector<KFParticle>& particles, const std::vector<KFParticle>& primaryVertices, const int firstParticle)
+{
+  /** Adds candidates of one event to the current block. The primary vertex of the candidate is the one with the smallest
+   ** \f$\chi^2\f$-deviation, \f$l/\Delta l\f$ and \f$\chi^2_{topo}/NDF\f$ are calculated with respect to it. If there are no 
+   ** primary vertices, the index of the vertex is set to "-1" and the topological quantities to "0". The block is written
+   ** to the file as soon as it contains at least KFPCandidateWriter::fBlockSize candidates.
+   ** \param[in] particles - output array of the reconstructed particles, for example KFParticleTopoReconstructor::GetParticles()
+   ** \param[in] primaryVertices - primary vertices of the event
+   ** \param[in] firstParticle - index of the first particle to be stored, for example to skip particles formed from tracks
+   **/
+  if(!IsOpen()) return;
+  
+  for(unsigned int iParticle=firstParticle; iParticle<particles.size(); iParticle++)
+  {
+    const KFParticle& particle = particles[iParticle];
+    
+    for(int iP=0; iP<8; iP++)
+      AddValue(kX+iP, particle.GetParameter(iP));
+    for(int iP=0; iP<8; iP++)
+      AddValue(kC00+iP, particle.GetCovariance(iP, iP));
+    AddValue(kChi2, particle.GetChi2());
+    AddValue(kNDF, particle.GetNDF());
+    AddValue(kPDG, particle.GetPDG());
+    
+    int pvIndex = -1;
+    float minDeviation = 0.f;
+    for(unsigned int iPV=0; iPV<primaryVertices.size(); iPV++)
+    {
+      const float deviation = particle.GetDeviationFromVertex(primaryVertices[iPV]);
+      if(pvIndex < 0 || deviation < minDeviation)
+      {
+        pvIndex = iPV;
+        minDeviation = deviation;
+      }
+    }
+    AddValue(kPVIndex, pvIndex);
+    AddValue(kEvent, fNEvents);
+    AddValue(kId, particle.Id());
+    AddValue(kNDaughters, particle.NDaughters());
+    AddValue(kDaughterOffset, int(fColumns[kDaughterIds].size()));
+    for(int iDaughter=0; iDaughter<particle.NDaughters(); iDaughter++)
+      AddValue(kDaughterIds, particle.DaughterIds()[iDaughter]);
+    
+    float mass = 0.f, massError = 0.f;
+    particle.GetMass(mass, massError);
+    AddValue(kMass, mass);
+    AddValue(kMassError, massError);
+    
+    float ldl = 0.f, chi2Topo = 0.f;
+    if(pvIndex >= 0)
+    {
+      KFParticle particleTopo = particle;
+      particleTopo.SetProductionVertex(primaryVertices[pvIndex]);
+      float l = 0.f, dl = 0.f;
+      particleTopo.GetDecayLength(l, dl);
+      if(dl > 0.f) ldl = l/dl;
+      if(particleTopo.GetNDF() > 0) chi2Topo = particleTopo.GetChi2()/float(particleTopo.GetNDF());
+    }
+    AddValue(kLdL, ldl);
+    AddValue(kChi2Topo, chi2Topo);
+  }
+  
+  fNEvents++;
+  fBlockNEvents++;
+  if(int(fColumns[kX].size()) >= fBlockSize)
+    FlushBlock();
+}
+
+void KFPCandidateWriter::FlushBlock()
+{
+  /** Compresses all columns of the current block, writes them to the file and adds the block to the index. */
+  if(fBlockNEvents == 0) return;
+  
+  std::vector<unsigned int> blockIndex;
+  blockIndex.push_back(fColumns[kX].size());
+  blockIndex.push_back(fBlockFirstEvent);
+  blockIndex.push_back(fBlockNEvents);
+  
+  for(int iColumn=0; iColumn<kNColumns; iColumn++)
+  {
+    unsigned int codec = kRaw;
+    Encode(fColumns[iColumn], fBuffer, codec);
+    
+    blockIndex.push_back(static_cast<unsigned int>(fOffset & 0xffffffffu));
+    blockIndex.push_back(static_cast<unsigned int>(fOffset >> 32));
+    blockIndex.push_back(fBuffer.size());
+    blockIndex.push_back(fColumns[iColumn].size());
+    blockIndex.push_back(codec);
+    
+    if(!fBuffer.empty())
+      fFile.write(reinterpret_cast<const char*>(&fBuffer[0]), fBuffer.size());
+    fOffset += fBuffer.size();
+    fColumns[iColumn].clear();
+  }
+  
+  fBlockIndex.push_back(blockIndex);
+  fBlockFirstEvent = fNEvents;
+  fBlockNEvents = 0;
+}
+
+void KFPCandidateWriter::Close()
+{
+  /** Writes the last block and the footer with the index and closes the file. */
+  if(!IsOpen()) return;
+  
+  FlushBlock();
+  
+  //the footer is aligned to 4 bytes, so it can be accessed directly in the mapped file
+  const char padding[4] = {0, 0, 0, 0};
+  const int nPaddingBytes = (4 - fOffset % 4) % 4;
+  fFile.write(padding, nPaddingBytes);
+  fOffset += nPaddingBytes;
+  
+  const unsigned long long footerOffset = fOffset;
+  const unsigned int footerHeader[2] = {kNColumns, static_cast<unsigned int>(fBlockIndex.size())};
+  fFile.write(reinterpret_cast<const char*>(footerHeader), sizeof(footerHeader));
+  for(unsigned int iBlock=0; iBlock<fBlockIndex.size(); iBlock++)
+    fFile.write(reinterpret_cast<const char*>(&fBlockIndex[iBlock][0]), fBlockIndex[iBlock].size()*sizeof(unsigned int));
+  
+  const unsigned int trailer[3] = { static_cast<unsigned int>(footerOffset & 0xffffffffu), static_cast<unsigned int>(footerOffset >> 32), fMagic };
+  fFile.write(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+  fFile.close();
+  fBlockIndex.clear();
+}
+
+void KFPCandidateWriter::Encode(const std::vector<unsigned int>& words, std::vector<unsigned char>& bytes, unsigned int& codec)
+{
+  /** Compresses a column. Each word is XOR-ed with the previous one, so repeating values, like PDG or event number,
+   ** become zero, and close floating point values get zero high bytes. Then bytes are transposed into 4 planes, which
+   ** groups zeros together, and encoded: a control byte below 128 is followed by "control+1" literal bytes, a control byte "c"
+   ** not below 128 stands for "c-127" zero bytes. If the compression does not reduce the size, the column is stored as is.
+   ** \param[in] words - values of the column
+   ** \param[out] bytes - compressed data
+   ** \param[out] codec - codec of the compressed data, see KFPCandidateWriter::Codec
+   **/
+  const unsigned int nWords = words.size();
+  const unsigned int nBytes = 4*nWords;
+  
+  std::vector<unsigned char> planes(nBytes);
+  unsigned int previous = 0;
+  for(unsigned int iWord=0; iWord<nWords; iWord++)
+  {
+    const unsigned int word = words[iWord] ^ previous;
+    previous = words[iWord];
+    for(int iPlane=0; iPlane<4; iPlane++)
+      planes[iPlane*nWords + iWord] = (word >> (8*iPlane)) & 0xff;
+  }
+  
+  bytes.clear();
+  unsigned int iByte = 0;
+  while(iByte < nBytes && bytes.size() < nBytes)
+  {
+    unsigned int runLength = 0;
+    if(planes[iByte] == 0)
+    {
+      while(iByte+runLength < nBytes && runLength < 128 && planes[iByte+runLength] == 0)
+        runLength++;
+      bytes.push_back(static_cast<unsigned char>(127 + runLength));
+    }
+    else
+    {
+      while(iByte+runLength < nBytes && runLength < 128 && planes[iByte+runLength] != 0)
+        runLength++;
+      bytes.push_back(static_cast<unsigned char>(runLength - 1));
+      bytes.insert(bytes.end(), planes.begin() + iByte, planes.begin() + iByte + runLength);
+    }
+    iByte += runLength;
+  }
+  
+  codec = kXorPlaneRLE;
+  if(bytes.size() >= nBytes)
+  {
+    codec = kRaw;
+    bytes.resize(nBytes);
+    if(nBytes > 0)
+      memcpy(&bytes[0], &words[0], nBytes);
+  }
+}
+
+bool KFPCandidateWriter::Decode(const unsigned char* bytes, const unsigned int nBytes, const unsigned int codec, 
+                                const unsigned int nWords, unsigned int* words)
+{
+  /** Decompresses a column, see KFPCandidateWriter::Encode(). Returns false if the data are corrupted.
+   ** \param[in] bytes - pointer to the compressed data
+   ** \param[in] nBytes - size of the compressed data
+   ** \param[in] codec - codec of the compressed data, see KFPCandidateWriter::Codec
+   ** \param[in] nWords - number of values in the column
+   ** \param[out] words - pointer to the output array with at least "nWords" elements
+   **/
+  if(codec == kRaw)
+  {
+    if(nBytes != 4ull*nWords) return false;
+    if(nBytes > 0)
+      memcpy(words, bytes, nBytes);
+    return true;
+  }
+  if(codec != kXorPlaneRLE) return false;
+  
+  std::vector<unsigned char> planes(4ull*nWords);
+  unsigned long long iOut = 0;
+  for(unsigned int iByte=0; iByte<nBytes; )
+  {
+    const unsigned int control = bytes[iByte++];
+    if(control >= 128)
+    {
+      const unsigned int runLength = control - 127;
+      if(iOut + runLength > planes.size()) return false;
+      for(unsigned int i=0; i<runLength; i++)
+        planes[iOut++] = 0;
+    }
+    else
+    {
+      const unsigned int runLength = control + 1;
+      if(iOut + runLength > planes.size() || iByte + runLength > nBytes) return false;
+      memcpy(&planes[iOut], bytes + iByte, runLength);
+      iOut += runLength;
+      iByte += runLength;
+    }
+  }
+  if(iOut != planes.size()) return false;
+  
+  unsigned int previous = 0;
+  for(unsigned int iWord=0; iWord<nWords; iWord++)
+  {
+    unsigned int word = 0;
+    for(int iPlane=0; iPlane<4; iPlane++)
+      word |= static_cast<unsigned int>(planes[iPlane*nWords + iWord]) << (8*iPlane);
+    previous ^= word;
+    words[iWord] = previous;
+  }
+  return true;
+}
@@ -0,0 +1,112 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KFPCandidateWriter_H
+#define KFPCandidateWriter_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+
+class KFParticle;
+
+/** @class KFPCandidateWriter
+ ** @brief A class to write the reconstructed candidates to a columnar binary file.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** Candidates of many events are collected into blocks, each column of a block is compressed separately and written
+ ** to the file when the block is full. The columns contain the parameters, the diagonal elements of the covariance
+ ** matrix, chi2, NDF, PDG, index of the primary vertex, Id, the offsets and indices of daughters, and the derived 
+ ** quantities: mass, its error, \f$l/\Delta l\f$ and \f$\chi^2_{topo}/NDF\f$ with respect to the primary vertex.
+ ** The footer at the end of the file contains the index of all blocks and columns, so a single column of a 
+ ** single block can be read without touching the rest of the file, see KFPCandidateReader. \n
+ ** The file layout is: magic number and version; compressed columns of all blocks; footer with the number
+ ** of columns and blocks and for each block the number of rows, first event, number of events and for each column the offset, 
+ ** compressed size, number of values and the codec; offset of the footer and the magic number. \n
+ ** Each column is stored as 32-bit words. The compression is lossless: each word is XOR-ed with the previous one,
+ ** the bytes are transposed into planes and the runs of zero bytes are encoded.
+ **/
+
+class KFPCandidateWriter
+{
+ public:
+  
+  /** Columns of the file. */
+  enum Column
+  {
+    kX = 0, kY, kZ, kPx, kPy, kPz, kE, kS,      ///< parameters of the candidate
+    kC00, kC11, kC22, kC33, kC44, kC55, kC66, kC77, ///< diagonal elements of the covariance matrix
+    kChi2, kNDF, kPDG, kPVIndex, kEvent, kId,
+    kNDaughters, kDaughterOffset,               ///< number of daughters and the offset in the column KFPCandidateWriter::kDaughterIds
+    kMass, kMassError, kLdL, kChi2Topo,         ///< derived quantities
+    kDaughterIds,                               ///< indices of daughters of all candidates in the block
+    kNColumns
+  };
+  
+  /** Codecs of the compressed columns. */
+  enum Codec
+  {
+    kRaw = 0,    ///< not compressed
+    kXorPlaneRLE ///< XOR with the previous word, transposition into byte planes, zero-run encoding
+  };
+  
+  static const unsigned int fMagic = 0x4350464b;   ///< Magic number "KFPC".
+  static const unsigned int fVersion = 1;          ///< Version of the format.
+  
+  KFPCandidateWriter(): fFile(), fBlockSize(16384), fNEvents(0), fBlockFirstEvent(0), fBlockNEvents(0), fOffset(0), fBlockIndex() { }
+  ~KFPCandidateWriter() { Close(); }
+  
+  bool Open(const std::string& fileName, const int blockSize = 16384);
+  void AddEvent(const std::vector<KFParticle>& particles, const std::vector<KFParticle>& primaryVertices, const int firstParticle = 0);
+  void Close();
+  
+  bool IsOpen() const { return fFile.is_open(); } ///< Returns true if the file is open.
+  int GetNEvents() const { return fNEvents; } ///< Returns number of written events.
+  int GetNBlocks() const { return fBlockIndex.size(); } ///< Returns number of the written blocks.
+  
+  static void Encode(const std::vector<unsigned int>& words, std::vector<unsigned char>& bytes, unsigned int& codec);
+  static bool Decode(const unsigned char* bytes, const unsigned int nBytes, const unsigned int codec, 
+                     const unsigned int nWords, unsigned int* words);
+  
+ private:
+  KFPCandidateWriter(const KFPCandidateWriter&);
+  KFPCandidateWriter& operator=(const KFPCandidateWriter&);
+  
+  void FlushBlock();
+  void AddValue(const int iColumn, const float value);
+  void AddValue(const int iColumn, const int value) { fColumns[iColumn].push_back(static_cast<unsigned int>(value)); } ///< Adds an integer to the column "iColumn".
+  
+  std::ofstream fFile;  ///< Output file.
+  int fBlockSize;       ///< Number of candidates in a block.
+  int fNEvents;         ///< Number of written events.
+  int fBlockFirstEvent; ///< Index of the first event of the current block.
+  int fBlockNEvents;    ///< Number of events in the current block.
+  unsigned long long fOffset; ///< Current offset in the file.
+  std::vector<unsigned int> fColumns[kNColumns]; ///< Columns of the current block.
+  std::vector<unsigned char> fBuffer; ///< Buffer for the compressed column.
+  /** Index of the written blocks: number of rows, first event, number of events, and for each column
+   ** low and high words of the offset, compressed size, number of values and codec. */
+  std::vector< std::vector<unsigned int> > fBlockIndex;
+};
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "KFPCovarianceCodec.h"
+
+const float KFPCovarianceCodec::fMinPivot = 1.e-6f;
+
+void KFPCovarianceCodec::Encode(const float_v* C, unsigned short* code, const int nMatrices)
+{
+  /** Encodes SIMD vector of covariance matrices, see the description of the class.
+   ** \param[in] C - covariance matrices in the lower triangular form, 36 elements
+   ** \param[out] code - output array with at least 36*nMatrices words
+   ** \param[in] nMatrices - number of matrices to be stored, the first lanes of the SIMD vectors are used
+   **/
+  float_v sigma[8], invSigma[8];
+  int_v sigmaCode[8];
+  for(int i=0; i<8; i++)
+  {
+    sigma[i] = sqrt(max(C[i*(i+3)/2], float_v(Vc::Zero)));
+    const float_m isValid = (sigma[i] > 1.e-30f);
+    invSigma[i] = 0.f;
+    invSigma[i](isValid) = 1.f/sigma[i];
+    
+    const float_v logSigma = Vc::log(max(sigma[i], float_v(1.e-30f))) * 1.442695041f;
+    float_v quantised = round( (logSigma + 32.f) * 1024.f );
+    quantised = min( max(quantised, float_v(1.f)), float_v(65535.f) );
+    sigmaCode[i] = simd_cast<int_v>(quantised);
+    sigmaCode[i]( !simd_cast<int_m>(isValid) ) = 0;
+  }
+  
+  //Cholesky decomposition of the correlation matrix, rows of zero sigma are set to the unit vectors
+  float_v G[36];
+  for(int i=0; i<8; i++)
+  {
+    const float_m isValidRow = (invSigma[i] > 0.f);
+    for(int j=0; j<i; j++)
+    {
+      float_v s = C[i*(i+1)/2+j] * invSigma[i] * invSigma[j];
+      for(int k=0; k<j; k++)
+        s -= G[i*(i+1)/2+k] * G[j*(j+1)/2+k];
+      const float_v& pivot = G[j*(j+1)/2+j];
+      G[i*(i+1)/2+j] = 0.f;
+      G[i*(i+1)/2+j]( isValidRow && (pivot > 0.f) ) = s/pivot;
+      G[i*(i+1)/2+j] = min( max(G[i*(i+1)/2+j], float_v(-1.f)), float_v(1.f) );
+    }
+    float_v s(1.f);
+    for(int k=0; k<i; k++)
+      s -= G[i*(i+1)/2+k] * G[i*(i+1)/2+k];
+    G[i*(i+1)/2+i] = sqrt(max(s, float_v(Vc::Zero)));
+  }
+  
+  int_v offDiagonalCode[28];
+  for(int i=1, iCode=0; i<8; i++)
+    for(int j=0; j<i; j++, iCode++)
+      offDiagonalCode[iCode] = simd_cast<int_v>( round(G[i*(i+1)/2+j] * 32767.f) ) & 0xffff;
+  
+  for(int iV=0; iV<nMatrices; iV++)
+  {
+    unsigned short* matrixCode = code + iV*fNWords;
+    for(int i=0; i<8; i++)
+      matrixCode[i] = sigmaCode[i][iV];
+    for(int iCode=0; iCode<28; iCode++)
+      matrixCode[8+iCode] = offDiagonalCode[iCode][iV];
+  }
+}
+
+void KFPCovarianceCodec::Decode(const unsigned short* code, float_v* C, const int nMatrices)
+{
+  /** Decodes SIMD vector of covariance matrices, see the description of the class. Lanes above "nMatrices" are set to zero.
+   ** \param[in] code - array with 36*nMatrices words
+   ** \param[out] C - covariance matrices in the lower triangular form, 36 elements
+   ** \param[in] nMatrices - number of matrices to be decoded
+   **/
+  int_v sigmaCode[8], offDiagonalCode[28];
+  for(int i=0; i<8; i++)
+    sigmaCode[i] = 0;
+  for(int iCode=0; iCode<28; iCode++)
+    offDiagonalCode[iCode] = 0;
+  for(int iV=0; iV<nMatrices; iV++)
+  {
+    const unsigned short* matrixCode = code + iV*fNWords;
+    for(int i=0; i<8; i++)
+      sigmaCode[i][iV] = matrixCode[i];
+    for(int iCode=0; iCode<28; iCode++)
+      offDiagonalCode[iCode][iV] = static_cast<short>(matrixCode[8+iCode]);
+  }
+  
+  float_v sigma[8];
+  for(int i=0; i<8; i++)
+  {
+    sigma[i] = Vc::exp( (simd_cast<float_v>(sigmaCode[i]) * (1.f/1024.f) - 32.f) * 0.6931471806f );
+    sigma[i]( simd_cast<float_m>(sigmaCode[i] == 0) ) = 0.f;
+  }
+  
+  float_v G[36];
+  for(int i=0, iCode=0; i<8; i++)
+  {
+    float_v s(Vc::Zero);
+    for(int j=0; j<i; j++, iCode++)
+    {
+      G[i*(i+1)/2+j] = simd_cast<float_v>(offDiagonalCode[iCode]) * (1.f/32767.f);
+      s += G[i*(i+1)/2+j] * G[i*(i+1)/2+j];
+    }
+    //the diagonal element should not be smaller than sqrt(fMinPivot), otherwise the row is scaled down
+    const float_m isSaturated = (s > 1.f - fMinPivot);
+    if(!isSaturated.isEmpty())
+    {
+      float_v scale(1.f);
+      scale(isSaturated) = sqrt( (1.f - fMinPivot) / s );
+      for(int j=0; j<i; j++)
+        G[i*(i+1)/2+j] *= scale;
+      s(isSaturated) = 1.f - fMinPivot;
+    }
+    G[i*(i+1)/2+i] = sqrt(1.f - s);
+  }
+  
+  for(int i=0; i<8; i++)
+  {
+    for(int j=0; j<=i; j++)
+    {
+      float_v r(Vc::Zero);
+      for(int k=0; k<=j; k++)
+        r += G[i*(i+1)/2+k] * G[j*(j+1)/2+k];
+      C[i*(i+1)/2+j] = sigma[i] * sigma[j] * r;
+    }
+  }
+}
+
+void KFPCovarianceCodec::Encode(const float* C, unsigned short* code)
+{
+  /** Encodes a single covariance matrix with the SIMD kernel.
+   ** \param[in] C - covariance matrix in the lower triangular form, 36 elements
+   ** \param[out] code - output array with 36 words
+   **/
+  float_v CSIMD[36];
+  for(int iC=0; iC<36; iC++)
+    CSIMD[iC] = C[iC];
+  Encode(CSIMD, code, 1);
+}
+
+void KFPCovarianceCodec::Decode(const unsigned short* code, float* C)
+{
+  /** Decodes a single covariance matrix with the SIMD kernel.
+   ** \param[in] code - array with 36 words
+   ** \param[out] C - covariance matrix in the lower triangular form, 36 elements
+   **/
+  float_v CSIMD[36];
+  Decode(code, CSIMD, 1);
+  for(int iC=0; iC<36; iC++)
+    C[iC] = CSIMD[iC][0];
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KFPCovarianceCodec_H
+#define KFPCovarianceCodec_H
+
+#include "KFParticleDef.h"
+
+/** @class KFPCovarianceCodec
+ ** @brief A class to encode the covariance matrix of the particle into 16-bit words for storage and transfer.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** The covariance matrix C of 8 parameters { X, Y, Z, Px, Py, Pz, E, S } is factorised as C = D G G^T D, where D is
+ ** the diagonal matrix of sigmas and G is the Cholesky factor of the correlation matrix: lower triangular with unit
+ ** norm of each row. 36 words are stored instead of 36 floats: \n
+ ** 1) words 0-7: \f$\log_2\sigma_i\f$ in the range [-32, 32) with the step 1/1024, "0" stands for zero sigma. 
+ ** The relative error of the decoded sigma is below \f$2^{1/2048}-1 = 3.4\cdot10^{-4}\f$; \n
+ ** 2) words 8-35: off-diagonal elements of G row by row as signed 16-bit numbers with the step 1/32767. 
+ ** The diagonal elements are restored from the unit norm of the rows. The absolute error of the decoded correlation
+ ** coefficients is about \f$10^{-4}\f$ for matrices, which are well defined in the float precision. \n
+ ** Since the decoded matrix is constructed as a product of a triangular factor with a positive diagonal
+ ** with its transpose, it is positive-definite if all sigmas are not zero: the diagonal elements of G are limited 
+ ** from below by KFPCovarianceCodec::fMinPivot. Only matrices, which are close to singular already in the float
+ ** precision, can loose this property due to rounding. Matrices with zero sigma are decoded as positive semi-definite. \n
+ ** The kernels process float_vLen matrices at once, codes are stored as 36 consecutive words for each matrix.
+ **/
+
+class KFPCovarianceCodec
+{
+ public:
+  static const int fNWords = 36; ///< Number of 16-bit words per matrix.
+  
+  static void Encode(const float_v* C, unsigned short* code, const int nMatrices = float_vLen);
+  static void Decode(const unsigned short* code, float_v* C, const int nMatrices = float_vLen);
+  
+  static void Encode(const float* C, unsigned short* code);
+  static void Decode(const unsigned short* code, float* C);
+  
+ private:
+  static const float fMinPivot; ///< Lower limit of the squared diagonal element of the Cholesky factor of the correlation matrix.
+};
+
+#endif
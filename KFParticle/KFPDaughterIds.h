@@ -0,0 +1,89 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KFPDaughterIds_H
+#define KFPDaughterIds_H
+
+#include <vector>
+
+/** @class KFPDaughterIds
+ ** @brief A container of the indices of daughter particles with the inline storage.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** Up to KFPDaughterIds::fNInlineIds indices are stored inside the object, which covers particles created
+ ** from tracks and almost all decays. Copying of such objects does not allocate memory. If more indices are
+ ** added all of them are moved to the vector on the heap. The interface repeats the used part of std::vector.
+ **/
+
+class KFPDaughterIds
+{
+ public:
+  KFPDaughterIds(): fSize(0), fHeapIds()
+  {
+    for(int i=0; i<fNInlineIds; i++)
+      fInlineIds[i] = -1;
+  }
+
+  unsigned int size() const { return fSize; } ///< Returns number of stored indices.
+  bool empty() const { return fSize == 0; } ///< Returns true if no indices are stored.
+  /** Returns true if the indices are stored inside the object without the heap allocation. */
+  bool IsInline() const { return fSize <= fNInlineIds; }
+
+  const int& operator[](const unsigned int i) const { return IsInline() ? fInlineIds[i] : fHeapIds[i]; } ///< Returns index "i".
+  int& operator[](const unsigned int i) { return IsInline() ? fInlineIds[i] : fHeapIds[i]; } ///< Returns reference to index "i".
+
+  const int* begin() const { return IsInline() ? fInlineIds : &fHeapIds[0]; } ///< Returns a pointer to the first index.
+  const int* end() const { return begin() + fSize; } ///< Returns a pointer behind the last index.
+
+  void clear()
+  {
+    /** Removes all indices. The memory on the heap, if was allocated, is kept for reuse. */
+    fSize = 0;
+    fHeapIds.clear();
+  }
+
+  void push_back(const int id)
+  {
+    /** Adds index "id". If the inline storage is full, all indices are moved to the heap.
+     ** \param[in] id - index to be added
+     **/
+    if(fSize < fNInlineIds)
+      fInlineIds[fSize] = id;
+    else
+    {
+      if(fSize == fNInlineIds)
+        fHeapIds.assign(fInlineIds, fInlineIds + fNInlineIds);
+      fHeapIds.push_back(id);
+    }
+    fSize++;
+  }
+
+  static const int fNInlineIds = 4; ///< Number of indices stored inside the object.
+
+ private:
+  int fInlineIds[fNInlineIds]; ///< Inline storage of the indices, is used if KFPDaughterIds::fSize is not larger than KFPDaughterIds::fNInlineIds.
+  unsigned int fSize;          ///< Number of stored indices.
+  std::vector<int> fHeapIds;   ///< Storage of the indices on the heap, is used only if KFPDaughterIds::fSize exceeds KFPDaughterIds::fNInlineIds.
+};
+
+#endif
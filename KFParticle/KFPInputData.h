@@ -150,6 +150,7 @@ class KFPInputData
       {
         ifile >> tmpInt;
         fTracks[iSet].SetPVIndex(tmpInt, iTr);
+        fTracks[iSet].SetPIDMask(0, iTr);
       }
       
       ifile >> tmpInt;
@@ -180,16 +181,23 @@ class KFPInputData
     return 1;
   }
   
+  int DataSize() const
+  {
+    /** Returns size of the memory in "int" (or bloks of 4 bytes, or 32 bits) required by KFPInputData::SetDataToVector(). */
+    int dataSize = NInputSets + 1 + 1; //sizes of the track vectors and pv vector, and field
+    for(int iSet=0; iSet<NInputSets; iSet++)
+      dataSize += fTracks[iSet].DataSize();
+    dataSize += fPV.size() * 9;
+    return dataSize;
+  }
+  
   void SetDataToVector(int* data, int& dataSize)
   {
     /** Stores information to the memory under pointer "data".
      ** \param[out] data - memory, where input information will be stored
      ** \param[out] dataSize - size of the stored memory in "int" (or bloks of 4 bytes, or 32 bits)
      **/
-    dataSize = NInputSets + 1 + 1; //sizes of the track vectors and pv vector, and field
-    for(int iSet=0; iSet<NInputSets; iSet++)
-      dataSize += fTracks[iSet].DataSize();
-    dataSize += fPV.size() * 9;
+    dataSize = DataSize();
         
     for(int iSet=0; iSet<NInputSets; iSet++)
       data[iSet] = fTracks[iSet].Size();
@@ -224,11 +232,29 @@ class KFPInputData
     }    
   }
 
-  void ReadDataFromVector(int* data)
+  bool ReadDataFromVector(int* data, const int dataSize = -1)
   {
-    /** Reads input data from the given memory.
+    /** Reads input data from the given memory. The layout is checked before the data are copied: returns "false" and does not
+     ** change the object if the track vectors were not written in the current format (see KFPTrackVector::DataFormatVersion())
+     ** or the stored data do not fit into "dataSize" words.
      ** \param[in] data - pointer to the memory with the input data
+     ** \param[in] dataSize - size of the memory in "int" (or bloks of 4 bytes, or 32 bits), "-1" if it is not known
      **/
+    if(dataSize >= 0 && dataSize < NInputSets+2) return false;
+    const int wordsPerTrack = KFPTrackVector::DataSize(1) - KFPTrackVector::DataSize(0);
+    long storedSize = NInputSets+2;
+    for(int iSet=0; iSet<NInputSets; iSet++)
+    {
+      if(data[iSet] < 0) return false;
+      if(dataSize >= 0 && data[iSet] > dataSize/wordsPerTrack) return false;
+      if(dataSize >= 0 && storedSize >= dataSize) return false;
+      if(data[storedSize] != KFPTrackVector::DataFormatVersion()) return false;
+      storedSize += KFPTrackVector::DataSize(data[iSet]);
+    }
+    if(data[NInputSets] < 0) return false;
+    storedSize += long(data[NInputSets]) * 9;
+    if(dataSize >= 0 && storedSize > dataSize) return false;
+    
     int offset = NInputSets+2;
     for(int iSet=0; iSet<NInputSets; iSet++)
     {
@@ -259,7 +285,8 @@ class KFPInputData
         fPV[iPV].Covariance(iC) = tmpFloat;
       }
       offset += fPV.size();
-    }        
+    }
+    return true;
   }
   
   void Print()
@@ -0,0 +1,178 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "KFPInputDataPrefetcher.h"
+
+#include <cstdio>
+
+bool KFPTextInputDataSource::ReadEvent(KFPInputData& data)
+{
+  /** Reads the next event from the file "prefix/event#_KFPTracks.data".
+   ** \param[out] data - input data of the event
+   **/
+  if(fNEvents >= 0 && fIEvent >= fNEvents) return false;
+  
+  //sets, which are not present in the file, should not keep tracks of the previous event in the slot
+  for(int iSet=0; iSet<NInputSets; iSet++)
+    data.GetTracks()[iSet].Resize(0);
+  
+  char fileName[32];
+  sprintf(fileName, "/event%d_KFPTracks.data", fIEvent);
+  if(!data.ReadDataFromFile(fPrefix + fileName)) return false;
+  fIEvent++;
+  return true;
+}
+
+bool KFPBinaryInputDataSource::ReadEvent(KFPInputData& data)
+{
+  /** Reads the next event from the binary file.
+   ** \param[out] data - input data of the event
+   **/
+  int dataSize = 0;
+  if(!fFile.read(reinterpret_cast<char*>(&dataSize), sizeof(int)) || dataSize <= 0) return false;
+  
+  if(int(fBuffer.size()) < dataSize)
+    fBuffer.resize(dataSize);
+  if(!fFile.read(reinterpret_cast<char*>(&fBuffer[0]), dataSize*sizeof(int))) return false;
+  
+  return data.ReadDataFromVector(&fBuffer[0], dataSize);
+}
+
+bool KFPBinaryInputDataSource::WriteEvent(std::ostream& out, KFPInputData& data)
+{
+  /** Writes the event in the binary format read by KFPBinaryInputDataSource::ReadEvent().
+   ** \param[in] out - output stream, should be opened in the binary mode
+   ** \param[in] data - input data of the event
+   **/
+  std::vector<int> buffer(data.DataSize());
+  int dataSize = 0;
+  data.SetDataToVector(&buffer[0], dataSize);
+  out.write(reinterpret_cast<const char*>(&dataSize), sizeof(int));
+  out.write(reinterpret_cast<const char*>(&buffer[0]), dataSize*sizeof(int));
+  return out.good();
+}
+
+bool KFPInputDataPrefetcher::Start(KFPInputDataSource* source, const int nSlots)
+{
+  /** Allocates the slots and starts the background thread, which reads events from the source. 
+   ** \param[in] source - source of events, should stay alive until the prefetcher is stopped
+   ** \param[in] nSlots - number of slots, defines the maximum number of events kept in memory
+   **/
+  Stop();
+  if(!source || nSlots <= 0) return false;
+  
+  if(fNSlots != nSlots)
+  {
+    if(fSlots.fInput) delete [] fSlots.fInput;
+    fSlots.fInput = new KFPInputData[nSlots];
+    fNSlots = nSlots;
+  }
+  fSlotStatus.assign(nSlots, kFree);
+  fSlotEvent.assign(nSlots, -1);
+  fSource = source;
+  fIWrite = 0;
+  fIRead = 0;
+  fIsFinished = false;
+  fIsStopped = false;
+  
+  fThread = std::thread(&KFPInputDataPrefetcher::Run, this);
+  return true;
+}
+
+void KFPInputDataPrefetcher::Stop()
+{
+  /** Stops the background thread. Events, which are not yet taken, are discarded. */
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fIsStopped = true;
+  }
+  fSlotFree.notify_all();
+  fSlotReady.notify_all();
+  if(fThread.joinable())
+    fThread.join();
+  fIsFinished = true;
+  fSource = 0;
+}
+
+void KFPInputDataPrefetcher::Run()
+{
+  /** Loop of the background thread: waits for the next slot in the ring to be released, fills it from the source
+   ** and marks it as ready. The source is read without the lock, so reconstruction threads are not blocked by I/O. */
+  while(true)
+  {
+    int iSlot = 0;
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      while(!fIsStopped && fSlotStatus[fIWrite % fNSlots] != kFree)
+        fSlotFree.wait(lock);
+      if(fIsStopped) break;
+      iSlot = fIWrite % fNSlots;
+    }
+    
+    const bool isRead = fSource->ReadEvent(fSlots.fInput[iSlot]);
+    
+    {
+      std::unique_lock<std::mutex> lock(fMutex);
+      if(!isRead)
+        fIsFinished = true;
+      else
+      {
+        fSlotStatus[iSlot] = kReady;
+        fSlotEvent[iSlot] = fIWrite;
+        fIWrite++;
+      }
+    }
+    fSlotReady.notify_all();
+    if(!isRead) break;
+  }
+}
+
+KFPInputData* KFPInputDataPrefetcher::GetNextEvent(int& iEvent)
+{
+  /** Returns the next event in the input order, waits if it is not read yet. Returns 0 if the input is finished or 
+   ** the prefetcher is stopped. The slot should be returned with KFPInputDataPrefetcher::ReleaseEvent().
+   ** \param[out] iEvent - index of the event in the input
+   **/
+  std::unique_lock<std::mutex> lock(fMutex);
+  while(!fIsStopped && !fIsFinished && fIRead == fIWrite)
+    fSlotReady.wait(lock);
+  if(fIsStopped || fIRead == fIWrite) return 0;
+  
+  const int iSlot = fIRead % fNSlots;
+  fSlotStatus[iSlot] = kInUse;
+  iEvent = fSlotEvent[iSlot];
+  fIRead++;
+  return &fSlots.fInput[iSlot];
+}
+
+void KFPInputDataPrefetcher::ReleaseEvent(const KFPInputData* data)
+{
+  /** Returns the slot to the ring, so the background thread can fill it with the next event.
+   ** \param[in] data - pointer obtained with KFPInputDataPrefetcher::GetNextEvent()
+   **/
+  const int iSlot = data - fSlots.fInput;
+  if(iSlot < 0 || iSlot >= fNSlots) return;
+  {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fSlotStatus[iSlot] = kFree;
+  }
+  fSlotFree.notify_one();
+}
@@ -0,0 +1,150 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KFPInputDataPrefetcher_H
+#define KFPInputDataPrefetcher_H
+
+#include "KFPInputData.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** @class KFPInputDataSource
+ ** @brief Interface of the sequential source of events for KFPInputDataPrefetcher.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** Any format can be streamed by KFPInputDataPrefetcher by implementing KFPInputDataSource::ReadEvent().
+ ** The function is called only from the thread of the prefetcher.
+ **/
+
+class KFPInputDataSource
+{
+ public:
+  KFPInputDataSource() { }
+  virtual ~KFPInputDataSource() { }
+  /** Reads the next event into "data", which is a preallocated slot of the prefetcher. Returns false at the end of the input. */
+  virtual bool ReadEvent(KFPInputData& data) = 0;
+};
+
+/** @class KFPTextInputDataSource
+ ** @brief Source of events in the text format written by KFParticleTopoReconstructor::SaveInputParticles().
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** Events are read from the files "prefix/event#_KFPTracks.data" with KFPInputData::ReadDataFromFile(), 
+ ** the input ends at the first missing file or after the requested number of events.
+ **/
+
+class KFPTextInputDataSource: public KFPInputDataSource
+{
+ public:
+  KFPTextInputDataSource(const std::string& prefix, const int nEvents = -1): fPrefix(prefix), fNEvents(nEvents), fIEvent(0) { }
+  bool ReadEvent(KFPInputData& data);
+  
+ private:
+  std::string fPrefix; ///< Path to the folder with the input files.
+  int fNEvents;        ///< Maximum number of events to be read, negative value means all available events.
+  int fIEvent;         ///< Index of the next event.
+};
+
+/** @class KFPBinaryInputDataSource
+ ** @brief Source of events in the binary format.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** Each event is stored as its size in words of 4 bytes followed by the data in the flat layout of 
+ ** KFPInputData::SetDataToVector(). Files are written with KFPBinaryInputDataSource::WriteEvent().
+ **/
+
+class KFPBinaryInputDataSource: public KFPInputDataSource
+{
+ public:
+  KFPBinaryInputDataSource(const std::string& fileName): fFile(fileName.data(), std::ios::in | std::ios::binary), fBuffer() { }
+  bool IsOpen() const { return fFile.is_open(); } ///< Returns true if the input file is opened.
+  bool ReadEvent(KFPInputData& data);
+  
+  static bool WriteEvent(std::ostream& out, KFPInputData& data);
+  
+ private:
+  std::ifstream fFile;      ///< Input file.
+  std::vector<int> fBuffer; ///< Buffer for the flat data of one event, is reused between events.
+};
+
+/** @class KFPInputDataPrefetcher
+ ** @brief Reads events on a background thread into a ring of preallocated slots.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** The slots are stored in KFPInputDataArray, so they are aligned to the size of float_v, and the vectors
+ ** inside the slots keep their memory between events. The background thread fills the slots in the ring order
+ ** and waits if the next slot is still in use (backpressure), so at most KFPInputDataPrefetcher::fNSlots events are
+ ** kept in memory. Reconstruction threads take events in the input order with KFPInputDataPrefetcher::GetNextEvent()
+ ** and return the slot with KFPInputDataPrefetcher::ReleaseEvent() after the event is processed. Several
+ ** reconstruction threads can take events concurrently.
+ **/
+
+class KFPInputDataPrefetcher
+{
+ public:
+  KFPInputDataPrefetcher(): fSlots(), fSlotStatus(), fSlotEvent(), fNSlots(0), fSource(0), fThread(), fMutex(),
+                            fSlotReady(), fSlotFree(), fIWrite(0), fIRead(0), fIsFinished(true), fIsStopped(false) { }
+  ~KFPInputDataPrefetcher() { Stop(); }
+  
+  bool Start(KFPInputDataSource* source, const int nSlots = 4);
+  void Stop();
+  
+  KFPInputData* GetNextEvent(int& iEvent);
+  void ReleaseEvent(const KFPInputData* data);
+  
+ private:
+  KFPInputDataPrefetcher(const KFPInputDataPrefetcher&);
+  KFPInputDataPrefetcher& operator=(const KFPInputDataPrefetcher&);
+  
+  /** Status of a slot. */
+  enum SlotStatus { kFree, kReady, kInUse };
+  
+  void Run();
+  
+  KFPInputDataArray fSlots;          ///< Preallocated slots with the input data.
+  std::vector<int> fSlotStatus;      ///< Status of each slot, see KFPInputDataPrefetcher::SlotStatus.
+  std::vector<int> fSlotEvent;       ///< Index of the event stored in each slot.
+  int fNSlots;                       ///< Number of slots.
+  KFPInputDataSource* fSource;       ///< Source of events, is not owned by the prefetcher.
+  std::thread fThread;               ///< Background thread, which reads events.
+  std::mutex fMutex;                 ///< Mutex to protect the status of the slots and the counters.
+  std::condition_variable fSlotReady; ///< Is notified when a slot is filled or the input is finished.
+  std::condition_variable fSlotFree;  ///< Is notified when a slot is released or the prefetcher is stopped.
+  int fIWrite;                       ///< Number of events read by the background thread.
+  int fIRead;                        ///< Number of events taken by the reconstruction threads.
+  bool fIsFinished;                  ///< Shows if the input is finished.
+  bool fIsStopped;                   ///< Shows if the prefetcher is stopped.
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "KFPParticleVector.h"
+#include "KFParticle.h"
+
+void KFPParticleVector::Resize(const int n)
+{
+  /** Resizes all vectors in the class to a given value. New daughter indices are set to "-1".
+   ** \param[in] n - new size of the vector
+   **/
+  for(int i=0; i<8; i++)
+    fP[i].resize(n);
+  for(int i=0; i<36; i++)
+    fC[i].resize(n);
+#ifdef NonhomogeneousField
+  for(int i=0; i<10; i++)
+    fField[i].resize(n);
+#endif
+  fId.resize(n);
+  fPDG.resize(n);
+  fQ.resize(n);
+  fNDF.resize(n);
+  fChi2.resize(n);
+  fAtProductionVertex.resize(n);
+  fNDaughters.resize(n, 0);
+  for(unsigned int iD=0; iD<fDaughterIds.size(); iD++)
+    fDaughterIds[iD].resize(n, -1);
+}
+
+void KFPParticleVector::SetNDaughterVectors(const int n)
+{
+  /** Increases the number of vectors with daughter indices to "n", if it is smaller. Indices of the already
+   ** stored candidates in the new vectors are set to "-1".
+   ** \param[in] n - required number of vectors with daughter indices
+   **/
+  while(int(fDaughterIds.size()) < n)
+    fDaughterIds.push_back(kfvector_int(Size(), -1));
+}
+
+void KFPParticleVector::GetParticle(KFParticle& particle, const int n) const
+{
+  /** Copies the candidate with index "n" to the scalar KFParticle object.
+   ** \param[out] particle - output particle
+   ** \param[in] n - index of the candidate
+   **/
+  particle.SetId(fId[n]);
+
+  particle.CleanDaughtersId();
+  for(int iD=0; iD<fNDaughters[n]; iD++)
+    particle.AddDaughterId(fDaughterIds[iD][n]);
+
+  particle.SetPDG(fPDG[n]);
+
+  for(int iP=0; iP<8; iP++)
+    particle.Parameters()[iP] = fP[iP][n];
+  for(int iC=0; iC<36; iC++)
+    particle.CovarianceMatrix()[iC] = fC[iC][n];
+
+  particle.NDF() = fNDF[n];
+  particle.Chi2() = fChi2[n];
+  particle.Q() = fQ[n];
+  particle.SetAtProductionVertex(fAtProductionVertex[n]);
+#ifdef NonhomogeneousField
+  for(int iF=0; iF<10; iF++)
+    particle.SetFieldCoeff(fField[iF][n], iF);
+#endif
+}
+
+void KFPParticleVector::SetParticle(const KFParticle& particle, const int n)
+{
+  /** Copies the scalar KFParticle object to the position "n". The vector should be already resized and should have
+   ** enough vectors with daughter indices, see KFPParticleVector::SetNDaughterVectors(). Daughter indices of the
+   ** unused vectors are set to "-1".
+   ** \param[in] particle - input particle
+   ** \param[in] n - index of the candidate
+   **/
+  fId[n] = particle.Id();
+
+  fNDaughters[n] = particle.NDaughters();
+  for(int iD=0; iD<particle.NDaughters(); iD++)
+    fDaughterIds[iD][n] = particle.DaughterIds()[iD];
+  for(unsigned int iD=particle.NDaughters(); iD<fDaughterIds.size(); iD++)
+    fDaughterIds[iD][n] = -1;
+
+  fPDG[n] = particle.GetPDG();
+
+  for(int iP=0; iP<8; iP++)
+    fP[iP][n] = particle.GetParameter(iP);
+  for(int iC=0; iC<36; iC++)
+    fC[iC][n] = particle.GetCovariance(iC);
+
+  fNDF[n] = particle.GetNDF();
+  fChi2[n] = particle.GetChi2();
+  fQ[n] = particle.GetQ();
+  fAtProductionVertex[n] = particle.GetAtProductionVertex();
+#ifdef NonhomogeneousField
+  for(int iF=0; iF<10; iF++)
+    fField[iF][n] = particle.GetFieldCoeff()[iF];
+#endif
+}
+
+void KFPParticleVector::SetParticles(const std::vector<KFParticle>& particles)
+{
+  /** Replaces the content of the vector with a set of scalar particles. The vectors are padded to the multiple of the SIMD
+   ** vector length, so that the candidates can be loaded with aligned vector loads by KFParticleSIMD::Load(), the padding
+   ** entries are not defined. The number of vectors with daughter indices is set to the maximum number of daughters in the set.
+   ** \param[in] particles - vector with the input particles
+   **/
+  const int nParticles = particles.size();
+  int nDaughters = 0;
+  for(int iP=0; iP<nParticles; iP++)
+    if(particles[iP].NDaughters() > nDaughters)
+      nDaughters = particles[iP].NDaughters();
+  
+  fDaughterIds.resize(nDaughters);
+  Resize( ((nParticles + float_vLen - 1)/float_vLen)*float_vLen );
+  for(int iP=0; iP<nParticles; iP++)
+    SetParticle(particles[iP], iP);
+}
@@ -0,0 +1,109 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KFPParticleVector_H
+#define KFPParticleVector_H
+
+#include "KFParticleDef.h"
+
+#include <vector>
+
+class KFParticle;
+
+/** @class KFPParticleVector
+ ** @brief A class to store vectors of reconstructed particle candidates.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** A particle is described with the state vector { X, Y, Z, Px, Py, Pz, E, S }, the corresponding
+ ** covariance matrix, Id, PDG hypothesis, charge, chi2, number of degrees of freedom, indices of
+ ** daughters and the magnetic field approximation (in case of nonhomogeneous CBM-like field). \n
+ ** The data model implemented in the class is "Structure Of Arrays" as in KFPTrackVector: each parameter is stored
+ ** in a separate vector. Candidates are filled from the SIMD vectors with KFParticleSIMD::GetKFParticles(),
+ ** which writes all selected entries into the columns at once, or from scalar particles with SetParticle() and SetParticles(). Blocks of
+ ** consecutive candidates are loaded back to the SIMD vectors with aligned loads by KFParticleSIMD::Load(). Since different candidates can have different number
+ ** of daughters, the number of daughters is stored for each candidate, the unused daughter indices are set to "-1".
+ **/
+
+class KFPParticleVector
+{
+ public:
+  KFPParticleVector(): fId(), fPDG(), fQ(), fNDF(), fChi2(), fAtProductionVertex(), fNDaughters(), fDaughterIds() { }
+  virtual ~KFPParticleVector() { }
+
+  /**Returns size of the vectors. All data vectors have the same size. */
+  int Size() const { return fP[0].size(); }
+
+  void Resize(const int n);
+  void Clear() { Resize(0); } ///< Removes all candidates.
+  void SetNDaughterVectors(const int n);
+  void GetParticle(KFParticle& particle, const int n) const;
+  void SetParticle(const KFParticle& particle, const int n);
+  void SetParticles(const std::vector<KFParticle>& particles);
+
+  const kfvector_float& Parameter(const int i)  const { return fP[i]; }  ///< Returns constant reference to the parameter vector with index "i".
+  const kfvector_float& Covariance(const int i)  const { return fC[i]; } ///< Returns constant reference to the vector of the covariance matrix elements with index "i".
+#ifdef NonhomogeneousField
+  const kfvector_float& FieldCoefficient(const int i)  const { return fField[i]; } ///< Returns constant reference to the magnetic field coefficient with index "i".
+#endif
+  const kfvector_int& Id()         const { return fId; }         ///< Returns constant reference to the vector with Id of the candidates.
+  const kfvector_int& PDG()        const { return fPDG; }        ///< Returns constant reference to the vector with PDG hypothesis.
+  const kfvector_int& Q()          const { return fQ; }          ///< Returns constant reference to the vector with charge.
+  const kfvector_int& NDF()        const { return fNDF; }        ///< Returns constant reference to the vector with number of degrees of freedom.
+  const kfvector_float& Chi2()     const { return fChi2; }       ///< Returns constant reference to the vector with chi2.
+  const kfvector_int& AtProductionVertex() const { return fAtProductionVertex; } ///< Returns constant reference to the vector with flags of the production vertex.
+  const kfvector_int& NDaughters() const { return fNDaughters; } ///< Returns constant reference to the vector with number of daughters.
+  int NDaughterVectors() const { return fDaughterIds.size(); }   ///< Returns number of vectors with daughter indices.
+  const kfvector_int& DaughterIds(const int i) const { return fDaughterIds[i]; } ///< Returns constant reference to the vector with the daughter index "i".
+
+  //modifiers, store lanes of "value" selected by "mask" to the positions "index"
+  void SetParameter (const float_v& value, int iP, const uint_v& index, const float_m& mask) { value.scatter(&(fP[iP][0]), index, mask); } ///< Stores selected entries of parameter "iP".
+  void SetCovariance(const float_v& value, int iC, const uint_v& index, const float_m& mask) { value.scatter(&(fC[iC][0]), index, mask); } ///< Stores selected entries of the covariance element "iC".
+#ifdef NonhomogeneousField
+  void SetFieldCoefficient(const float_v& value, int iF, const uint_v& index, const float_m& mask) { value.scatter(&(fField[iF][0]), index, mask); } ///< Stores selected entries of field coefficient "iF".
+#endif
+  void SetId        (const int_v& value, const uint_v& index, const int_m& mask) { value.scatter(&(fId[0]), index, mask); }         ///< Stores selected entries of Id.
+  void SetPDG       (const int_v& value, const uint_v& index, const int_m& mask) { value.scatter(&(fPDG[0]), index, mask); }        ///< Stores selected entries of PDG.
+  void SetQ         (const int_v& value, const uint_v& index, const int_m& mask) { value.scatter(&(fQ[0]), index, mask); }          ///< Stores selected entries of charge.
+  void SetNDF       (const int_v& value, const uint_v& index, const int_m& mask) { value.scatter(&(fNDF[0]), index, mask); }        ///< Stores selected entries of NDF.
+  void SetChi2      (const float_v& value, const uint_v& index, const float_m& mask) { value.scatter(&(fChi2[0]), index, mask); }   ///< Stores selected entries of chi2.
+  void SetNDaughters(const int_v& value, const uint_v& index, const int_m& mask) { value.scatter(&(fNDaughters[0]), index, mask); } ///< Stores selected entries of the number of daughters.
+  void SetDaughterId(const int_v& value, int iD, const uint_v& index, const int_m& mask) { value.scatter(&(fDaughterIds[iD][0]), index, mask); } ///< Stores selected entries of daughter index "iD".
+  void SetAtProductionVertex(const int_v& value, const uint_v& index, const int_m& mask) { value.scatter(&(fAtProductionVertex[0]), index, mask); } ///< Stores selected entries of the flag of the production vertex.
+
+ private:
+  kfvector_float fP[8];  ///< Parameters of the candidates: X, Y, Z, Px, Py, Pz, E, S.
+  kfvector_float fC[36]; ///< Covariance matrices of the parameters.
+#ifdef NonhomogeneousField
+  kfvector_float fField[10]; ///< Approximation of the magnetic field along the trajectory of the candidates.
+#endif
+  kfvector_int fId;    ///< Id of the candidates.
+  kfvector_int fPDG;   ///< PDG hypothesis of the candidates.
+  kfvector_int fQ;     ///< Charge of the candidates.
+  kfvector_int fNDF;   ///< Number of degrees of freedom.
+  kfvector_float fChi2; ///< Chi2 of the fit.
+  kfvector_int fAtProductionVertex; ///< Flag showing if the candidates are at the production vertex.
+  kfvector_int fNDaughters; ///< Number of daughters of the candidates.
+  std::vector<kfvector_int> fDaughterIds; ///< Indices of the daughters: vector "i" contains the daughter "i" of each candidate.
+};
+
+#endif
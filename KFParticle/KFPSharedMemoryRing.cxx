@@ -0,0 +1,327 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "KFPSharedMemoryRing.h"
+
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const unsigned int KFPSharedMemoryRing::fMagic = 0x5253504b;
+
+bool KFPSharedMemoryRing::Create(const std::string& name, const int nSlots, const int slotSize, const bool overwrite)
+{
+  /** Creates the shared memory segment with the ring and initialises it. The segment is removed when the object is closed. 
+   ** Returns false in case of failure, in particular if a segment with the same name exists and "overwrite" is not set, so 
+   ** that a ring used by another pair of processes is not destroyed.
+   ** \param[in] name - name of the segment in the POSIX notation, for example "/kfparticle_input"
+   ** \param[in] nSlots - number of slots
+   ** \param[in] slotSize - capacity of each slot in words of 4 bytes, should be not smaller than the maximum size of 
+   ** the stored event
+   ** \param[in] overwrite - if true, a segment with the same name, for example left from a crashed run, is removed first
+   **/
+  Close();
+  if(nSlots <= 0 || slotSize <= 0) return false;
+  
+  if(overwrite)
+    shm_unlink(name.data());
+  const int fileDescriptor = shm_open(name.data(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if(fileDescriptor < 0) return false;
+  
+  const int slotStride = ((slotSize + 1 + 15)/16)*16;
+  const unsigned long long size = sizeof(Header) + static_cast<unsigned long long>(nSlots) * slotStride * sizeof(int);
+  if(ftruncate(fileDescriptor, size) != 0 || !Map(fileDescriptor, size))
+  {
+    close(fileDescriptor);
+    shm_unlink(name.data());
+    return false;
+  }
+  close(fileDescriptor);
+  
+  fHeader = new(fHeader) Header();
+  fHeader->fNSlots = nSlots;
+  fHeader->fSlotSize = slotSize;
+  fHeader->fWritten.store(0);
+  fHeader->fRead.store(0);
+  fHeader->fMagic.store(fMagic, std::memory_order_release);
+  
+  fNSlots = nSlots;
+  fSlotSize = slotSize;
+  fSlotStride = slotStride;
+  fIsOwner = true;
+  fName = name;
+  return true;
+}
+
+bool KFPSharedMemoryRing::Attach(const std::string& name)
+{
+  /** Attaches to the ring created by another process with KFPSharedMemoryRing::Create(). Returns false if the segment
+   ** does not exist or is not initialised yet.
+   ** \param[in] name - name of the segment
+   **/
+  Close();
+  
+  const int fileDescriptor = shm_open(name.data(), O_RDWR, 0600);
+  if(fileDescriptor < 0) return false;
+  
+  struct stat fileStat;
+  if(fstat(fileDescriptor, &fileStat) != 0 || static_cast<unsigned long long>(fileStat.st_size) < sizeof(Header) ||
+     !Map(fileDescriptor, fileStat.st_size))
+  {
+    close(fileDescriptor);
+    return false;
+  }
+  close(fileDescriptor);
+  
+  const bool isInitialised = (fHeader->fMagic.load(std::memory_order_acquire) == fMagic);
+  const int slotStride = ((fHeader->fSlotSize + 1 + 15)/16)*16;
+  if(!isInitialised || fSegmentSize < sizeof(Header) + static_cast<unsigned long long>(fHeader->fNSlots) * slotStride * sizeof(int))
+  {
+    Close();
+    return false;
+  }
+  
+  fNSlots = fHeader->fNSlots;
+  fSlotSize = fHeader->fSlotSize;
+  fSlotStride = slotStride;
+  fIsOwner = false;
+  fName = name;
+  return true;
+}
+
+bool KFPSharedMemoryRing::Map(const int fileDescriptor, const unsigned long long size)
+{
+  /** Maps the shared memory segment and sets pointers to the header and slots.
+   ** \param[in] fileDescriptor - descriptor of the opened segment
+   ** \param[in] size - size of the segment in bytes
+   **/
+  void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+  if(data == MAP_FAILED) return false;
+  
+  fHeader = static_cast<Header*>(data);
+  fSlots = reinterpret_cast<int*>(static_cast<char*>(data) + sizeof(Header));
+  fSegmentSize = size;
+  return true;
+}
+
+void KFPSharedMemoryRing::Close()
+{
+  /** Unmaps the segment. If the segment was created by the current object, it is removed. */
+  if(fHeader)
+    munmap(fHeader, fSegmentSize);
+  if(fIsOwner)
+    shm_unlink(fName.data());
+  
+  fHeader = 0;
+  fSlots = 0;
+  fSegmentSize = 0;
+  fNSlots = 0;
+  fSlotSize = 0;
+  fSlotStride = 0;
+  fIsOwner = false;
+  fName.clear();
+  fCachedWritten = 0;
+  fCachedRead = 0;
+}
+
+int* KFPSharedMemoryRing::BeginWrite()
+{
+  /** Returns pointer to the next free slot with KFPSharedMemoryRing::fSlotSize words, or 0 if the ring is full.
+   ** Should be called only by the producer. The slot is published with KFPSharedMemoryRing::EndWrite(). */
+  const unsigned long long written = fHeader->fWritten.load(std::memory_order_relaxed);
+  if(written - fCachedRead >= static_cast<unsigned long long>(fNSlots))
+  {
+    fCachedRead = fHeader->fRead.load(std::memory_order_acquire);
+    if(written - fCachedRead >= static_cast<unsigned long long>(fNSlots))
+      return 0;
+  }
+  return Slot(written) + 1;
+}
+
+void KFPSharedMemoryRing::EndWrite(const int dataSize)
+{
+  /** Publishes the slot obtained with KFPSharedMemoryRing::BeginWrite().
+   ** \param[in] dataSize - number of words written to the slot
+   **/
+  const unsigned long long written = fHeader->fWritten.load(std::memory_order_relaxed);
+  Slot(written)[0] = dataSize;
+  fHeader->fWritten.store(written + 1, std::memory_order_release);
+}
+
+const int* KFPSharedMemoryRing::BeginRead(int& dataSize)
+{
+  /** Returns pointer to the oldest published slot, or 0 if the ring is empty. Should be called only by the consumer.
+   ** The slot stays valid until KFPSharedMemoryRing::EndRead() is called.
+   ** \param[out] dataSize - number of words stored in the slot
+   **/
+  const unsigned long long read = fHeader->fRead.load(std::memory_order_relaxed);
+  if(read == fCachedWritten)
+  {
+    fCachedWritten = fHeader->fWritten.load(std::memory_order_acquire);
+    if(read == fCachedWritten)
+      return 0;
+  }
+  const int* slot = Slot(read);
+  dataSize = slot[0];
+  return slot + 1;
+}
+
+void KFPSharedMemoryRing::EndRead()
+{
+  /** Releases the slot obtained with KFPSharedMemoryRing::BeginRead(), so it can be reused by the producer. */
+  const unsigned long long read = fHeader->fRead.load(std::memory_order_relaxed);
+  fHeader->fRead.store(read + 1, std::memory_order_release);
+}
+
+bool KFPSharedMemoryRing::Write(KFPInputData& data)
+{
+  /** Serialises the input data directly into the next free slot with KFPInputData::SetDataToVector(). Returns false if
+   ** the ring is full or the data do not fit into the slot.
+   ** \param[in] data - input data of the event
+   **/
+  if(data.DataSize() > fSlotSize) return false;
+  int* slot = BeginWrite();
+  if(!slot) return false;
+  
+  int dataSize = 0;
+  data.SetDataToVector(slot, dataSize);
+  EndWrite(dataSize);
+  return true;
+}
+
+bool KFPSharedMemoryRing::Read(KFPInputData& data)
+{
+  /** Reads the input data from the oldest slot with KFPInputData::ReadDataFromVector() and releases the slot. Returns 
+   ** false if the ring is empty or if the slot does not contain the input data in the current format, the slot is released then as well.
+   ** \param[out] data - input data of the event
+   **/
+  int dataSize = 0;
+  const int* slot = BeginRead(dataSize);
+  if(!slot) return false;
+  
+  const bool isRead = (dataSize >= 0) && (dataSize <= fSlotSize) && data.ReadDataFromVector(const_cast<int*>(slot), dataSize);
+  EndRead();
+  return isRead;
+}
+
+int KFPSharedMemoryRing::DataSize(const std::vector<KFParticle>& particles)
+{
+  /** Returns number of words required to store the particles with KFPSharedMemoryRing::Write().
+   ** \param[in] particles - vector with particles
+   **/
+  int dataSize = 1;
+  for(unsigned int iParticle=0; iParticle<particles.size(); iParticle++)
+    dataSize += 50 + particles[iParticle].NDaughters();
+  return dataSize;
+}
+
+bool KFPSharedMemoryRing::Write(const std::vector<KFParticle>& particles)
+{
+  /** Stores particles directly into the next free slot, the layout is given in the description of the class. Returns false
+   ** if the ring is full or the particles do not fit into the slot.
+   ** \param[in] particles - vector with particles, for example KFParticleTopoReconstructor::GetParticles()
+   **/
+  const int dataSize = DataSize(particles);
+  if(dataSize > fSlotSize) return false;
+  int* data = BeginWrite();
+  if(!data) return false;
+  
+  data[0] = particles.size();
+  int offset = 1;
+  for(unsigned int iParticle=0; iParticle<particles.size(); iParticle++)
+  {
+    const KFParticle& particle = particles[iParticle];
+    for(int iP=0; iP<8; iP++)
+    {
+      float& tmpFloat = reinterpret_cast<float&>(data[offset++]);
+      tmpFloat = particle.GetParameter(iP);
+    }
+    for(int iC=0; iC<36; iC++)
+    {
+      float& tmpFloat = reinterpret_cast<float&>(data[offset++]);
+      tmpFloat = particle.GetCovariance(iC);
+    }
+    float& chi2 = reinterpret_cast<float&>(data[offset++]);
+    chi2 = particle.GetChi2();
+    data[offset++] = particle.GetNDF();
+    data[offset++] = particle.GetQ();
+    data[offset++] = particle.GetPDG();
+    data[offset++] = particle.Id();
+    data[offset++] = particle.NDaughters();
+    for(int iD=0; iD<particle.NDaughters(); iD++)
+      data[offset++] = particle.DaughterIds()[iD];
+  }
+  
+  EndWrite(dataSize);
+  return true;
+}
+
+bool KFPSharedMemoryRing::Read(std::vector<KFParticle>& particles)
+{
+  /** Reads particles from the oldest slot and releases the slot. Returns false if the ring is empty or if the sizes stored 
+   ** in the slot do not fit into the slot, the slot is released then as well and "particles" are cleared.
+   ** \param[out] particles - vector with particles
+   **/
+  int dataSize = 0;
+  const int* data = BeginRead(dataSize);
+  if(!data) return false;
+  
+  const int nParticles = (dataSize >= 1 && dataSize <= fSlotSize) ? data[0] : -1;
+  if(nParticles < 0 || nParticles > (dataSize - 1)/50)
+  {
+    particles.clear();
+    EndRead();
+    return false;
+  }
+  
+  particles.resize(nParticles);
+  int offset = 1;
+  for(unsigned int iParticle=0; iParticle<particles.size(); iParticle++)
+  {
+    const int nDaughters = (offset + 50 <= dataSize) ? data[offset + 49] : -1;
+    if(nDaughters < 0 || nDaughters > dataSize - offset - 50)
+    {
+      particles.clear();
+      EndRead();
+      return false;
+    }
+    
+    KFParticle& particle = particles[iParticle];
+    for(int iP=0; iP<8; iP++)
+      particle.Parameter(iP) = reinterpret_cast<const float&>(data[offset++]);
+    for(int iC=0; iC<36; iC++)
+      particle.Covariance(iC) = reinterpret_cast<const float&>(data[offset++]);
+    particle.Chi2() = reinterpret_cast<const float&>(data[offset++]);
+    particle.NDF() = data[offset++];
+    particle.Q() = data[offset++];
+    particle.SetPDG(data[offset++]);
+    particle.SetId(data[offset++]);
+    offset++;
+    particle.CleanDaughtersId();
+    for(int iD=0; iD<nDaughters; iD++)
+      particle.AddDaughterId(data[offset++]);
+  }
+  
+  EndRead();
+  return true;
+}
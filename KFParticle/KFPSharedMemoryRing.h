@@ -0,0 +1,117 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KFPSharedMemoryRing_H
+#define KFPSharedMemoryRing_H
+
+#include "KFPInputData.h"
+#include "KFParticle.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/** @class KFPSharedMemoryRing
+ ** @brief A ring buffer of fixed-size slots in the POSIX shared memory to exchange events between processes.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** The ring connects exactly one producer and one consumer process on the same node. The owner creates the segment
+ ** with KFPSharedMemoryRing::Create(), the other side attaches to it with KFPSharedMemoryRing::Attach(). The segment
+ ** consists of a header with two counters and KFPSharedMemoryRing::fNSlots slots, each slot contains the size of
+ ** the stored data in words followed by the data itself. The producer writes directly into the free slot and
+ ** publishes it by increasing the counter of the written slots, the consumer reads directly from the slot and frees
+ ** it by increasing the counter of the read slots. The counters are lock-free atomics, the counters are placed in
+ ** separate cache lines and each side caches the counter of the other side, so in the steady state no system calls
+ ** and no extra copies are performed. All functions are non-blocking: if the ring is full or empty they return
+ ** immediately and the caller decides whether to poll again. \n
+ ** Input data are stored in the flat layout of KFPInputData::SetDataToVector(), which was used for the offload to 
+ ** Xeon Phi over SCIF. For the results a second ring in the opposite direction is used: particles are stored with
+ ** KFPSharedMemoryRing::Write(const std::vector<KFParticle>&) in the following layout: number of particles, then for
+ ** each particle 8 parameters, 36 elements of the covariance matrix, chi2, NDF, charge, PDG, Id, number of 
+ ** daughters and their indices. The readers check the stored sizes against the size of the slot, so a corrupted
+ ** slot is rejected instead of being read out of bounds.
+ **/
+
+class KFPSharedMemoryRing
+{
+ public:
+  KFPSharedMemoryRing(): fHeader(0), fSlots(0), fSegmentSize(0), fNSlots(0), fSlotSize(0), fSlotStride(0), fIsOwner(false), 
+                         fName(), fCachedWritten(0), fCachedRead(0) { }
+  ~KFPSharedMemoryRing() { Close(); }
+
+  bool Create(const std::string& name, const int nSlots, const int slotSize, const bool overwrite = false);
+  bool Attach(const std::string& name);
+  void Close();
+
+  bool IsOpen() const { return fHeader != 0; } ///< Returns true if the ring is connected to the shared memory segment.
+  int GetNSlots() const { return fNSlots; }     ///< Returns number of slots in the ring.
+  int GetSlotSize() const { return fSlotSize; } ///< Returns capacity of a slot in words of 4 bytes.
+
+  int* BeginWrite();
+  void EndWrite(const int dataSize);
+  const int* BeginRead(int& dataSize);
+  void EndRead();
+
+  bool Write(KFPInputData& data);
+  bool Read(KFPInputData& data);
+  bool Write(const std::vector<KFParticle>& particles);
+  bool Read(std::vector<KFParticle>& particles);
+
+  static int DataSize(const std::vector<KFParticle>& particles);
+
+ private:
+  KFPSharedMemoryRing(const KFPSharedMemoryRing&);
+  KFPSharedMemoryRing& operator=(const KFPSharedMemoryRing&);
+
+  /** @brief Header of the shared memory segment, the counters are placed in separate cache lines. */
+  struct Header
+  {
+    std::atomic<unsigned int> fMagic; ///< Marker of the initialised segment, is set after all other fields.
+    unsigned int fNSlots;    ///< Number of slots.
+    unsigned int fSlotSize;  ///< Capacity of a slot in words.
+    char fPad0[64 - sizeof(std::atomic<unsigned int>) - 2*sizeof(unsigned int)]; ///< Padding to the cache line.
+    std::atomic<unsigned long long> fWritten; ///< Number of slots written by the producer.
+    char fPad1[64 - sizeof(std::atomic<unsigned long long>)]; ///< Padding to the cache line.
+    std::atomic<unsigned long long> fRead;    ///< Number of slots released by the consumer.
+    char fPad2[64 - sizeof(std::atomic<unsigned long long>)]; ///< Padding to the cache line.
+  };
+
+  bool Map(const int fileDescriptor, const unsigned long long size);
+  /** Returns pointer to the slot, which corresponds to the counter value "iSlot". */
+  int* Slot(const unsigned long long iSlot) const { return fSlots + (iSlot % fNSlots) * fSlotStride; }
+
+  static const unsigned int fMagic; ///< Marker of the initialised segment.
+
+  Header* fHeader;                   ///< Pointer to the header of the mapped segment.
+  int* fSlots;                       ///< Pointer to the first slot of the mapped segment.
+  unsigned long long fSegmentSize;   ///< Size of the mapped segment in bytes.
+  int fNSlots;                       ///< Number of slots.
+  int fSlotSize;                     ///< Capacity of a slot in words.
+  int fSlotStride;                   ///< Distance between slots in words, is a multiple of the cache line.
+  bool fIsOwner;                     ///< Shows if the segment was created by this object and should be removed at closing.
+  std::string fName;                 ///< Name of the shared memory segment.
+  unsigned long long fCachedWritten; ///< Last value of KFPSharedMemoryRing::Header::fWritten seen by the consumer.
+  unsigned long long fCachedRead;    ///< Last value of KFPSharedMemoryRing::Header::fRead seen by the producer.
+};
+
+#endif
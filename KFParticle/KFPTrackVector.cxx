@@ -78,7 +78,8 @@ void KFPTrackVector::SetCovariance(const float_v& value, int iC, int iTr)
 
 void KFPTrackVector::Resize(const int n)
 {
-  /** Resizes all vectors in the class to a given value.
+  /** Resizes all vectors in the class to a given value. New tracks get the error of the time "-1", which means that
+   ** the track has no time information, the time should be set explicitly with KFPTrackVector::SetT() and KFPTrackVector::SetTErr().
    ** \param[in] n - new size of the vector
    **/
   for(int i=0; i<6; i++)
@@ -96,6 +97,9 @@ void KFPTrackVector::Resize(const int n)
   fQ.resize(n);
   fPVIndex.resize(n);
   fNPixelHits.resize(n);
+  fPIDMask.resize(n);
+  fT.resize(n);
+  fTErr.resize(n, -1.f);
 }
 
 void KFPTrackVector::Set(KFPTrackVector& v, int vSize, int offset)
@@ -123,6 +127,9 @@ void KFPTrackVector::Set(KFPTrackVector& v, int vSize, int offset)
     fQ[offset+iV] = v.fQ[iV];
     fPVIndex[offset+iV] = v.fPVIndex[iV];
     fNPixelHits[offset+iV] = v.fNPixelHits[iV];
+    fPIDMask[offset+iV] = v.fPIDMask[iV];
+    fT[offset+iV] = v.fT[iV];
+    fTErr[offset+iV] = v.fTErr[iV];
   }
 }
 
@@ -239,6 +246,31 @@ void KFPTrackVector::SetTracks(const KFPTrackVector& track, const kfvector_uint&
     int_v& vec = reinterpret_cast<int_v&>(fNPixelHits[iElement]);
     vec.gather(&(track.fNPixelHits[0]), index, int_m(iElement+uint_v::IndexesFromZero()<nIndexes));
   }
+  {
+    int iElement=0;
+    for(iElement=0; iElement<nIndexes-float_vLen; iElement += float_vLen)
+    {
+      const uint_v& index = reinterpret_cast<const uint_v&>(trackIndex[iElement]);
+      int_v& vec = reinterpret_cast<int_v&>(fPIDMask[iElement]);
+      vec.gather(&(track.fPIDMask[0]), index);
+    }
+    const uint_v& index = reinterpret_cast<const uint_v&>(trackIndex[iElement]);
+    int_v& vec = reinterpret_cast<int_v&>(fPIDMask[iElement]);
+    vec.gather(&(track.fPIDMask[0]), index, int_m(iElement+uint_v::IndexesFromZero()<nIndexes));
+  }
+  {
+    int iElement=0;
+    for(iElement=0; iElement<nIndexes-float_vLen; iElement += float_vLen)
+    {
+      const uint_v& index = reinterpret_cast<const uint_v&>(trackIndex[iElement]);
+      reinterpret_cast<float_v&>(fT[iElement]).gather(&(track.fT[0]), index);
+      reinterpret_cast<float_v&>(fTErr[iElement]).gather(&(track.fTErr[0]), index);
+    }
+    const uint_v& index = reinterpret_cast<const uint_v&>(trackIndex[iElement]);
+    const float_m& isValid = simd_cast<float_m>(iElement+uint_v::IndexesFromZero()<nIndexes);
+    reinterpret_cast<float_v&>(fT[iElement]).gather(&(track.fT[0]), index, isValid);
+    reinterpret_cast<float_v&>(fTErr[iElement]).gather(&(track.fTErr[0]), index, isValid);
+  }
 }
 
 void KFPTrackVector::GetTrack(KFPTrack& track, const int n)
@@ -344,7 +376,7 @@ void KFPTrackVector::PrintTrack(int n)
     std::cout << fC[i][n] << " ";
   std::cout << std::endl;
   
-  std::cout  <<  fId[n] << " " << fPDG[n] << " " << fQ[n] << " " << fPVIndex[n]  << " " << fNPixelHits[n] << std::endl;
+  std::cout  <<  fId[n] << " " << fPDG[n] << " " << fQ[n] << " " << fPVIndex[n]  << " " << fNPixelHits[n] << " " << fT[n] << " " << fTErr[n] << std::endl;
 }
 
 void KFPTrackVector::Print()
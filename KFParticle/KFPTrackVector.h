@@ -50,22 +50,27 @@ class KFPTrackVector
 {
   friend class KFParticleTopoReconstructor;
  public:
-  KFPTrackVector():fId(), fPDG(), fQ(), fPVIndex(), fNPixelHits(), fNE(0), fNMu(0), fNPi(0), fNK(0), fNP(0), fND(0), fNT(0), fNHe3(0), fNHe4(0) { }
+  /** Species of the PID hypotheses, the bit "1 << species" is set in KFPTrackVector::fPIDMask for each alternative hypothesis of the track. */
+  enum PIDSpecies { kPIDElectron, kPIDMuon, kPIDPion, kPIDKaon, kPIDProton, kPIDDeuteron, kPIDTriton, kPIDHe3, kPIDHe4, kNPIDSpecies };
+  
+  KFPTrackVector():fId(), fPDG(), fQ(), fPVIndex(), fNPixelHits(), fPIDMask(), fT(), fTErr(), fNE(0), fNMu(0), fNPi(0), fNK(0), fNP(0), fND(0), fNT(0), fNHe3(0), fNHe4(0) { }
   virtual ~KFPTrackVector() { }
 
   /**Returns size of the vectors. All data vectors have the same size. */
   int Size() const { return fP[0].size(); }
-  int DataSize() const { 
-    /**Returns size of the memory in floats (4 bytes or 32 bits) allocated by the current object. */
-    const int& size = fP[0].size();
-    
-    const int dataSize = size * 32 
+  int DataSize() const { return DataSize(Size()); } ///< Returns size of the memory in floats (4 bytes or 32 bits) allocated by the current object.
+  static int DataSize(const int size) { 
+    /** Returns size of the memory in floats (4 bytes or 32 bits) written by KFPTrackVector::SetDataToVector() for "size" tracks. */
+    const int dataSize = size * 35 
 #ifdef NonhomogeneousField
                        + size * 10
 #endif
-                       + 9;
+                       + 9 + 1;
     return dataSize; 
   }
+  /** Returns the version of the memory layout of KFPTrackVector::SetDataToVector(), which is stored as the first word of each
+   ** track vector and checked by KFPTrackVector::ReadDataFromVector(). */
+  static int DataFormatVersion() { return fDataFormatVersion; }
   
   void Resize(const int n);
   void Set(KFPTrackVector& v, int vSize, int offset);
@@ -90,6 +95,9 @@ class KFPTrackVector
   const kfvector_int& Q()          const { return fQ; }       ///< Returns constant reference to the vector with charge KFPTrackVector::fQ.
   const kfvector_int& PVIndex()    const { return fPVIndex; } ///< Returns constant reference to the vector with indices of corresponding primary vertex KFPTrackVector::fPVIndex.
   const kfvector_int& NPixelHits() const { return fNPixelHits; } ///< Returns constant reference to the vector with the number of precise measurements KFPTrackVector::fNPixelHits.
+  const kfvector_int& PIDMask()    const { return fPIDMask; }    ///< Returns constant reference to the vector with the alternative PID hypotheses KFPTrackVector::fPIDMask.
+  const kfvector_float& T()        const { return fT; }       ///< Returns constant reference to the vector with the time of the tracks KFPTrackVector::fT.
+  const kfvector_float& TErr()     const { return fTErr; }    ///< Returns constant reference to the vector with the error of the time KFPTrackVector::fTErr.
 
   float Pt(const int n) const { return sqrt(fP[3][n]*fP[3][n]+fP[4][n]*fP[4][n]); } ///< Returns transverse momentum of the track with index "n".
   float P(const int n)  const { return sqrt(fP[3][n]*fP[3][n]+fP[4][n]*fP[4][n]+fP[5][n]*fP[5][n]); } ///< Returns momentum of the track with index "n".
@@ -109,6 +117,9 @@ class KFPTrackVector
   void SetQ           (int value, int iTr) { fQ[iTr] = value; }          ///< Sets charge of the track with index "iTr".
   void SetPVIndex     (int value, int iTr) { fPVIndex[iTr] = value; }    ///< Sets index of the corresponding primary vertex of the track with index "iTr".
   void SetNPixelHits  (int value, int iTr) { fNPixelHits[iTr] = value; } ///< Sets number of precise measurement of the track with index "iTr".
+  void SetPIDMask     (int value, int iTr) { fPIDMask[iTr] = value; }    ///< Sets the bit mask of the alternative PID hypotheses of the track with index "iTr", see KFPTrackVector::PIDSpecies.
+  void SetT           (float value, int iTr) { fT[iTr] = value; }       ///< Sets time of the track with index "iTr".
+  void SetTErr        (float value, int iTr) { fTErr[iTr] = value; }    ///< Sets error of the time of the track with index "iTr".
   void SetLastElectron(int n)              { fNE = n; }                  ///< Sets index of the last electron.
   void SetLastMuon    (int n)              { fNMu = n; }                 ///< Sets index of the last muon.
   void SetLastPion    (int n)              { fNPi = n; }                 ///< Sets index of the last pion.
@@ -144,6 +155,38 @@ class KFPTrackVector
     
     fNMu += fNE; fNPi += fNMu; fNK  += fNPi; fNP  += fNK;
     fND += fNP; fNT += fND; fNHe3 += fNT; fNHe4 += fNHe3;
+    
+    RecalculateHypothesisIndices();
+  }
+  
+  void RecalculateHypothesisIndices()
+  {
+    /** Recalculates the lists of the tracks with the alternative PID hypotheses KFPTrackVector::fHypothesisIndex 
+     ** from KFPTrackVector::fPIDMask. */
+    for(int iSpecies=0; iSpecies<kNPIDSpecies; iSpecies++)
+      fHypothesisIndex[iSpecies].clear();
+    for(int i=0; i<Size(); i++)
+    {
+      if(fPIDMask[i] == 0) continue;
+      for(int iSpecies=0; iSpecies<kNPIDSpecies; iSpecies++)
+        if(fPIDMask[i] & (1 << iSpecies))
+          fHypothesisIndex[iSpecies].push_back(i);
+    }
+  }
+  
+  /** Returns indices of the tracks, which have an alternative PID hypothesis "iSpecies". Is calculated by KFPTrackVector::RecalculateHypothesisIndices(). */
+  const kfvector_uint& HypothesisIndex(const int iSpecies) const { return fHypothesisIndex[iSpecies]; }
+  
+  static int PDGOfSpecies(const int iSpecies, const int q)
+  {
+    /** Returns the PDG code of the particle of the species "iSpecies" with the charge sign "q".
+     ** \param[in] iSpecies - species, see KFPTrackVector::PIDSpecies
+     ** \param[in] q - charge of the track
+     **/
+    const int pdg[kNPIDSpecies] = { 11, 13, 211, 321, 2212, 1000010020, 1000010030, 1000020030, 1000020040 };
+    if(iSpecies <= kPIDMuon) //negative leptons have positive PDG codes
+      return (q < 0) ? pdg[iSpecies] : -pdg[iSpecies];
+    return (q < 0) ? -pdg[iSpecies] : pdg[iSpecies];
   }
   
   int FirstElectron()  { return 0; } ///< Returns index of the first electron.
@@ -237,6 +280,18 @@ class KFPTrackVector
     for(int n=0; n<localSize; n++)
       fNPixelHits[n] = track.fNPixelHits[n];
     
+    fPIDMask.resize(localSize);
+    for(int n=0; n<localSize; n++)
+      fPIDMask[n] = track.fPIDMask[n];
+    
+    fT.resize(localSize);
+    for(int n=0; n<localSize; n++)
+      fT[n] = track.fT[n];
+    
+    fTErr.resize(localSize);
+    for(int n=0; n<localSize; n++)
+      fTErr[n] = track.fTErr[n];
+    
     fNE   = track.fNE;
     fNMu  = track.fNMu;
     fNPi  = track.fNPi;
@@ -247,6 +302,9 @@ class KFPTrackVector
     fNHe3 = track.fNHe3;
     fNHe4 = track.fNHe4;
     
+    for(int iSpecies=0; iSpecies<kNPIDSpecies; iSpecies++)
+      fHypothesisIndex[iSpecies].assign(track.fHypothesisIndex[iSpecies].begin(), track.fHypothesisIndex[iSpecies].end());
+    
     return *this;
   }
   
@@ -260,6 +318,8 @@ class KFPTrackVector
      ** copied the offset is shifted on the size of the written object so the next KFPTrackVector object
      ** can be copied to the "data"
      **/
+    data[offset] = fDataFormatVersion; offset++;
+    
     for(int iP=0; iP<6; iP++)
     {
       memcpy( &(data[offset]), &(fP[iP][0]), Size()*sizeof(float));
@@ -287,6 +347,15 @@ class KFPTrackVector
     memcpy( &(data[offset]), &(fNPixelHits[0]), Size()*sizeof(float));
     offset += Size();
     
+    memcpy( &(data[offset]), &(fPIDMask[0]), Size()*sizeof(float));
+    offset += Size();
+    
+    memcpy( &(data[offset]), &(fT[0]), Size()*sizeof(float));
+    offset += Size();
+    
+    memcpy( &(data[offset]), &(fTErr[0]), Size()*sizeof(float));
+    offset += Size();
+    
 #ifdef NonhomogeneousField
     for(int iF=0; iF<10; iF++)
     {
@@ -306,16 +375,20 @@ class KFPTrackVector
     data[offset] = fNHe4; offset++;
   }
   
-  void ReadDataFromVector(int* data, int& offset)
+  bool ReadDataFromVector(int* data, int& offset)
   {
-    /** Copies entire vector from the provided memory starting form the position "offset".
-     ** The function is used in KFPInputData::ReadDataFromVector().
+    /** Copies entire vector from the provided memory starting form the position "offset". The current object should be resized
+     ** to the number of the stored tracks. Returns "false" and does not change the object and the offset if the memory does not 
+     ** start with KFPTrackVector::fDataFormatVersion. The function is used in KFPInputData::ReadDataFromVector().
      ** \param[in] data - pointer to the memory with the track vectors; since all fields of
      ** KFPTrackVector are of the same size (int or float) pointer can be safely casted to int*
      ** \param[in,out] offset - starting position of the memory to be copied; after all vectors are
      ** copied the offset is shifted on the size of the read object so the next KFPTrackVector object
      ** can be copied 
      **/
+    if(data[offset] != fDataFormatVersion) return false;
+    offset++;
+    
     for(int iP=0; iP<6; iP++)
     {
       memcpy( &(fP[iP][0]), &(data[offset]), Size()*sizeof(float));
@@ -343,6 +416,15 @@ class KFPTrackVector
     memcpy( &(fNPixelHits[0]), &(data[offset]), Size()*sizeof(float));
     offset += Size();
     
+    memcpy( &(fPIDMask[0]), &(data[offset]), Size()*sizeof(float));
+    offset += Size();
+    
+    memcpy( &(fT[0]), &(data[offset]), Size()*sizeof(float));
+    offset += Size();
+    
+    memcpy( &(fTErr[0]), &(data[offset]), Size()*sizeof(float));
+    offset += Size();
+    
 #ifdef NonhomogeneousField
     for(int iF=0; iF<10; iF++)
     {
@@ -360,6 +442,9 @@ class KFPTrackVector
     fNT = data[offset];   offset++;
     fNHe3 = data[offset]; offset++;
     fNHe4 = data[offset]; offset++;
+    
+    RecalculateHypothesisIndices();
+    return true;
   }
   
   void *operator new(size_t size) { return _mm_malloc(size, sizeof(float_v)); }     ///< new operator for allocation of the SIMD-alligned dynamic memory allocation
@@ -378,6 +463,12 @@ class KFPTrackVector
   kfvector_int fQ;          ///< Vector with the charge of the tracks.
   kfvector_int fPVIndex;    ///< Vector with the index of the corresponding primary vertex. If track is considered secondary "-1" is stored.
   kfvector_int fNPixelHits; ///< Vector with the number of hits from precise detectors (like MVD in CBM, HFT in STAR, ITS in ALICE, etc.) 
+  /** Vector with the bit masks of the alternative PID hypotheses, see KFPTrackVector::PIDSpecies. The track is stored once and sorted
+   ** according to its PDG code, KFParticleFinder::Find2DaughterDecay() checks all hypotheses for each pair of tracks. "0" - only the PDG code is used. */
+  kfvector_int fPIDMask;
+  /** Vector with the time of the tracks. Is used in the continuous readout mode, see KFParticleTopoReconstructor::ProcessTimeFrame(). */
+  kfvector_float fT;
+  kfvector_float fTErr;     ///< Vector with the errors of the time of the tracks, "-1" if the track has no time information.
   
   /** The coefficients of the field approximation of each field component along the track trajectory using parabolas: \n
    ** cx0 = fField[0], cx1 = fField[1], cx2 = fField[2] - coefficients of the Bx approximation; \n
@@ -401,6 +492,12 @@ class KFPTrackVector
   int fNT;   ///< Index of the last triton.
   int fNHe3; ///< Index of the last He3.
   int fNHe4; ///< Index of the last He4.
+  kfvector_uint fHypothesisIndex[kNPIDSpecies]; ///< Indices of the tracks with each alternative PID hypothesis.
+  
+  /** Version of the memory layout of KFPTrackVector::SetDataToVector(): "KF" in the upper bytes and the number of the version in
+   ** the lower ones. The version 3 adds the time KFPTrackVector::fT and its error KFPTrackVector::fTErr, the version 2 adds 
+   ** KFPTrackVector::fPIDMask, the version 1 without the version word had 32 words per track. */
+  static const int fDataFormatVersion = 0x4B460003;
 } __attribute__((aligned(sizeof(float_v))));
 
 #endif
@@ -36,6 +36,8 @@
 
 #include <vector>
 
+#include "KFPDaughterIds.h"
+
 /** @class KFParticleBase
  ** @brief The base of KFParticle class, describes particle objects.
  ** @author  S.Gorbunov, I.Kisel, M.Zyzak
@@ -224,7 +226,7 @@ class KFParticleBase :public TObject {
 
   int Id() const { return fId; } ///< Returns Id of the particle.
   int NDaughters() const { return fDaughtersIds.size(); } ///< Returns number of daughter particles.
-  const std::vector<int>& DaughterIds() const { return fDaughtersIds; } ///< Returns the vector with the indices of daughter particles.
+  const KFPDaughterIds& DaughterIds() const { return fDaughtersIds; } ///< Returns the container with the indices of daughter particles.
   void CleanDaughtersId() { fDaughtersIds.clear(); } ///< Cleans the vector with the indices of daughter particles.
   
   void SetId( int id ) { fId = id; } ///< Sets the Id of the particle. After the construction of a particle should be set by user.
@@ -286,12 +288,13 @@ class KFParticleBase :public TObject {
   
   /** \brief A vector with ids of the daughter particles: \n
    ** 1) if particle is created from a track - the index of the track, in this case the size of the vector is always equal to one; \n
-   ** 2) if particle is constructed from other particles - indices of these particles in the same array.
+   ** 2) if particle is constructed from other particles - indices of these particles in the same array. \n
+   ** Up to four indices are stored inline, so copying of the particle does not allocate memory in most cases.
    **/
-  std::vector<int> fDaughtersIds;
+  KFPDaughterIds fDaughtersIds;
  
 #ifndef KFParticleStandalone
-  ClassDef( KFParticleBase, 3 )
+  ClassDef( KFParticleBase, 4 )
 #endif
 };
 
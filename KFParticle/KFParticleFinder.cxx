@@ -26,15 +26,36 @@ using std::vector;
 
 #include "KFParticleDatabase.h"
 #include "KFPEmcCluster.h"
+#include "KFPInputData.h"
+
+#include <algorithm>
+#include <functional>
 
 KFParticleFinder::KFParticleFinder():
   fNPV(-1),fNThreads(1),fDistanceCut(1.f),fLCut(-5.f),fCutCharmPt(0.2f),fCutCharmChiPrim(85.f),fCutLVMPt(0.0f),fCutLVMP(0.0f),fCutJPsiPt(1.0f),
+  fCutPi0EmcMinEnergy(0.f), fCutPi0EmcAsymmetry(0.8f), fCutPi0EmcNSigmaMass(3.f),
   fD0(0), fD0bar(0), fD04(0), fD04bar(0), fD0KK(0), fD0pipi(0), fDPlus(0), fDMinus(0), 
   fDPlus3Pi(0), fDMinus3Pi(0), fDsPlusK2Pi(0), fDsMinusK2Pi(0), fLcPlusP2Pi(0), fLcMinusP2Pi(0),
   fLPi(0), fLPiPIndex(0), fHe3Pi(0), fHe3PiBar(0), fHe4Pi(0), fHe4PiBar(0), 
   fHe4L(0), fHe5L(0),  fLLn(0), fH5LL(0),
   fSecCandidates(), fPrimCandidates(), fPrimCandidatesTopo(),fPrimCandidatesTopoMass(),
-  fEmcClusters(0), fMixedEventAnalysis(0), fDecayReconstructionList()
+  fEmcClusters(0), fUsePi0Emc(false), fMixedEventAnalysis(0), fDecayReconstructionList(),
+  fPairGeometryCache(0), fPairGeometryParameters(0), fPairGeometryCacheMaxSize(1u << 22), fNPairGeometryCalculated(0), fNPairGeometryReused(0),
+  fUseV0Prefilter(false), fV0PrefilterNSigmaMass(0.f), fNV0PrefilterTested(0), fNV0PrefilterRejected(0),
+  fTimeNSigmaCut(0.f), fNTimeIncompatiblePairs(0),
+  fMandatoryChannelPriority(1000), fHasDeadline(false), fDeadline(),
+  fTriggerPDG(), fTriggerNCandidates(), fTriggerSelection(), fTriggerNAccepted(), fFiredTriggerCondition(-1), fNTriggerCheckedParticles(0),
+  fCandidateCap(), fCandidateCapFigureOfMerit(), fNDiscardedCandidates(0), fNDiscardedCandidatesPerPDG(), fFinalCandidateHeap(),
+  fBackgroundMassOnly(false), fNBackgroundRotations(1), fBackgroundPDG(), fBackgroundMass(),
+  fKinkMaxDistance(0.f), fKinkMinCosAngle(-1.f), fNKinkPairsTested(0), fNKinkPairsAccepted(0),
+  fKinkGridCellSize(1.f), fKinkGridFirstTrack(), fKinkGridTracks(),
+  fTrackV0TileNV0(0), fTrackV0TileNTracks(0), fTrackV0TileV0s(), fTrackV0TileTracks(), fIsTrackV0TileTrackLoaded(),
+  fNTrackV0Combinations(0), fTrackV0Time(0.), fNTrackV0ExcludedDaughters(),
+  fPIDHypothesisTracks(0), fPIDHypothesisChiToPrimVtx(),
+  fUseNProngCharm(false), fNProngTracks(), fNProngPairTable(), fNProngKeyTracks(), fNProngKey(), fIsNProngPairTableSet(),
+  fNNProngPairs(0), fNNProngTuples(0), fCandidateSoA(),
+  fUseSIMDSelection(false), fNSelectedCandidates(0), fSelectParticlesTime(0.),
+  fCountDaughterIdsStorage(false), fNInlineDaughterIds(0), fNHeapDaughterIds(0)
 {
   /** The default constructor. Initialises all cuts to the default values. **/
   //Cuts
@@ -69,6 +90,13 @@ KFParticleFinder::KFParticleFinder():
   fCutsPartPart[0][0] =  10;  fCutsPartPart[0][1] = 3;  fCutsPartPart[0][2] = 3;
   //Sigma0 -> Lambda Gamma, pi0 -> Gamma Gamma, K* -> K pi0, Sigma*0 -> Lambda pi0, Xi* -> Xi pi0
   fCutsPartPart[1][0] = -10;  fCutsPartPart[1][1] = 3;  fCutsPartPart[1][2] = 3;  
+  
+  //by default the groups of channels are run in the order of KFParticleFinder::ChannelGroup
+  for(int iGroup=0; iGroup<kNChannelGroups; iGroup++)
+  {
+    fChannelGroupPriority[iGroup] = 10*(kNChannelGroups - iGroup);
+    fChannelGroupStatus[iGroup] = kChannelNotRun;
+  }
 }
 
 //________________________________________________________________________________
@@ -107,6 +135,40 @@ void KFParticleFinder::Init(int nPV)
   fLLn.clear();
   fH5LL.clear();
   
+  fNPairGeometryCalculated = 0;
+  fNPairGeometryReused = 0;
+  fNV0PrefilterTested = 0;
+  fNV0PrefilterRejected = 0;
+  fNTimeIncompatiblePairs = 0;
+  for(int iGroup=0; iGroup<kNChannelGroups; iGroup++)
+    fChannelGroupStatus[iGroup] = kChannelNotRun;
+  for(unsigned int iCondition=0; iCondition<fTriggerNAccepted.size(); iCondition++)
+    fTriggerNAccepted[iCondition] = 0;
+  fFiredTriggerCondition = -1;
+  fNTriggerCheckedParticles = 0;
+  fNDiscardedCandidates = 0;
+  fNDiscardedCandidatesPerPDG.clear();
+  fFinalCandidateHeap.clear();
+  fBackgroundPDG.clear();
+  fBackgroundMass.clear();
+  fNKinkPairsTested = 0;
+  fNKinkPairsAccepted = 0;
+  fNTrackV0Combinations = 0;
+  fTrackV0Time = 0.;
+  fNTrackV0ExcludedDaughters.clear();
+  fNNProngPairs = 0;
+  fNNProngTuples = 0;
+  fNSelectedCandidates = 0;
+  fSelectParticlesTime = 0.;
+  fNInlineDaughterIds = 0;
+  fNHeapDaughterIds = 0;
+  for(int iProng=0; iProng<fNProngMax; iProng++)
+  {
+    fNProngKeyTracks[iProng] = 0;
+    for(int jProng=0; jProng<fNProngMax; jProng++)
+      fIsNProngPairTableSet[iProng][jProng] = false;
+  }
+  
   for(int iCandidates=0; iCandidates<fNSecCandidatesSets; iCandidates++)
     fSecCandidates[iCandidates].clear();
   
@@ -135,12 +197,18 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
    ** 1) a new event is initialised; \n
    ** 2) long-lived particles formed from tracks are stored to the output array "Particles"; \n
    ** 3) 2-daughter channels are reconstructed (KFParticleFinder::Find2DaughterDecay()); \n
-   ** 4) the 2-daughter same-signed background is collected for resonances (KFParticleFinder::ConstructPrimaryBG()); \n
+   ** 4) the 2-daughter same-signed background is collected for resonances (KFParticleFinder::ConstructPrimaryBG()), or, if 
+   ** KFParticleFinder::fBackgroundMassOnly is set, only the mass of the like-sign and rotated background is stored
+   ** (KFParticleFinder::FillPrimaryBackground()); \n
    ** 5) found primary candidates of \f$K_s^0\f$, \f$\Lambda\f$, \f$\overline{\Lambda}\f$ and \f$\gamma\f$ are transported
-   ** to the point of the closest approach with the corresponding primary vertex (KFParticleFinder::ExtrapolateToPV()); \n
+   ** to the point of the closest approach with the corresponding primary vertex, the extrapolation is done on the SIMD
+   ** vectors when the candidates are stored (KFParticleFinder::SaveV0PrimSecCand()); \n
    ** 6) reconstruction with the missing mass method (KFParticleFinder::NeutralDaughterDecay()); \n
    ** 7) all other decays are reconstructed one after another. \n
+   ** Alternative PID hypotheses of the tracks (KFPTrackVector::PIDMask()) are checked directly by KFParticleFinder::Find2DaughterDecay(),
+   ** for the other channels tracks are copied for each hypothesis by KFParticleFinder::ExpandPIDHypotheses().
    ** If analysis is run in the mixed event mode only steps 1) and 2) are performed.
+   ** If trigger conditions are set the reconstruction of the channel groups is run in the trigger mode (KFParticleFinder::RunTrigger()).
    ** \param[in] vRTracks - pointer to the array with vectors of tracks:\n
    ** 0) secondary positive at the first hit position; \n
    ** 1) secondary negative at the first hit position; \n
@@ -172,6 +240,7 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
   if(fEmcClusters)
     nEmcClusters = fEmcClusters->Size();
   vector<KFParticle> vGammaPrimEmc;
+  int firstEmcParticle = 0;
 
   int nPartEstimation = nPart+vRTracks[0].Size()+vRTracks[1].Size()+vRTracks[2].Size()+vRTracks[3].Size() + nEmcClusters;
 
@@ -203,6 +272,7 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
       }
     }
 
+    firstEmcParticle = Particles.size();
     if(fEmcClusters)
     {
       KFParticleSIMD tmpGammaSIMD;
@@ -228,25 +298,383 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
 
 
 
+  const int firstCandidate = Particles.size();
+
   Find2DaughterDecay(vRTracks, ChiToPrimVtx,
                      Particles, PrimVtx, fCuts2D,
                      fSecCuts, fPrimCandidates, fSecCandidates);
 
+  // only the two-daughter channels read the alternative PID hypotheses from KFPTrackVector::PIDMask(), the other channels
+  // get a copy of each track for each of its hypotheses
+  if(ExpandPIDHypotheses(vRTracks, ChiToPrimVtx))
+  {
+    vRTracks = fPIDHypothesisTracks;
+    ChiToPrimVtx = fPIDHypothesisChiToPrimVtx;
+  }
+
   if(!fMixedEventAnalysis)
   {
-    //Construct two-particle background from positive primary tracks for subtraction from the resonance spectra
-    ConstructPrimaryBG(vRTracks, Particles, PrimVtx, fCuts2D, fSecCuts, fPrimCandidates, fSecCandidates);
+    // primary K0s, Lambda, Lambda_bar and gamma are already extrapolated to the primary vertex by SaveV0PrimSecCand()
     
-    for(int iPV=0; iPV<fNPV; iPV++ )
+    if(!(fTriggerPDG.empty()))
+      RunTrigger(vRTracks, ChiToPrimVtx, Particles, PrimVtx, firstEmcParticle);
+    else
     {
-      ExtrapolateToPV(fPrimCandidates[0][iPV],PrimVtx[iPV]);
-      ExtrapolateToPV(fPrimCandidates[1][iPV],PrimVtx[iPV]);
-      ExtrapolateToPV(fPrimCandidates[2][iPV],PrimVtx[iPV]);
-      ExtrapolateToPV(fPrimCandidates[3][iPV],PrimVtx[iPV]);
+      // the channel groups are run in the order of their priority, the groups with the low priority can be skipped
+      // if the latency budget is exceeded
+      int groupOrder[kNChannelGroups];
+      for(int iGroup=0; iGroup<kNChannelGroups; iGroup++)
+        groupOrder[iGroup] = iGroup;
+      for(int iGroup=1; iGroup<kNChannelGroups; iGroup++)
+        for(int jGroup=iGroup; jGroup>0 && fChannelGroupPriority[groupOrder[jGroup]] > fChannelGroupPriority[groupOrder[jGroup-1]]; jGroup--)
+          std::swap(groupOrder[jGroup], groupOrder[jGroup-1]);
+      
+      for(int iGroup=0; iGroup<kNChannelGroups; iGroup++)
+        RunChannelGroup(groupOrder[iGroup], vRTracks, ChiToPrimVtx, Particles, PrimVtx, firstEmcParticle);
     }
     
-    NeutralDaughterDecay(vRTracks, Particles);
+    //reconstruct particles with daughters in ElectroMagnetic Calorimeter
+//     if(fEmcClusters)
+//     {
+//       //pi0 -> gamma gamma, EMC
+//       vector< vector<KFParticle> > vPi0PrimEmc(1);
+//       vector<KFParticle> vPi0SecEmc;
+//       vector< vector<KFParticle> > vD0PrimEmc(1);
+//       CombinePartPart(vGammaPrimEmc, vGammaPrimEmc, Particles, PrimVtx, fCutsPartPart[1], 0, 111, 1, 0, &vPi0PrimEmc, &vPi0SecEmc, mPi0, mPi0Sigma);
+//           
+//       //D+ -> K0 pi+
+//       FindTrackV0Decay(fSecCandidates[0],    310, vRTracks[0],  1, vRTracks[0].FirstPion(), vRTracks[0].LastPion(), Particles, PrimVtx, -1/*, &(ChiToPrimVtx[0])*/);
+//       //D0 -> K0 pi+ pi-
+//       FindTrackV0Decay(fK0PiPlus, 100411, vRTracks[1], -1, vRTracks[1].FirstPion(), vRTracks[1].LastPion(), Particles, PrimVtx, -1/*, &(ChiToPrimVtx[0])*/);
+//       //D0 -> K0 pi+ pi- pi0
+//       CombinePartPart(fK0PiPi, vPi0PrimEmc[0], Particles, PrimVtx, fCutsPartPart[1], -1, 428, 0, 0, &vD0PrimEmc, 0, 
+//                       KFParticleDatabase::Instance()->GetD0Mass(), 0.025);
+//       
+//       for(int iPV=0; iPV<1; iPV++ )
+//       {
+//         ExtrapolateToPV(vPi0PrimEmc[iPV],PrimVtx[iPV]);
+//         ExtrapolateToPV(vD0PrimEmc[iPV],PrimVtx[iPV]);
+//       }
+//       //D0* -> D0 pi0
+//       CombinePartPart(vD0PrimEmc[0], vPi0PrimEmc[0], Particles, PrimVtx, fCutsPartPart[1], 0, 10428);
+//     }
+  }
+  else
+  {
+    //D0 -> pi+ K-
+    SelectParticles(Particles,fD0,PrimVtx,fCutsCharm[2],fCutsCharm[1],
+                    KFParticleDatabase::Instance()->GetD0Mass(), KFParticleDatabase::Instance()->GetD0MassSigma(), fSecCuts[0]);
+    //D0_bar -> pi+ K-
+    SelectParticles(Particles,fD0bar,PrimVtx,fCutsCharm[2],fCutsCharm[1],
+                    KFParticleDatabase::Instance()->GetD0Mass(), KFParticleDatabase::Instance()->GetD0MassSigma(), fSecCuts[0]);
+  }
+  
+  ApplyCandidateCaps(Particles, firstCandidate);
+  if(fCountDaughterIdsStorage)
+    CountDaughterIdsStorage(Particles);
+}
+
+int KFParticleFinder::GetChannelGroupOfPDG(int pdg)
+{
+  /** Returns the group of channels, which reconstructs particles with the PDG code "pdg", see KFParticleFinder::ChannelGroup.
+   ** "-1" is returned for particles reconstructed by KFParticleFinder::Find2DaughterDecay(), KFParticleFinder::kNChannelGroups -
+   ** if the PDG code is not known and all groups should be run.
+   ** \param[in] pdg - PDG code of the particle
+   **/
+  const int absPDG = abs(pdg);
+  
+  // D0 candidates of the 2-daughter stage are stored only after the selection in KFParticleFinder::ReconstructOpenCharm()
+  const int nTwoDaughter = 17;
+  const int twoDaughterPDG[nTwoDaughter] = { 22, 113, 100113, 200113, 310, 313, 333, 443, 100443, 2114, 3003, 3103, 3004, 3005, 3122, 3124, 200443 };
+  for(int iPDG=0; iPDG<nTwoDaughter; iPDG++)
+    if(absPDG == twoDaughterPDG[iPDG]) return -1;
+  
+  if(absPDG >= 7000000 && absPDG < 10000000) return kKinks;
+  if(absPDG == 3312 || absPDG == 3334) return kStrangeBaryons;
+  
+  const int nResonances = 6;
+  const int resonancePDG[nResonances] = { 323, 3114, 3224, 3324, 1003314, 1003334 };
+  for(int iPDG=0; iPDG<nResonances; iPDG++)
+    if(absPDG == resonancePDG[iPDG]) return kResonances;
+  
+  if( (absPDG >= 3006 && absPDG <= 3011) || absPDG == 3203 ) return kHypernuclei;
+  if(absPDG >= 3000 && absPDG <= 3002) return kDibaryons;
+  
+  const int nPi0Channels = 11;
+  const int pi0ChannelPDG[nPi0Channels] = { 111, 3212, 3214, 3222, 3314, 3322, 100313, 100323, 300443, 400443, 500443 };
+  for(int iPDG=0; iPDG<nPi0Channels; iPDG++)
+    if(absPDG == pi0ChannelPDG[iPDG]) return kPi0Channels;
+  
+  if( (absPDG >= 9001 && absPDG <= 9004) || absPDG == 2224 ) return kBackground;
+  
+  //open charm and beauty: D, Ds, Lambdac, Xic and B hadrons with all their excited states and decay modes
+  const int flavour = absPDG % 10000;
+  if( (flavour >= 400 && flavour < 600) || (flavour >= 4000 && flavour < 6000) ) return kCharm;
+  
+  return kNChannelGroups;
+}
+
+bool KFParticleFinder::IsLastHitTracksNeeded() const
+{
+  /** Returns true if the tracks at the last hit position (sets 4-7, see KFParticleFinder::FindParticles()) are used in the 
+   ** current configuration. They are needed only by the missing mass method (KFParticleFinder::NeutralDaughterDecay()), which 
+   ** is run if it is requested by one of the trigger conditions in the trigger mode, or if the reconstruction list is empty or
+   ** contains a particle reconstructed by this method. KFParticleTopoReconstructor does not copy and sort these tracks otherwise.
+   **/
+  if(fMixedEventAnalysis) return false;
+  
+  if(!(fTriggerPDG.empty()))
+  {
+    for(unsigned int iCondition=0; iCondition<fTriggerPDG.size(); iCondition++)
+    {
+      const int group = GetChannelGroupOfPDG(fTriggerPDG[iCondition]);
+      if(group == kKinks || group == kNChannelGroups) return true;
+    }
+    return false;
+  }
+  
+  if(fDecayReconstructionList.empty()) return true;
+  for(std::map<int,bool>::const_iterator it=fDecayReconstructionList.begin(); it!=fDecayReconstructionList.end(); it++)
+    if(GetChannelGroupOfPDG(it->first) == kKinks) return true;
+  return false;
+}
+
+bool KFParticleFinder::ExpandPIDHypotheses(KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx)
+{
+  /** Copies the tracks to KFParticleFinder::fPIDHypothesisTracks adding a copy of the track for each of its alternative
+   ** PID hypotheses from KFPTrackVector::PIDMask(). The copies keep the Id of the track, have the PDG code of the hypothesis and
+   ** an empty mask, the tracks are sorted according to the PDG code as by KFParticleTopoReconstructor::SortTracks(). Returns 
+   ** false and does nothing if no track has an alternative hypothesis.
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[in] ChiToPrimVtx - arrays with vectors of the \f$\chi^2_{prim}\f$ deviations for secondary tracks.
+   **/
+  vector<KFPTrackIndex> sortedTracks[4];
+  bool hasHypotheses = false;
+  for(int iTV=0; iTV<4; iTV++)
+  {
+    const KFPTrackVector& tracks = vRTracks[iTV];
+    for(int iTr=0; iTr<tracks.Size(); iTr++)
+    {
+      KFPTrackIndex index;
+      index.fIndex = iTr;
+      index.fPdg = tracks.PDG()[iTr];
+      sortedTracks[iTV].push_back(index);
+      
+      const int pidMask = tracks.PIDMask()[iTr];
+      if(pidMask == 0) continue;
+      for(int iSpecies=0; iSpecies<KFPTrackVector::kNPIDSpecies; iSpecies++)
+      {
+        if(!(pidMask & (1 << iSpecies))) continue;
+        index.fPdg = KFPTrackVector::PDGOfSpecies(iSpecies, tracks.Q()[iTr]);
+        if(index.fPdg == tracks.PDG()[iTr]) continue;
+        sortedTracks[iTV].push_back(index);
+        hasHypotheses = true;
+      }
+    }
+  }
+  if(!hasHypotheses) return false;
+  
+  if(!fPIDHypothesisTracks)
+    fPIDHypothesisTracks = new KFPTrackVector[8];
+  for(int iTV=0; iTV<4; iTV++)
+  {
+    const int nTracks = sortedTracks[iTV].size();
+    std::stable_sort(sortedTracks[iTV].begin(), sortedTracks[iTV].end(), KFPTrackIndex::Compare);
+    kfvector_uint trackIndex(((nTracks + float_vLen - 1)/float_vLen)*float_vLen, 0);
+    for(int iTr=0; iTr<nTracks; iTr++)
+      trackIndex[iTr] = sortedTracks[iTV][iTr].fIndex;
+    
+    // the tracks at the last hit position, if they are provided, are copied in the same order
+    for(int iSet=0; iSet<2; iSet++)
+    {
+      KFPTrackVector& tracks = fPIDHypothesisTracks[iTV + 4*iSet];
+      tracks.Resize(0);
+      if(vRTracks[iTV + 4*iSet].Size() == 0) continue;
+      tracks.SetTracks(vRTracks[iTV + 4*iSet], trackIndex, nTracks);
+      for(int iTr=0; iTr<nTracks; iTr++)
+      {
+        tracks.SetPDG(sortedTracks[iTV][iTr].fPdg, iTr);
+        tracks.SetPIDMask(0, iTr);
+      }
+      tracks.RecalculateLastIndex();
+    }
+    
+    if(iTV < 2)
+    {
+      fPIDHypothesisChiToPrimVtx[iTV].resize(nTracks);
+      for(int iTr=0; iTr<nTracks; iTr++)
+        fPIDHypothesisChiToPrimVtx[iTV][iTr] = ChiToPrimVtx[iTV][trackIndex[iTr]];
+    }
+  }
+  return true;
+}
+
+bool KFParticleFinder::CheckTriggerConditions(const vector<KFParticle>& Particles)
+{
+  /** Checks the particles added to the output array since the previous call against the trigger conditions.
+   ** Returns true if one of the conditions is fulfilled, the index of the condition is stored to KFParticleFinder::fFiredTriggerCondition.
+   ** \param[in] Particles - output vector with particles.
+   **/
+  // a condition can be fulfilled by a candidate, which has replaced an already checked one, see KFParticleFinder::AddFinalCandidate()
+  for(unsigned int iCondition=0; iCondition<fTriggerPDG.size(); iCondition++)
+  {
+    if(fTriggerNAccepted[iCondition] > 0 && fTriggerNAccepted[iCondition] >= fTriggerNCandidates[iCondition])
+    {
+      fFiredTriggerCondition = iCondition;
+      return true;
+    }
+  }
+  
+  for(; fNTriggerCheckedParticles<Particles.size(); fNTriggerCheckedParticles++)
+  {
+    const KFParticle& particle = Particles[fNTriggerCheckedParticles];
+    for(unsigned int iCondition=0; iCondition<fTriggerPDG.size(); iCondition++)
+    {
+      if(!IsAcceptedByTrigger(particle, iCondition)) continue;
+      
+      fTriggerNAccepted[iCondition]++;
+      if(fTriggerNAccepted[iCondition] >= fTriggerNCandidates[iCondition])
+      {
+        fFiredTriggerCondition = iCondition;
+        fNTriggerCheckedParticles++;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool KFParticleFinder::IsAcceptedByTrigger(const KFParticle& particle, const unsigned int iCondition) const
+{
+  /** Returns true if the particle is accepted by the trigger condition with index "iCondition".
+   ** \param[in] particle - particle to be checked
+   ** \param[in] iCondition - index of the trigger condition
+   **/
+  if(particle.GetPDG() != fTriggerPDG[iCondition]) return false;
+  return !fTriggerSelection[iCondition] || fTriggerSelection[iCondition](particle);
+}
+
+void KFParticleFinder::RunTrigger(KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx, vector<KFParticle>& Particles,
+                                  std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx, const int firstEmcParticle)
+{
+  /** Runs the trigger mode. Only groups of channels, which produce particles of the trigger conditions, are run together with
+   ** their prerequisites, groups are ordered by their cost starting from the cheapest one. The trigger conditions are checked
+   ** after 2-daughter decays and after each group, the reconstruction is stopped as soon as one of the conditions is fulfilled.
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[in] ChiToPrimVtx - arrays with vectors of the \f$\chi^2_{prim}\f$ deviations for secondary tracks.
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   ** \param[in] firstEmcParticle - index of the first gamma from EMC clusters in "Particles".
+   **/
+  if(CheckTriggerConditions(Particles)) return;
+  
+  bool isGroupNeeded[kNChannelGroups];
+  for(int iGroup=0; iGroup<kNChannelGroups; iGroup++)
+    isGroupNeeded[iGroup] = false;
+  for(unsigned int iCondition=0; iCondition<fTriggerPDG.size(); iCondition++)
+  {
+    const int group = GetChannelGroupOfPDG(fTriggerPDG[iCondition]);
+    if(group == kNChannelGroups)
+    {
+      for(int iGroup=0; iGroup<kNChannelGroups; iGroup++)
+        isGroupNeeded[iGroup] = true;
+    }
+    else if(group >= 0)
+      isGroupNeeded[group] = true;
+  }
+  
+  //groups sorted according to the estimated combinatorics starting from the cheapest one
+  const int groupCostOrder[kNChannelGroups] = { kStrangeBaryons, kDibaryons, kHypernuclei, kResonances, 
+                                                kKinks, kPi0Channels, kCharm, kBackground };
+  for(int iGroup=0; iGroup<kNChannelGroups; iGroup++)
+  {
+    const int group = groupCostOrder[iGroup];
+    if(!isGroupNeeded[group]) continue;
     
+    RunChannelGroup(group, vRTracks, ChiToPrimVtx, Particles, PrimVtx, firstEmcParticle);
+    if(CheckTriggerConditions(Particles)) return;
+  }
+}
+
+void KFParticleFinder::RunChannelGroup(const int iGroup, KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx, vector<KFParticle>& Particles,
+                                       std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx, const int firstEmcParticle,
+                                       const bool isPrerequisite)
+{
+  /** Runs a group of channels if it was not run yet. If the latency budget is exceeded the group is skipped unless
+   ** its priority is not lower than KFParticleFinder::fMandatoryChannelPriority. Once the group passed this check,
+   ** groups, which provide input candidates for it, are run first independently of their priority and of the budget,
+   ** also if they were skipped before.
+   ** \param[in] iGroup - index of the group, see KFParticleFinder::ChannelGroup
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[in] ChiToPrimVtx - arrays with vectors of the \f$\chi^2_{prim}\f$ deviations for secondary tracks.
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   ** \param[in] firstEmcParticle - index of the first gamma from EMC clusters in "Particles".
+   ** \param[in] isPrerequisite - if true, the group provides input for the group, which is being run, and is run unconditionally.
+   **/
+  if( (fChannelGroupStatus[iGroup] != kChannelNotRun) && !(isPrerequisite && fChannelGroupStatus[iGroup] == kChannelSkipped) ) return;
+  
+  if( !isPrerequisite && (fChannelGroupPriority[iGroup] < fMandatoryChannelPriority) && IsOverBudget() )
+  {
+    fChannelGroupStatus[iGroup] = kChannelSkipped;
+    return;
+  }
+  
+  // Xi and Omega are daughters of resonances, charmed baryons and charmonium, the Lambda pi- pairs for H0 -> Lambda p pi-
+  // are collected together with Xi-
+  if(iGroup == kResonances || iGroup == kCharm || iGroup == kPi0Channels || iGroup == kDibaryons)
+    RunChannelGroup(kStrangeBaryons, vRTracks, ChiToPrimVtx, Particles, PrimVtx, firstEmcParticle, true);
+  
+  fChannelGroupStatus[iGroup] = kChannelDone;
+  
+  switch(iGroup)
+  {
+    case kBackground:     ReconstructBackground(vRTracks, Particles, PrimVtx); break;
+    case kKinks:          NeutralDaughterDecay(vRTracks, Particles); break;
+    case kStrangeBaryons: ReconstructStrangeBaryons(vRTracks, ChiToPrimVtx, Particles, PrimVtx); break;
+    case kResonances:     ReconstructResonances(vRTracks, Particles, PrimVtx); break;
+    case kHypernuclei:    ReconstructHypernuclei(vRTracks, Particles, PrimVtx); break;
+    case kCharm:          ReconstructOpenCharm(vRTracks, ChiToPrimVtx, Particles, PrimVtx); break;
+    case kDibaryons:      ReconstructDibaryons(vRTracks, Particles, PrimVtx); break;
+    case kPi0Channels:    ReconstructPi0Channels(vRTracks, Particles, PrimVtx, firstEmcParticle); break;
+  }
+}
+
+bool KFParticleFinder::IsPartiallyProcessed() const
+{
+  /** Returns true if at least one group of channels was skipped or truncated in the current event because of the latency budget. */
+  for(int iGroup=0; iGroup<kNChannelGroups; iGroup++)
+    if(fChannelGroupStatus[iGroup] == kChannelSkipped || fChannelGroupStatus[iGroup] == kChannelTruncated)
+      return true;
+  return false;
+}
+
+void KFParticleFinder::ReconstructBackground(KFPTrackVector* vRTracks, vector<KFParticle>& Particles,
+                                             std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx)
+{
+  /** Constructs the two-particle background from primary tracks for subtraction from the resonance spectra
+   ** (group KFParticleFinder::kBackground).
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   **/
+  //Construct two-particle background from primary tracks for subtraction from the resonance spectra
+  if(fBackgroundMassOnly)
+    FillPrimaryBackground(vRTracks, PrimVtx);
+  else
+    ConstructPrimaryBG(vRTracks, Particles, PrimVtx, fCuts2D, fSecCuts, fPrimCandidates, fSecCandidates);
+}
+
+void KFParticleFinder::ReconstructStrangeBaryons(KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx, vector<KFParticle>& Particles,
+                                                 std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx)
+{
+  /** Reconstructs \f$\Xi^\pm\f$ and \f$\Omega^\pm\f$ and extrapolates primary candidates to the primary vertex
+   ** (group KFParticleFinder::kStrangeBaryons).
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[in] ChiToPrimVtx - arrays with vectors of the \f$\chi^2_{prim}\f$ deviations for secondary tracks.
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   **/
     //Xi- -> Lambda pi-, Omega- -> Lambda K-
     FindTrackV0Decay(fSecCandidates[1], 3122, vRTracks[1], -1, vRTracks[1].FirstPion(), vRTracks[1].LastKaon(),
                     Particles, PrimVtx, -1, &(ChiToPrimVtx[1]), &fPrimCandidates[5]);
@@ -258,11 +686,20 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     {
       ExtrapolateToPV(fPrimCandidates[5][iPV],PrimVtx[iPV]);
       ExtrapolateToPV(fPrimCandidates[6][iPV],PrimVtx[iPV]);
-      
+
       ExtrapolateToPV(fPrimCandidates[7][iPV],PrimVtx[iPV]);
       ExtrapolateToPV(fPrimCandidates[8][iPV],PrimVtx[iPV]);
     }
+}
 
+void KFParticleFinder::ReconstructResonances(KFPTrackVector* vRTracks, vector<KFParticle>& Particles,
+                                             std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx)
+{
+  /** Reconstructs strange resonances \f$K^*\f$, \f$\Sigma^*\f$, \f$\Xi^*\f$, \f$\Omega^*\f$ (group KFParticleFinder::kResonances).
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   **/
     //K*+ -> K0 pi+
     for(int iPV=0; iPV<fNPV; iPV++)
       FindTrackV0Decay(fPrimCandidates[0][iPV], 310, vRTracks[2], 1, vRTracks[2].FirstPion(), vRTracks[2].LastPion(),
@@ -303,6 +740,16 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     for(int iPV=0; iPV<fNPV; iPV++)
       FindTrackV0Decay(fPrimCandidates[10][iPV], -3324, vRTracks[2], 1, vRTracks[2].FirstKaon(), vRTracks[2].LastKaon(),
                         Particles, PrimVtx, iPV, 0);
+}
+
+void KFParticleFinder::ReconstructHypernuclei(KFPTrackVector* vRTracks, vector<KFParticle>& Particles,
+                                              std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx)
+{
+  /** Reconstructs hypernuclei with three and more daughters (group KFParticleFinder::kHypernuclei).
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   **/
     //Hypernuclei
     //He4L -> He3 p pi-
     FindTrackV0Decay(fHe3Pi   , 3004, vRTracks[0],  1, vRTracks[0].FirstProton(), vRTracks[0].LastProton(), Particles, PrimVtx, -1, 0, 0, &fHe4L);
@@ -322,19 +769,65 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     FindTrackV0Decay(fLLn     , 3203, vRTracks[0],  1, vRTracks[0].FirstProton(), vRTracks[0].LastProton(), Particles, PrimVtx, -1, 0 );
     //He6LL -> He5L p pi-
     FindTrackV0Decay(fH5LL    , 3010, vRTracks[0],  1, vRTracks[0].FirstProton(), vRTracks[0].LastProton(), Particles, PrimVtx, -1, 0 );
+}
+
+void KFParticleFinder::ReconstructOpenCharm(KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx, vector<KFParticle>& Particles,
+                                            std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx)
+{
+  /** Reconstructs open charm and beauty particles (group KFParticleFinder::kCharm). If the latency budget
+   ** is exceeded the reconstruction is stopped between the blocks of channels and the group is marked as truncated.
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[in] ChiToPrimVtx - arrays with vectors of the \f$\chi^2_{prim}\f$ deviations for secondary tracks.
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   **/
     // Charm
+    if(fUseNProngCharm)
+    {
+      //D+ -> K- pi+ pi+
+      KFPTrackVector* dPlusTracks[3] = {&vRTracks[1], &vRTracks[0], &vRTracks[0]};
+      kfvector_float* dPlusChiPrim[3] = {&ChiToPrimVtx[1], &ChiToPrimVtx[0], &ChiToPrimVtx[0]};
+      const int dPlusPDG[3] = {-321, 211, 211};
+      const int dPlusFirst[3] = {vRTracks[1].FirstKaon(), vRTracks[0].FirstPion(), vRTracks[0].FirstPion()};
+      const int dPlusLast[3] = {vRTracks[1].LastKaon(), vRTracks[0].LastPion(), vRTracks[0].LastPion()};
+      FindNProngDecay(fDPlus, 411, 3, dPlusTracks, dPlusChiPrim, dPlusPDG, dPlusFirst, dPlusLast, PrimVtx);
+      //D0 -> K- pi+ pi+ pi-
+      KFPTrackVector* d04Tracks[4] = {&vRTracks[1], &vRTracks[0], &vRTracks[0], &vRTracks[1]};
+      kfvector_float* d04ChiPrim[4] = {&ChiToPrimVtx[1], &ChiToPrimVtx[0], &ChiToPrimVtx[0], &ChiToPrimVtx[1]};
+      const int d04PDG[4] = {-321, 211, 211, -211};
+      const int d04First[4] = {vRTracks[1].FirstKaon(), vRTracks[0].FirstPion(), vRTracks[0].FirstPion(), vRTracks[1].FirstPion()};
+      const int d04Last[4] = {vRTracks[1].LastKaon(), vRTracks[0].LastPion(), vRTracks[0].LastPion(), vRTracks[1].LastPion()};
+      FindNProngDecay(fD04, 429, 4, d04Tracks, d04ChiPrim, d04PDG, d04First, d04Last, PrimVtx);
+      //D- -> K+ pi- pi-
+      KFPTrackVector* dMinusTracks[3] = {&vRTracks[0], &vRTracks[1], &vRTracks[1]};
+      kfvector_float* dMinusChiPrim[3] = {&ChiToPrimVtx[0], &ChiToPrimVtx[1], &ChiToPrimVtx[1]};
+      const int dMinusPDG[3] = {321, -211, -211};
+      const int dMinusFirst[3] = {vRTracks[0].FirstKaon(), vRTracks[1].FirstPion(), vRTracks[1].FirstPion()};
+      const int dMinusLast[3] = {vRTracks[0].LastKaon(), vRTracks[1].LastPion(), vRTracks[1].LastPion()};
+      FindNProngDecay(fDMinus, -411, 3, dMinusTracks, dMinusChiPrim, dMinusPDG, dMinusFirst, dMinusLast, PrimVtx);
+      //D0_bar -> K+ pi- pi- pi+
+      KFPTrackVector* d04barTracks[4] = {&vRTracks[0], &vRTracks[1], &vRTracks[1], &vRTracks[0]};
+      kfvector_float* d04barChiPrim[4] = {&ChiToPrimVtx[0], &ChiToPrimVtx[1], &ChiToPrimVtx[1], &ChiToPrimVtx[0]};
+      const int d04barPDG[4] = {321, -211, -211, 211};
+      const int d04barFirst[4] = {vRTracks[0].FirstKaon(), vRTracks[1].FirstPion(), vRTracks[1].FirstPion(), vRTracks[0].FirstPion()};
+      const int d04barLast[4] = {vRTracks[0].LastKaon(), vRTracks[1].LastPion(), vRTracks[1].LastPion(), vRTracks[0].LastPion()};
+      FindNProngDecay(fD04bar, -429, 4, d04barTracks, d04barChiPrim, d04barPDG, d04barFirst, d04barLast, PrimVtx);
+    }
     //LambdaC -> pi+ K- p, Ds+ -> pi+ K- K+, D+ -> pi+ K- pi+
     FindTrackV0Decay(fD0, 421, vRTracks[0], 1, vRTracks[0].FirstPion(), vRTracks[0].LastProton(),
                     Particles, PrimVtx, -1, &(ChiToPrimVtx[0]));
     //LambdaC_bar -> pi- K+ p-, Ds- -> pi- K+ K-, D- -> pi- K+ pi-
     FindTrackV0Decay(fD0bar, -421, vRTracks[1], -1, vRTracks[1].FirstPion(), vRTracks[1].LastProton(),
                     Particles, PrimVtx, -1, &(ChiToPrimVtx[1]));    
-    //D0->pi+ K- pi+ pi-
-    FindTrackV0Decay(fDPlus, 411, vRTracks[1], -1, vRTracks[1].FirstPion(), vRTracks[1].LastPion(),
-                    Particles, PrimVtx, -1, &(ChiToPrimVtx[1]));
-    //D0_bar->pi- K+ pi- pi+
-    FindTrackV0Decay(fDMinus, -411, vRTracks[0], 1, vRTracks[0].FirstPion(), vRTracks[0].LastPion(),
-                    Particles, PrimVtx, -1, &(ChiToPrimVtx[0]));
+    if(!fUseNProngCharm)
+    {
+      //D0->pi+ K- pi+ pi-
+      FindTrackV0Decay(fDPlus, 411, vRTracks[1], -1, vRTracks[1].FirstPion(), vRTracks[1].LastPion(),
+                      Particles, PrimVtx, -1, &(ChiToPrimVtx[1]));
+      //D0_bar->pi- K+ pi- pi+
+      FindTrackV0Decay(fDMinus, -411, vRTracks[0], 1, vRTracks[0].FirstPion(), vRTracks[0].LastPion(),
+                      Particles, PrimVtx, -1, &(ChiToPrimVtx[0]));
+    }
     //B+ -> D0_bar pi+, B+ -> D0_bar K+
     FindTrackV0Decay(fD0bar, -421, vRTracks[0], 1, vRTracks[0].FirstPion(), vRTracks[0].LastKaon(),
                      Particles, PrimVtx, -1, &(ChiToPrimVtx[0]));    
@@ -389,7 +882,13 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     for(int iPV=0; iPV<fNPV; iPV++)
       FindTrackV0Decay(fDMinus, -411, vRTracks[2], 1, vRTracks[2].FirstPion(), vRTracks[2].LastPion(),
                         Particles, PrimVtx, iPV, 0);
-    
+
+    if(IsOverBudget())
+    {
+      fChannelGroupStatus[kCharm] = kChannelTruncated;
+      return;
+    }
+
     float cutsD0[3] = {fCutsCharm[1], fCutsCharm[2], fCutsCharm[0]};
 //     float cutsD0[3] = {-5, 1e10, 1e10}; 
     //D0 -> K0 pi+ pi-
@@ -398,15 +897,15 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     //D0 -> K0 K+ K-
     for(int iPV=0; iPV<fNPV; iPV++)
       CombinePartPart(fD0KK, fPrimCandidates[0][iPV], Particles, PrimVtx, cutsD0, -1, 427, 0, 1);
-    
-    
+
+
     //LambdaC -> p pi+ pi-, Ds+ -> K+ pi+ pi-, D+ -> pi+ pi+ pi-
     FindTrackV0Decay(fD0pipi, 420, vRTracks[0], 1, vRTracks[0].FirstPion(), vRTracks[0].LastProton(),
                      Particles, PrimVtx, -1, &(ChiToPrimVtx[0]));
     //LambdaC_bar -> p_bar pi+ pi-, Ds- -> K- pi+ pi-, D- -> pi+ pi- pi-
     FindTrackV0Decay(fD0pipi, 420, vRTracks[1],-1, vRTracks[1].FirstPion(), vRTracks[1].LastProton(),
                      Particles, PrimVtx, -1, &(ChiToPrimVtx[1]));
-    
+
     //D+ -> K0 pi+ pi+ pi-
     for(int iPV=0; iPV<fNPV; iPV++)
       CombinePartPart(fDPlus3Pi, fPrimCandidates[0][iPV], Particles, PrimVtx, cutsD0, -1, 200411, 0, 1);
@@ -425,21 +924,21 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     //Xic0_bar -> Xi+ pi+ pi- pi-
     for(int iPV=0; iPV<fNPV; iPV++)
       CombinePartPart(fDMinus3Pi, fPrimCandidates[6][iPV], Particles, PrimVtx, cutsD0, -1, -4132, 0, 1);
-    
+
     //Ds+ -> K0 K+ pi+ pi-
     for(int iPV=0; iPV<fNPV; iPV++)
       CombinePartPart(fDsPlusK2Pi, fPrimCandidates[0][iPV], Particles, PrimVtx, cutsD0, -1, 300431, 0, 1);
     //Ds- -> K0 K- pi+ pi-
     for(int iPV=0; iPV<fNPV; iPV++)
       CombinePartPart(fDsMinusK2Pi, fPrimCandidates[0][iPV], Particles, PrimVtx, cutsD0, -1, -300431, 0, 1);
-    
+
     //Lc+ -> p K0 pi+ pi-
     for(int iPV=0; iPV<fNPV; iPV++)
       CombinePartPart(fLcPlusP2Pi, fPrimCandidates[0][iPV], Particles, PrimVtx, cutsD0, -1, 204122, 0, 1);
     //Lc- -> p- K0 pi+ pi-
     for(int iPV=0; iPV<fNPV; iPV++)
       CombinePartPart(fLcMinusP2Pi, fPrimCandidates[0][iPV], Particles, PrimVtx, cutsD0, -1, -204122, 0, 1);
-    
+
     //D0 -> pi+ pi-
     SelectParticles(Particles,fD0pipi,PrimVtx,fCutsCharm[2],fCutsCharm[1],
                     KFParticleDatabase::Instance()->GetD0Mass(), KFParticleDatabase::Instance()->GetD0MassSigma(), fSecCuts[0]);
@@ -464,8 +963,14 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     //LambdaC_bar -> p_bar pi+ pi-
     SelectParticles(Particles,fLcMinusP2Pi,PrimVtx,fCutsCharm[2],fCutsCharm[1],
                     KFParticleDatabase::Instance()->GetD0Mass(), KFParticleDatabase::Instance()->GetD0MassSigma(), fSecCuts[0]);
-    
-    
+
+
+    if(IsOverBudget())
+    {
+      fChannelGroupStatus[kCharm] = kChannelTruncated;
+      return;
+    }
+
     //D+ -> K0 pi+
     for(int iPV=0; iPV<fNPV; iPV++)
       FindTrackV0Decay(fPrimCandidates[0][iPV], 310, vRTracks[0],  1, vRTracks[0].FirstPion(), vRTracks[0].LastPion(),
@@ -482,6 +987,12 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     for(int iPV=0; iPV<fNPV; iPV++)
       FindTrackV0Decay(fPrimCandidates[0][iPV], 310, vRTracks[1], -1, vRTracks[1].FirstKaon(), vRTracks[1].LastKaon(),
                        Particles, PrimVtx, -1, &(ChiToPrimVtx[1]) );      
+    if(IsOverBudget())
+    {
+      fChannelGroupStatus[kCharm] = kChannelTruncated;
+      return;
+    }
+
     //Lambdac+ -> Lambda pi+
     for(int iPV=0; iPV<fNPV; iPV++)
       FindTrackV0Decay(fPrimCandidates[1][iPV], 3122, vRTracks[0], 1, vRTracks[0].FirstPion(), vRTracks[0].LastPion(),
@@ -498,12 +1009,34 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     for(int iPV=0; iPV<fNPV; iPV++)
       FindTrackV0Decay(fPrimCandidates[0][iPV], 310, vRTracks[1], -1, vRTracks[1].FirstProton(), vRTracks[1].LastProton(),
                        Particles, PrimVtx, -1, &(ChiToPrimVtx[1]) );   
-      
+}
+
+void KFParticleFinder::ReconstructDibaryons(KFPTrackVector* vRTracks, vector<KFParticle>& Particles,
+                                            std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx)
+{
+  /** Reconstructs H0 dibaryon (group KFParticleFinder::kDibaryons). The Lambda pi- pairs are collected by 
+   ** KFParticleFinder::ReconstructStrangeBaryons(), the group KFParticleFinder::kStrangeBaryons is run first.
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   **/
     //H0 -> Lambda Lambda
     CombinePartPart(fSecCandidates[1], fSecCandidates[1], Particles, PrimVtx, fCutsPartPart[0], -1, 3000, 1, 1);
     //H0 -> Lambda p pi-
     FindTrackV0Decay(fLPi, 3002, vRTracks[0], 1, vRTracks[0].FirstProton(), vRTracks[0].LastProton(),
                       Particles, PrimVtx, -1);
+}
+
+void KFParticleFinder::ReconstructPi0Channels(KFPTrackVector* vRTracks, vector<KFParticle>& Particles,
+                                              std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx, const int firstEmcParticle)
+{
+  /** Reconstructs \f$\Sigma^0\f$, \f$\pi^0\f$ and decays with \f$\pi^0\f$ in the final state, charmonium decays into hyperons
+   ** (group KFParticleFinder::kPi0Channels).
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks, see KFParticleFinder::FindParticles()
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   ** \param[in] firstEmcParticle - index of the first gamma from EMC clusters in "Particles".
+   **/
     //Sigma0 -> Lambda Gamma
     for(int iPV=0; iPV<fNPV; iPV++)
       CombinePartPart(fPrimCandidates[3][iPV], fPrimCandidates[1][iPV], Particles, PrimVtx, fCutsPartPart[1], iPV, 3212);
@@ -519,6 +1052,9 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
       CombinePartPart(fPrimCandidates[3][iPV], fPrimCandidates[3][iPV], Particles, PrimVtx, fCutsPartPart[1], iPV, 111, 1, 0, &fPrimCandidates[4], &fSecCandidates[4], mPi0, mPi0Sigma);
       CombinePartPart(fSecCandidates[3],       fPrimCandidates[3][iPV], Particles, PrimVtx, fCutsPartPart[1],  -1, 111, 0, 0, &fPrimCandidates[4], &fSecCandidates[4], mPi0, mPi0Sigma);
     }
+    //pi0 -> gamma gamma, EMC
+    if(fEmcClusters && fUsePi0Emc)
+      FindPi0Emc(Particles, PrimVtx, firstEmcParticle);
     for(int iPV=0; iPV<fNPV; iPV++ )
       ExtrapolateToPV(fPrimCandidates[4][iPV],PrimVtx[iPV]);
     //eta -> pi0 pi0 pi0
@@ -565,65 +1101,225 @@ void KFParticleFinder::FindParticles(KFPTrackVector* vRTracks, kfvector_float* C
     //Psi -> Omega- Omega+
     for(int iPV=0; iPV<fNPV; iPV++)
       CombinePartPart(fPrimCandidates[7][iPV], fPrimCandidates[8][iPV], Particles, PrimVtx, fCutsPartPart[1], iPV, 500443, 0, 1);  
+}
+
+void KFParticleFinder::ApplyCandidateCaps(vector<KFParticle>& Particles, const int firstCandidate)
+{
+  /** Keeps only the best candidates for the PDG codes with the limited number of candidates, see KFParticleFinder::SetCandidateCap().
+   ** Is run at the end of the event for the intermediate candidates, which are referred by index from the lists of candidates 
+   ** during the reconstruction and can not be removed earlier; the final candidates are already limited by 
+   ** KFParticleFinder::AddFinalCandidate(). For each limited PDG code the best candidates are selected with a bounded heap, which 
+   ** contains the worst of the selected candidates on top. Daughters of the kept candidates are kept independently of their rank. 
+   ** The output array is compacted, Ids and indices of daughters of the remaining candidates are updated.
+   ** \param[in,out] Particles - output vector with particles.
+   ** \param[in] firstCandidate - index of the first short-lived candidate in "Particles", particles before it are not touched.
+   **/
+  if(fCandidateCap.empty()) return;
+  
+  const int nParticles = Particles.size();
+  std::map<int, std::vector< std::pair<float,int> > > selected;
+  vector<bool> isLimited(nParticles, false);
+  
+  for(int iParticle=firstCandidate; iParticle<nParticles; iParticle++)
+  {
+    const KFParticle& particle = Particles[iParticle];
+    std::map<int,int>::const_iterator cap = fCandidateCap.find(particle.GetPDG());
+    if(cap == fCandidateCap.end()) continue;
+    isLimited[iParticle] = true;
+    if(cap->second <= 0) continue;
     
-    //reconstruct particles with daughters in ElectroMagnetic Calorimeter
-//     if(fEmcClusters)
-//     {
-//       //pi0 -> gamma gamma, EMC
-//       vector< vector<KFParticle> > vPi0PrimEmc(1);
-//       vector<KFParticle> vPi0SecEmc;
-//       vector< vector<KFParticle> > vD0PrimEmc(1);
-//       CombinePartPart(vGammaPrimEmc, vGammaPrimEmc, Particles, PrimVtx, fCutsPartPart[1], 0, 111, 1, 0, &vPi0PrimEmc, &vPi0SecEmc, mPi0, mPi0Sigma);
-//           
-//       //D+ -> K0 pi+
-//       FindTrackV0Decay(fSecCandidates[0],    310, vRTracks[0],  1, vRTracks[0].FirstPion(), vRTracks[0].LastPion(), Particles, PrimVtx, -1/*, &(ChiToPrimVtx[0])*/);
-//       //D0 -> K0 pi+ pi-
-//       FindTrackV0Decay(fK0PiPlus, 100411, vRTracks[1], -1, vRTracks[1].FirstPion(), vRTracks[1].LastPion(), Particles, PrimVtx, -1/*, &(ChiToPrimVtx[0])*/);
-//       //D0 -> K0 pi+ pi- pi0
-//       CombinePartPart(fK0PiPi, vPi0PrimEmc[0], Particles, PrimVtx, fCutsPartPart[1], -1, 428, 0, 0, &vD0PrimEmc, 0, 
-//                       KFParticleDatabase::Instance()->GetD0Mass(), 0.025);
-//       
-//       for(int iPV=0; iPV<1; iPV++ )
-//       {
-//         ExtrapolateToPV(vPi0PrimEmc[iPV],PrimVtx[iPV]);
-//         ExtrapolateToPV(vD0PrimEmc[iPV],PrimVtx[iPV]);
-//       }
-//       //D0* -> D0 pi0
-//       CombinePartPart(vD0PrimEmc[0], vPi0PrimEmc[0], Particles, PrimVtx, fCutsPartPart[1], 0, 10428);
-//     }
+    const float figureOfMerit = GetCandidateFigureOfMerit(particle);
+    
+    std::vector< std::pair<float,int> >& heap = selected[particle.GetPDG()];
+    if(int(heap.size()) < cap->second)
+    {
+      heap.push_back(std::pair<float,int>(figureOfMerit, iParticle));
+      std::push_heap(heap.begin(), heap.end());
+    }
+    else if(figureOfMerit < heap.front().first)
+    {
+      std::pop_heap(heap.begin(), heap.end());
+      heap.back() = std::pair<float,int>(figureOfMerit, iParticle);
+      std::push_heap(heap.begin(), heap.end());
+    }
   }
-  else
+  
+  vector<bool> isKept(nParticles, true);
+  for(int iParticle=firstCandidate; iParticle<nParticles; iParticle++)
+    isKept[iParticle] = !isLimited[iParticle];
+  for(std::map<int, std::vector< std::pair<float,int> > >::const_iterator it = selected.begin(); it != selected.end(); ++it)
+    for(unsigned int iEntry=0; iEntry<it->second.size(); iEntry++)
+      isKept[it->second[iEntry].second] = true;
+  
+  //daughters are always stored before mothers, so one backward pass keeps all generations of daughters
+  for(int iParticle=nParticles-1; iParticle>=firstCandidate; iParticle--)
   {
-    //D0 -> pi+ K-
-    SelectParticles(Particles,fD0,PrimVtx,fCutsCharm[2],fCutsCharm[1],
-                    KFParticleDatabase::Instance()->GetD0Mass(), KFParticleDatabase::Instance()->GetD0MassSigma(), fSecCuts[0]);
-    //D0_bar -> pi+ K-
-    SelectParticles(Particles,fD0bar,PrimVtx,fCutsCharm[2],fCutsCharm[1],
-                    KFParticleDatabase::Instance()->GetD0Mass(), KFParticleDatabase::Instance()->GetD0MassSigma(), fSecCuts[0]);
+    if(!isKept[iParticle]) continue;
+    const KFParticle& particle = Particles[iParticle];
+    for(int iDaughter=0; iDaughter<particle.NDaughters(); iDaughter++)
+    {
+      const int daughterIndex = particle.DaughterIds()[iDaughter];
+      if(daughterIndex >= firstCandidate && daughterIndex < iParticle)
+        isKept[daughterIndex] = true;
+    }
+  }
+  
+  vector<int> newIndex(nParticles, -1);
+  vector<int> daughterIds;
+  int nKept = firstCandidate;
+  for(int iParticle=0; iParticle<firstCandidate; iParticle++)
+    newIndex[iParticle] = iParticle;
+  for(int iParticle=firstCandidate; iParticle<nParticles; iParticle++)
+  {
+    if(!isKept[iParticle])
+    {
+      fNDiscardedCandidates++;
+      fNDiscardedCandidatesPerPDG[Particles[iParticle].GetPDG()]++;
+      continue;
+    }
+    newIndex[iParticle] = nKept;
+    
+    if(nKept != iParticle)
+      Particles[nKept] = Particles[iParticle];
+    KFParticle& particle = Particles[nKept];
+    particle.SetId(nKept);
+    
+    daughterIds.assign(particle.DaughterIds().begin(), particle.DaughterIds().end());
+    particle.CleanDaughtersId();
+    for(unsigned int iDaughter=0; iDaughter<daughterIds.size(); iDaughter++)
+    {
+      const int daughterIndex = daughterIds[iDaughter];
+      particle.AddDaughterId( (daughterIndex >= firstCandidate && daughterIndex < iParticle) ? newIndex[daughterIndex] : daughterIndex );
+    }
+    nKept++;
+  }
+  Particles.resize(nKept);
+}
+
+float KFParticleFinder::GetCandidateFigureOfMerit(const KFParticle& particle) const
+{
+  /** Returns the figure of merit of the candidate with the limited PDG code, which is set by KFParticleFinder::SetCandidateCap(),
+   ** smaller values correspond to better candidates.
+   ** \param[in] particle - candidate
+   **/
+  std::map<int,int>::const_iterator figureOfMerit = fCandidateCapFigureOfMerit.find(particle.GetPDG());
+  if(figureOfMerit != fCandidateCapFigureOfMerit.end() && figureOfMerit->second == kMassDeviation)
+  {
+    float mass = 0.f, massError = 0.f;
+    particle.GetMass(mass, massError);
+    const float massPDG = KFParticleDatabase::Instance()->GetMass(particle.GetPDG());
+    return (massError > 0.f) ? fabs(mass - massPDG)/massError : 1.e10f;
+  }
+  return (particle.GetNDF() > 0) ? particle.GetChi2()/float(particle.GetNDF()) : particle.GetChi2();
+}
+
+void KFParticleFinder::AddFinalCandidate(vector<KFParticle>& Particles, KFParticle& candidate)
+{
+  /** Stores the candidate, which is not used further in the reconstruction, to the output array and sets its Id. If the number 
+   ** of candidates with its PDG code is limited (see KFParticleFinder::SetCandidateCap()) and the limit is reached by the candidates
+   ** stored with this function, the candidate replaces the worst of them or is discarded. The output array does not grow then.
+   ** If the replaced candidate was already checked by the trigger conditions, the replacing one is checked instead.
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in,out] candidate - candidate to be stored.
+   **/
+  std::map<int,int>::const_iterator cap = fCandidateCap.find(candidate.GetPDG());
+  if(cap == fCandidateCap.end())
+  {
+    candidate.SetId(Particles.size());
+    Particles.push_back(candidate);
+    return;
+  }
+  
+  const float figureOfMerit = GetCandidateFigureOfMerit(candidate);
+  std::vector< std::pair<float,int> >& heap = fFinalCandidateHeap[candidate.GetPDG()];
+  if(int(heap.size()) < cap->second)
+  {
+    heap.push_back(std::pair<float,int>(figureOfMerit, Particles.size()));
+    std::push_heap(heap.begin(), heap.end());
+    candidate.SetId(Particles.size());
+    Particles.push_back(candidate);
+    return;
+  }
+  
+  fNDiscardedCandidates++;
+  fNDiscardedCandidatesPerPDG[candidate.GetPDG()]++;
+  if(heap.empty() || !(figureOfMerit < heap.front().first)) return;
+  
+  std::pop_heap(heap.begin(), heap.end());
+  const int index = heap.back().second;
+  heap.back().first = figureOfMerit;
+  std::push_heap(heap.begin(), heap.end());
+  candidate.SetId(index);
+  
+  // if the slot was already checked by the trigger, the counters are corrected for the replaced candidate
+  if(index < int(fNTriggerCheckedParticles))
+  {
+    for(unsigned int iCondition=0; iCondition<fTriggerPDG.size(); iCondition++)
+    {
+      if(IsAcceptedByTrigger(Particles[index], iCondition)) fTriggerNAccepted[iCondition]--;
+      if(IsAcceptedByTrigger(candidate, iCondition)) fTriggerNAccepted[iCondition]++;
+    }
+  }
+  Particles[index] = candidate;
+}
+
+void KFParticleFinder::CountDaughterIdsStorage(const vector<KFParticle>& Particles)
+{
+  /** Counts the particles in the output array and in the sets of candidates, which keep the indices of their daughters
+   ** inline (see KFPDaughterIds) or on the heap. Each particle with the inline storage is one heap allocation avoided
+   ** with respect to std::vector, for every copy of the particle made during the reconstruction. Is called only if
+   ** KFParticleFinder::SetCountDaughterIdsStorage() is switched on.
+   ** \param[in] Particles - output vector with particles.
+   **/
+  fNInlineDaughterIds = 0;
+  fNHeapDaughterIds = 0;
+  
+  vector<const vector<KFParticle>*> particleSets;
+  particleSets.push_back(&Particles);
+  for(int iSet=0; iSet<fNSecCandidatesSets; iSet++)
+    particleSets.push_back(&fSecCandidates[iSet]);
+  for(int iSet=0; iSet<fNPrimCandidatesSets; iSet++)
+    for(unsigned int iPV=0; iPV<fPrimCandidates[iSet].size(); iPV++)
+      particleSets.push_back(&fPrimCandidates[iSet][iPV]);
+  for(int iSet=0; iSet<fNPrimCandidatesTopoSets; iSet++)
+  {
+    for(unsigned int iPV=0; iPV<fPrimCandidatesTopo[iSet].size(); iPV++)
+      particleSets.push_back(&fPrimCandidatesTopo[iSet][iPV]);
+    for(unsigned int iPV=0; iPV<fPrimCandidatesTopoMass[iSet].size(); iPV++)
+      particleSets.push_back(&fPrimCandidatesTopoMass[iSet][iPV]);
+  }
+  
+  for(unsigned int iSet=0; iSet<particleSets.size(); iSet++)
+  {
+    const vector<KFParticle>& particles = *(particleSets[iSet]);
+    for(unsigned int iP=0; iP<particles.size(); iP++)
+    {
+      if(particles[iP].DaughterIds().IsInline())
+        fNInlineDaughterIds++;
+      else
+        fNHeapDaughterIds++;
+    }
   }
 }
 
 void KFParticleFinder::ExtrapolateToPV(vector<KFParticle>& vParticles, KFParticleSIMD& PrimVtx)
 {
   /** Extrapolates all particles from the input vector to the DCA point with the primary vertex.
+   ** Particles are read into the SIMD vector directly from the input array and only their
+   ** parameters and covariance matrices are written back, all other properties are not
+   ** changed by the extrapolation.
    ** \param[in,out] vParticles - array of particles to be transported.
    ** \param[in] PrimVtx - the primary vertex, where particles should be transported.
    **/
   KFParticle* parts[float_vLen];
-  KFParticle tmpPart[float_vLen];
   
-  for(int iv=0; iv<float_vLen; iv++)
-    parts[iv] = &tmpPart[iv];
-    
-  for(unsigned int iL=0; iL<vParticles.size(); iL += float_vLen)
+  const unsigned int nPart = vParticles.size();
+  for(unsigned int iL=0; iL<nPart; iL += float_vLen)
   {
-
-    unsigned int nPart = vParticles.size();
-    unsigned int nEntries = (iL + float_vLen < nPart) ? float_vLen : (nPart - iL);
-
+    const unsigned int nEntries = (iL + float_vLen < nPart) ? float_vLen : (nPart - iL);
     
     for(unsigned int iv=0; iv<nEntries; iv++)
-      tmpPart[iv] = vParticles[iL+iv];
+      parts[iv] = &vParticles[iL+iv];
 
     KFParticleSIMD tmp(parts,nEntries);
 
@@ -631,11 +1327,83 @@ void KFParticleFinder::ExtrapolateToPV(vector<KFParticle>& vParticles, KFParticl
 
     for(unsigned int iv=0; iv<nEntries; iv++)
     {
-      tmp.GetKFParticle(vParticles[iL+iv], iv);
+      for(int iP=0; iP<8; iP++)
+        vParticles[iL+iv].Parameters()[iP] = tmp.GetParameter(iP)[iv];
+      for(int iC=0; iC<36; iC++)
+        vParticles[iL+iv].CovarianceMatrix()[iC] = tmp.GetCovariance(iC)[iv];
     }
   }
 }
 
+int_m KFParticleFinder::V0Prefilter(const float_v* pairParameters,
+                                    const int_v& daughterNegPDG,
+                                    const int_v& daughterPosPDG,
+                                    const int_v& motherPDG,
+                                    const int_m& isSecondary,
+                                    std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx) const
+{
+  /** Fast check of the SIMD-vector of track pairs before the full construction of the 2-daughter candidates. The parameters
+   ** of the daughters at the point of the closest approach are taken from the calculation of the pair geometry in 
+   ** KFParticleFinder::Find2DaughterDecay(), the covariance matrices are not touched. The following approximate quantities are 
+   ** checked only for the secondary pairs, the primary pairs and the gamma candidates are always accepted: \n
+   ** 1) if KFParticleFinder::fV0PrefilterNSigmaMass is positive, for K0s, Lambda, H3Lambda and H4Lambda the invariant mass 
+   ** should be within KFParticleFinder::fV0PrefilterNSigmaMass sigmas of the peak (see KFParticleDatabase::GetMotherMass()); \n
+   ** 2) the decay point should not lie behind all primary vertices along the mother momentum,
+   ** KFParticleFinder::fDistanceCut is used as a tolerance. \n
+   ** Returns the mask of the lanes which passed the prefilter.
+   ** \param[in] pairParameters - X, Y, Z, Px, Py, Pz of the negative and then of the positive daughters at the point of the closest approach.
+   ** \param[in] daughterNegPDG - PDG hypothesis of the negative daughters.
+   ** \param[in] daughterPosPDG - PDG hypothesis of the positive daughters.
+   ** \param[in] motherPDG - PDG hypothesis of the mother particles.
+   ** \param[in] isSecondary - mask of the pairs of secondary tracks.
+   ** \param[in] PrimVtx - array with primary vertices.
+   **/
+  const float_v* negParameters = pairParameters;
+  const float_v* posParameters = pairParameters + 6;
+  
+  const float_v& px = negParameters[3] + posParameters[3];
+  const float_v& py = negParameters[4] + posParameters[4];
+  const float_v& pz = negParameters[5] + posParameters[5];
+  
+  int_m isGood(true);
+  
+  //invariant mass, the sidebands are kept if the window is not set
+  const int_m& hasTableMass = isSecondary && ( (motherPDG == 310) || (abs(motherPDG) == 3122) || 
+                                               (abs(motherPDG) == 3004) || (abs(motherPDG) == 3005) );
+  if( fV0PrefilterNSigmaMass > 0.f && !(hasTableMass.isEmpty()) )
+  {
+    const float_v& massNeg = KFParticleDatabase::Instance()->GetMass(daughterNegPDG);
+    const float_v& massPos = KFParticleDatabase::Instance()->GetMass(daughterPosPDG);
+    const float_v& p2Neg = negParameters[3]*negParameters[3] + negParameters[4]*negParameters[4] + negParameters[5]*negParameters[5];
+    const float_v& p2Pos = posParameters[3]*posParameters[3] + posParameters[4]*posParameters[4] + posParameters[5]*posParameters[5];
+    const float_v& energy = sqrt(p2Neg + massNeg*massNeg) + sqrt(p2Pos + massPos*massPos);
+    float_v mass2 = energy*energy - (px*px + py*py + pz*pz);
+    mass2( mass2 < 0.f ) = 0.f;
+  
+    float_v massMotherPDG, massMotherPDGSigma;
+    KFParticleDatabase::Instance()->GetMotherMass(motherPDG, massMotherPDG, massMotherPDGSigma);
+    isGood = !hasTableMass || simd_cast<int_m>( abs(sqrt(mass2) - massMotherPDG) < fV0PrefilterNSigmaMass*massMotherPDGSigma );
+  }
+  
+  //pointing to the primary vertices
+  const int_m& checkPointing = isGood && isSecondary && (motherPDG != 22);
+  if( !(checkPointing.isEmpty()) && fNPV > 0 )
+  {
+    const float_v& x = 0.5f*(negParameters[0] + posParameters[0]);
+    const float_v& y = 0.5f*(negParameters[1] + posParameters[1]);
+    const float_v& z = 0.5f*(negParameters[2] + posParameters[2]);
+    const float_v& tolerance = -fDistanceCut*sqrt(px*px + py*py + pz*pz);
+    
+    float_m isPointing(false);
+    for(int iP=0; iP<fNPV; iP++)
+      isPointing |= ( (x - PrimVtx[iP].X())*px + (y - PrimVtx[iP].Y())*py + (z - PrimVtx[iP].Z())*pz > tolerance );
+    
+    isGood &= (!checkPointing) || simd_cast<int_m>(isPointing);
+  }
+  
+  return isGood;
+}
+
 inline void KFParticleFinder::ConstructV0(KFPTrackVector* vTracks,
                                           int iTrTypePos,
                                           int iTrTypeNeg,
@@ -818,7 +1586,11 @@ inline void KFParticleFinder::ConstructV0(KFPTrackVector* vTracks,
     if( mother.PDG()[iv] == -3005)
       fHe4PiBar.push_back(mother_temp);
     
-    Particles.push_back(mother_temp);
+    // candidates, which are not collected for the further reconstruction, are final
+    if( saveMother[iv] || abs(mother.PDG()[iv]) == 3004 || abs(mother.PDG()[iv]) == 3005 )
+      Particles.push_back(mother_temp);
+    else
+      AddFinalCandidate(Particles, mother_temp);
     
     if( mother.PDG()[iv] == 22 && isPrimary[iv] )
     {
@@ -828,14 +1600,12 @@ inline void KFParticleFinder::ConstructV0(KFPTrackVector* vTracks,
       if( (negPt2 >fCutLVMPt*fCutLVMPt) && (posPt2 >fCutLVMPt*fCutLVMPt) )
       {
         mother_temp.SetPDG(100113);
-        mother_temp.SetId(Particles.size());
-        Particles.push_back(mother_temp);
+        AddFinalCandidate(Particles, mother_temp);
         
         if( (negPt2 >fCutJPsiPt*fCutJPsiPt) && (posPt2 >fCutJPsiPt*fCutJPsiPt) )
         {
           mother_temp.SetPDG(443);
-          mother_temp.SetId(Particles.size());
-          Particles.push_back(mother_temp);
+          AddFinalCandidate(Particles, mother_temp);
         }
       }  
     }
@@ -848,8 +1618,7 @@ inline void KFParticleFinder::ConstructV0(KFPTrackVector* vTracks,
       if( (negPt2 >fCutJPsiPt*fCutJPsiPt) && (posPt2 >fCutJPsiPt*fCutJPsiPt) && (abs(daughterPosPDG[iv]) == 13) && (abs(daughterNegPDG[iv]) == 13))
       {
         mother_temp.SetPDG(100443);
-        mother_temp.SetId(Particles.size());
-        Particles.push_back(mother_temp);
+        AddFinalCandidate(Particles, mother_temp);
       }  
     }
     
@@ -877,7 +1646,8 @@ inline void KFParticleFinder::SaveV0PrimSecCand(KFParticleSIMD& mother,
                                                 vector<KFParticle>* vMotherSec)
 {
   /** The function which decides if primary and secondary candidates found by KFParticleFinder::ConstructV0()
-   ** should be stored and stores them to the provided arrays.
+   ** should be stored and stores them to the provided arrays. If the mixed event mode is not set primary
+   ** candidates are extrapolated to the corresponding primary vertex in the SIMD form before being stored.
    ** \param[in] mother - constructed SIMD vector of particle candidates. 
    ** \param[in] NParticles - number of particles in the SIMD vector.
    ** \param[in] mother_temp - temporary object to extract KFParticle from constructed KFParticleSIMD mother. Preallocated for better performance.
@@ -906,6 +1676,10 @@ inline void KFParticleFinder::SaveV0PrimSecCand(KFParticleSIMD& mother,
   arrayIndex(mother.PDG() ==  int_v(3122)) = 1;
   arrayIndex(mother.PDG() == int_v(-3122)) = 2;
   arrayIndex(mother.PDG() ==    int_v(22)) = 3;
+  
+  float_m isArrayIndex[4]; //candidates are stored to the arrays with the bulk copy for each type separately
+  for(int iSet=0; iSet<4; iSet++)
+    isArrayIndex[iSet] = simd_cast<float_m>(arrayIndex == iSet) && simd_cast<float_m>(int_v::IndexesFromZero() < int(NParticles));
 
   float_m isPrimaryPart(false);
 
@@ -922,24 +1696,14 @@ inline void KFParticleFinder::SaveV0PrimSecCand(KFParticleSIMD& mother,
     if(isPrimaryPartLocal.isEmpty()) continue;
     isPrimaryPart |= isPrimaryPartLocal;
     for(int iV=0; iV<NParticles; iV++)
-    {
       if(isPrimaryPartLocal[iV])
-      {
-        motherTopo.GetKFParticle(mother_temp, iV);
-        fPrimCandidatesTopo[arrayIndex[iV]][iP].push_back(mother_temp);
         iPrimVert[iV].push_back(iP);
-      }
-    }
+    for(int iSet=0; iSet<4; iSet++)
+      motherTopo.GetKFParticles(fPrimCandidatesTopo[iSet][iP], isPrimaryPartLocal && isArrayIndex[iSet]);
     
     motherTopo.SetNonlinearMassConstraint(massMotherPDG);
-    for(int iV=0; iV<NParticles; iV++)
-    {
-      if(isPrimaryPartLocal[iV])
-      {
-        motherTopo.GetKFParticle(mother_temp, iV);
-        fPrimCandidatesTopoMass[arrayIndex[iV]][iP].push_back(mother_temp);
-      }
-    }
+    for(int iSet=0; iSet<4; iSet++)
+      motherTopo.GetKFParticles(fPrimCandidatesTopoMass[iSet][iP], isPrimaryPartLocal && isArrayIndex[iSet]);
   }
   
   isPrim |= ( ( isPrimaryPart ) && (isK0 || isLambda || isGamma) );
@@ -951,9 +1715,13 @@ inline void KFParticleFinder::SaveV0PrimSecCand(KFParticleSIMD& mother,
   
   mother.SetNonlinearMassConstraint(massMotherPDG);
 
+  // In the standard mode primary candidates are used only after extrapolation to the corresponding
+  // primary vertex. It is performed here on the SIMD vector, before the scalar candidates are created.
+  const bool extrapolateToPV = !fMixedEventAnalysis;
+  
   for(int iv=0; iv<NParticles; iv++)
   { 
-    if(isPrim[iv] || isSec[iv])
+    if( (isPrim[iv] && !extrapolateToPV) || isSec[iv] )
     {  
       mother.GetKFParticle(mother_temp, iv);
       
@@ -967,6 +1735,23 @@ inline void KFParticleFinder::SaveV0PrimSecCand(KFParticleSIMD& mother,
         vMotherSec[arrayIndex[iv]].push_back(mother_temp);
     }
   }
+  
+  if(extrapolateToPV && !isPrim.isEmpty())
+  {
+    for(int iP=0; iP<fNPV; iP++)
+    {
+      float_m isPrimPV(false);
+      for(int iv=0; iv<NParticles; iv++)
+        isPrimPV[iv] = isPrim[iv] && (std::find(iPrimVert[iv].begin(), iPrimVert[iv].end(), iP) != iPrimVert[iv].end());
+      if(isPrimPV.isEmpty()) continue;
+      
+      motherTopo = mother;
+      motherTopo.TransportToPoint(PrimVtx[iP].Parameters());
+      
+      for(int iSet=0; iSet<4; iSet++)
+        motherTopo.GetKFParticles(vMotherPrim[iSet][iP], isPrimPV && isArrayIndex[iSet]);
+    }
+  }
 }
 
 void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_float* ChiToPrimVtx,
@@ -977,7 +1762,8 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
                                           vector< vector<KFParticle> >* vMotherPrim,
                                           vector<KFParticle>* vMotherSec )
 {
-  /** Reconstructs all 2-daughter decays.
+  /** Reconstructs all 2-daughter decays. If KFParticleFinder::fUseV0Prefilter is set, the pairs are checked with the parameter-only
+   ** prefilter KFParticleFinder::V0Prefilter() and only the accepted pairs are passed to the full construction.
    ** \param[in] vRTracks - pointer to the array with vectors of tracks:\n
    ** 0) secondary positive at the first hit position; \n
    ** 1) secondary negative at the first hit position; \n
@@ -1019,6 +1805,11 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
   int trTypeIndexPos[2] = {0,2};
   int trTypeIndexNeg[2] = {1,3};
 
+  // bits of the lanes to pack and unpack the entries of the pair geometry cache
+  int_v laneBit;
+  for(int iV=0; iV<float_vLen; iV++)
+    laneBit[iV] = 1 << iV;
+  
   for( int iTrTypeNeg = 0; iTrTypeNeg<2; iTrTypeNeg++)
   {
     KFPTrackVector& negTracks = vTracks[ trTypeIndexNeg[iTrTypeNeg] ];
@@ -1029,6 +1820,18 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
       int_v negTracksSize = negTracks.Size();
       int nPositiveTracks = posTracks.Size();
       
+      // The same pair of SIMD vectors of tracks is considered for several track categories and mother hypotheses.
+      // The distance between tracks and their pointing do not depend on the mass hypothesis, they are calculated
+      // once and stored in the cache together with the transported daughter parameters for each pair of SIMD vectors
+      // and each rotation of the negative vector. All categories of one negative vector are processed together, 
+      // so the cache holds only the pairs of the current negative vector.
+      const int nPosVectors = (nPositiveTracks + float_vLen - 1) / float_vLen;
+      const unsigned long pairGeometryCacheSize = (unsigned long)(nPosVectors) * float_vLen;
+      const bool usePairGeometryCache = !( (iTrTypePos == 1) && (iTrTypeNeg == 1) ) &&
+                                        (pairGeometryCacheSize > 0) && (pairGeometryCacheSize <= fPairGeometryCacheMaxSize);
+      if(usePairGeometryCache && fPairGeometryParameters.size() < pairGeometryCacheSize*fNPairGeometryParameters)
+        fPairGeometryParameters.resize(pairGeometryCacheSize*fNPairGeometryParameters);
+      
       //track categories
       int nTC = 5;
       int startTCPos[5] = {0};
@@ -1086,17 +1889,158 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
         startTCNeg[4] = negTracks.FirstProton(); endTCNeg[4] = negTracks.LastProton();      
       }
       
+      // Tracks with alternative PID hypotheses (see KFPTrackVector::PIDMask()) are stored once in the category of their PDG code.
+      // For each category they are gathered with the lists KFPTrackVector::HypothesisIndex() into compact SIMD vectors, which
+      // follow the native tracks in the loops: the gathered negative tracks take the PDG hypothesis of the category, the gathered
+      // positive tracks are checked only with their alternative hypotheses. The native tracks are processed as without hypotheses.
+      int pidSpeciesNeg[5] = {-1, -1, -1, -1, -1};
+      int pidSpeciesMaskPos[5] = {0};
+      if( iTrTypeNeg == iTrTypePos )
+      {
+        const int maskLight = (1 << KFPTrackVector::kPIDPion) | (1 << KFPTrackVector::kPIDKaon) | (1 << KFPTrackVector::kPIDProton);
+        const int maskNuclei = (1 << KFPTrackVector::kPIDDeuteron) | (1 << KFPTrackVector::kPIDTriton) | 
+                               (1 << KFPTrackVector::kPIDHe3) | (1 << KFPTrackVector::kPIDHe4);
+        pidSpeciesNeg[2] = KFPTrackVector::kPIDPion;
+        pidSpeciesNeg[3] = KFPTrackVector::kPIDKaon;
+        pidSpeciesNeg[4] = KFPTrackVector::kPIDProton;
+        if(iTrTypeNeg == 0)
+        {
+          pidSpeciesMaskPos[2] = maskLight | maskNuclei;
+          pidSpeciesMaskPos[3] = (1 << KFPTrackVector::kPIDPion) | (1 << KFPTrackVector::kPIDKaon);
+          pidSpeciesMaskPos[4] = (1 << KFPTrackVector::kPIDPion);
+        }
+        else
+        {
+          pidSpeciesNeg[1] = KFPTrackVector::kPIDMuon;
+          pidSpeciesMaskPos[1] = (1 << KFPTrackVector::kPIDMuon);
+          pidSpeciesMaskPos[2] = maskLight;
+          pidSpeciesMaskPos[3] = maskLight | maskNuclei;
+          pidSpeciesMaskPos[4] = maskLight;
+        }
+      }
+      
+      // the gathered tracks of each category are padded to the SIMD vectors and addressed with the indices after the native tracks
+      const int negHypothesisOffset = ((negTracksSize[0] + float_vLen - 1) / float_vLen) * float_vLen;
+      const int posHypothesisOffset = nPosVectors * float_vLen;
+      int startTCNegHyp[5] = {0};
+      int endTCNegHyp[5] = {0};
+      int endTCNegHypValid[5] = {0};
+      int startTCPosHyp[5] = {0};
+      int endTCPosHyp[5] = {0};
+      int endTCPosHypValid[5] = {0};
+      kfvector_uint negHypothesisIndex, posHypothesisIndex;
+      for(int iTC=0; iTC<nTC; iTC++)
+      {
+        startTCPosHyp[iTC] = endTCPos[iTC];
+        endTCPosHyp[iTC] = endTCPos[iTC];
+        endTCPosHypValid[iTC] = endTCPos[iTC];
+        
+        if(pidSpeciesNeg[iTC] >= 0)
+        {
+          const int pdgHypothesis = KFPTrackVector::PDGOfSpecies(pidSpeciesNeg[iTC], -1);
+          const kfvector_uint& hypothesisIndex = negTracks.HypothesisIndex(pidSpeciesNeg[iTC]);
+          const int firstIndex = negHypothesisIndex.size();
+          for(unsigned int iIndex=0; iIndex<hypothesisIndex.size(); iIndex++)
+          {
+            const int pdg = abs(negTracks.PDG()[hypothesisIndex[iIndex]]);
+            if(pdg == abs(pdgHypothesis)) continue;
+            //light nuclei belong to the same category as antiprotons for the secondary tracks
+            if(pidSpeciesNeg[iTC] == KFPTrackVector::kPIDProton && iTrTypeNeg == 0 && pdg >= 1000000000) continue;
+            negHypothesisIndex.push_back(hypothesisIndex[iIndex]);
+          }
+          endTCNegHypValid[iTC] = negHypothesisOffset + negHypothesisIndex.size();
+          while(int(negHypothesisIndex.size()) > firstIndex && negHypothesisIndex.size()%float_vLen != 0)
+            negHypothesisIndex.push_back(negHypothesisIndex[firstIndex]);
+          startTCNegHyp[iTC] = negHypothesisOffset + firstIndex;
+          endTCNegHyp[iTC] = negHypothesisOffset + negHypothesisIndex.size();
+        }
+        
+        if(pidSpeciesMaskPos[iTC] != 0)
+        {
+          const int firstIndex = posHypothesisIndex.size();
+          for(int iSpecies=0; iSpecies<KFPTrackVector::kNPIDSpecies; iSpecies++)
+          {
+            if(!(pidSpeciesMaskPos[iTC] & (1 << iSpecies))) continue;
+            const kfvector_uint& hypothesisIndex = posTracks.HypothesisIndex(iSpecies);
+            posHypothesisIndex.insert(posHypothesisIndex.end(), hypothesisIndex.begin(), hypothesisIndex.end());
+          }
+          std::sort(posHypothesisIndex.begin() + firstIndex, posHypothesisIndex.end());
+          posHypothesisIndex.erase(std::unique(posHypothesisIndex.begin() + firstIndex, posHypothesisIndex.end()), posHypothesisIndex.end());
+          endTCPosHypValid[iTC] = posHypothesisOffset + posHypothesisIndex.size();
+          while(int(posHypothesisIndex.size()) > firstIndex && posHypothesisIndex.size()%float_vLen != 0)
+            posHypothesisIndex.push_back(posHypothesisIndex[firstIndex]);
+          if(int(posHypothesisIndex.size()) > firstIndex)
+          {
+            startTCPosHyp[iTC] = posHypothesisOffset + firstIndex;
+            endTCPosHyp[iTC] = posHypothesisOffset + posHypothesisIndex.size();
+          }
+        }
+      }
+      
+      KFPTrackVector negHypothesisTracks, posHypothesisTracks;
+      kfvector_float negHypothesisChiPrim, posHypothesisChiPrim;
+      if(!negHypothesisIndex.empty())
+      {
+        negHypothesisTracks.SetTracks(negTracks, negHypothesisIndex, negHypothesisIndex.size());
+        if( (iTrTypeNeg == 0) && (iTrTypePos == 0) )
+        {
+          negHypothesisChiPrim.resize(negHypothesisIndex.size());
+          for(unsigned int iIndex=0; iIndex<negHypothesisIndex.size(); iIndex++)
+            negHypothesisChiPrim[iIndex] = ChiToPrimVtx[trTypeIndexNeg[iTrTypeNeg]][negHypothesisIndex[iIndex]];
+        }
+        // the padding lanes are marked with the index after the last track and are never active
+        for(int iTC=0; iTC<nTC; iTC++)
+          for(int iTrN=endTCNegHypValid[iTC]; iTrN<endTCNegHyp[iTC]; iTrN++)
+            negHypothesisIndex[iTrN - negHypothesisOffset] = negTracks.Size();
+      }
+      if(!posHypothesisIndex.empty())
+      {
+        posHypothesisTracks.SetTracks(posTracks, posHypothesisIndex, posHypothesisIndex.size());
+        if( (iTrTypeNeg == 0) && (iTrTypePos == 0) )
+        {
+          posHypothesisChiPrim.resize(posHypothesisIndex.size());
+          for(unsigned int iIndex=0; iIndex<posHypothesisIndex.size(); iIndex++)
+            posHypothesisChiPrim[iIndex] = ChiToPrimVtx[trTypeIndexPos[iTrTypePos]][posHypothesisIndex[iIndex]];
+        }
+        for(int iTC=0; iTC<nTC; iTC++)
+          for(int iTrP=endTCPosHypValid[iTC]; iTrP<endTCPosHyp[iTC]; iTrP++)
+            posHypothesisIndex[iTrP - posHypothesisOffset] = nPositiveTracks;
+      }
+      
+      // the ranges of all categories start at the borders of the SIMD vectors
+      int firstNeg = negTracksSize[0];
+      int lastNeg = 0;
       for(int iTC=0; iTC<nTC; iTC++)
       {
-        for(int iTrN=startTCNeg[iTC]; iTrN < endTCNeg[iTC]; iTrN += float_vLen)
+        if(startTCNeg[iTC] >= endTCNeg[iTC]) continue;
+        if(startTCNeg[iTC] < firstNeg) firstNeg = startTCNeg[iTC];
+        if(endTCNeg[iTC] > lastNeg) lastNeg = endTCNeg[iTC];
+      }
+      const int firstNegHyp = negHypothesisIndex.empty() ? lastNeg : negHypothesisOffset;
+      const int lastNegHyp = negHypothesisIndex.empty() ? lastNeg : negHypothesisOffset + int(negHypothesisIndex.size());
+      
+      for(int iTrN=firstNeg; iTrN < lastNegHyp; iTrN += float_vLen)
+      {
+        // the native tracks are followed by the gathered tracks with the alternative hypotheses
+        if(iTrN >= lastNeg && iTrN < firstNegHyp) iTrN = firstNegHyp;
+        const bool isNegHypothesis = (iTrN >= negHypothesisOffset);
+        KFPTrackVector& negSource = isNegHypothesis ? negHypothesisTracks : negTracks;
+        const int iNeg = isNegHypothesis ? (iTrN - negHypothesisOffset) : iTrN;
+        
+        if(usePairGeometryCache && !isNegHypothesis)
+          fPairGeometryCache.assign(pairGeometryCacheSize, 0);
+        
+        for(int iTC=0; iTC<nTC; iTC++)
         {
-          const int NTracksNeg = (iTrN + float_vLen < negTracks.Size()) ? float_vLen : (negTracks.Size() - iTrN);
+          if( (iTrN < startTCNeg[iTC] || iTrN >= endTCNeg[iTC]) && (iTrN < startTCNegHyp[iTC] || iTrN >= endTCNegHyp[iTC]) ) continue;
 
           int_v negInd = int_v::IndexesFromZero() + int(iTrN);
+          if(isNegHypothesis)
+            negInd = reinterpret_cast<const int_v&>(negHypothesisIndex[iNeg]);
 
-          int_v negPDG = reinterpret_cast<const int_v&>(negTracks.PDG()[iTrN]);
-          int_v negPVIndex = reinterpret_cast<const int_v&>(negTracks.PVIndex()[iTrN]);
-          int_v negNPixelHits = reinterpret_cast<const int_v&>(negTracks.NPixelHits()[iTrN]);
+          int_v negPDG = reinterpret_cast<const int_v&>(negSource.PDG()[iNeg]);
+          int_v negPVIndex = reinterpret_cast<const int_v&>(negSource.PVIndex()[iNeg]);
+          int_v negNPixelHits = reinterpret_cast<const int_v&>(negSource.NPixelHits()[iNeg]);
           
           int_v trackPdgNeg = negPDG;
           int_m activeNeg = (negPDG != -1);
@@ -1108,29 +2052,51 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
             activeNeg |= int_m(negPVIndex < 0) && int_m(negPDG == -1) ;
           }
 #endif    
-          activeNeg &= (int_v::IndexesFromZero() < int(NTracksNeg));
+          if(isNegHypothesis)
+            trackPdgNeg = KFPTrackVector::PDGOfSpecies(pidSpeciesNeg[iTC], -1);
+          activeNeg &= (negInd < negTracksSize);
               
-          daughterNeg.Load(negTracks, iTrN, negPDG);
+          daughterNeg.Load(negSource, iNeg, negPDG);
                 
           float_v chiPrimNeg(Vc::Zero);
           float_v chiPrimPos(Vc::Zero);
           
           if( (iTrTypeNeg == 0) && (iTrTypePos == 0) )
-            chiPrimNeg = reinterpret_cast<const float_v&>( ChiToPrimVtx[trTypeIndexNeg[iTrTypeNeg]][iTrN]);
+            chiPrimNeg = reinterpret_cast<const float_v&>( isNegHypothesis ? negHypothesisChiPrim[iNeg] : ChiToPrimVtx[trTypeIndexNeg[iTrTypeNeg]][iNeg]);
+          
+          float_v timeNeg = reinterpret_cast<const float_v&>(negSource.T()[iNeg]);
+          float_v timeErrorNeg = reinterpret_cast<const float_v&>(negSource.TErr()[iNeg]);
           
-          for(int iTrP=startTCPos[iTC]; iTrP < endTCPos[iTC]; iTrP += float_vLen)
+          for(int iTrP=startTCPos[iTC]; iTrP < endTCPosHyp[iTC]; iTrP += float_vLen)
           {
-            const int NTracks = (iTrP + float_vLen < nPositiveTracks) ? float_vLen : (nPositiveTracks - iTrP);
-
-            const int_v& posPDG = reinterpret_cast<const int_v&>(posTracks.PDG()[iTrP]);
-            const int_v& posPVIndex = reinterpret_cast<const  int_v&>(posTracks.PVIndex()[iTrP]);     
-            const int_v& posNPixelHits = reinterpret_cast<const int_v&>(posTracks.NPixelHits()[iTrP]);
+            if(iTrP >= endTCPos[iTC] && iTrP < startTCPosHyp[iTC]) iTrP = startTCPosHyp[iTC];
+            const bool isPosHypothesis = (iTrP >= posHypothesisOffset);
+            KFPTrackVector& posSource = isPosHypothesis ? posHypothesisTracks : posTracks;
+            const int iPos = isPosHypothesis ? (iTrP - posHypothesisOffset) : iTrP;
+
+            int_v posInd = int_v::IndexesFromZero() + int(iTrP);
+            if(isPosHypothesis)
+              posInd = reinterpret_cast<const int_v&>(posHypothesisIndex[iPos]);
+            const int_m isPosTrack = (posInd < int_v(nPositiveTracks));
+            
+            const int_v& posPDG = reinterpret_cast<const int_v&>(posSource.PDG()[iPos]);
+            const int_v& posPVIndex = reinterpret_cast<const  int_v&>(posSource.PVIndex()[iPos]);
+            const int_v& posNPixelHits = reinterpret_cast<const int_v&>(posSource.NPixelHits()[iPos]);
             const int_m& isPosSecondary = (posPVIndex < 0);
+            int_v posPIDMask(Vc::Zero);
+            if(isPosHypothesis)
+              posPIDMask = reinterpret_cast<const int_v&>(posSource.PIDMask()[iPos]) & int_v(pidSpeciesMaskPos[iTC]);
 
-            daughterPos.Load(posTracks, iTrP, posPDG);
+            daughterPos.Load(posSource, iPos, posPDG);
             
             if( (iTrTypeNeg == 0) && (iTrTypePos == 0) )
-              chiPrimPos = reinterpret_cast<const float_v&>( ChiToPrimVtx[trTypeIndexPos[iTrTypePos]][iTrP]);
+              chiPrimPos = reinterpret_cast<const float_v&>( isPosHypothesis ? posHypothesisChiPrim[iPos] : ChiToPrimVtx[trTypeIndexPos[iTrTypePos]][iPos]);
+            
+            const float_v& timePos = reinterpret_cast<const float_v&>(posSource.T()[iPos]);
+            const float_v& timeErrorPos = reinterpret_cast<const float_v&>(posSource.TErr()[iPos]);
+            
+            // the pair geometry of the native tracks is kept in the cache, for the gathered tracks it is shared by the hypotheses
+            const bool usePairGeometryCacheEntry = usePairGeometryCache && !isNegHypothesis && !isPosHypothesis;
             
             for(int iRot = 0; iRot<float_vLen; iRot++)
             {
@@ -1144,19 +2110,21 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
               
                 daughterNeg.Rotate();
                 chiPrimNeg = chiPrimNeg.rotated(1);
+                timeNeg = timeNeg.rotated(1);
+                timeErrorNeg = timeErrorNeg.rotated(1);
 
                 activeNeg = ( (negPDG != -1) || ( (negPVIndex < 0) && (negPDG == -1) ) ) && (negInd < negTracksSize);
               }
               const int_m& isSecondary = int_m( negPVIndex < 0 ) && isPosSecondary;
               const int_m& isPrimary   = int_m( negPVIndex >= 0 ) && (!isPosSecondary);
             
-              float_m closeDaughters = simd_cast<float_m>(activeNeg && (int_v::IndexesFromZero() < int_v(NTracks)));
+              float_m closeDaughters = simd_cast<float_m>(activeNeg && isPosTrack);
               
               if(closeDaughters.isEmpty() && (iTC != 0)) continue;
               
               
-              int_v trackPdgPos[2];
-              int_m active[2];
+              int_v trackPdgPos[2 + KFPTrackVector::kNPIDSpecies];
+              int_m active[2 + KFPTrackVector::kNPIDSpecies];
 
               active[0] = (posPDG != -1);
               active[0] &= ((isPrimary && (posPVIndex == negPVIndex)) || !(isPrimary));
@@ -1187,8 +2155,42 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
               if(iTC==0) 
               {
                 nPDGPos = 1;
-                active[0] = (negInd < negTracksSize) && (int_v::IndexesFromZero() < int_v(NTracks));
+                active[0] = (negInd < negTracksSize) && isPosTrack;
+              }
+              
+              // the gathered positive tracks are checked only with the alternative hypotheses
+              if(isPosHypothesis)
+              {
+                nPDGPos = 0;
+                active[0] = int_m(false);
+                const int_m activePos = ((isPrimary && (posPVIndex == negPVIndex)) || !(isPrimary)) && simd_cast<int_m>(closeDaughters);
+                for(int iSpecies=0; iSpecies<KFPTrackVector::kNPIDSpecies; iSpecies++)
+                {
+                  if(!(pidSpeciesMaskPos[iTC] & (1 << iSpecies))) continue;
+                  const int pdgHypothesis = KFPTrackVector::PDGOfSpecies(iSpecies, 1);
+                  const int_m hasHypothesis = activePos && ((posPIDMask & int_v(1 << iSpecies)) != int_v(Vc::Zero)) && 
+                                              (abs(posPDG) != int_v(abs(pdgHypothesis)));
+                  if(hasHypothesis.isEmpty()) continue;
+                  trackPdgPos[nPDGPos] = pdgHypothesis;
+                  active[nPDGPos] = hasHypothesis;
+                  nPDGPos++;
+                }
               }
+              
+              // in the continuous readout tracks from different collisions are rejected by time before any geometry is calculated
+              if(fTimeNSigmaCut > 0.f)
+              {
+                const float_v dt = timeNeg - timePos;
+                const float_m isTimeCompatible = (timeErrorNeg < 0.f) || (timeErrorPos < 0.f) ||
+                  (dt*dt <= fTimeNSigmaCut*fTimeNSigmaCut*(timeErrorNeg*timeErrorNeg + timeErrorPos*timeErrorPos));
+                fNTimeIncompatiblePairs += (active[0] && !simd_cast<int_m>(isTimeCompatible)).count();
+                for(int iPDGPos=0; iPDGPos<nPDGPos; iPDGPos++)
+                  active[iPDGPos] &= simd_cast<int_m>(isTimeCompatible);
+              }
+              
+              bool isPairGeometrySet = false;
+              int_m isGoodPairLocal;
+              float_v pairParametersLocal[fNPairGeometryParameters];
 
               for(int iPDGPos=0; iPDGPos<nPDGPos; iPDGPos++)
               {
@@ -1275,26 +2277,70 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
                 }
                 if(active[iPDGPos].isEmpty()) continue;
 
+                // parameters of the negative and positive daughters transported to the point of the closest approach
+                const float_v* pairParameters = pairParametersLocal;
                 if(!( (iTrTypePos == 1) && (iTrTypeNeg == 1) ) )
                 {
-                  float_v dS[2];
-                  daughterNeg.GetDStoParticleFast( daughterPos, dS );   
-                  float_v negParameters[8], posParameters[8];
-                  daughterNeg.TransportFast( dS[0], negParameters ); 
-                  daughterPos.TransportFast( dS[1], posParameters ); 
-                  float_v dx = negParameters[0]-posParameters[0]; 
-                  float_v dy = negParameters[1]-posParameters[1]; 
-                  float_v dz = negParameters[2]-posParameters[2];
-                  float_v dr = sqrt(dx*dx+dy*dy+dz*dz);
-
-                  active[iPDGPos] &= simd_cast<int_m>(dr < float_v(fDistanceCut));
-                  if(active[iPDGPos].isEmpty()) continue;
+                  const unsigned int cacheEntry = (iTrP/float_vLen)*float_vLen + iRot;
+                  unsigned int* cachedGeometry = 0;
+                  if(usePairGeometryCacheEntry)
+                    cachedGeometry = &fPairGeometryCache[cacheEntry];
                   
-                  float_v p1p2 = posParameters[3]*negParameters[3] + posParameters[4]*negParameters[4] + posParameters[5]*negParameters[5];
-                  float_v p12  = posParameters[3]*posParameters[3] + posParameters[4]*posParameters[4] + posParameters[5]*posParameters[5];
-                  float_v p22  = negParameters[3]*negParameters[3] + negParameters[4]*negParameters[4] + negParameters[5]*negParameters[5];
-                  active[iPDGPos] &= simd_cast<int_m>(p1p2 > -p12);
-                  active[iPDGPos] &= simd_cast<int_m>(p1p2 > -p22);
+                  int_m isGoodPair;
+                  if(cachedGeometry && ((*cachedGeometry) & fPairGeometryIsSet))
+                  {
+                    isGoodPair = ( (int_v(int(*cachedGeometry)) & laneBit) != int_v(Vc::Zero) );
+                    pairParameters = &fPairGeometryParameters[cacheEntry*fNPairGeometryParameters];
+                    fNPairGeometryReused++;
+                  }
+                  else if(isPairGeometrySet)
+                  {
+                    isGoodPair = isGoodPairLocal;
+                    fNPairGeometryReused++;
+                  }
+                  else
+                  {
+                    float_v dS[2];
+                    daughterNeg.GetDStoParticleFast( daughterPos, dS );   
+                    float_v negParameters[8], posParameters[8];
+                    daughterNeg.TransportFast( dS[0], negParameters ); 
+                    daughterPos.TransportFast( dS[1], posParameters ); 
+                    float_v dx = negParameters[0]-posParameters[0]; 
+                    float_v dy = negParameters[1]-posParameters[1]; 
+                    float_v dz = negParameters[2]-posParameters[2];
+                    float_v dr = sqrt(dx*dx+dy*dy+dz*dz);
+                    
+                    float_v p1p2 = posParameters[3]*negParameters[3] + posParameters[4]*negParameters[4] + posParameters[5]*negParameters[5];
+                    float_v p12  = posParameters[3]*posParameters[3] + posParameters[4]*posParameters[4] + posParameters[5]*posParameters[5];
+                    float_v p22  = negParameters[3]*negParameters[3] + negParameters[4]*negParameters[4] + negParameters[5]*negParameters[5];
+                    
+                    isGoodPair = simd_cast<int_m>( (dr < float_v(fDistanceCut)) && (p1p2 > -p12) && (p1p2 > -p22) );
+                    fNPairGeometryCalculated++;
+                    
+                    float_v* parametersToStore = pairParametersLocal;
+                    if(cachedGeometry)
+                    {
+                      unsigned int geometryBits = fPairGeometryIsSet;
+                      for(int iV=0; iV<float_vLen; iV++)
+                        if(isGoodPair[iV]) geometryBits |= (1u << iV);
+                      *cachedGeometry = geometryBits;
+                      parametersToStore = &fPairGeometryParameters[cacheEntry*fNPairGeometryParameters];
+                    }
+                    else
+                    {
+                      isPairGeometrySet = true;
+                      isGoodPairLocal = isGoodPair;
+                    }
+                    for(int iP=0; iP<6; iP++)
+                    {
+                      parametersToStore[iP] = negParameters[iP];
+                      parametersToStore[6+iP] = posParameters[iP];
+                    }
+                    pairParameters = parametersToStore;
+                  }
+                  
+                  active[iPDGPos] &= isGoodPair;
+                  if(active[iPDGPos].isEmpty()) continue;
                 }
                 
                 const float_v& ptNeg2 = daughterNeg.Px()*daughterNeg.Px() + daughterNeg.Py()*daughterNeg.Py();
@@ -1311,42 +2357,53 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
                 
                 if(active[iPDGPos].isEmpty()) continue;
 
+                int_m isPrefiltered = active[iPDGPos];
+                if(fUseV0Prefilter && (iTrTypeNeg == 0) && (iTrTypePos == 0))
+                {
+                  isPrefiltered &= V0Prefilter(pairParameters, trackPdgNeg, trackPdgPos[iPDGPos], motherPDG, isSecondary, PrimVtx);
+                  fNV0PrefilterTested += active[iPDGPos].count();
+                  fNV0PrefilterRejected += (active[iPDGPos] && !isPrefiltered).count();
+                }
+                
                 for(int iV=0; iV<float_vLen; iV++)
                 {
                   if(!(active[iPDGPos][iV])) continue;
                   
-
-                  idPosDaughters[nBufEntry] = iTrP+iV;
-                  idNegDaughters[nBufEntry] = negInd[iV];
+                  //pairs rejected by the prefilter are not constructed, but can still form the pi+ pi- pairs for the D0 decays
+                  if(isPrefiltered[iV])
+                  {
+                    idPosDaughters[nBufEntry] = posInd[iV];
+                    idNegDaughters[nBufEntry] = negInd[iV];
                   
-                  daughterPosPDG[nBufEntry] = trackPdgPos[iPDGPos][iV];
-                  daughterNegPDG[nBufEntry] = trackPdgNeg[iV];
+                    daughterPosPDG[nBufEntry] = trackPdgPos[iPDGPos][iV];
+                    daughterNegPDG[nBufEntry] = trackPdgNeg[iV];
                   
-                  if(motherPDG[iV] == 22)
-                  {
-                    daughterPosPDG[nBufEntry] = -11;
-                    daughterNegPDG[nBufEntry] =  11;
-                  }
+                    if(motherPDG[iV] == 22)
+                    {
+                      daughterPosPDG[nBufEntry] = -11;
+                      daughterNegPDG[nBufEntry] =  11;
+                    }
                   
-                  pvIndexMother[nBufEntry] = isPrimary[iV] ? negPVIndex[iV] : -1;
+                    pvIndexMother[nBufEntry] = isPrimary[iV] ? negPVIndex[iV] : -1;
                   
-                  if( iTrTypeNeg != iTrTypePos ) pvIndexMother[nBufEntry] = 0;
+                    if( iTrTypeNeg != iTrTypePos ) pvIndexMother[nBufEntry] = 0;
                   
-                  V0PDG[nBufEntry] = motherPDG[iV];
+                    V0PDG[nBufEntry] = motherPDG[iV];
                   
-                  nBufEntry++;
+                    nBufEntry++;
 
-                  if(int(nBufEntry) == float_vLen)
-                  {
-                    KFParticleDatabase::Instance()->GetMotherMass(V0PDG,massMotherPDG,massMotherPDGSigma);
-                    mother.SetPDG( V0PDG );
-                    ConstructV0(vTracks, trTypeIndexPos[iTrTypePos], trTypeIndexNeg[iTrTypeNeg],                
-                                idPosDaughters, idNegDaughters, daughterPosPDG, daughterNegPDG,
-                                mother, mother_temp,
-                                nBufEntry, l, dl, Particles, PrimVtx,
-                                cuts, pvIndexMother, secCuts, massMotherPDG,
-                                massMotherPDGSigma, motherPrimSecCand, nPrimSecCand, vMotherPrim, vMotherSec);
-                    nBufEntry = 0; 
+                    if(int(nBufEntry) == float_vLen)
+                    {
+                      KFParticleDatabase::Instance()->GetMotherMass(V0PDG,massMotherPDG,massMotherPDGSigma);
+                      mother.SetPDG( V0PDG );
+                      ConstructV0(vTracks, trTypeIndexPos[iTrTypePos], trTypeIndexNeg[iTrTypeNeg],                
+                                  idPosDaughters, idNegDaughters, daughterPosPDG, daughterNegPDG,
+                                  mother, mother_temp,
+                                  nBufEntry, l, dl, Particles, PrimVtx,
+                                  cuts, pvIndexMother, secCuts, massMotherPDG,
+                                  massMotherPDGSigma, motherPrimSecCand, nPrimSecCand, vMotherPrim, vMotherSec);
+                      nBufEntry = 0; 
+                    }
                   }
                   
                   //TODO optimize this part of code for D-mesons
@@ -1357,7 +2414,7 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
                      chiPrimNeg[iV] > fCutCharmChiPrim && chiPrimPos[iV] > fCutCharmChiPrim &&
                      ptNeg2[iV] >= fCutCharmPt*fCutCharmPt && ptPos2[iV] >= fCutCharmPt*fCutCharmPt )
                   {
-                    idPosDaughters[nBufEntry] = iTrP+iV;
+                    idPosDaughters[nBufEntry] = posInd[iV];
                     idNegDaughters[nBufEntry] = negInd[iV];
                     
                     daughterPosPDG[nBufEntry] = trackPdgPos[iPDGPos][iV];
@@ -1387,34 +2444,34 @@ void KFParticleFinder::Find2DaughterDecay(KFPTrackVector* vTracks, kfvector_floa
               }//iPDGPos
             }//iRot
           }//iTrP
-        }//iTrN
-        
-        if( nBufEntry>0 )
+        }//iTC
+      }//iTrN
+      
+      if( nBufEntry>0 )
+      {
+        for(int iV=nBufEntry; iV<float_vLen; iV++)
         {
-          for(int iV=nBufEntry; iV<float_vLen; iV++)
-          {
-            idPosDaughters[iV] = idPosDaughters[0];
-            idNegDaughters[iV] = idNegDaughters[0];
-          }
+          idPosDaughters[iV] = idPosDaughters[0];
+          idNegDaughters[iV] = idNegDaughters[0];
+        }
 
-          KFParticleDatabase::Instance()->GetMotherMass(V0PDG,massMotherPDG,massMotherPDGSigma);
-          mother.SetPDG( V0PDG );
+        KFParticleDatabase::Instance()->GetMotherMass(V0PDG,massMotherPDG,massMotherPDGSigma);
+        mother.SetPDG( V0PDG );
 
-          ConstructV0(vTracks, trTypeIndexPos[iTrTypePos], trTypeIndexNeg[iTrTypeNeg],              
-                      idPosDaughters, idNegDaughters, daughterPosPDG, daughterNegPDG,
-                      mother, mother_temp,
-                      nBufEntry, l, dl, Particles, PrimVtx,
-                      cuts, pvIndexMother, secCuts, massMotherPDG,
-                      massMotherPDGSigma, motherPrimSecCand, nPrimSecCand, vMotherPrim, vMotherSec);
-          nBufEntry = 0; 
-        }
-        
-        if(nPrimSecCand>0)
-        {
-          SaveV0PrimSecCand(motherPrimSecCand,nPrimSecCand,mother_temp,PrimVtx,secCuts,vMotherPrim,vMotherSec);
-          nPrimSecCand = 0;
-        }
-      }//iTC
+        ConstructV0(vTracks, trTypeIndexPos[iTrTypePos], trTypeIndexNeg[iTrTypeNeg],              
+                    idPosDaughters, idNegDaughters, daughterPosPDG, daughterNegPDG,
+                    mother, mother_temp,
+                    nBufEntry, l, dl, Particles, PrimVtx,
+                    cuts, pvIndexMother, secCuts, massMotherPDG,
+                    massMotherPDGSigma, motherPrimSecCand, nPrimSecCand, vMotherPrim, vMotherSec);
+        nBufEntry = 0; 
+      }
+      
+      if(nPrimSecCand>0)
+      {
+        SaveV0PrimSecCand(motherPrimSecCand,nPrimSecCand,mother_temp,PrimVtx,secCuts,vMotherPrim,vMotherSec);
+        nPrimSecCand = 0;
+      }
     }//iTrTypeNeg
   }//iTrTypePos
 }
@@ -1591,6 +2648,226 @@ void KFParticleFinder::ConstructPrimaryBG(KFPTrackVector* vTracks,
   }
 }
 
+float_m KFParticleFinder::SelectPrimaryBackgroundPair(const KFParticleSIMD& daughter, const KFParticleSIMD& partner, KFParticleSIMD& mother,
+                                                       std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx) const
+{
+  /** Constructs a SIMD vector of background pairs of primary tracks and applies the same selection as KFParticleFinder::ConstructV0()
+   ** applies to the primary 2-daughter candidates: \f$\chi^2_{geo}/NDF\f$ below KFParticleFinder::fCuts2D[1], finite and positive
+   ** \f$\chi^2\f$, and the distance to the closest primary vertex below 200 cm. Returns the mask of the accepted pairs.
+   ** \param[in] daughter - SIMD vector with the first daughters.
+   ** \param[in] partner - SIMD vector with the second daughters.
+   ** \param[out] mother - constructed background pairs.
+   ** \param[in] PrimVtx - array with primary vertices.
+   **/
+  const KFParticleSIMD* vDaughtersPointer[2] = {&partner, &daughter};
+  mother.Construct(vDaughtersPointer, 2, 0);
+  
+  float_m isGood = (mother.Chi2()/simd_cast<float_v>(mother.NDF()) < fCuts2D[1]);
+  isGood &= KFPMath::Finite(mother.GetChi2());
+  isGood &= (mother.GetChi2() > 0.0f);
+  isGood &= (mother.GetChi2() == mother.GetChi2());
+  if( isGood.isEmpty() ) return isGood;
+  
+  float_v lMin(1.e8f);
+  for(int iP=0; iP<fNPV; iP++)
+  {
+    float_v l, dl;
+    mother.GetDistanceToVertexLine(PrimVtx[iP], l, dl);
+    lMin( (l < lMin) && isGood ) = l;
+  }
+  isGood &= (lMin < 200.f);
+  
+  return isGood;
+}
+
+void KFParticleFinder::StoreBackgroundMass(const int_v& motherPDG, const float_v& mass, const float_m& active)
+{
+  /** Stores the PDG code and the invariant mass of the background pairs to KFParticleFinder::fBackgroundPDG and 
+   ** KFParticleFinder::fBackgroundMass.
+   ** \param[in] motherPDG - PDG codes of the background pairs
+   ** \param[in] mass - invariant mass of the background pairs
+   ** \param[in] active - mask of the pairs to be stored
+   **/
+  for(int iV=0; iV<float_vLen; iV++)
+  {
+    if(!(active[iV])) continue;
+    fBackgroundPDG.push_back(motherPDG[iV]);
+    fBackgroundMass.push_back(mass[iV]);
+  }
+}
+
+void KFParticleFinder::FillPrimaryBackground(KFPTrackVector* vTracks, std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx)
+{
+  /** Constructs background for 2-daughter resonances in one vectorised pass over primary tracks and stores only the PDG code
+   ** and the invariant mass of the pairs to KFParticleFinder::fBackgroundPDG and KFParticleFinder::fBackgroundMass, the
+   ** candidates are not stored to the output array. Both daughters should belong to the same primary vertex, the pairs are
+   ** fitted and selected with the cuts of the primary 2-daughter candidates (KFParticleFinder::SelectPrimaryBackgroundPair()), 
+   ** so the background is comparable to the signal. Two types of the background are constructed: \n
+   ** 1) like-sign pairs with the same PDG codes as in KFParticleFinder::ConstructPrimaryBG(); \n
+   ** 2) unlike-sign pairs, where the positive daughter is rotated in the XY plane around its primary vertex on
+   ** \f$\alpha_k = \pi(2k+1)/N\f$, k = 0..N-1, N = KFParticleFinder::fNBackgroundRotations. The pairs are stored with the PDG
+   ** codes of the corresponding resonances. \n
+   ** The outer loop runs over SIMD vectors of tracks, the rotated daughters are calculated once for each vector and are reused
+   ** for all partners.
+   ** \param[in] vRTracks - pointer to the array with vectors of tracks:\n
+   ** 0) secondary positive at the first hit position; \n
+   ** 1) secondary negative at the first hit position; \n
+   ** 2) primary positive at the first hit position; \n
+   ** 3) primary negative at the first hit position; \n
+   ** 4) secondary positive at the last hit position; \n
+   ** 5) secondary negative at the last hit position; \n
+   ** 6) primary positive at the last hit position; \n
+   ** 7) primary negative at the last hit position.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   **/
+  const int nRotations = fNBackgroundRotations;
+  std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> > rotatedDaughter(nRotations);
+  
+  KFParticleSIMD daughter, partner, mother;
+  float_v mass, massError;
+  
+  KFPTrackVector& negativeTracks = vTracks[3];
+  
+  for(int iSet=2; iSet<4; iSet++)
+  {
+    const int signPDG = (iSet == 2) ? 1 : -1;
+    KFPTrackVector& tracks = vTracks[iSet];
+    const int nTracks = tracks.Size();
+    const bool constructRotated = (iSet == 2) && (nRotations > 0);
+    
+    for(int iTr=0; iTr<nTracks; iTr += float_vLen)
+    {
+      const int_v& pdg = reinterpret_cast<const int_v&>(tracks.PDG()[iTr]);
+      const int_v& pvIndex = reinterpret_cast<const int_v&>(tracks.PVIndex()[iTr]);
+      const int_v& trackIndex = int_v::IndexesFromZero() + iTr;
+      const int_m& isValid = (trackIndex < nTracks) && (pdg != -1) && (pvIndex >= 0) && (pvIndex < fNPV);
+      if(isValid.isEmpty()) continue;
+      
+      daughter.Load(tracks, iTr, pdg);
+      const int_v& absPDG = abs(pdg);
+      
+      //like-sign pairs, each pair is taken once
+      for(int jTr=iTr+1; jTr<nTracks; jTr++)
+      {
+        const int partnerPDG = abs(tracks.PDG()[jTr]);
+        if( !(partnerPDG == 211 || partnerPDG == 321 || partnerPDG == 2212) ) continue;
+        
+        int_m active = isValid && (trackIndex < jTr) && (pvIndex == tracks.PVIndex()[jTr]);
+        if(active.isEmpty()) continue;
+        
+        int_v motherPDG(-1);
+        if(partnerPDG == 211)
+        {
+          motherPDG( absPDG ==  211 ) = signPDG*9001; //pi+pi+
+          motherPDG( absPDG ==  321 ) = signPDG*9002; //pi+K+
+          motherPDG( absPDG == 2212 ) = signPDG*2224; //pi+p
+        }
+        else if(partnerPDG == 321)
+        {
+          motherPDG( absPDG ==  211 ) = signPDG*9002; //pi+K+
+          motherPDG( absPDG ==  321 ) = signPDG*9003; //K+K+
+          motherPDG( absPDG == 2212 ) = signPDG*9004; //K+p
+        }
+        else
+        {
+          motherPDG( absPDG ==  211 ) = signPDG*2224; //pi+p
+          motherPDG( absPDG ==  321 ) = signPDG*9004; //K+p
+        }
+        active &= (motherPDG != -1);
+        if(!(fDecayReconstructionList.empty()))
+        {
+          for(int iV=0; iV<float_vLen; iV++)
+          {
+            if(!(active[iV])) continue;
+            if(fDecayReconstructionList.find(motherPDG[iV]) == fDecayReconstructionList.end())
+              motherPDG[iV] = -1;
+          }
+          active &= (motherPDG != -1);
+        }
+        if(active.isEmpty()) continue;
+        
+        uint_v partnerIndex(jTr);
+        partner.Create(tracks, partnerIndex, int_v(tracks.PDG()[jTr]));
+        const float_m& isGoodPair = simd_cast<float_m>(active) && SelectPrimaryBackgroundPair(daughter, partner, mother, PrimVtx);
+        if(isGoodPair.isEmpty()) continue;
+        
+        mother.GetMass(mass, massError);
+        StoreBackgroundMass(motherPDG, mass, isGoodPair);
+      }
+      
+      if(!constructRotated) continue;
+      
+      //rotated unlike-sign pairs
+      float_v vertex[3] = {0.f, 0.f, 0.f};
+      for(int iV=0; iV<float_vLen; iV++)
+      {
+        if(!(isValid[iV])) continue;
+        vertex[0][iV] = PrimVtx[pvIndex[iV]].X()[0];
+        vertex[1][iV] = PrimVtx[pvIndex[iV]].Y()[0];
+        vertex[2][iV] = PrimVtx[pvIndex[iV]].Z()[0];
+      }
+      for(int iRotation=0; iRotation<nRotations; iRotation++)
+      {
+        rotatedDaughter[iRotation] = daughter;
+        rotatedDaughter[iRotation].RotateXY(3.14159265359f*float(2*iRotation+1)/float(nRotations), vertex);
+      }
+      
+      for(int jTr=0; jTr<negativeTracks.Size(); jTr++)
+      {
+        const int partnerPDG = abs(negativeTracks.PDG()[jTr]);
+        if( !(partnerPDG == 211 || partnerPDG == 321 || partnerPDG == 2212) ) continue;
+        
+        int_m active = isValid && (pvIndex == negativeTracks.PVIndex()[jTr]);
+        if(active.isEmpty()) continue;
+        
+        int_v motherPDG(-1);
+        if(partnerPDG == 211)
+        {
+          motherPDG( absPDG ==  211 ) =   113; //rho -> pi+ pi-
+          motherPDG( absPDG ==  321 ) =   313; //K*0 -> K+ pi-
+          motherPDG( absPDG == 2212 ) =  2114; //Delta0 -> p pi-
+        }
+        else if(partnerPDG == 321)
+        {
+          motherPDG( absPDG ==  211 ) =  -313; //K*0_bar -> K- pi+
+          motherPDG( absPDG ==  321 ) =   333; //phi -> K+ K-
+          motherPDG( absPDG == 2212 ) =  3124; //Lambda* -> p K-
+        }
+        else
+        {
+          motherPDG( absPDG ==  211 ) = -2114; //Delta0_bar -> p- pi+
+          motherPDG( absPDG ==  321 ) = -3124; //Lambda*_bar -> p- K+
+        }
+        active &= (motherPDG != -1);
+        if(!(fDecayReconstructionList.empty()))
+        {
+          for(int iV=0; iV<float_vLen; iV++)
+          {
+            if(!(active[iV])) continue;
+            if(fDecayReconstructionList.find(motherPDG[iV]) == fDecayReconstructionList.end())
+              motherPDG[iV] = -1;
+          }
+          active &= (motherPDG != -1);
+        }
+        if(active.isEmpty()) continue;
+        
+        uint_v partnerIndex(jTr);
+        partner.Create(negativeTracks, partnerIndex, int_v(negativeTracks.PDG()[jTr]));
+        
+        for(int iRotation=0; iRotation<nRotations; iRotation++)
+        {
+          const float_m& isGoodPair = simd_cast<float_m>(active) && 
+                                      SelectPrimaryBackgroundPair(rotatedDaughter[iRotation], partner, mother, PrimVtx);
+          if(isGoodPair.isEmpty()) continue;
+          
+          mother.GetMass(mass, massError);
+          StoreBackgroundMass(motherPDG, mass, isGoodPair);
+        }
+      }
+    }
+  }
+}
+
 void KFParticleFinder::ConstructTrackV0Cand(KFPTrackVector& vTracks,
                                             uint_v& idTracks,
                                             int_v& trackPDG,
@@ -1926,6 +3203,16 @@ void KFParticleFinder::ConstructTrackV0Cand(KFPTrackVector& vTracks,
       mother_temp.AddDaughterId(Particles.size());
       mother_temp.AddDaughterId(trackId[iv]);
       Particles.push_back(daughter_temp);
+      Particles.push_back(mother_temp);
+      continue;
+    }
+    
+    // primary candidates of the channels without output lists, for example resonances, are final
+    if( isPrimary[iv] && !vMotherPrim && !vMotherSec && 
+        abs(mother.GetPDG()[iv]) != 3312 && abs(mother.GetPDG()[iv]) != 3334 && mother.GetPDG()[iv] != 3203 && mother.GetPDG()[iv] != 3010 )
+    {
+      AddFinalCandidate(Particles, mother_temp);
+      continue;
     }
     Particles.push_back(mother_temp);
 
@@ -1968,6 +3255,24 @@ void KFParticleFinder::ConstructTrackV0Cand(KFPTrackVector& vTracks,
   }
 }
 
+KFParticleSIMD& KFParticleFinder::GetTrackV0TileTrack(KFPTrackVector& vTracks, const int iTr, const int firstTrackTile, const int_v& trackPDG)
+{
+  /** Returns the SIMD vector of tracks starting from "iTr" in the current tile of KFParticleFinder::FindTrackV0Decay(). 
+   ** Tracks are converted from the columns of "vTracks" at the first request and are reused by other particles of the tile.
+   ** \param[in] vTracks - vector with input tracks
+   ** \param[in] iTr - index of the first track in the SIMD vector
+   ** \param[in] firstTrackTile - index of the first track of the current tile
+   ** \param[in] trackPDG - PDG hypotheses of the tracks
+   **/
+  const int iVector = (iTr - firstTrackTile)/float_vLen;
+  if(!fIsTrackV0TileTrackLoaded[iVector])
+  {
+    fTrackV0TileTracks[iVector].Load(vTracks, iTr, trackPDG);
+    fIsTrackV0TileTrackLoaded[iVector] = true;
+  }
+  return fTrackV0TileTracks[iVector];
+}
+
 void KFParticleFinder::FindTrackV0Decay(vector<KFParticle>& vV0,
                                         const int V0PDG,
                                         KFPTrackVector& vTracks,
@@ -1997,11 +3302,14 @@ void KFParticleFinder::FindTrackV0Decay(vector<KFParticle>& vV0,
    **/
   
   if( (vV0.size() < 1) || ((lastTrack-firstTrack) < 1) ) return;
+  const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  fNTrackV0Combinations += (unsigned long)(vV0.size())*(lastTrack - firstTrack);
+  
   KFParticle mother_temp;
 
   KFParticle* v0Pointer[float_v::Size];
 
-  KFParticleSIMD mother, track;
+  KFParticleSIMD mother;
   std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> > motherTopo(fNPV);
 
   kfvector_floatv l(fNPV), dl(fNPV);
@@ -2022,14 +3330,32 @@ void KFParticleFinder::FindTrackV0Decay(vector<KFParticle>& vV0,
 
   bool isCharm = ((abs(V0PDG) == 421) || (abs(V0PDG) == 411) || (abs(V0PDG) == 429) || (abs(V0PDG) == 420) || (abs(V0PDG) == 419)) && (v0PVIndex<0);
 
-  for(unsigned int iV0=0; iV0 < vV0.size(); iV0++)
+  // Without tiling each particle is combined with the whole range of tracks. With tiling the loop runs over the tiles of 
+  // fTrackV0TileNV0 particles and fTrackV0TileNTracks tracks, the tracks of the tile are read from the columns of vTracks 
+  // and converted to KFParticleSIMD once and stay in the cache while all particles of the tile are combined with them.
+  const bool isTiled = (fTrackV0TileNTracks > 0);
+  const int nV0Tile = isTiled ? std::max(fTrackV0TileNV0, 1) : 1;
+  const int nTracksTile = isTiled ? ((fTrackV0TileNTracks + float_vLen - 1)/float_vLen)*float_vLen : (lastTrack - firstTrack);
+  fTrackV0TileV0s.resize(nV0Tile);
+  fTrackV0TileTracks.resize((nTracksTile + float_vLen - 1)/float_vLen);
+  
+  for(unsigned int firstV0Tile=0; firstV0Tile < vV0.size(); firstV0Tile += nV0Tile)
+  for(int firstTrackTile=firstTrack; firstTrackTile < lastTrack; firstTrackTile += nTracksTile)
+  for(unsigned int iV0=firstV0Tile; iV0 < std::min(firstV0Tile + nV0Tile, (unsigned int)(vV0.size())); iV0++)
   {    
+    // particles of the tile are converted with its first tile of tracks, converted tracks are dropped when a new tile starts
+    if( (v0PVIndex < 0) && (firstTrackTile == firstTrack) )
+      fTrackV0TileV0s[iV0 - firstV0Tile] = KFParticleSIMD(vV0[iV0]);
+    if(iV0 == firstV0Tile)
+      fIsTrackV0TileTrackLoaded.assign(fTrackV0TileTracks.size(), false);
+    const int lastTrackTile = std::min(firstTrackTile + nTracksTile, lastTrack);
+    
     int iNegDaughter = vV0[iV0].DaughterIds()[0];
     int iPosDaughter = vV0[iV0].DaughterIds()[1];
     
-    for(int iTr=firstTrack; iTr < lastTrack; iTr += float_vLen)
+    for(int iTr=firstTrackTile; iTr < lastTrackTile; iTr += float_vLen)
     {
-      const int NTracks = (iTr + float_vLen < lastTrack) ? float_vLen : (lastTrack - iTr);
+      const int NTracks = (iTr + float_vLen < lastTrackTile) ? float_vLen : (lastTrackTile - iTr);
 
       const int_v& trackPDG = reinterpret_cast<const int_v&>(vTracks.PDG()[iTr]);
       const int_v& trackPVIndex = reinterpret_cast<const  int_v&>(vTracks.PVIndex()[iTr]);
@@ -2040,6 +3366,19 @@ void KFParticleFinder::FindTrackV0Decay(vector<KFParticle>& vV0,
       const int_m& isSamePV = (isPrimary && (v0PVIndex == trackPVIndex)) || !(isPrimary);
 
       float_m closeDaughters = simd_cast<float_m>(isSamePV) && simd_cast<float_m>(int_v::IndexesFromZero() < int(NTracks));
+          
+      // own daughter tracks of the particle are excluded before the geometry is checked and the combination is constructed
+      const int_v& trackId = reinterpret_cast<const int_v&>(vTracks.Id()[iTr]);
+      int_m isOwnDaughter(false);
+      for(int iD=0; iD<vV0[iV0].NDaughters(); iD++)
+        isOwnDaughter |= (trackId == int_v(vV0[iV0].DaughterIds()[iD]));
+      isOwnDaughter &= simd_cast<int_m>(closeDaughters);
+      if(!(isOwnDaughter.isEmpty()))
+      {
+        fNTrackV0ExcludedDaughters[V0PDG] += isOwnDaughter.count();
+        closeDaughters &= !simd_cast<float_m>(isOwnDaughter);
+        if(closeDaughters.isEmpty()) continue;
+      }
 
 //       if(v0PVIndex < 0)
 //       {
@@ -2080,8 +3419,8 @@ void KFParticleFinder::FindTrackV0Decay(vector<KFParticle>& vV0,
       
       if(v0PVIndex < 0)
       {
-        KFParticleSIMD v0(vV0[iV0]);
-        track.Load(vTracks, iTr, trackPDG);
+        const KFParticleSIMD& v0 = fTrackV0TileV0s[iV0 - firstV0Tile];
+        const KFParticleSIMD& track = GetTrackV0TileTrack(vTracks, iTr, firstTrackTile, trackPDG);
         closeDaughters &= v0.GetDistanceFromParticle(track) < float_v(fDistanceCut);
         if(closeDaughters.isEmpty()) continue;
       }
@@ -2288,6 +3627,9 @@ void KFParticleFinder::FindTrackV0Decay(vector<KFParticle>& vV0,
           motherPDG( isSecondary && int_m(trackPdgPos[iPDGPos] ==  211) ) = -204122;
         
         active[iPDGPos] &= (motherPDG != -1);
+        // D+ -> K- pi+ pi+ is reconstructed directly from tracks by KFParticleFinder::FindNProngDecay()
+        if(fUseNProngCharm && isCharm)
+          active[iPDGPos] &= (abs(motherPDG) != 411);
         if(!(fDecayReconstructionList.empty()))
         {
           for(int iV=0; iV<float_vLen; iV++)
@@ -2306,7 +3648,7 @@ void KFParticleFinder::FindTrackV0Decay(vector<KFParticle>& vV0,
         
         if(isCharm)
         {
-          track.Load(vTracks, iTr, trackPDG);
+          const KFParticleSIMD& track = GetTrackV0TileTrack(vTracks, iTr, firstTrackTile, trackPDG);
           const float_v& trackPt = track.Px()*track.Px() + track.Py()*track.Py();
           const int_v& nPixelHits = reinterpret_cast<const int_v&>(vTracks.NPixelHits()[iTr]);
           
@@ -2327,7 +3669,7 @@ void KFParticleFinder::FindTrackV0Decay(vector<KFParticle>& vV0,
                  
           if(!(isCharmParticle.isEmpty()))
           {
-            track.Load(vTracks, iTr, trackPDG);
+            const KFParticleSIMD& track = GetTrackV0TileTrack(vTracks, iTr, firstTrackTile, trackPDG);
             const float_v& trackPt = track.Px()*track.Px() + track.Py()*track.Py();
             const int_v& nPixelHits = reinterpret_cast<const int_v&>(vTracks.NPixelHits()[iTr]);
             
@@ -2407,22 +3749,339 @@ void KFParticleFinder::FindTrackV0Decay(vector<KFParticle>& vV0,
         }//iV
       }//iPDGPos
     }//iTr
+  }//iV0
+
+  if(nBufEntry > 0)
+  {
+    for(int iV=nBufEntry; iV<float_vLen; iV++)
+      idTrack[iV] = idTrack[0];
+    
+    mother.SetPDG( motherParticlePDG );
+    ConstructTrackV0Cand(vTracks,  
+                          idTrack, trackPDGMother, v0Pointer,
+                          mother, motherTopo, mother_temp,
+                          nBufEntry, l, dl, Particles, PrimVtx,
+                          cuts, pvIndexMother, massMotherPDG,
+                          massMotherPDGSigma, vMotherPrim, vMotherSec);
+    nBufEntry = 0; 
   }
+  
+  fTrackV0Time += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
 
+void KFParticleFinder::FindNProngDecay(std::vector<KFParticle>& vMother,
+                                       const int motherPDG,
+                                       const int nProngs,
+                                       KFPTrackVector** prongTracks,
+                                       kfvector_float** prongChiPrim,
+                                       const int* prongPDG,
+                                       const int* firstTrack,
+                                       const int* lastTrack,
+                                       std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx)
+{
+  /** Reconstructs decays with "nProngs" charged daughters directly from tracks. Tracks of each prong are preselected with 
+   ** the open charm cuts on \f$p_t\f$, \f$\chi^2_{prim}\f$ and the number of precise measurements. For each two prongs a table of 
+   ** track pairs is filled in SIMD: a pair is accepted if the distance of the closest approach is below KFParticleFinder::fDistanceCut,
+   ** the daughters do not fly in the opposite directions and the \f$\chi^2_{geo}\f$ of their common vertex passes the cut for open 
+   ** charm with >=3 daughters, see KFParticleFinder::FitNProngPairs(). Then tuples of tracks are enumerated with ordered indices, if 
+   ** neighbouring prongs are taken from the same range of tracks each set of tracks is enumerated only once. Tuples with all pairs 
+   ** accepted are collected into SIMD vectors and fitted to a common vertex, see KFParticleFinder::ConstructNProngCand().
+   ** \param[out] vMother - output vector with candidates, which should be further selected with KFParticleFinder::SelectParticles().
+   ** \param[in] motherPDG - PDG hypothesis of the mother particle.
+   ** \param[in] nProngs - number of daughter tracks, should not exceed KFParticleFinder::fNProngMax.
+   ** \param[in] prongTracks - vector of tracks for each prong.
+   ** \param[in] prongChiPrim - \f$\chi^2_{prim}\f$ deviations of the tracks for each prong.
+   ** \param[in] prongPDG - PDG hypothesis for each prong.
+   ** \param[in] firstTrack - index of the first track in the vector of tracks for each prong.
+   ** \param[in] lastTrack - index of the last track in the vector of tracks for each prong.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   **/
+  
+  if( (nProngs < 2) || (nProngs > fNProngMax) ) return;
+  if( !(fDecayReconstructionList.empty()) && (fDecayReconstructionList.find(motherPDG) == fDecayReconstructionList.end()) ) return;
+  
+  // preselected tracks and pair tables of the prongs, which are the same as in the previous call within the event, are reused
+  bool isSameRange[fNProngMax];
+  for(int iProng=0; iProng<nProngs; iProng++)
+  {
+    isSameRange[iProng] = (iProng > 0) && (prongTracks[iProng] == prongTracks[iProng-1]) && (prongPDG[iProng] == prongPDG[iProng-1]) &&
+                          (firstTrack[iProng] == firstTrack[iProng-1]) && (lastTrack[iProng] == lastTrack[iProng-1]);
+    
+    if( (fNProngKeyTracks[iProng] == prongTracks[iProng]) && (fNProngKey[iProng][0] == prongPDG[iProng]) &&
+        (fNProngKey[iProng][1] == firstTrack[iProng]) && (fNProngKey[iProng][2] == lastTrack[iProng]) )
+    {
+      if(fNProngTracks[iProng].empty()) return;
+      continue;
+    }
+    
+    fNProngKeyTracks[iProng] = prongTracks[iProng];
+    fNProngKey[iProng][0] = prongPDG[iProng];
+    fNProngKey[iProng][1] = firstTrack[iProng];
+    fNProngKey[iProng][2] = lastTrack[iProng];
+    for(int iTableProng=0; iTableProng<=iProng; iTableProng++)
+      for(int jTableProng=iProng; jTableProng<fNProngMax; jTableProng++)
+        fIsNProngPairTableSet[iTableProng][jTableProng] = false;
+    
+    std::vector<int>& goodTracks = fNProngTracks[iProng];
+    if(isSameRange[iProng])
+    {
+      goodTracks = fNProngTracks[iProng-1];
+      continue;
+    }
+    
+    goodTracks.clear();
+    const KFPTrackVector& tracks = *(prongTracks[iProng]);
+    const kfvector_float& chiPrim = *(prongChiPrim[iProng]);
+    const int_v absPDG(abs(prongPDG[iProng]));
+    for(int iTr=(firstTrack[iProng]/float_vLen)*float_vLen; iTr<lastTrack[iProng]; iTr += float_vLen)
+    {
+      const int_v index = int_v(iTr) + int_v::IndexesFromZero();
+      const float_v& px = reinterpret_cast<const float_v&>(tracks.Px()[iTr]);
+      const float_v& py = reinterpret_cast<const float_v&>(tracks.Py()[iTr]);
+      const int_v& trackPDG = reinterpret_cast<const int_v&>(tracks.PDG()[iTr]);
+      const int_v& nPixelHits = reinterpret_cast<const int_v&>(tracks.NPixelHits()[iTr]);
+      
+      int_m isGood = (index >= firstTrack[iProng]) && (index < lastTrack[iProng]) && (nPixelHits >= int_v(3));
+      isGood &= (abs(trackPDG) == absPDG) || ( (trackPDG == -1) && (absPDG == 211) );
+      isGood &= simd_cast<int_m>(px*px + py*py >= fCutCharmPt*fCutCharmPt);
+      isGood &= simd_cast<int_m>(reinterpret_cast<const float_v&>(chiPrim[iTr]) > fCutCharmChiPrim);
+      if(isGood.isEmpty()) continue;
+      
+      for(int iV=0; iV<float_vLen; iV++)
+        if(isGood[iV]) goodTracks.push_back(iTr + iV);
+    }
+    if(goodTracks.empty()) return;
+  }
+  
+  // tables of the accepted pairs: prongs taken from the same range share the tables, within the same range only pairs 
+  // with ordered indices are needed
+  int firstOfRange[fNProngMax];
+  const std::vector<char>* pairTables[fNProngMax][fNProngMax];
+  for(int iProng=0; iProng<nProngs; iProng++)
+    firstOfRange[iProng] = isSameRange[iProng] ? firstOfRange[iProng-1] : iProng;
+  
+  for(int iProng=0; iProng<nProngs-1; iProng++)
+  {
+    const std::vector<int>& tracksA = fNProngTracks[iProng];
+    const int nA = tracksA.size();
+    for(int jProng=iProng+1; jProng<nProngs; jProng++)
+    {
+      const bool isOrdered = (firstOfRange[iProng] == firstOfRange[jProng]);
+      const int iTableProng = firstOfRange[iProng];
+      const int jTableProng = isOrdered ? (iTableProng + 1) : firstOfRange[jProng];
+      pairTables[iProng][jProng] = &fNProngPairTable[iTableProng][jTableProng];
+      if( (iTableProng != iProng) || (jTableProng != jProng) || fIsNProngPairTableSet[iProng][jProng] ) continue;
+      fIsNProngPairTableSet[iProng][jProng] = true;
+      
+      const std::vector<int>& tracksB = fNProngTracks[jProng];
+      const int nB = tracksB.size();
+      std::vector<char>& pairTable = fNProngPairTable[iProng][jProng];
+      pairTable.assign(nA*nB, 0);
+      
+      // pairs passing the geometry cuts are collected into SIMD vectors and fitted
+      uint_v pairIndexA, pairIndexB;
+      int pairTablePosition[float_vLen];
+      int nPairs = 0;
+      for(int iA=0; iA<nA; iA++)
+      {
+        uint_v indexA(static_cast<unsigned int>(tracksA[iA]));
+        KFParticleSIMD daughterA(*(prongTracks[iProng]), indexA, int_v(prongPDG[iProng]));
+        for(int iB=(isOrdered ? iA+1 : 0); iB<nB; iB += float_vLen)
+        {
+          const int nLanes = std::min(int(float_vLen), nB - iB);
+          uint_v indexB;
+          for(int iV=0; iV<float_vLen; iV++)
+            indexB[iV] = tracksB[iB + std::min(iV, nLanes-1)];
+          KFParticleSIMD daughterB(*(prongTracks[jProng]), indexB, int_v(prongPDG[jProng]));
+          
+          float_v dS[2];
+          daughterA.GetDStoParticleFast( daughterB, dS );
+          float_v parametersA[8], parametersB[8];
+          daughterA.TransportFast( dS[0], parametersA );
+          daughterB.TransportFast( dS[1], parametersB );
+          const float_v dx = parametersA[0] - parametersB[0];
+          const float_v dy = parametersA[1] - parametersB[1];
+          const float_v dz = parametersA[2] - parametersB[2];
+          const float_v dr = sqrt(dx*dx + dy*dy + dz*dz);
+          
+          const float_v p1p2 = parametersA[3]*parametersB[3] + parametersA[4]*parametersB[4] + parametersA[5]*parametersB[5];
+          const float_v p12  = parametersA[3]*parametersA[3] + parametersA[4]*parametersA[4] + parametersA[5]*parametersA[5];
+          const float_v p22  = parametersB[3]*parametersB[3] + parametersB[4]*parametersB[4] + parametersB[5]*parametersB[5];
+          const float_m isGoodPair = (dr < float_v(fDistanceCut)) && (p1p2 > -p12) && (p1p2 > -p22);
+          fNNProngPairs += nLanes;
+          if(isGoodPair.isEmpty()) continue;
+          
+          for(int iV=0; iV<nLanes; iV++)
+          {
+            if(!(isGoodPair[iV])) continue;
+            // copies of the same track with different PID hypotheses, see KFParticleFinder::ExpandPIDHypotheses()
+            if(prongTracks[iProng]->Id()[tracksA[iA]] == prongTracks[jProng]->Id()[indexB[iV]]) continue;
+            pairIndexA[nPairs] = tracksA[iA];
+            pairIndexB[nPairs] = indexB[iV];
+            pairTablePosition[nPairs] = iA*nB + iB + iV;
+            nPairs++;
+            if(nPairs == float_vLen)
+            {
+              FitNProngPairs(pairTable, *(prongTracks[iProng]), prongPDG[iProng], *(prongTracks[jProng]), prongPDG[jProng],
+                             pairIndexA, pairIndexB, pairTablePosition, nPairs);
+              nPairs = 0;
+            }
+          }
+        }
+      }
+      if(nPairs > 0)
+      {
+        for(int iV=nPairs; iV<float_vLen; iV++)
+        {
+          pairIndexA[iV] = pairIndexA[0];
+          pairIndexB[iV] = pairIndexB[0];
+        }
+        FitNProngPairs(pairTable, *(prongTracks[iProng]), prongPDG[iProng], *(prongTracks[jProng]), prongPDG[jProng],
+                       pairIndexA, pairIndexB, pairTablePosition, nPairs);
+      }
+    }
+  }
+  
+  // enumeration of the tuples, the prong iProng is advanced after all combinations of the next prongs are checked
+  uint_v prongIndex[fNProngMax];
+  int nBufEntry = 0;
+  int iTuple[fNProngMax];
+  int iProng = 0;
+  iTuple[0] = -1;
+  while(iProng >= 0)
+  {
+    iTuple[iProng]++;
+    if(iTuple[iProng] >= int(fNProngTracks[iProng].size()))
+    {
+      iProng--;
+      continue;
+    }
+    
+    bool isGoodTuple = true;
+    for(int iPrev=0; (iPrev<iProng) && isGoodTuple; iPrev++)
+      isGoodTuple = (*(pairTables[iPrev][iProng]))[iTuple[iPrev]*fNProngTracks[iProng].size() + iTuple[iProng]];
+    if(!isGoodTuple) continue;
+    
+    if(iProng < nProngs-1)
+    {
+      iProng++;
+      iTuple[iProng] = isSameRange[iProng] ? iTuple[iProng-1] : -1;
+      continue;
+    }
+    
+    for(int jProng=0; jProng<nProngs; jProng++)
+      prongIndex[jProng][nBufEntry] = fNProngTracks[jProng][iTuple[jProng]];
+    nBufEntry++;
+    fNNProngTuples++;
+    
+    if(nBufEntry == float_vLen)
+    {
+      ConstructNProngCand(vMother, motherPDG, nProngs, prongTracks, prongPDG, prongIndex, nBufEntry, PrimVtx);
+      nBufEntry = 0;
+    }
+  }
+  
   if(nBufEntry > 0)
   {
-    for(int iV=nBufEntry; iV<float_vLen; iV++)
-      idTrack[iV] = idTrack[0];
-    
-    mother.SetPDG( motherParticlePDG );
-    ConstructTrackV0Cand(vTracks,  
-                          idTrack, trackPDGMother, v0Pointer,
-                          mother, motherTopo, mother_temp,
-                          nBufEntry, l, dl, Particles, PrimVtx,
-                          cuts, pvIndexMother, massMotherPDG,
-                          massMotherPDGSigma, vMotherPrim, vMotherSec);
-    nBufEntry = 0; 
+    for(int jProng=0; jProng<nProngs; jProng++)
+      for(int iV=nBufEntry; iV<float_vLen; iV++)
+        prongIndex[jProng][iV] = prongIndex[jProng][0];
+    ConstructNProngCand(vMother, motherPDG, nProngs, prongTracks, prongPDG, prongIndex, nBufEntry, PrimVtx);
+  }
+}
+
+void KFParticleFinder::FitNProngPairs(std::vector<char>& pairTable,
+                                      KFPTrackVector& tracksA,
+                                      const int pdgA,
+                                      KFPTrackVector& tracksB,
+                                      const int pdgB,
+                                      uint_v& indexA,
+                                      uint_v& indexB,
+                                      const int* tablePosition,
+                                      const int nElements)
+{
+  /** Fits SIMD vector of track pairs to a common vertex and marks the pairs with \f$\chi^2_{geo}\f$ below the cut for open charm 
+   ** with >=3 daughters as accepted in the pair table of KFParticleFinder::FindNProngDecay().
+   ** \param[out] pairTable - table of the accepted pairs.
+   ** \param[in] tracksA - vector with the first tracks of the pairs.
+   ** \param[in] pdgA - PDG hypothesis of the first tracks.
+   ** \param[in] tracksB - vector with the second tracks of the pairs.
+   ** \param[in] pdgB - PDG hypothesis of the second tracks.
+   ** \param[in] indexA - indices of the first tracks in "tracksA".
+   ** \param[in] indexB - indices of the second tracks in "tracksB".
+   ** \param[in] tablePosition - positions of the pairs in the table.
+   ** \param[in] nElements - number of filled elements in the SIMD vector of pairs.
+   **/
+  
+  KFParticleSIMD daughterA(tracksA, indexA, int_v(pdgA));
+  KFParticleSIMD daughterB(tracksB, indexB, int_v(pdgB));
+  const KFParticleSIMD* pairDaughters[2] = {&daughterA, &daughterB};
+  KFParticleSIMD pair;
+  pair.Construct(pairDaughters, 2, 0, -1);
+  const float_m isGoodPair = (pair.Chi2()/simd_cast<float_v>(pair.NDF()) < fCutsTrackV0[1][2]);
+  for(int iV=0; iV<nElements; iV++)
+    pairTable[tablePosition[iV]] = isGoodPair[iV];
+}
+
+void KFParticleFinder::ConstructNProngCand(std::vector<KFParticle>& vMother,
+                                           const int motherPDG,
+                                           const int nProngs,
+                                           KFPTrackVector** prongTracks,
+                                           const int* prongPDG,
+                                           uint_v* prongIndex,
+                                           const int nElements,
+                                           std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx)
+{
+  /** Fits SIMD vector of track tuples to a common vertex and stores candidates, which pass the cuts for open charm with >=3 daughters
+   ** (\f$\chi^2_{geo}\f$ and \f$l/\Delta l\f$) and point to one of the primary vertices, to the output vector. The selected
+   ** candidates are appended at once with KFParticleSIMD::GetKFParticles().
+   ** \param[out] vMother - output vector with candidates.
+   ** \param[in] motherPDG - PDG hypothesis of the mother particle.
+   ** \param[in] nProngs - number of daughter tracks.
+   ** \param[in] prongTracks - vector of tracks for each prong.
+   ** \param[in] prongPDG - PDG hypothesis for each prong.
+   ** \param[in] prongIndex - indices of the tracks of each prong in the SIMD vector of tuples.
+   ** \param[in] nElements - number of filled elements in the SIMD vector of tuples.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   **/
+  
+  KFParticleSIMD daughters[fNProngMax];
+  const KFParticleSIMD* daughterPointers[fNProngMax];
+  for(int iProng=0; iProng<nProngs; iProng++)
+  {
+    daughters[iProng] = KFParticleSIMD(*(prongTracks[iProng]), prongIndex[iProng], int_v(prongPDG[iProng]));
+    daughters[iProng].SetId(int_v(&(prongTracks[iProng]->Id()[0]), prongIndex[iProng]));
+    daughterPointers[iProng] = &daughters[iProng];
+  }
+  
+  KFParticleSIMD mother;
+  mother.SetPDG(motherPDG);
+  mother.Construct(daughterPointers, nProngs, 0, -1);
+  
+  float_m saveParticle = simd_cast<float_m>(int_v::IndexesFromZero() < int(nElements));
+  saveParticle &= (mother.Chi2()/simd_cast<float_v>(mother.NDF()) < fCutsTrackV0[1][2] );
+  saveParticle &= KFPMath::Finite(mother.GetChi2());
+  saveParticle &= (mother.GetChi2() > 0.0f);
+  saveParticle &= (mother.GetChi2() == mother.GetChi2());
+  if( saveParticle.isEmpty() ) return;
+  
+  float_v lMin(1.e8f);
+  float_v ldlMin(1.e8f);
+  float_m isParticleFromVertex(false);
+  for(int iP=0; iP<fNPV; iP++)
+  {
+    float_v l, dl;
+    float_m isParticleFromVertexLocal;
+    mother.GetDistanceToVertexLine(PrimVtx[iP], l, dl, &isParticleFromVertexLocal);
+    isParticleFromVertex |= isParticleFromVertexLocal;
+    const float_v ldl = (l/dl);
+    lMin( l < lMin ) = l;
+    ldlMin( ldl < ldlMin ) = ldl;
   }
+  saveParticle &= (lMin < 200.f) && isParticleFromVertex && (ldlMin > fCutsTrackV0[1][0]);
+  if( saveParticle.isEmpty() ) return;
+  
+  mother.GetKFParticles(vMother, saveParticle);
 }
 
 void KFParticleFinder::SelectParticles(vector<KFParticle>& Particles,
@@ -2437,7 +4096,137 @@ void KFParticleFinder::SelectParticles(vector<KFParticle>& Particles,
   /** Selects particles from a set of candidates "vCandidates" according to the provided cuts
    ** on \f$\chi^2_{topo}\f$ and \f$l/\Delta l\f$
    ** and stores them to the output array "Particles". Also, "vCandidates" is cleaned, only
-   ** selected particles with additional cut on \f$\sigma_{M}\f$ are left there.
+   ** selected particles with additional cut on \f$\sigma_{M}\f$ are left there. Candidates are loaded from the SoA block 
+   ** KFParticleFinder::fCandidateSoA, all cuts and the mass constraint are applied in the SIMD form, the selected entries 
+   ** are appended to the outputs at once with KFParticleSIMD::GetKFParticles(). The selection is compared with
+   ** KFParticleFinder::SelectParticlesPerCandidate() by KFParticleTest::RunSelectParticlesBenchmark(), the gain depends
+   ** on the width of the SIMD vectors.
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in,out] vCandidates - vector with the input candidates.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   ** \param[in] cutChi2Topo - \f$\chi^2_{topo}\f$ cut.
+   ** \param[in] cutLdL - \f$l/\Delta l\f$ cut.
+   ** \param[in] mass - table mass for the given PDG hypothesis.
+   ** \param[in] massErr - sigma of the peak width for the given PDG hypothesis.
+   ** \param[in] massCut - \f$\sigma_{M}\f$ cut.
+   **/
+  const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  fNSelectedCandidates += vCandidates.size();
+  
+  if(!fUseSIMDSelection)
+  {
+    SelectParticlesPerCandidate(Particles, vCandidates, PrimVtx, cutChi2Topo, cutLdL, mass, massErr, massCut);
+    fSelectParticlesTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return;
+  }
+  
+  int nCand = vCandidates.size();
+  fCandidateSoA.SetParticles(vCandidates);
+  
+  vector<KFParticle> newCandidates;
+  kfvector_floatv l(fNPV), dl(fNPV);
+  KFParticleSIMD* candTopo = new KFParticleSIMD[fNPV];
+  KFParticleSIMD mother;
+
+  for(int iC=0; iC < nCand; iC += float_vLen)
+  {
+    int nEntries = (iC + float_vLen < nCand) ? float_vLen : (nCand - iC);
+
+    mother.Load(fCandidateSoA, iC);
+    
+    float_m saveParticle(simd_cast<float_m>(int_v::IndexesFromZero() < int(nEntries)));
+
+    float_v lMin(1.e8f);
+    float_v ldlMin(1.e8f);
+    float_m isParticleFromVertex(false);
+
+    for(int iP=0; iP<fNPV; iP++)
+    {
+      float_m isParticleFromVertexLocal;
+      mother.GetDistanceToVertexLine(PrimVtx[iP], l[iP], dl[iP], &isParticleFromVertexLocal);
+      isParticleFromVertex |= isParticleFromVertexLocal;
+      float_v ldl = (l[iP]/dl[iP]);
+      lMin( (l[iP] < lMin) && saveParticle) = l[iP];
+      ldlMin( (ldl < ldlMin) && saveParticle) = ldl;
+    }
+    saveParticle &= ldlMin > cutLdL;
+    saveParticle &= (lMin < 200.f);
+    saveParticle &= isParticleFromVertex;
+    if( saveParticle.isEmpty() ) continue;
+
+    float_m isPrimary(false);
+    for(int iP=0; iP<fNPV; iP++)
+    {
+      candTopo[iP] = mother;
+      candTopo[iP].SetProductionVertex(PrimVtx[iP]);
+      
+      const float_v& chi2 = candTopo[iP].GetChi2();
+      isPrimary |= KFPMath::Finite(chi2) && (chi2 > 0.0f) && (chi2 == chi2) &&
+                   (chi2/simd_cast<float_v>(candTopo[iP].GetNDF()) <= cutChi2Topo);
+    }
+    saveParticle &= isPrimary;
+    if( saveParticle.isEmpty() ) continue;
+
+    // the selected entries get the consecutive indices in the output array
+    int_v id(-1);
+    int nSelected = 0;
+    for(int iv=0; iv<nEntries; iv++)
+    {
+      if(!saveParticle[iv]) continue;
+      id[iv] = Particles.size() + nSelected;
+      nSelected++;
+    }
+    mother.SetId(id);
+    const unsigned int firstParticle = Particles.size();
+    mother.GetKFParticles(Particles, saveParticle);
+    
+    float_v m, dm;
+    mother.GetMass(m,dm);
+    const float_m isInMassWindow = saveParticle && !(abs(m - mass)/massErr > massCut);
+    const unsigned int firstCandidate = newCandidates.size();
+    if( !isInMassWindow.isEmpty() )
+    {
+      mother.SetNonlinearMassConstraint(float_v(mass));
+      mother.GetKFParticles(newCandidates, isInMassWindow);
+    }
+    
+    // the vectorised particle holds one flag "at production vertex" and a common number of daughters,
+    // both are restored from the input candidates so that the output is identical to the selection per candidate
+    unsigned int iParticle = firstParticle, iCandidate = firstCandidate;
+    for(int iv=0; iv<nEntries; iv++)
+    {
+      if(!saveParticle[iv]) continue;
+      const KFParticle& candidate = vCandidates[iC+iv];
+      KFParticle* outputs[2] = {&Particles[iParticle++], isInMassWindow[iv] ? &newCandidates[iCandidate++] : 0};
+      for(int iOutput=0; iOutput<2; iOutput++)
+      {
+        if(!outputs[iOutput]) continue;
+        outputs[iOutput]->CleanDaughtersId();
+        for(int iD=0; iD<candidate.NDaughters(); iD++)
+          outputs[iOutput]->AddDaughterId(candidate.DaughterIds()[iD]);
+        outputs[iOutput]->SetAtProductionVertex(candidate.GetAtProductionVertex());
+      }
+    }
+  }
+  if(candTopo) delete [] candTopo;
+  
+  vCandidates = newCandidates;
+  fSelectParticlesTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void KFParticleFinder::SelectParticlesPerCandidate(vector<KFParticle>& Particles,
+                                                   vector<KFParticle>& vCandidates,
+                                                   std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx,
+                                                   const float& cutChi2Topo,
+                                                   const float& cutLdL,
+                                                   const float& mass,
+                                                   const float& massErr,
+                                                   const float& massCut)
+{
+  /** Selects particles from a set of candidates "vCandidates" in the same way as KFParticleFinder::SelectParticles(),
+   ** but the distances to the primary vertices are the only quantities calculated in the SIMD form: \f$\chi^2_{topo}\f$,
+   ** the mass and the mass constraint are processed candidate by candidate. Is used as a reference,
+   ** see KFParticleFinder::SetUseSIMDSelection().
    ** \param[out] Particles - output vector with particles.
    ** \param[in,out] vCandidates - vector with the input candidates.
    ** \param[in] PrimVtx - vector with primary vertices.
@@ -2537,7 +4326,10 @@ void KFParticleFinder::CombinePartPart(vector<KFParticle>& particles1,
                                        float massMotherPDG,
                                        float massMotherPDGSigma)
 {
-  /** Combines two already constructed candidates into a new particle.
+  /** Combines two already constructed candidates into a new particle. The second set of particles is copied once
+   ** to the SoA block KFParticleFinder::fCandidateSoA and is loaded with aligned vector loads for each particle
+   ** of the first set, the check of the common daughters is performed with the daughter indices stored per lane.
+   ** The selected candidates are appended to "Particles" at once with KFParticleSIMD::GetKFParticles().
    ** \param[in] particles1 - vector with the first set of particles.
    ** \param[in] particles2 - vector with the second set of particles.
    ** \param[out] Particles - output vector with particles.
@@ -2562,8 +4354,8 @@ void KFParticleFinder::CombinePartPart(vector<KFParticle>& particles1,
 
   kfvector_floatv l(fNPV), dl(fNPV);
 
-  KFParticle* tmpPart2[float_vLen];
   int nPart2 = particles2.size();
+  fCandidateSoA.SetParticles(particles2);
 
   bool isPrimary = (iPV >= 0);
   bool isCharm = (MotherPDG == 425) ||
@@ -2578,17 +4370,18 @@ void KFParticleFinder::CombinePartPart(vector<KFParticle>& particles1,
   {
     KFParticleSIMD vDaughters[2] = {KFParticleSIMD(particles1[iP1]), KFParticleSIMD()};
 
-    unsigned int startIndex=0;
-    if(isSameInputPart) startIndex=iP1+1;
+    int startIndex=0;
+    if(isSameInputPart) startIndex=((iP1+1)/float_vLen)*float_vLen;
     for(int iP2=startIndex; iP2 < nPart2; iP2 += float_vLen)
     {
       int nElements = (iP2 + float_vLen < nPart2) ? float_vLen : (nPart2 - iP2);
-      float_m active(simd_cast<float_m>(int_v::IndexesFromZero() < int(nElements)));
+      int_m activeInt = (int_v::IndexesFromZero() < int(nElements));
+      if(isSameInputPart)
+        activeInt &= (int_v::IndexesFromZero() + iP2 > int(iP1));
+      float_m active(simd_cast<float_m>(activeInt));
+      if(active.isEmpty()) continue;
 
-      for(int iv=0; iv<nElements; iv++)
-        tmpPart2[iv] = &particles2[iP2+iv];
-
-      vDaughters[1] = KFParticleSIMD(tmpPart2,nElements);
+      vDaughters[1].Load(fCandidateSoA, iP2);
 
 //       if( reconstructPi0 )
 //       {
@@ -2704,37 +4497,40 @@ void KFParticleFinder::CombinePartPart(vector<KFParticle>& particles1,
         }
       }
       
+      // the stored entries get the consecutive indices in the output array and are appended at once
+      const float_m storeParticle = saveOnlyPrimary ? (saveParticle && isPrimaryPart) : saveParticle;
+      int_v id = mother.Id();
+      int nStored = 0;
+      for(int iv=0; iv<nElements; iv++)
+      {
+        if(!storeParticle[iv]) continue;
+        id[iv] = Particles.size() + nStored;
+        nStored++;
+      }
+      mother.SetId(id);
+      unsigned int iParticle = Particles.size();
+      mother.GetKFParticles(Particles, storeParticle);
+      
       for(int iv=0; iv<nElements; iv++)
       {
         if(!saveParticle[iv]) continue; 
         
-        mother.GetKFParticle(mother_temp, iv);
+        KFParticle& output = storeParticle[iv] ? Particles[iParticle++] : mother_temp;
+        if(!storeParticle[iv])
+          mother.GetKFParticle(mother_temp, iv);
 
         // reset daughter ids for 3- and 4-particle decays
         if( (abs(mother.PDG()[iv]) == 428))
         {
-          mother_temp.CleanDaughtersId();
+          output.CleanDaughtersId();
           for(int iD=0; iD < particles1[iP1].NDaughters(); iD++)
-            mother_temp.AddDaughterId( particles1[iP1].DaughterIds()[iD] );
-          mother_temp.AddDaughterId(tmpPart2[iv]->Id());
-        }
-        
-        if(saveOnlyPrimary)
-        {
-          if(isPrimaryPart[iv])
-          {
-            mother_temp.SetId(Particles.size());
-            Particles.push_back(mother_temp);
-          }
-        }
-        else
-        {
-          mother_temp.SetId(Particles.size());
-          Particles.push_back(mother_temp);
+            output.AddDaughterId( particles1[iP1].DaughterIds()[iD] );
+          output.AddDaughterId(particles2[iP2+iv].Id());
         }
         
         if(vMotherPrim || vMotherSec)
         {
+          mother_temp = output;
           float mass, errMass;
           mother_temp.GetMass(mass, errMass);
           if( (fabs(mass - massMotherPDG)/massMotherPDGSigma) > 3.f ) continue;
@@ -2743,8 +4539,8 @@ void KFParticleFinder::CombinePartPart(vector<KFParticle>& particles1,
           if(MotherPDG == 428)
           {
             mother_temp.CleanDaughtersId();
-            for(int iD=0; iD < tmpPart2[iv]->NDaughters(); iD++)
-              mother_temp.AddDaughterId( tmpPart2[iv]->DaughterIds()[iD] );
+            for(int iD=0; iD < particles2[iP2+iv].NDaughters(); iD++)
+              mother_temp.AddDaughterId( particles2[iP2+iv].DaughterIds()[iD] );
             for(int iD=0; iD < particles1[iP1].NDaughters(); iD++)
               mother_temp.AddDaughterId( particles1[iP1].DaughterIds()[iD] );            
           }
@@ -2763,6 +4559,176 @@ void KFParticleFinder::CombinePartPart(vector<KFParticle>& particles1,
 }
 
 
+void KFParticleFinder::FindPi0Emc(vector<KFParticle>& Particles,
+                                  std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx,
+                                  const int firstEmcParticle)
+{
+  /** Reconstructs \f$\pi^0\f$ from pairs of gamma-clusters of the electromagnetic calorimeter. Pairs are preselected
+   ** directly from the KFPEmcCluster arrays without creation of gamma particles: clusters are sorted by energy
+   ** in the descending order, for each leading cluster the range of partners is limited by the cut on the energy
+   ** asymmetry and by the minimum invariant mass \f$m^2 \le 4E_1E_2\f$, the invariant mass
+   ** \f$m^2 = 2E_1E_2(1-\cos\theta)\f$ of the partners from the range is calculated in the SIMD form.
+   ** Only pairs within the mass window are fitted by KFParticleFinder::ConstructPi0Emc() and stored.
+   ** The direction of gammas is estimated from the first primary vertex. Is called only if switched on with
+   ** KFParticleFinder::SetUsePi0Emc().
+   ** \param[out] Particles - output vector with particles, gammas from EMC should be already stored there.
+   ** \param[in] PrimVtx - vector with primary vertices.
+   ** \param[in] firstEmcParticle - index in "Particles" of the gamma from the first EMC cluster.
+   **/
+  if(!fEmcClusters || PrimVtx.size() < 1) return;
+  if(!(fDecayReconstructionList.empty()) && (fDecayReconstructionList.find(111) == fDecayReconstructionList.end())) return;
+
+  const KFPEmcCluster& clusters = *fEmcClusters;
+  const int nClusters = clusters.Size();
+  if(nClusters < 2) return;
+
+  const float& mPi0 = KFParticleDatabase::Instance()->GetPi0Mass();
+  const float& mPi0Sigma = KFParticleDatabase::Instance()->GetPi0MassSigma();
+  float massMin = mPi0 - fCutPi0EmcNSigmaMass*mPi0Sigma;
+  if(massMin < 0.f) massMin = 0.f;
+  const float massMax = mPi0 + fCutPi0EmcNSigmaMass*mPi0Sigma;
+  const float massMin2 = massMin*massMin;
+  const float massMax2 = massMax*massMax;
+  const float asymmetryFactor = (1.f - fCutPi0EmcAsymmetry)/(1.f + fCutPi0EmcAsymmetry);
+
+  //sort clusters by energy
+  vector< std::pair<float, int> > sortedClusters;
+  sortedClusters.reserve(nClusters);
+  for(int iC=0; iC<nClusters; iC++)
+    if(clusters.E()[iC] >= fCutPi0EmcMinEnergy)
+      sortedClusters.push_back(std::pair<float, int>(clusters.E()[iC], iC));
+  std::sort(sortedClusters.begin(), sortedClusters.end(), std::greater< std::pair<float, int> >());
+
+  const int nSorted = sortedClusters.size();
+  if(nSorted < 2) return;
+
+  //arrays are padded, so that the last SIMD vector can be read without checks
+  const int nSortedPadded = nSorted + float_vLen;
+  kfvector_float energy(nSortedPadded, 0.f);
+  kfvector_float direction[3];
+  for(int iP=0; iP<3; iP++)
+    direction[iP].resize(nSortedPadded, 0.f);
+  kfvector_uint clusterIndex(nSortedPadded, 0);
+
+  const float pv[3] = { PrimVtx[0].X()[0], PrimVtx[0].Y()[0], PrimVtx[0].Z()[0] };
+  for(int iC=0; iC<nSorted; iC++)
+  {
+    const int index = sortedClusters[iC].second;
+    energy[iC] = sortedClusters[iC].first;
+    clusterIndex[iC] = index;
+
+    float dr[3] = { clusters.X()[index] - pv[0], clusters.Y()[index] - pv[1], clusters.Z()[index] - pv[2] };
+    const float dl = sqrt(dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2]);
+    if(dl > 0.f)
+      for(int iP=0; iP<3; iP++)
+        direction[iP][iC] = dr[iP]/dl;
+  }
+
+  uint_v gammaIndex[2] = {uint_v(Vc::Zero), uint_v(Vc::Zero)};
+  int_v gammaId[2] = {int_v(Vc::Zero), int_v(Vc::Zero)};
+  int nPairs = 0;
+
+  for(int iC1=0; iC1<nSorted-1; iC1++)
+  {
+    const float e1 = energy[iC1];
+    //all partners have lower energy, the mass can not reach the window anymore
+    if(4.f*e1*e1 < massMin2) break;
+
+    float eMin = e1*asymmetryFactor;
+    const float eMinMass = massMin2/(4.f*e1);
+    if(eMinMass > eMin) eMin = eMinMass;
+    const int lastPartner = std::upper_bound(energy.begin() + iC1 + 1, energy.begin() + nSorted, eMin, std::greater<float>()) - energy.begin();
+
+    const float_v e1v(e1);
+    const float_v dir1[3] = { float_v(direction[0][iC1]), float_v(direction[1][iC1]), float_v(direction[2][iC1]) };
+
+    for(int iC2=iC1+1; iC2<lastPartner; iC2 += float_vLen)
+    {
+      const int NClustersVec = (iC2 + float_vLen < lastPartner) ? float_vLen : (lastPartner - iC2);
+      uint_v partnerIndex = uint_v::IndexesFromZero() + (unsigned int)iC2;
+
+      float_v e2, dir2[3];
+      e2.gather(&(energy[0]), partnerIndex);
+      for(int iP=0; iP<3; iP++)
+        dir2[iP].gather(&(direction[iP][0]), partnerIndex);
+
+      const float_v cosTheta = dir1[0]*dir2[0] + dir1[1]*dir2[1] + dir1[2]*dir2[2];
+      const float_v mass2 = 2.f*e1v*e2*(1.f - cosTheta);
+
+      float_m active = simd_cast<float_m>(int_v::IndexesFromZero() < int(NClustersVec));
+      active &= (mass2 >= massMin2) && (mass2 <= massMax2);
+      if(active.isEmpty()) continue;
+
+      for(int iv=0; iv<NClustersVec; iv++)
+      {
+        if(!active[iv]) continue;
+
+        gammaIndex[0][nPairs] = clusterIndex[iC1];
+        gammaIndex[1][nPairs] = clusterIndex[iC2+iv];
+        gammaId[0][nPairs] = firstEmcParticle + clusterIndex[iC1];
+        gammaId[1][nPairs] = firstEmcParticle + clusterIndex[iC2+iv];
+        nPairs++;
+
+        if(nPairs == float_vLen)
+        {
+          ConstructPi0Emc(gammaIndex, gammaId, nPairs, Particles, PrimVtx[0]);
+          nPairs = 0;
+        }
+      }
+    }
+  }
+
+  if(nPairs > 0)
+    ConstructPi0Emc(gammaIndex, gammaId, nPairs, Particles, PrimVtx[0]);
+}
+
+void KFParticleFinder::ConstructPi0Emc(uint_v* gammaIndex, int_v* gammaId, const int nPairs,
+                                       vector<KFParticle>& Particles, const KFParticleSIMD& PrimVtx)
+{
+  /** Fits \f$\pi^0\f$ candidates from the preselected pairs of EMC clusters. Candidates within the mass window
+   ** are stored to "Particles" and, with the mass constraint set, to the primary \f$\pi^0\f$ candidates of the first primary vertex.
+   ** \param[in] gammaIndex - indices of the first and the second cluster of each pair in KFPEmcCluster
+   ** \param[in] gammaId - indices of the corresponding gammas in "Particles"
+   ** \param[in] nPairs - number of pairs in the SIMD vectors
+   ** \param[out] Particles - output vector with particles.
+   ** \param[in] PrimVtx - the primary vertex, which is used for estimation of the momentum of gammas.
+   **/
+  const float& mPi0 = KFParticleDatabase::Instance()->GetPi0Mass();
+  const float& mPi0Sigma = KFParticleDatabase::Instance()->GetPi0MassSigma();
+
+  KFParticleSIMD gamma1(*fEmcClusters, gammaIndex[0], PrimVtx);
+  KFParticleSIMD gamma2(*fEmcClusters, gammaIndex[1], PrimVtx);
+  gamma1.SetId(gammaId[0]);
+  gamma2.SetId(gammaId[1]);
+  const KFParticleSIMD* pi0Daughters[2] = {&gamma1, &gamma2};
+
+  KFParticleSIMD pi0;
+  pi0.SetPDG(111);
+  pi0.Construct(pi0Daughters, 2, 0);
+
+  float_v mass, dm;
+  pi0.GetMass(mass, dm);
+
+  float_m savePi0 = simd_cast<float_m>(int_v::IndexesFromZero() < int(nPairs));
+  savePi0 &= KFPMath::Finite(pi0.GetChi2());
+  savePi0 &= (pi0.GetChi2() >= 0.0f);
+  savePi0 &= (abs(mass - mPi0) < fCutPi0EmcNSigmaMass*mPi0Sigma);
+  if(savePi0.isEmpty()) return;
+
+  KFParticle pi0Temp;
+  for(int iv=0; iv<nPairs; iv++)
+  {
+    if(!savePi0[iv]) continue;
+
+    pi0.GetKFParticle(pi0Temp, iv);
+    pi0Temp.SetId(Particles.size());
+    Particles.push_back(pi0Temp);
+
+    pi0Temp.SetNonlinearMassConstraint(mPi0);
+    fPrimCandidates[4][0].push_back(pi0Temp);
+  }
+}
+
 void KFParticleFinder::NeutralDaughterDecay(KFPTrackVector* vTracks,
                                             vector<KFParticle>& Particles)
 {
@@ -2776,9 +4742,12 @@ void KFParticleFinder::NeutralDaughterDecay(KFPTrackVector* vTracks,
    ** 5) secondary negative at the last hit position; \n
    ** 6) primary positive at the last hit position; \n
    ** 7) primary negative at the last hit position. \n
+   ** If KFParticleFinder::fKinkMaxDistance is set, the end points of the mother tracks are sorted into the 3D grid
+   ** (KFParticleFinder::BuildKinkGrid()) and for each daughter only mother tracks from the neighbouring cells are taken. Their distance,
+   ** ordering along the beam and, if KFParticleFinder::fKinkMinCosAngle is set, the kink angle are checked in the SIMD form, the pairs 
+   ** passing the checks are fitted in SIMD vectors (KFParticleFinder::ConstructKinkPairs()). Otherwise all combinations are fitted.
    ** \param[out] Particles - the output array with the reconstructed particle-candidates.
    **/
-  KFParticle mother_temp;
   KFParticleSIMD ChargedDaughter, MotherTrack;
 
   uint_v idMotherTrack;
@@ -2891,7 +4860,91 @@ void KFParticleFinder::NeutralDaughterDecay(KFPTrackVector* vTracks,
     
     outMotherPDG[3][0]=-8003222;
     
-    
+    //with the geometric index only mother tracks ending close to the start point of the daughter are fitted
+    if( (fKinkMaxDistance > 0.f) && (MotherTracksSize > 0) )
+    {
+      BuildKinkGrid(MotherTracks);
+      
+      const int categoryPDG[4] = {13, 211, 321, 2212};
+      const float maxDistance2 = fKinkMaxDistance*fKinkMaxDistance;
+      vector<int> partners;
+      uint_v idMother(Vc::Zero), idDaughter(Vc::Zero);
+      
+      for(int iTC=0; iTC<nTC; iTC++)
+      {
+        int nPairs = 0;
+        
+        for(int iTrD=startTCDaughter[iTC]; iTrD < endTCDaughter[iTC]; iTrD++)
+        {
+          if(abs(DaughterTracks.PDG()[iTrD]) != categoryPDG[iTC]) continue;
+          
+          const float pointD[3] = {DaughterTracks.Parameter(0)[iTrD], DaughterTracks.Parameter(1)[iTrD], DaughterTracks.Parameter(2)[iTrD]};
+          FindKinkPartners(pointD, partners);
+          if(partners.empty()) continue;
+          
+          const float_v pD[3] = {DaughterTracks.Parameter(3)[iTrD], DaughterTracks.Parameter(4)[iTrD], DaughterTracks.Parameter(5)[iTrD]};
+          const float_v pD2 = pD[0]*pD[0] + pD[1]*pD[1] + pD[2]*pD[2];
+          
+          const int nPartners = partners.size();
+          for(int iP=0; iP<nPartners; iP += float_vLen)
+          {
+            const int NPartnersVec = (iP + float_vLen < nPartners) ? float_vLen : (nPartners - iP);
+            
+            uint_v partnerIndex(Vc::Zero);
+            for(int iV=0; iV<NPartnersVec; iV++)
+              partnerIndex[iV] = partners[iP+iV];
+            
+            float_v rM[3], pM[3];
+            for(int iDim=0; iDim<3; iDim++)
+            {
+              rM[iDim].gather(&(MotherTracks.Parameter(iDim)[0]), partnerIndex);
+              pM[iDim].gather(&(MotherTracks.Parameter(iDim+3)[0]), partnerIndex);
+            }
+            
+            const float_v dx = pointD[0] - rM[0];
+            const float_v dy = pointD[1] - rM[1];
+            const float_v dz = pointD[2] - rM[2];
+            
+            float_m closePair = simd_cast<float_m>(int_v::IndexesFromZero() < int(NPartnersVec));
+            //daughter should start close to the last hit of the mother and not before it
+            closePair &= (dx*dx + dy*dy + dz*dz <= maxDistance2);
+            closePair &= (dz >= -0.5f);
+            //kink angle
+            if(fKinkMinCosAngle > -1.f)
+            {
+              const float_v pM2 = pM[0]*pM[0] + pM[1]*pM[1] + pM[2]*pM[2];
+              const float_v pMpD = pM[0]*pD[0] + pM[1]*pD[1] + pM[2]*pD[2];
+              closePair &= (pMpD >= fKinkMinCosAngle*sqrt(pM2*pD2));
+            }
+            
+            fNKinkPairsTested += NPartnersVec;
+            if(closePair.isEmpty()) continue;
+            
+            for(int iV=0; iV<NPartnersVec; iV++)
+            {
+              if(!closePair[iV]) continue;
+              
+              idMother[nPairs] = partners[iP+iV];
+              idDaughter[nPairs] = iTrD;
+              nPairs++;
+              fNKinkPairsAccepted++;
+              
+              if(nPairs == float_vLen)
+              {
+                ConstructKinkPairs(MotherTracks, DaughterTracks, idMother, idDaughter, nPairs, iTC, iTrTypeDaughter, nMotherHypothesis[iTC],
+                                   &motherPDGHypothesis[iTC][0], &neutralDaughterMassHypothesis[iTC][0], outNeutralDaughterPDG[iTC], outMotherPDG[iTC], Particles);
+                nPairs = 0;
+              }
+            }
+          }
+        }
+        
+        if(nPairs > 0)
+          ConstructKinkPairs(MotherTracks, DaughterTracks, idMother, idDaughter, nPairs, iTC, iTrTypeDaughter, nMotherHypothesis[iTC],
+                             &motherPDGHypothesis[iTC][0], &neutralDaughterMassHypothesis[iTC][0], outNeutralDaughterPDG[iTC], outMotherPDG[iTC], Particles);
+      }
+      continue;
+    }
 
     for(int iTC=0; iTC<nTC; iTC++)
     {
@@ -2965,85 +5018,10 @@ void KFParticleFinder::NeutralDaughterDecay(KFPTrackVector* vTracks,
               
               MotherTrack.Load(MotherTracks, iTrM, motherPDGHypothesis[iTC][iHypothesis]);
               
-              float_v zMother = MotherTrack.Z();
-              float_v zCD = ChargedDaughter.Z();
-              
-              //daughter particle should start after the last hit of a mother track
-              active &= simd_cast<int_m>(zCD >= (zMother - float_v(0.5f)));
-              if( active.isEmpty() ) continue;
-              
-              KFParticleSIMD neutralDaughter = MotherTrack;
-              //energy of the mother particle should be greater then of the daughter particle
-              active &= simd_cast<int_m>(neutralDaughter.E() > ChargedDaughter.E());
-              if( active.isEmpty() ) continue;
-              
-              neutralDaughter.AddDaughterId(motherTrackId);
-              neutralDaughter.NDF() = -1;
-              neutralDaughter.Chi2() = 0.f;
-              neutralDaughter.SubtractDaughter(ChargedDaughter);
-              
-              //decay point shoud be between mother and daughter tracks
-              active &= simd_cast<int_m>(neutralDaughter.Z() >= zMother - float_v(10.0f));
-              active &= simd_cast<int_m>(neutralDaughter.Z() <= zCD + float_v(10.0f));
-              //set cut on chi2 of the fit of the neutral daughter
-              active &= simd_cast<int_m>(neutralDaughter.NDF() >= int_v(Vc::Zero));
-              active &= simd_cast<int_m>(neutralDaughter.Chi2()/simd_cast<float_v>(neutralDaughter.NDF()) <= fCuts2D[1]);
-              //fit should converge
-              active &= simd_cast<int_m>(neutralDaughter.Chi2() >= float_v(Vc::Zero));
-              active &= simd_cast<int_m>(neutralDaughter.Chi2() == neutralDaughter.Chi2());
-              if( active.isEmpty() ) continue;
-              
-              //kill particle-candidates produced by clones
-              active &= simd_cast<int_m>( neutralDaughter.GetRapidity()<6.f && neutralDaughter.GetRapidity()>0.f);
-              if ((iTC==1 && iHypothesis<4) || iTC==2)
-                active &= simd_cast<int_m>( !( (neutralDaughter.GetPt())<0.5f && neutralDaughter.GetRapidity()<0.5f ) );
-              if (iTC==3)
-                active &= simd_cast<int_m>( !( (neutralDaughter.GetPt())<0.2f && neutralDaughter.GetRapidity()<1.f ) );
-              if( active.isEmpty() ) continue;
-              
-              KFParticleSIMD neutralDaughterUnconstr = neutralDaughter;
-              neutralDaughter.SetNonlinearMassConstraint(neutralDaughterMassHypothesis[iTC][iHypothesis]);
-              
-              const KFParticleSIMD* daughters[2] = {&neutralDaughter, &ChargedDaughter};
-              KFParticleSIMD mother;
-              mother.Construct(daughters, 2);
-              
-              //decay point shoud be between mother and daughter tracks
-              active &= simd_cast<int_m>(mother.Z() >= zMother);
-              active &= simd_cast<int_m>(mother.Z() <= zCD);
-              //set cut on chi2 of the fit of the mother particle
-              active &= simd_cast<int_m>(mother.NDF() >= int_v(Vc::Zero));
-              active &= simd_cast<int_m>(mother.Chi2()/simd_cast<float_v>(mother.NDF()) <= fCuts2D[1]);
-              //fit should converge
-              active &= simd_cast<int_m>(mother.Chi2() >= float_v(Vc::Zero));
-              active &= simd_cast<int_m>(mother.Chi2() == mother.Chi2());
-              if( active.isEmpty() ) continue;
-
-              for(int iV=0; iV<NTracks; iV++)
-              {
-                if(!active[iV]) continue;
-                
-                neutralDaughterUnconstr.GetKFParticle(mother_temp, iV);
-                int neutralId = Particles.size();
-                mother_temp.SetId(neutralId);
-                if (iTrTypeDaughter==0)
-                  mother_temp.SetPDG(-outNeutralDaughterPDG[iTC][iHypothesis]);
-                else
-                  mother_temp.SetPDG(outNeutralDaughterPDG[iTC][iHypothesis]);
-                Particles.push_back(mother_temp);
-
-                mother.GetKFParticle(mother_temp, iV);
-                mother_temp.SetId(Particles.size());
-                mother_temp.CleanDaughtersId();
-                mother_temp.AddDaughterId(ChargedDaughter.Id()[iV]);
-                mother_temp.AddDaughterId(neutralId);
-                
-                if (iTrTypeDaughter==0)  
-                  mother_temp.SetPDG(-outMotherPDG[iTC][iHypothesis]);
-                else
-                  mother_temp.SetPDG(outMotherPDG[iTC][iHypothesis]);
-                Particles.push_back(mother_temp);
-              }
+              int neutralDaughterKFPDG = outNeutralDaughterPDG[iTC][iHypothesis];
+              if(iTrTypeDaughter==0) neutralDaughterKFPDG = -outNeutralDaughterPDG[iTC][iHypothesis];
+              ConstructNeutralDaughterDecay(MotherTrack, ChargedDaughter, motherTrackId, active, NTracks, iTC, iHypothesis,
+                                            neutralDaughterMassHypothesis[iTC][iHypothesis], neutralDaughterKFPDG, motherKFPDG, Particles);
             }
           }//iRot
         }//iTrM
@@ -3052,6 +5030,246 @@ void KFParticleFinder::NeutralDaughterDecay(KFPTrackVector* vTracks,
   }//iTrTypeDaughter
 }
 
+void KFParticleFinder::ConstructNeutralDaughterDecay(const KFParticleSIMD& MotherTrack, const KFParticleSIMD& ChargedDaughter,
+                                                     const int_v& motherTrackId, int_m active, const int nLanes,
+                                                     const int iTC, const int iHypothesis, const float neutralDaughterMass,
+                                                     const int neutralDaughterPDG, const int motherPDG,
+                                                     vector<KFParticle>& Particles)
+{
+  /** Reconstructs the neutral daughter and the mother particle by the missing mass method for one hypothesis
+   ** from the SIMD vectors of mother tracks at the last hit and charged daughter tracks at the first hit.
+   ** Candidates, which pass the cuts, are stored to the output array.
+   ** \param[in] MotherTrack - mother tracks at the last hit with the mass hypothesis of the mother particle
+   ** \param[in] ChargedDaughter - charged daughter tracks at the first hit
+   ** \param[in] motherTrackId - indices of the mother tracks
+   ** \param[in] active - mask of the lanes to be processed
+   ** \param[in] nLanes - number of filled lanes of the SIMD vectors
+   ** \param[in] iTC - category of the charged daughter: 0 - muon, 1 - pion, 2 - kaon, 3 - proton
+   ** \param[in] iHypothesis - index of the mother hypothesis within the category, defines cuts against clones
+   ** \param[in] neutralDaughterMass - mass hypothesis of the neutral daughter
+   ** \param[in] neutralDaughterPDG - PDG code of the output neutral daughter
+   ** \param[in] motherPDG - PDG code of the output mother particle
+   ** \param[out] Particles - the output array with the reconstructed particle-candidates.
+   **/
+  const float_v& zMother = MotherTrack.Z();
+  const float_v& zCD = ChargedDaughter.Z();
+  
+  //daughter particle should start after the last hit of a mother track
+  active &= simd_cast<int_m>(zCD >= (zMother - float_v(0.5f)));
+  if( active.isEmpty() ) return;
+  
+  KFParticleSIMD neutralDaughter = MotherTrack;
+  //energy of the mother particle should be greater then of the daughter particle
+  active &= simd_cast<int_m>(neutralDaughter.E() > ChargedDaughter.E());
+  if( active.isEmpty() ) return;
+  
+  neutralDaughter.AddDaughterId(motherTrackId);
+  neutralDaughter.NDF() = -1;
+  neutralDaughter.Chi2() = 0.f;
+  neutralDaughter.SubtractDaughter(ChargedDaughter);
+  
+  //decay point shoud be between mother and daughter tracks
+  active &= simd_cast<int_m>(neutralDaughter.Z() >= zMother - float_v(10.0f));
+  active &= simd_cast<int_m>(neutralDaughter.Z() <= zCD + float_v(10.0f));
+  //set cut on chi2 of the fit of the neutral daughter
+  active &= simd_cast<int_m>(neutralDaughter.NDF() >= int_v(Vc::Zero));
+  active &= simd_cast<int_m>(neutralDaughter.Chi2()/simd_cast<float_v>(neutralDaughter.NDF()) <= fCuts2D[1]);
+  //fit should converge
+  active &= simd_cast<int_m>(neutralDaughter.Chi2() >= float_v(Vc::Zero));
+  active &= simd_cast<int_m>(neutralDaughter.Chi2() == neutralDaughter.Chi2());
+  if( active.isEmpty() ) return;
+  
+  //kill particle-candidates produced by clones
+  active &= simd_cast<int_m>( neutralDaughter.GetRapidity()<6.f && neutralDaughter.GetRapidity()>0.f);
+  if ((iTC==1 && iHypothesis<4) || iTC==2)
+    active &= simd_cast<int_m>( !( (neutralDaughter.GetPt())<0.5f && neutralDaughter.GetRapidity()<0.5f ) );
+  if (iTC==3)
+    active &= simd_cast<int_m>( !( (neutralDaughter.GetPt())<0.2f && neutralDaughter.GetRapidity()<1.f ) );
+  if( active.isEmpty() ) return;
+  
+  KFParticleSIMD neutralDaughterUnconstr = neutralDaughter;
+  neutralDaughter.SetNonlinearMassConstraint(neutralDaughterMass);
+  
+  const KFParticleSIMD* daughters[2] = {&neutralDaughter, &ChargedDaughter};
+  KFParticleSIMD mother;
+  mother.Construct(daughters, 2);
+  
+  //decay point shoud be between mother and daughter tracks
+  active &= simd_cast<int_m>(mother.Z() >= zMother);
+  active &= simd_cast<int_m>(mother.Z() <= zCD);
+  //set cut on chi2 of the fit of the mother particle
+  active &= simd_cast<int_m>(mother.NDF() >= int_v(Vc::Zero));
+  active &= simd_cast<int_m>(mother.Chi2()/simd_cast<float_v>(mother.NDF()) <= fCuts2D[1]);
+  //fit should converge
+  active &= simd_cast<int_m>(mother.Chi2() >= float_v(Vc::Zero));
+  active &= simd_cast<int_m>(mother.Chi2() == mother.Chi2());
+  if( active.isEmpty() ) return;
+
+  KFParticle mother_temp;
+  for(int iV=0; iV<nLanes; iV++)
+  {
+    if(!active[iV]) continue;
+    
+    neutralDaughterUnconstr.GetKFParticle(mother_temp, iV);
+    int neutralId = Particles.size();
+    mother_temp.SetId(neutralId);
+    mother_temp.SetPDG(neutralDaughterPDG);
+    Particles.push_back(mother_temp);
+
+    mother.GetKFParticle(mother_temp, iV);
+    mother_temp.SetId(Particles.size());
+    mother_temp.CleanDaughtersId();
+    mother_temp.AddDaughterId(ChargedDaughter.Id()[iV]);
+    mother_temp.AddDaughterId(neutralId);
+    mother_temp.SetPDG(motherPDG);
+    Particles.push_back(mother_temp);
+  }
+}
+
+void KFParticleFinder::BuildKinkGrid(const KFPTrackVector& tracks)
+{
+  /** Builds the geometric index of the end points of the mother tracks for KFParticleFinder::NeutralDaughterDecay():
+   ** the bounding box of the points is divided into cubic cells with the size of KFParticleFinder::fKinkMaxDistance,
+   ** tracks are sorted by cells. If the box is too large the size of cells is increased, so that the number
+   ** of cells along each axis does not exceed KFParticleFinder::fKinkGridMaxNCells.
+   ** \param[in] tracks - mother tracks at the last hit position
+   **/
+  const int nTracks = tracks.Size();
+  
+  float posMax[3];
+  for(int iDim=0; iDim<3; iDim++)
+  {
+    fKinkGridMin[iDim] = tracks.Parameter(iDim)[0];
+    posMax[iDim] = tracks.Parameter(iDim)[0];
+  }
+  for(int iTr=1; iTr<nTracks; iTr++)
+  {
+    for(int iDim=0; iDim<3; iDim++)
+    {
+      const float pos = tracks.Parameter(iDim)[iTr];
+      if(pos < fKinkGridMin[iDim]) fKinkGridMin[iDim] = pos;
+      if(pos > posMax[iDim]) posMax[iDim] = pos;
+    }
+  }
+  
+  fKinkGridCellSize = fKinkMaxDistance;
+  for(int iDim=0; iDim<3; iDim++)
+  {
+    const float extent = posMax[iDim] - fKinkGridMin[iDim];
+    if(extent > fKinkGridCellSize*fKinkGridMaxNCells)
+      fKinkGridCellSize = extent/fKinkGridMaxNCells;
+  }
+  
+  int nCells = 1;
+  for(int iDim=0; iDim<3; iDim++)
+  {
+    fKinkGridNCells[iDim] = int( (posMax[iDim] - fKinkGridMin[iDim])/fKinkGridCellSize ) + 1;
+    if(fKinkGridNCells[iDim] > fKinkGridMaxNCells) fKinkGridNCells[iDim] = fKinkGridMaxNCells;
+    nCells *= fKinkGridNCells[iDim];
+  }
+  
+  vector<int> trackCell(nTracks);
+  fKinkGridFirstTrack.assign(nCells+1, 0);
+  for(int iTr=0; iTr<nTracks; iTr++)
+  {
+    int iCell[3];
+    for(int iDim=0; iDim<3; iDim++)
+    {
+      iCell[iDim] = int( (tracks.Parameter(iDim)[iTr] - fKinkGridMin[iDim])/fKinkGridCellSize );
+      if(iCell[iDim] >= fKinkGridNCells[iDim]) iCell[iDim] = fKinkGridNCells[iDim] - 1;
+    }
+    trackCell[iTr] = (iCell[0]*fKinkGridNCells[1] + iCell[1])*fKinkGridNCells[2] + iCell[2];
+    fKinkGridFirstTrack[trackCell[iTr]+1]++;
+  }
+  for(int iCell=0; iCell<nCells; iCell++)
+    fKinkGridFirstTrack[iCell+1] += fKinkGridFirstTrack[iCell];
+  
+  vector<int> cellPosition(fKinkGridFirstTrack.begin(), fKinkGridFirstTrack.end()-1);
+  fKinkGridTracks.resize(nTracks);
+  for(int iTr=0; iTr<nTracks; iTr++)
+    fKinkGridTracks[cellPosition[trackCell[iTr]]++] = iTr;
+}
+
+void KFParticleFinder::FindKinkPartners(const float* point, vector<int>& partners) const
+{
+  /** Collects mother tracks from the geometric index, which end in the cells within KFParticleFinder::fKinkMaxDistance
+   ** from the given point. The exact distance is not checked.
+   ** \param[in] point - start point of the charged daughter track
+   ** \param[out] partners - indices of the mother tracks
+   **/
+  partners.clear();
+  
+  int cellMin[3], cellMax[3];
+  for(int iDim=0; iDim<3; iDim++)
+  {
+    const float dMin = (point[iDim] - fKinkMaxDistance - fKinkGridMin[iDim])/fKinkGridCellSize;
+    const float dMax = (point[iDim] + fKinkMaxDistance - fKinkGridMin[iDim])/fKinkGridCellSize;
+    if( (dMax < 0.f) || !(dMin < float(fKinkGridNCells[iDim])) ) return;
+    cellMin[iDim] = (dMin < 0.f) ? 0 : int(dMin);
+    cellMax[iDim] = (dMax >= float(fKinkGridNCells[iDim])) ? fKinkGridNCells[iDim]-1 : int(dMax);
+  }
+  
+  for(int iX=cellMin[0]; iX<=cellMax[0]; iX++)
+    for(int iY=cellMin[1]; iY<=cellMax[1]; iY++)
+      for(int iZ=cellMin[2]; iZ<=cellMax[2]; iZ++)
+      {
+        const int iCell = (iX*fKinkGridNCells[1] + iY)*fKinkGridNCells[2] + iZ;
+        for(int iTr=fKinkGridFirstTrack[iCell]; iTr<fKinkGridFirstTrack[iCell+1]; iTr++)
+          partners.push_back(fKinkGridTracks[iTr]);
+      }
+}
+
+void KFParticleFinder::ConstructKinkPairs(KFPTrackVector& MotherTracks, KFPTrackVector& DaughterTracks,
+                                          uint_v& idMother, uint_v& idDaughter, const int nPairs,
+                                          const int iTC, const int iTrTypeDaughter, const int nHypothesis,
+                                          const int* motherPDGHypothesis, const float* neutralDaughterMassHypothesis,
+                                          const int* outNeutralDaughterPDG, const int* outMotherPDG,
+                                          vector<KFParticle>& Particles)
+{
+  /** Fits the buffered pairs of mother and charged daughter tracks, which were selected with the geometric index,
+   ** for all mother hypotheses of the category of the daughter.
+   ** \param[in] MotherTracks - mother tracks at the last hit position
+   ** \param[in] DaughterTracks - charged daughter tracks at the first hit position
+   ** \param[in] idMother - indices of the mother tracks
+   ** \param[in] idDaughter - indices of the daughter tracks
+   ** \param[in] nPairs - number of pairs in the buffer
+   ** \param[in] iTC - category of the charged daughter
+   ** \param[in] iTrTypeDaughter - 0 for positive daughters, 1 for negative
+   ** \param[in] nHypothesis - number of mother hypotheses for the category
+   ** \param[in] motherPDGHypothesis - PDG hypotheses of the mother tracks
+   ** \param[in] neutralDaughterMassHypothesis - mass hypotheses of the neutral daughter
+   ** \param[in] outNeutralDaughterPDG - PDG codes of the output neutral daughters for negative charged daughters
+   ** \param[in] outMotherPDG - PDG codes of the output mother particles for negative charged daughters
+   ** \param[out] Particles - the output array with the reconstructed particle-candidates.
+   **/
+  int_v daughterPDG, daughterId, motherTrackId;
+  daughterPDG.gather(&(DaughterTracks.PDG()[0]), idDaughter);
+  daughterId.gather(&(DaughterTracks.Id()[0]), idDaughter);
+  motherTrackId.gather(&(MotherTracks.Id()[0]), idMother);
+  
+  KFParticleSIMD ChargedDaughter(DaughterTracks, idDaughter, daughterPDG);
+  ChargedDaughter.SetId(daughterId);
+  
+  const int_m active = (int_v::IndexesFromZero() < int(nPairs));
+  
+  KFParticleSIMD MotherTrack;
+  for(int iHypothesis=0; iHypothesis<nHypothesis; iHypothesis++)
+  {
+    int motherKFPDG = outMotherPDG[iHypothesis];
+    int neutralDaughterKFPDG = outNeutralDaughterPDG[iHypothesis];
+    if(iTrTypeDaughter==0)
+    {
+      motherKFPDG = -outMotherPDG[iHypothesis];
+      neutralDaughterKFPDG = -outNeutralDaughterPDG[iHypothesis];
+    }
+    if(!(fDecayReconstructionList.empty()) && (fDecayReconstructionList.find(motherKFPDG) == fDecayReconstructionList.end())) continue;
+    
+    MotherTrack.Create(MotherTracks, idMother, int_v(motherPDGHypothesis[iHypothesis]));
+    ConstructNeutralDaughterDecay(MotherTrack, ChargedDaughter, motherTrackId, active, nPairs, iTC, iHypothesis,
+                                  neutralDaughterMassHypothesis[iHypothesis], neutralDaughterKFPDG, motherKFPDG, Particles);
+  }
+}
+
 void KFParticleFinder::AddCandidate(const KFParticle& candidate, int iPV)
 {
   /** Adds an externally found particle to either set of secondary or primary candidates:\n
@@ -26,9 +26,11 @@
 #include "KFParticle.h"
 #include "KFParticleSIMD.h"
 #include "KFPTrackVector.h"
+#include "KFPParticleVector.h"
 
 #include <vector>
 #include <map>
+#include <chrono>
 
 class KFPEmcCluster;
 
@@ -48,8 +50,39 @@ class KFParticleFinder
 {
  public:
 
+  /** Groups of decay channels run by KFParticleFinder::FindParticles() after the 2-daughter decays, the order defines 
+   ** the default priority of the groups. */
+  enum ChannelGroup
+  {
+    kBackground = 0,     ///< background for the resonances from primary tracks
+    kKinks,              ///< decays with the neutral daughter
+    kStrangeBaryons,     ///< \f$\Xi^\pm\f$ and \f$\Omega^\pm\f$
+    kResonances,         ///< strange resonances
+    kHypernuclei,        ///< hypernuclei with three and more daughters
+    kCharm,              ///< open charm and beauty
+    kDibaryons,          ///< H0 dibaryon
+    kPi0Channels,        ///< decays with \f$\gamma\f$ and \f$\pi^0\f$, charmonium
+    kNChannelGroups
+  };
+  
+  /** Figures of merit to rank the candidates of the channel with the limited number of candidates, the lower value is better. */
+  enum CandidateFigureOfMerit
+  {
+    kChi2NDF = 0,   ///< \f$\chi^2/NDF\f$ of the decay vertex fit
+    kMassDeviation  ///< deviation of the mass from the table value in units of the mass error
+  };
+  
+  /** Status of the group of channels in the current event. */
+  enum ChannelGroupStatus
+  {
+    kChannelNotRun = 0, ///< the group was not run
+    kChannelDone,       ///< the group was fully processed
+    kChannelTruncated,  ///< the group was stopped in the middle because of the latency budget
+    kChannelSkipped     ///< the group was skipped because of the latency budget
+  };
+
   KFParticleFinder();
-  virtual ~KFParticleFinder() {};
+  virtual ~KFParticleFinder() { if(fPIDHypothesisTracks) delete [] fPIDHypothesisTracks; }
   
   void Init(int nPV);
   void SetNThreads(short int n) { fNThreads = n;} ///< Sets the number of threads to by run in parallel. Currently not used.
@@ -84,6 +117,13 @@ class KFParticleFinder
                     std::vector<KFParticle>* vMotherSec = 0
                   ) __attribute__((always_inline));
   
+  int_m V0Prefilter(const float_v* pairParameters,
+                    const int_v& daughterNegPDG,
+                    const int_v& daughterPosPDG,
+                    const int_v& motherPDG,
+                    const int_m& isSecondary,
+                    std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx) const;
+  
   void SaveV0PrimSecCand(KFParticleSIMD& mother,
                           int& NParticles,
                           KFParticle& mother_temp,
@@ -127,6 +167,8 @@ class KFParticleFinder
                           std::vector< std::vector<KFParticle> >* vMotherPrim,
                           std::vector<KFParticle>* vMotherSec );
   
+  void FillPrimaryBackground(KFPTrackVector* vTracks, std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx);
+  
   void NeutralDaughterDecay(KFPTrackVector* vTracks, std::vector<KFParticle>& Particles);
 
   void FindTrackV0Decay(std::vector<KFParticle>& vV0,
@@ -142,6 +184,37 @@ class KFParticleFinder
                         std::vector< std::vector<KFParticle> >* vMotherPrim = 0,
                         std::vector<KFParticle>* vMotherSec = 0);
 
+  KFParticleSIMD& GetTrackV0TileTrack(KFPTrackVector& vTracks, const int iTr, const int firstTrackTile, const int_v& trackPDG);
+
+  void FindNProngDecay(std::vector<KFParticle>& vMother,
+                       const int motherPDG,
+                       const int nProngs,
+                       KFPTrackVector** prongTracks,
+                       kfvector_float** prongChiPrim,
+                       const int* prongPDG,
+                       const int* firstTrack,
+                       const int* lastTrack,
+                       std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx);
+  
+  void FitNProngPairs(std::vector<char>& pairTable,
+                      KFPTrackVector& tracksA,
+                      const int pdgA,
+                      KFPTrackVector& tracksB,
+                      const int pdgB,
+                      uint_v& indexA,
+                      uint_v& indexB,
+                      const int* tablePosition,
+                      const int nElements);
+  
+  void ConstructNProngCand(std::vector<KFParticle>& vMother,
+                           const int motherPDG,
+                           const int nProngs,
+                           KFPTrackVector** prongTracks,
+                           const int* prongPDG,
+                           uint_v* prongIndex,
+                           const int nElements,
+                           std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx);
+
   void SelectParticles(std::vector<KFParticle>& Particles,
                        std::vector<KFParticle>& vCandidates,
                        std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx,
@@ -150,6 +223,14 @@ class KFParticleFinder
                        const float& mass,
                        const float& massErr,
                        const float& massCut);
+  void SelectParticlesPerCandidate(std::vector<KFParticle>& Particles,
+                                   std::vector<KFParticle>& vCandidates,
+                                   std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx,
+                                   const float& cutChi2Topo,
+                                   const float& cutLdL,
+                                   const float& mass,
+                                   const float& massErr,
+                                   const float& massCut);
   
   void CombinePartPart(std::vector<KFParticle>& particles1,
                        std::vector<KFParticle>& particles2,
@@ -165,12 +246,34 @@ class KFParticleFinder
                        float massMotherPDG = 0.f,
                        float massMotherPDGSigma = 0.f);
 
+  void FindPi0Emc(std::vector<KFParticle>& Particles,
+                  std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx,
+                  const int firstEmcParticle);
+
   //Set Emc clusters containing gammas
   void SetEmcClusters(KFPEmcCluster* clusters) { fEmcClusters = clusters; } ///< Set a pointer to the gamma-clusters from the electromagnetic calorimeter.
+  /** Switches on the reconstruction of \f$\pi^0\f$ from pairs of EMC clusters with KFParticleFinder::FindPi0Emc(). Requires
+   ** EMC clusters to be set, is switched off by default. */
+  void SetUsePi0Emc(bool use) { fUsePi0Emc = use; }
+  bool GetUsePi0Emc() const { return fUsePi0Emc; } ///< Returns if \f$\pi^0\f$ are reconstructed from pairs of EMC clusters.
   
   // Mixed Event Analysis
   void SetMixedEventAnalysis() { fMixedEventAnalysis = 1; } ///< Switch KFParticleFinder to the mixed event mode.
   
+  // Background for resonances
+  /** Switches on the mass-only mode of the background for 2-daughter resonances: instead of KFParticleFinder::ConstructPrimaryBG()
+   ** like-sign and rotated pairs of primary tracks are constructed by KFParticleFinder::FillPrimaryBackground() and only
+   ** their PDG code and invariant mass are stored, see KFParticleFinder::GetBackgroundPDG() and KFParticleFinder::GetBackgroundMass().
+   ** The spectra can be added to the histograms with KFPHistogram::FillMass().
+   ** \param[in] use - "true" switches the mass-only mode on, "false" - off
+   ** \param[in] nRotations - number of rotations of the positive daughter, "0" switches the rotational background off
+   **/
+  void SetBackgroundMassOnly(bool use, int nRotations = 1) { fBackgroundMassOnly = use; fNBackgroundRotations = nRotations; }
+  bool GetBackgroundMassOnly() const { return fBackgroundMassOnly; } ///< Returns if the mass-only mode of the background is switched on.
+  int GetNBackgroundRotations() const { return fNBackgroundRotations; } ///< Returns number of rotations for the rotational background.
+  const std::vector<int>& GetBackgroundPDG() const { return fBackgroundPDG; } ///< Returns PDG codes of the background pairs in the mass-only mode.
+  const std::vector<float>& GetBackgroundMass() const { return fBackgroundMass; } ///< Returns invariant mass of the background pairs in the mass-only mode.
+  
   //Get secondary particles with the mass constraint
   /** Returns number of sets of vectors with secondary candidates for different decays. */
   static int GetNSecondarySets()  { return fNSecCandidatesSets; }
@@ -301,6 +404,10 @@ class KFParticleFinder
   void SetPtCutLMVM(float cut) { fCutLVMPt = cut; }  ///< Sets the cut on transverse momentum of each daughter track of low mass vector mesons.
   void SetPCutLMVM(float cut)  { fCutLVMP = cut; }   ///< Sets the cut on momentum of each daughter track of low mass vector mesons in dimuon channel.
   void SetPtCutJPsi(float cut) { fCutJPsiPt = cut; } ///< Sets the cut on transverse momentum of each daughter track of \f$J/\psi\f$.
+
+  void SetMinEnergyCutPi0Emc(float cut)  { fCutPi0EmcMinEnergy = cut; }  ///< Sets the cut on energy of each EMC cluster for \f$\pi^0\f$ reconstruction.
+  void SetAsymmetryCutPi0Emc(float cut)  { fCutPi0EmcAsymmetry = cut; }  ///< Sets the cut on energy asymmetry \f$|E_1-E_2|/(E_1+E_2)\f$ of EMC clusters for \f$\pi^0\f$.
+  void SetSigmaMassCutPi0Emc(float cut)  { fCutPi0EmcNSigmaMass = cut; } ///< Sets the width of the mass window in \f$\sigma_{M}\f$ for \f$\pi^0\f$ from EMC clusters.
   
   void SetPtCutCharm(float cut)         { fCutCharmPt = cut; } ///< Sets the cut on transverse momentum of each daughter track of open charm particles.
   void SetChiPrimaryCutCharm(float cut) { fCutCharmChiPrim = cut; } ///< Sets cut on \f$\chi^2_{prim}\f$ of each track for open charm particles.
@@ -336,6 +443,19 @@ class KFParticleFinder
     fCutLVMPt = finder->fCutLVMPt;
     fCutLVMP = finder->fCutLVMP;
     fCutJPsiPt = finder->fCutJPsiPt;
+    fCutPi0EmcMinEnergy = finder->fCutPi0EmcMinEnergy;
+    fCutPi0EmcAsymmetry = finder->fCutPi0EmcAsymmetry;
+    fCutPi0EmcNSigmaMass = finder->fCutPi0EmcNSigmaMass;
+    fTimeNSigmaCut = finder->fTimeNSigmaCut;
+    for(int iGroup=0; iGroup<kNChannelGroups; iGroup++)
+      fChannelGroupPriority[iGroup] = finder->fChannelGroupPriority[iGroup];
+    fMandatoryChannelPriority = finder->fMandatoryChannelPriority;
+    fTriggerPDG = finder->fTriggerPDG;
+    fTriggerNCandidates = finder->fTriggerNCandidates;
+    fTriggerSelection = finder->fTriggerSelection;
+    fTriggerNAccepted = finder->fTriggerNAccepted;
+    fCandidateCap = finder->fCandidateCap;
+    fCandidateCapFigureOfMerit = finder->fCandidateCapFigureOfMerit;
   }
   
   //Functionality to check the cuts
@@ -360,6 +480,10 @@ class KFParticleFinder
   float GetPtCutLMVM() const { return fCutLVMPt; }  ///< Returns cut on transverse momentum of each daughter track of low mass vector mesons.
   float GetPCutLMVM()  const { return fCutLVMP; }   ///< Returns cut on momentum of each daughter track of low mass vector mesons in dimuon channel.
   float GetPtCutJPsi() const { return fCutJPsiPt; } ///< Returns cut on transverse momentum of each daughter track of \f$J/\psi\f$.
+
+  float GetMinEnergyCutPi0Emc() const { return fCutPi0EmcMinEnergy; }  ///< Returns cut on energy of each EMC cluster for \f$\pi^0\f$ reconstruction.
+  float GetAsymmetryCutPi0Emc() const { return fCutPi0EmcAsymmetry; }  ///< Returns cut on energy asymmetry of EMC clusters for \f$\pi^0\f$ reconstruction.
+  float GetSigmaMassCutPi0Emc() const { return fCutPi0EmcNSigmaMass; } ///< Returns width of the mass window in \f$\sigma_{M}\f$ for \f$\pi^0\f$ from EMC clusters.
   
   float GetPtCutCharm()         const { return fCutCharmPt; } ///< Returns the cut on transverse momentum of each daughter track of open charm particles.
   float GetChiPrimaryCutCharm() const { return fCutCharmChiPrim; } ///< Returns cut on \f$\chi^2_{prim}\f$ of each track for open charm particles.
@@ -379,6 +503,157 @@ class KFParticleFinder
   const std::map<int,bool> GetReconstructionList() const { return fDecayReconstructionList; } ///< Returns list of decays to be reconstructed.
   void SetReconstructionList(const std::map<int,bool>& decays) { fDecayReconstructionList = decays; } ///< Set enitre reconstruction list
 
+  /** Sets the maximum number of entries in the cache of the pair geometry used in KFParticleFinder::Find2DaughterDecay(). The cache
+   ** holds the pairs of one SIMD vector of negative tracks, i.e. one entry per positive track. If more entries are required 
+   ** for a set of positive tracks the cache is not used for them. "0" switches the cache off. */
+  void SetPairGeometryCacheMaxSize(unsigned int size) { fPairGeometryCacheMaxSize = size; }
+  unsigned int GetPairGeometryCacheMaxSize() const { return fPairGeometryCacheMaxSize; } ///< Returns the maximum size of the pair geometry cache.
+  /** Returns number of SIMD vectors of track pairs in the current event, for which the distance and the pointing 
+   ** were calculated in KFParticleFinder::Find2DaughterDecay(). */
+  unsigned long GetNPairGeometryCalculated() const { return fNPairGeometryCalculated; }
+  /** Returns number of SIMD vectors of track pairs in the current event, for which the distance and the pointing
+   ** were taken from the cache instead of being recalculated for another mother hypothesis. */
+  unsigned long GetNPairGeometryReused() const { return fNPairGeometryReused; }
+
+  /** Switches on or off the parameter-only prefilter of the secondary track pairs in KFParticleFinder::Find2DaughterDecay(). The
+   ** prefilter rejects the pairs pointing away from all primary vertices and, if the mass window is set, the pairs with the approximate
+   ** invariant mass far from the table mass of the mother before the full construction of the candidate. Gamma candidates are not
+   ** prefiltered. Is switched off by default. */
+  void SetV0Prefilter(bool use) { fUseV0Prefilter = use; }
+  bool GetV0Prefilter() const { return fUseV0Prefilter; } ///< Returns if the parameter-only prefilter of the track pairs is switched on.
+  /** Sets the half-width of the invariant mass window of the prefilter for secondary K0s, Lambda, H3Lambda and H4Lambda in units 
+   ** of the expected width of the peak, see KFParticleDatabase::GetMotherMass(). The window removes the sidebands of these
+   ** candidates from the output. "0" switches the window off, which is the default. */
+  void SetV0PrefilterMassWindow(float nSigma) { fV0PrefilterNSigmaMass = nSigma; }
+  float GetV0PrefilterMassWindow() const { return fV0PrefilterNSigmaMass; } ///< Returns the half-width of the mass window of the prefilter in sigmas.
+  unsigned long GetNV0PrefilterTested() const { return fNV0PrefilterTested; } ///< Returns number of track pairs checked by the prefilter in the current event.
+  unsigned long GetNV0PrefilterRejected() const { return fNV0PrefilterRejected; } ///< Returns number of track pairs rejected by the prefilter in the current event.
+  /** Returns the fraction of the track pairs rejected by the prefilter in the current event. */
+  float GetV0PrefilterRejectionRate() const { return (fNV0PrefilterTested > 0) ? float(fNV0PrefilterRejected)/float(fNV0PrefilterTested) : 0.f; }
+
+  /** Sets the cut on the time compatibility of the daughter tracks in KFParticleFinder::Find2DaughterDecay() in units of the error
+   ** of the time difference, see KFPTrackVector::T(). The cut is checked before the geometry of the pair. "0" switches the cut off,
+   ** which is the default. Tracks with the negative error of the time are compatible with any time. */
+  void SetTimeCompatibilityCut(float nSigma) { fTimeNSigmaCut = nSigma; }
+  float GetTimeCompatibilityCut() const { return fTimeNSigmaCut; } ///< Returns the cut on the time compatibility of the daughter tracks.
+  unsigned long GetNTimeIncompatiblePairs() const { return fNTimeIncompatiblePairs; } ///< Returns number of track pairs rejected by the time cut in the current event.
+
+  /** Sets the priority of the group of channels, see KFParticleFinder::ChannelGroup. Groups are run in the order of decreasing priority, 
+   ** groups with equal priorities are run in the default order. */
+  void SetChannelGroupPriority(int iGroup, int priority) { fChannelGroupPriority[iGroup] = priority; }
+  int GetChannelGroupPriority(int iGroup) const { return fChannelGroupPriority[iGroup]; } ///< Returns the priority of the group of channels.
+  /** Groups with the priority not lower than "priority" are run even if the latency budget is exceeded. By default all groups can be skipped. */
+  void SetMandatoryChannelPriority(int priority) { fMandatoryChannelPriority = priority; }
+  int GetMandatoryChannelPriority() const { return fMandatoryChannelPriority; } ///< Returns the minimal priority of the groups, which are never skipped.
+  /** Sets the deadline for the current event: when it is exceeded the not mandatory groups of channels are skipped and the group, 
+   ** which is currently running, is stopped at the next checkpoint. */
+  void SetDeadline(const std::chrono::steady_clock::time_point& deadline) { fDeadline = deadline; fHasDeadline = true; }
+  void ResetDeadline() { fHasDeadline = false; } ///< Switches off the deadline.
+  /** Returns true if the deadline is set and exceeded. */
+  bool IsOverBudget() const { return fHasDeadline && (std::chrono::steady_clock::now() > fDeadline); }
+  int GetChannelGroupStatus(int iGroup) const { return fChannelGroupStatus[iGroup]; } ///< Returns the status of the group of channels in the current event, see KFParticleFinder::ChannelGroupStatus.
+  bool IsPartiallyProcessed() const;
+
+  /** Selection function of the trigger condition, returns true if the candidate is accepted. */
+  typedef bool (*TriggerSelection)(const KFParticle& particle);
+  /** Adds a condition of the trigger mode: the event is triggered if at least "nCandidates" candidates with the PDG code "pdg" are
+   ** accepted by "selection", if "selection" is not set all candidates are accepted. Particles and antiparticles should be added
+   ** as separate conditions. If at least one condition is added only the groups of channels, which can produce the requested
+   ** particles, are run in the order of their cost, and the reconstruction is stopped when any condition is fulfilled. */
+  void AddTriggerCondition(int pdg, int nCandidates = 1, TriggerSelection selection = 0)
+  {
+    fTriggerPDG.push_back(pdg);
+    fTriggerNCandidates.push_back(nCandidates);
+    fTriggerSelection.push_back(selection);
+    fTriggerNAccepted.push_back(0);
+  }
+  /** Removes all trigger conditions, the normal mode is switched on. */
+  void ClearTriggerConditions() { fTriggerPDG.clear(); fTriggerNCandidates.clear(); fTriggerSelection.clear(); fTriggerNAccepted.clear(); }
+  int GetNTriggerConditions() const { return fTriggerPDG.size(); } ///< Returns number of the trigger conditions.
+  bool IsTriggered() const { return fFiredTriggerCondition >= 0; } ///< Returns true if one of the trigger conditions is fulfilled in the current event.
+  int GetFiredTriggerCondition() const { return fFiredTriggerCondition; } ///< Returns the index of the fulfilled trigger condition, "-1" if the event is not triggered.
+  int GetNTriggerAccepted(int iCondition) const { return fTriggerNAccepted[iCondition]; } ///< Returns number of candidates accepted by the trigger condition in the current event.
+  static int GetChannelGroupOfPDG(int pdg);
+  bool IsLastHitTracksNeeded() const;
+
+  /** Limits the number of candidates with the PDG code "pdg" stored in the output array per event: only "maxCandidates" best
+   ** candidates according to the "figureOfMerit" (see KFParticleFinder::CandidateFigureOfMerit) are kept. Candidates, which are
+   ** daughters of other kept candidates, are never removed. Candidates of the final channels, which are not used further in
+   ** the reconstruction, are limited already when they are stored, so the output array does not grow beyond the limit; other
+   ** candidates are limited at the end of the event. */
+  void SetCandidateCap(int pdg, int maxCandidates, int figureOfMerit = kChi2NDF)
+  {
+    fCandidateCap[pdg] = maxCandidates;
+    fCandidateCapFigureOfMerit[pdg] = figureOfMerit;
+  }
+  void ClearCandidateCaps() { fCandidateCap.clear(); fCandidateCapFigureOfMerit.clear(); } ///< Removes all limits on the number of candidates.
+  unsigned long GetNDiscardedCandidates() const { return fNDiscardedCandidates; } ///< Returns number of candidates discarded by the limits in the current event.
+  /** Returns number of candidates with the PDG code "pdg" discarded by the limits in the current event. */
+  unsigned long GetNDiscardedCandidates(int pdg) const
+  {
+    std::map<int, unsigned long>::const_iterator it = fNDiscardedCandidatesPerPDG.find(pdg);
+    return (it == fNDiscardedCandidatesPerPDG.end()) ? 0 : it->second;
+  }
+
+  /** Switches on the geometric index of the track end points in KFParticleFinder::NeutralDaughterDecay(): only pairs where the charged
+   ** daughter starts within "maxDistance" from the last hit of the mother track are fitted. If "minCosAngle" is larger than -1 pairs with
+   ** the cosine of the kink angle below it are also rejected before the fit. "0" distance switches the index off, which is the default. */
+  void SetKinkPrefilter(float maxDistance, float minCosAngle = -1.f) { fKinkMaxDistance = maxDistance; fKinkMinCosAngle = minCosAngle; }
+  float GetKinkMaxDistance() const { return fKinkMaxDistance; } ///< Returns the maximum distance between the mother end point and the daughter start point.
+  float GetKinkMinCosAngle() const { return fKinkMinCosAngle; } ///< Returns the cut on the cosine of the kink angle.
+  unsigned long GetNKinkPairsTested() const { return fNKinkPairsTested; } ///< Returns number of mother-daughter pairs from the neighbouring cells checked in the current event.
+  unsigned long GetNKinkPairsAccepted() const { return fNKinkPairsAccepted; } ///< Returns number of mother-daughter pairs passed to the fit in the current event.
+
+  /** Switches on the tiling of the loop over particles and tracks in KFParticleFinder::FindTrackV0Decay(): blocks of "nV0" particles 
+   ** are combined with blocks of "nTracks" tracks, both are kept in the SIMD form in the scratch memory and are reused within the tile.
+   ** The block of tracks is rounded up to the SIMD vector length. The tiles should fit L1 or L2 cache, the size of KFParticleSIMD
+   ** is about 60 SIMD vectors. The same candidates are found, but they are stored in a different order. "0" tracks switches the tiling off,
+   ** which is the default. */
+  void SetTrackV0Tiling(int nV0, int nTracks) { fTrackV0TileNV0 = nV0; fTrackV0TileNTracks = nTracks; }
+  int GetTrackV0TileNV0() const { return fTrackV0TileNV0; }         ///< Returns number of particles in the tile of KFParticleFinder::FindTrackV0Decay().
+  int GetTrackV0TileNTracks() const { return fTrackV0TileNTracks; } ///< Returns number of tracks in the tile of KFParticleFinder::FindTrackV0Decay().
+  unsigned long GetNTrackV0Combinations() const { return fNTrackV0Combinations; } ///< Returns number of particle-track combinations checked by KFParticleFinder::FindTrackV0Decay() in the current event.
+  double GetTrackV0Time() const { return fTrackV0Time; } ///< Returns time in seconds spent in KFParticleFinder::FindTrackV0Decay() in the current event.
+  /** Returns number of particle-track combinations per second achieved by KFParticleFinder::FindTrackV0Decay() in the current event. */
+  double GetTrackV0CombinationRate() const { return (fTrackV0Time > 0.) ? double(fNTrackV0Combinations)/fTrackV0Time : 0.; }
+  /** Returns number of combinations of particles with the PDG code "pdg" with their own daughter tracks, which were excluded 
+   ** by KFParticleFinder::FindTrackV0Decay() in the current event before any calculation. */
+  unsigned long GetNTrackV0ExcludedDaughters(int pdg) const
+  {
+    std::map<int, unsigned long>::const_iterator it = fNTrackV0ExcludedDaughters.find(pdg);
+    return (it == fNTrackV0ExcludedDaughters.end()) ? 0 : it->second;
+  }
+  /** Returns number of the excluded combinations of particles with their own daughter tracks for each PDG code of the particles. */
+  const std::map<int, unsigned long>& GetNTrackV0ExcludedDaughters() const { return fNTrackV0ExcludedDaughters; }
+
+  /** Switches on the reconstruction of D+ -> K- pi+ pi+ and D0 -> K- pi+ pi+ pi- (together with the charge conjugated decays) directly 
+   ** from tracks with KFParticleFinder::FindNProngDecay() instead of adding tracks one by one to the 2-daughter candidates. 
+   ** The 3- and 4-prong candidates are fitted to a common vertex at once, intermediate candidates are not stored. Is switched off by default. */
+  void SetUseNProngCharm(bool use) { fUseNProngCharm = use; }
+  bool GetUseNProngCharm() const { return fUseNProngCharm; } ///< Returns if multi-prong open charm is reconstructed with KFParticleFinder::FindNProngDecay().
+  unsigned long GetNNProngPairs() const { return fNNProngPairs; }   ///< Returns number of track pairs checked by KFParticleFinder::FindNProngDecay() in the current event.
+  unsigned long GetNNProngTuples() const { return fNNProngTuples; } ///< Returns number of track tuples fitted by KFParticleFinder::FindNProngDecay() in the current event.
+
+  /** Switches between the selection of the open charm candidates by KFParticleFinder::SelectParticles() in the SIMD form
+   ** and the selection candidate by candidate with KFParticleFinder::SelectParticlesPerCandidate(), which is the default. The gain 
+   ** of the SIMD form depends on the width of the SIMD vectors, it should be switched on only after it is validated with 
+   ** KFParticleTest::RunSelectParticlesBenchmark() on the target architecture. */
+  void SetUseSIMDSelection(bool use) { fUseSIMDSelection = use; }
+  bool GetUseSIMDSelection() const { return fUseSIMDSelection; } ///< Returns if candidates are selected by KFParticleFinder::SelectParticles() in the SIMD form.
+  unsigned long GetNSelectedCandidates() const { return fNSelectedCandidates; } ///< Returns number of candidates checked by KFParticleFinder::SelectParticles() in the current event.
+  double GetSelectParticlesTime() const { return fSelectParticlesTime; } ///< Returns time in seconds spent in KFParticleFinder::SelectParticles() in the current event.
+
+  /** Switches on the counting of the storage of daughter indices by KFParticleFinder::CountDaughterIdsStorage() at the end of each event.
+   ** It scans all sets of candidates, therefore it is off by default and should be used only for diagnostics. */
+  void SetCountDaughterIdsStorage(bool count) { fCountDaughterIdsStorage = count; }
+  bool GetCountDaughterIdsStorage() const { return fCountDaughterIdsStorage; } ///< Returns if the storage of daughter indices is counted.
+  /** Returns number of particles in the output and in the sets of candidates of the current event with the daughter indices stored 
+   ** inline, each of them saves one heap allocation per copy with respect to std::vector. Is filled only if 
+   ** KFParticleFinder::SetCountDaughterIdsStorage() is switched on. */
+  unsigned long GetNInlineDaughterIds() const { return fNInlineDaughterIds; }
+  /** Returns number of particles in the output and in the sets of candidates of the current event with the daughter indices on the heap. */
+  unsigned long GetNHeapDaughterIds() const { return fNHeapDaughterIds; }
+
  private:
 
   short int fNPV; ///< Number of primary vertex candidates in the event.
@@ -407,6 +682,10 @@ class KFParticleFinder
   
   //cuts on J/Psi
   float fCutJPsiPt; ///< Cut on transverse momentum of daughter tracks for \f$J/\psi\f$.
+  //cuts on pi0 from EMC clusters
+  float fCutPi0EmcMinEnergy;  ///< Cut on energy of each EMC cluster, 0 GeV by default.
+  float fCutPi0EmcAsymmetry;  ///< Cut on energy asymmetry \f$|E_1-E_2|/(E_1+E_2)\f$ of two EMC clusters, 0.8 by default.
+  float fCutPi0EmcNSigmaMass; ///< Half-width of the mass window in \f$\sigma_{M}\f$ for \f$\pi^0\f$ from EMC clusters, 3 by default.
   
   //vectors with temporary particles for charm reconstruction
   std::vector<KFParticle> fD0;         ///<Vector with temporary D0->K-pi+ candidates.
@@ -456,12 +735,147 @@ class KFParticleFinder
   std::vector< std::vector<KFParticle> > fPrimCandidatesTopoMass[fNPrimCandidatesTopoSets];
   
   KFPEmcCluster* fEmcClusters; ///< Pointer to the input gamma-clusters from the electromagnetic calorimeter.
+  bool fUsePi0Emc; ///< Flag showing if \f$\pi^0\f$ are reconstructed from pairs of EMC clusters by KFParticleFinder::FindPi0Emc().
 
   bool fMixedEventAnalysis; ///< Flag defines if the mixed event analysis is run. In mixed event mode limited number of decays is reconstructed.
   
   /** \brief Map defines if the reconstruction of the decay with a certain PDG hypothesis should be run. If the map is empty - all decays are reconstructed. If at least one decay is added - only those decays will be reconstructed which are specified in the list. **/
   std::map<int,bool> fDecayReconstructionList;
   
+  /** \brief Cache of the mass independent geometry of the track pairs in KFParticleFinder::Find2DaughterDecay(). For the current
+   ** SIMD vector of negative tracks, each SIMD vector of positive tracks and each rotation the bits of lanes, which pass the distance 
+   ** and pointing cuts, are stored together with the flag KFParticleFinder::fPairGeometryIsSet showing that the entry is filled. **/
+  std::vector<unsigned int> fPairGeometryCache;
+  /** \brief Parameters X, Y, Z, Px, Py, Pz of the negative and the positive daughters transported to the point of their closest
+   ** approach, KFParticleFinder::fNPairGeometryParameters SIMD vectors for each entry of KFParticleFinder::fPairGeometryCache. **/
+  kfvector_floatv fPairGeometryParameters;
+  static const int fNPairGeometryParameters = 12; ///< Number of the transported parameters of a pair in KFParticleFinder::fPairGeometryParameters.
+  unsigned int fPairGeometryCacheMaxSize; ///< Maximum number of entries in KFParticleFinder::fPairGeometryCache.
+  static const unsigned int fPairGeometryIsSet = 1u << 31; ///< Flag of the filled entry in KFParticleFinder::fPairGeometryCache.
+  unsigned long fNPairGeometryCalculated; ///< Number of calculations of the pair geometry in the current event.
+  unsigned long fNPairGeometryReused;     ///< Number of calculations of the pair geometry avoided by the cache in the current event.
+  
+  bool fUseV0Prefilter;           ///< Flag defines if the parameter-only prefilter of the track pairs is run in KFParticleFinder::Find2DaughterDecay().
+  float fV0PrefilterNSigmaMass;   ///< Half-width of the invariant mass window of the prefilter in units of the expected width of the peak, "0" switches the window off.
+  unsigned long fNV0PrefilterTested;   ///< Number of track pairs checked by the prefilter in the current event.
+  unsigned long fNV0PrefilterRejected; ///< Number of track pairs rejected by the prefilter in the current event.
+  float fTimeNSigmaCut; ///< Cut on the time compatibility of the daughter tracks, "0" switches the cut off.
+  unsigned long fNTimeIncompatiblePairs; ///< Number of track pairs rejected by the time cut in the current event.
+  
+  int fChannelGroupPriority[kNChannelGroups]; ///< Priorities of the groups of channels, see KFParticleFinder::ChannelGroup.
+  int fChannelGroupStatus[kNChannelGroups];   ///< Status of the groups of channels in the current event, see KFParticleFinder::ChannelGroupStatus.
+  int fMandatoryChannelPriority; ///< Groups with the priority not lower than this value are never skipped.
+  bool fHasDeadline; ///< Flag shows if the deadline for the current event is set.
+  std::chrono::steady_clock::time_point fDeadline; ///< Deadline for the current event.
+  
+  std::vector<int> fTriggerPDG;                     ///< PDG codes of the trigger conditions.
+  std::vector<int> fTriggerNCandidates;             ///< Number of candidates required by the trigger conditions.
+  std::vector<TriggerSelection> fTriggerSelection;  ///< Selection functions of the trigger conditions.
+  std::vector<int> fTriggerNAccepted;               ///< Number of candidates accepted by the trigger conditions in the current event.
+  int fFiredTriggerCondition;                       ///< Index of the fulfilled trigger condition in the current event, "-1" if not triggered.
+  unsigned int fNTriggerCheckedParticles;           ///< Number of particles from the output array already checked by the trigger conditions.
+  
+  std::map<int,int> fCandidateCap;               ///< Maximum number of candidates per event for each limited PDG code.
+  std::map<int,int> fCandidateCapFigureOfMerit;  ///< Figure of merit to select the best candidates for each limited PDG code.
+  unsigned long fNDiscardedCandidates;           ///< Number of candidates discarded by the limits in the current event.
+  std::map<int, unsigned long> fNDiscardedCandidatesPerPDG; ///< Number of discarded candidates for each limited PDG code in the current event.
+  /** Heaps with the figure of merit and the index in the output array of the candidates stored by KFParticleFinder::AddFinalCandidate()
+   ** for each limited PDG code, the worst candidate is on top. */
+  std::map<int, std::vector< std::pair<float,int> > > fFinalCandidateHeap;
+  
+  bool fBackgroundMassOnly; ///< Flag showing if only the mass of the background for resonances is stored by KFParticleFinder::FillPrimaryBackground().
+  int fNBackgroundRotations; ///< Number of rotations of the positive daughter for the rotational background.
+  std::vector<int> fBackgroundPDG;     ///< PDG codes of the background pairs in the current event in the mass-only mode.
+  std::vector<float> fBackgroundMass;  ///< Invariant mass of the background pairs in the current event in the mass-only mode.
+  
+  float fKinkMaxDistance; ///< Maximum distance between the last hit of the mother and the first hit of the daughter in KFParticleFinder::NeutralDaughterDecay(), "0" - all pairs are fitted.
+  float fKinkMinCosAngle; ///< Cut on the cosine of the kink angle between the mother and the daughter tracks, "-1" - no cut.
+  unsigned long fNKinkPairsTested;   ///< Number of mother-daughter pairs from the neighbouring cells in the current event.
+  unsigned long fNKinkPairsAccepted; ///< Number of mother-daughter pairs passed to the fit in the current event.
+  static const int fKinkGridMaxNCells = 64; ///< Maximum number of cells of the geometric index along each axis.
+  float fKinkGridMin[3];   ///< Lower corner of the geometric index.
+  int fKinkGridNCells[3];  ///< Number of cells of the geometric index along each axis.
+  float fKinkGridCellSize; ///< Size of the cell of the geometric index.
+  std::vector<int> fKinkGridFirstTrack; ///< Index of the first track of each cell in KFParticleFinder::fKinkGridTracks, the last element is the total number of tracks.
+  std::vector<int> fKinkGridTracks;     ///< Indices of the mother tracks sorted by cells.
+  
+  int fTrackV0TileNV0;    ///< Number of particles in the tile of KFParticleFinder::FindTrackV0Decay().
+  int fTrackV0TileNTracks; ///< Number of tracks in the tile of KFParticleFinder::FindTrackV0Decay(), "0" - tiling is switched off.
+  std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> > fTrackV0TileV0s;    ///< Particles of the current tile converted to the SIMD form.
+  std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> > fTrackV0TileTracks; ///< Tracks of the current tile converted to the SIMD form.
+  std::vector<bool> fIsTrackV0TileTrackLoaded; ///< Flags of the SIMD vectors of tracks already converted in the current tile.
+  unsigned long fNTrackV0Combinations; ///< Number of particle-track combinations checked by KFParticleFinder::FindTrackV0Decay() in the current event.
+  double fTrackV0Time; ///< Time spent in KFParticleFinder::FindTrackV0Decay() in the current event.
+  std::map<int, unsigned long> fNTrackV0ExcludedDaughters; ///< Number of the excluded combinations of particles with their own daughter tracks for each PDG code of the particles.
+  
+  KFPTrackVector* fPIDHypothesisTracks; ///< Input tracks with a copy for each alternative PID hypothesis, see KFParticleFinder::ExpandPIDHypotheses().
+  kfvector_float fPIDHypothesisChiToPrimVtx[2]; ///< \f$\chi^2_{prim}\f$ deviations of the secondary tracks in KFParticleFinder::fPIDHypothesisTracks.
+  
+  bool fUseNProngCharm; ///< Flag showing if multi-prong open charm is reconstructed with KFParticleFinder::FindNProngDecay().
+  static const int fNProngMax = 4; ///< Maximum number of daughter tracks in KFParticleFinder::FindNProngDecay().
+  std::vector<int> fNProngTracks[fNProngMax]; ///< Indices of the preselected tracks of each prong in KFParticleFinder::FindNProngDecay().
+  std::vector<char> fNProngPairTable[fNProngMax][fNProngMax]; ///< Flags of the accepted track pairs for each two prongs in KFParticleFinder::FindNProngDecay().
+  KFPTrackVector* fNProngKeyTracks[fNProngMax]; ///< Vector of tracks of each prong in the previous call of KFParticleFinder::FindNProngDecay() in the current event.
+  int fNProngKey[fNProngMax][3]; ///< PDG hypothesis, first and last track of each prong in the previous call of KFParticleFinder::FindNProngDecay().
+  bool fIsNProngPairTableSet[fNProngMax][fNProngMax]; ///< Flags of the pair tables, which are filled for the current prongs and can be reused.
+  unsigned long fNNProngPairs;  ///< Number of track pairs checked by KFParticleFinder::FindNProngDecay() in the current event.
+  unsigned long fNNProngTuples; ///< Number of track tuples fitted by KFParticleFinder::FindNProngDecay() in the current event.
+  
+  KFPParticleVector fCandidateSoA; ///< Set of candidates in the SoA form padded to the SIMD vector length, see KFPParticleVector::SetParticles().
+  
+  bool fUseSIMDSelection; ///< Flag showing if candidates are selected by KFParticleFinder::SelectParticles() in the SIMD form.
+  unsigned long fNSelectedCandidates; ///< Number of candidates checked by KFParticleFinder::SelectParticles() in the current event.
+  double fSelectParticlesTime; ///< Time spent in KFParticleFinder::SelectParticles() in the current event.
+  
+  bool fCountDaughterIdsStorage;     ///< Flag showing if the storage of daughter indices is counted by KFParticleFinder::CountDaughterIdsStorage().
+  unsigned long fNInlineDaughterIds; ///< Number of particles with the inline daughter indices in the current event.
+  unsigned long fNHeapDaughterIds;   ///< Number of particles with the daughter indices on the heap in the current event.
+  
+  float_m SelectPrimaryBackgroundPair(const KFParticleSIMD& daughter, const KFParticleSIMD& partner, KFParticleSIMD& mother,
+                                      std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx) const;
+  void StoreBackgroundMass(const int_v& motherPDG, const float_v& mass, const float_m& active);
+  void ConstructPi0Emc(uint_v* gammaIndex, int_v* gammaId, const int nPairs,
+                       std::vector<KFParticle>& Particles, const KFParticleSIMD& PrimVtx);
+  void ConstructNeutralDaughterDecay(const KFParticleSIMD& MotherTrack, const KFParticleSIMD& ChargedDaughter,
+                                     const int_v& motherTrackId, int_m active, const int nLanes,
+                                     const int iTC, const int iHypothesis, const float neutralDaughterMass,
+                                     const int neutralDaughterPDG, const int motherPDG,
+                                     std::vector<KFParticle>& Particles);
+  void BuildKinkGrid(const KFPTrackVector& tracks);
+  void CountDaughterIdsStorage(const std::vector<KFParticle>& Particles);
+  bool ExpandPIDHypotheses(KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx);
+  bool IsAcceptedByTrigger(const KFParticle& particle, const unsigned int iCondition) const;
+  bool CheckTriggerConditions(const std::vector<KFParticle>& Particles);
+  void ApplyCandidateCaps(std::vector<KFParticle>& Particles, const int firstCandidate);
+  float GetCandidateFigureOfMerit(const KFParticle& particle) const;
+  void AddFinalCandidate(std::vector<KFParticle>& Particles, KFParticle& candidate);
+  void RunTrigger(KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx, std::vector<KFParticle>& Particles,
+                  std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx, const int firstEmcParticle);
+  void RunChannelGroup(const int iGroup, KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx, std::vector<KFParticle>& Particles,
+                       std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx, const int firstEmcParticle,
+                       const bool isPrerequisite = false);
+  void ReconstructBackground(KFPTrackVector* vRTracks, std::vector<KFParticle>& Particles,
+                             std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx);
+  void ReconstructStrangeBaryons(KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx, std::vector<KFParticle>& Particles,
+                                 std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx);
+  void ReconstructResonances(KFPTrackVector* vRTracks, std::vector<KFParticle>& Particles,
+                             std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx);
+  void ReconstructHypernuclei(KFPTrackVector* vRTracks, std::vector<KFParticle>& Particles,
+                              std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx);
+  void ReconstructOpenCharm(KFPTrackVector* vRTracks, kfvector_float* ChiToPrimVtx, std::vector<KFParticle>& Particles,
+                            std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx);
+  void ReconstructDibaryons(KFPTrackVector* vRTracks, std::vector<KFParticle>& Particles,
+                            std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx);
+  void ReconstructPi0Channels(KFPTrackVector* vRTracks, std::vector<KFParticle>& Particles,
+                              std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& PrimVtx, const int firstEmcParticle);
+  void FindKinkPartners(const float* point, std::vector<int>& partners) const;
+  void ConstructKinkPairs(KFPTrackVector& MotherTracks, KFPTrackVector& DaughterTracks,
+                          uint_v& idMother, uint_v& idDaughter, const int nPairs,
+                          const int iTC, const int iTrTypeDaughter, const int nHypothesis,
+                          const int* motherPDGHypothesis, const float* neutralDaughterMassHypothesis,
+                          const int* outNeutralDaughterPDG, const int* outMotherPDG,
+                          std::vector<KFParticle>& Particles);
+  
   KFParticleFinder(const KFParticleFinder&); ///< Copying is disabled for this class.
   KFParticleFinder& operator=(const KFParticleFinder&); ///< Copying is disabled for this class.
 };
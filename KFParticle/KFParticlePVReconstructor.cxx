@@ -22,6 +22,10 @@
 #include "KFParticlePVReconstructor.h"
 #include "KFPTrackVector.h"
 #include "KFParticle.h"
+#include "KFParticleSIMD.h"
+#include "KFPSimdAllocator.h"
+
+#include <algorithm>
 
 using std::vector;
 using std::array;
@@ -30,7 +34,8 @@ void KFParticlePVReconstructor::Init(KFPTrackVector *tracks, int nParticles)
 {
   /** The function initialises an input for the search of primary vertices:\n
    ** 1) it receives as an input an array with tracks;\n
-   ** 2) tracks are converted to KFParticle objects assuming pion mass;\n
+   ** 2) tracks are converted to vectorised KFParticleSIMD objects assuming pion mass
+   ** and are transported to the target position;\n
    ** 3) the position of the primary vertex is estimated with simplified
    ** Kalman filter equations using all tracks; \n
    ** 4) tracks are checked to deviate from the obtained estimation within
@@ -42,7 +47,10 @@ void KFParticlePVReconstructor::Init(KFPTrackVector *tracks, int nParticles)
    ** estimation;\n
    ** 7) the weight for each particle is calculated according to its errors,
    ** if errors are not defined after extrapolation or if particle 10 cm
-   ** away from the {0,0,0} point the weight of -100 is assigned.
+   ** away from the {0,0,0} point the weight of -100 is assigned;\n
+   ** 8) only at the end scalar KFParticle objects are filled, they are used
+   ** in the fit of the primary vertex candidates; the time of the tracks is
+   ** copied for the search of clusters in time.
    ** \param[in] tracks - a pointer to the KFPTrackVector with input tracks
    ** \param[in] nParticles - number of the input tracks
    **/
@@ -50,73 +58,91 @@ void KFParticlePVReconstructor::Init(KFPTrackVector *tracks, int nParticles)
   fNParticles = nParticles;
   fParticles.resize(fNParticles);
   fWeight.resize(fNParticles);
+  fTime.resize(fNParticles);
+  fTimeError.resize(fNParticles);
+  for(int iTr=0; iTr<fNParticles; iTr++)
+  {
+    fTime[iTr] = tracks->T()[iTr];
+    fTimeError[iTr] = tracks->TErr()[iTr];
+  }
   
-  float C[3] = {0,0,0};
-  int nC[3] = {0,0,0};
+  CleanPV();
   
-  KFPTrack track;
-  for ( int iTr = 0; iTr < fNParticles; iTr++ ) {
-    tracks->GetTrack(track,iTr);
-    fParticles[iTr] = KFParticle( track, 211 );
-    fParticles[iTr].AddDaughterId(track.Id());
-    float zeroPoint[3]{fTarget[0], fTarget[1], fTarget[2]};
-    fParticles[iTr].TransportToPoint(zeroPoint);
-    
+  // Tracks are read directly from the columns of KFPTrackVector and processed by float_vLen
+  // entries at once, scalar KFParticle objects are filled only when the final parameters are known.
+  const int nVectors = (fNParticles + float_vLen - 1) / float_vLen;
+  vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> > particlesSIMD(nVectors);
+  
+  const float_v zeroPoint[3] = {fTarget[0], fTarget[1], fTarget[2]};
+  const int_v pionPDG(211);
+  
+  for(int iV=0, iTr=0; iV<nVectors; iV++, iTr += float_vLen)
+  {
+    KFParticleSIMD& particle = particlesSIMD[iV];
+    particle.Load(*tracks, iTr, pionPDG);
+    particle.SetPDG(211);
+    // the input tracks do not carry the quality of the fit
+    particle.Chi2() = -1.f;
+    particle.NDF() = -1;
+    particle.AddDaughterId( reinterpret_cast<const int_v&>(tracks->Id()[iTr]) );
+    particle.TransportToPoint(zeroPoint);
+  }
+  
+  // The initial errors of the estimation are taken from the first track.
+  float C[3] = {1.e-2f, 1.e-2f, 1.e-2f};
+  if(fNParticles > 0)
+  {
     for(int iC=0; iC<3; iC++)
     {
-      if(!(fParticles[0].Covariance(iC,iC)==fParticles[0].Covariance(iC,iC))) continue; 
-      if(fParticles[0].Covariance(iC,iC) < 10.f && fParticles[0].Covariance(iC,iC) > 0.f )
-      {
-        C[iC] += fParticles[0].Covariance(iC,iC);
-        nC[iC]++;
-      }
+      const float c = particlesSIMD[0].GetCovariance(iC,iC)[0];
+      if(c < 10.f && c > 0.f)
+        C[iC] = c;
     }
   }
   
-  fPrimVertices.clear();
-  fClusters.clear();
-  
   float pvEstimation[3] = {0.};
   float pvEstimationTr[3] = {0.};
 
-  float parTmp[8] = {0.};
-  float covTmp[36] = {0.};
-  
-  for(int iC=0; iC<3; iC++)
-  {
-    if(nC[iC] >0)
-      C[iC] /= nC[iC];
-    else
-      C[iC] = 1.e-2;
-  }
+  float_v parTmp[8];
+  float_v covTmp[36];
   
   for(int iIter=0; iIter<3; iIter++)
   {
     C[0]*=100.f; C[1]*=100.f; C[2]*=100.f;
-    for ( int iTr = 0; iTr < fNParticles; iTr++ ) {
-      float ds = 0.f;
-      float dsdr[6] = {0.f};
+    const float_v pvPoint[3] = {pvEstimationTr[0], pvEstimationTr[1], pvEstimationTr[2]};
+    
+    for(int iV=0, iTr=0; iV<nVectors; iV++, iTr += float_vLen)
+    {
+      float_v ds = 0.f;
+      float_v dsdr[6] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
       if(iIter>0)
-        ds = fParticles[iTr].GetDStoPoint(pvEstimationTr, dsdr);
-      fParticles[iTr].Transport( ds, dsdr, parTmp, covTmp);
+        ds = particlesSIMD[iV].GetDStoPoint(pvPoint, dsdr);
+      particlesSIMD[iV].Transport( ds, dsdr, parTmp, covTmp);
 
-      float r2 = parTmp[0]*parTmp[0] + parTmp[1]*parTmp[1];
-      if(!(r2==r2)) continue;
-      if(r2 > 25 ) continue;  
-      
-      const float V[3] = {covTmp[0], covTmp[2], covTmp[5]}; 
+      const float_v r2 = parTmp[0]*parTmp[0] + parTmp[1]*parTmp[1];
+      const float_m isGood = (r2 == r2) && (r2 <= 25.f) && 
+                             simd_cast<float_m>(int_v::IndexesFromZero() < int(fNParticles - iTr));
+      if(isGood.isEmpty()) continue;
       
-      for(int iComp=0; iComp<3; iComp++)
+      // The estimation is updated track by track, so the result does not depend on the SIMD width.
+      for(int iLane=0; iLane<float_vLen; iLane++)
       {
-        float K = C[iComp]/(C[iComp]+V[iComp]);
-        if (fabs(V[iComp]) < 1.e-8) continue;
-        if(C[iComp] > 16*V[iComp])
-          K = 1.f - V[iComp]/C[iComp];
-        const float dzeta = parTmp[iComp]-pvEstimation[iComp];
-        if(K!=K) continue;
-        if(K<0. || K>0.999) continue;
-        pvEstimation[iComp] += K*dzeta;
-        C[iComp] -= K*C[iComp];
+        if(!isGood[iLane]) continue;
+        
+        const float V[3] = {covTmp[0][iLane], covTmp[2][iLane], covTmp[5][iLane]}; 
+        
+        for(int iComp=0; iComp<3; iComp++)
+        {
+          float K = C[iComp]/(C[iComp]+V[iComp]);
+          if (fabs(V[iComp]) < 1.e-8) continue;
+          if(C[iComp] > 16*V[iComp])
+            K = 1.f - V[iComp]/C[iComp];
+          const float dzeta = parTmp[iComp][iLane]-pvEstimation[iComp];
+          if(K!=K) continue;
+          if(K<0. || K>0.999) continue;
+          pvEstimation[iComp] += K*dzeta;
+          C[iComp] -= K*C[iComp];
+        }
       }
     }
     pvEstimationTr[0] = pvEstimation[0];
@@ -124,19 +150,24 @@ void KFParticlePVReconstructor::Init(KFPTrackVector *tracks, int nParticles)
     pvEstimationTr[2] = pvEstimation[2];
   }
 
-  for(int iP=0; iP<fNParticles; iP++)
+  const float_v pvPoint[3] = {pvEstimation[0], pvEstimation[1], pvEstimation[2]};
+  for(int iV=0, iTr=0; iV<nVectors; iV++, iTr += float_vLen)
   {
-    fParticles[iP].TransportToPoint(pvEstimation);
-
-    fWeight[iP] = fParticles[iP].CovarianceMatrix()[0]
-      + fParticles[iP].CovarianceMatrix()[2] + fParticles[iP].CovarianceMatrix()[5];
-    
-    if(fWeight[iP] > 0.f)
-      fWeight[iP] = 1.f/sqrt(fWeight[iP]);
-    else
-      fWeight[iP] = -100;
+    KFParticleSIMD& particle = particlesSIMD[iV];
+    particle.TransportToPoint(pvPoint);
+
+    float_v weight = particle.GetCovariance(0) + particle.GetCovariance(2) + particle.GetCovariance(5);
+    const float_m isWeightDefined = weight > 0.f;
+    weight(isWeightDefined) = 1.f/sqrt(weight);
+    weight(!isWeightDefined) = -100.f;
+    weight( (particle.X()*particle.X() + particle.Y()*particle.Y()) > 100.f ) = -100.f;
     
-    if( (fParticles[iP].X()*fParticles[iP].X() + fParticles[iP].Y()*fParticles[iP].Y()) > 100.f ) fWeight[iP] = -100.f;
+    const int nLanes = std::min(int(float_vLen), fNParticles - iTr);
+    for(int iLane=0; iLane<nLanes; iLane++)
+    {
+      fWeight[iTr+iLane] = weight[iLane];
+      particle.GetKFParticle(fParticles[iTr+iLane], iLane);
+    }
   }
 } // void KFParticlePVReconstructor::Init
 
@@ -146,13 +177,14 @@ void KFParticlePVReconstructor::FindPrimaryClusters( int cutNDF )
    ** vertex:\n
    ** 1) input particles are assumed to be transported to the beam line or target position;\n
    ** 2) at first, the best particle with the highest weight is selected;\n
-   ** 3) then a cluster is formed around this particle;\n
+   ** 3) then a cluster is formed around this particle, if KFParticlePVReconstructor::fTimeNSigmaCut
+   ** is set only particles compatible in time with the best particle are considered;\n
    ** 4) if a beam line is set it is used for the reconstruction as an additional track,
    ** but will not be added to the resulting cluster of daughter particles;\n
    ** 5) the primary vertex candidate is fitted with KFVertex::ConstructPrimaryVertex()
    ** using KFParticlePVReconstructor::fChi2Cut;\n
    ** 6) cluster is cleaned from particles deviating more then the fChi2Cut from the fitted
-   ** candidate;\n
+   ** candidate, other particles compatible in time with the cluster are added;\n
    ** 7) the cluster and the vertex candidate are stored if they satisfy the provided cutNDF;\n
    ** 8) the procedure is repeated until not used tracks with well-defined weight are left.
    ** 
@@ -164,12 +196,13 @@ void KFParticlePVReconstructor::FindPrimaryClusters( int cutNDF )
   if( IsBeamLine() )
     cutNDF += 2;
   
-  vector<unsigned short int> notUsedTracks(fNParticles);
-  vector<unsigned short int> *notUsedTracksPtr = &notUsedTracks;
+  // indices are stored as int, since time frames of the continuous readout can contain more than 65535 tracks
+  vector<int> notUsedTracks(fNParticles);
+  vector<int> *notUsedTracksPtr = &notUsedTracks;
   int nNotUsedTracks = fNParticles;
 
-  vector<unsigned short int> notUsedTracksNew(fNParticles);
-  vector<unsigned short int> *notUsedTracksNewPtr = &notUsedTracksNew;
+  vector<int> notUsedTracksNew(fNParticles);
+  vector<int> *notUsedTracksNewPtr = &notUsedTracksNew;
   int nNotUsedTracksNew = 0;
 
   for(int iTr=0; iTr<fNParticles; iTr++)
@@ -177,12 +210,12 @@ void KFParticlePVReconstructor::FindPrimaryClusters( int cutNDF )
     
   while(nNotUsedTracks>0)
   {
-    short int bestTrack = 0;
+    int bestTrack = 0;
     float bestWeight = -1.f;
 
-    for(unsigned short int iTr = 0; iTr < nNotUsedTracks; iTr++)
+    for(int iTr = 0; iTr < nNotUsedTracks; iTr++)
     {
-      unsigned short int &curTrack = (*notUsedTracksPtr)[iTr];
+      int &curTrack = (*notUsedTracksPtr)[iTr];
       
       if (fWeight[curTrack] > bestWeight)
       {
@@ -204,11 +237,13 @@ void KFParticlePVReconstructor::FindPrimaryClusters( int cutNDF )
     float covVertex[6] = {0.f};
     float weightVertex = 0.f;
 
-    for(unsigned short int iTr = 0; iTr < nNotUsedTracks; iTr++)
+    for(int iTr = 0; iTr < nNotUsedTracks; iTr++)
     {
-      unsigned short int &curTrack = (*notUsedTracksPtr)[iTr];
-      float chi2deviation = fParticles[curTrack].GetDeviationFromVertex(rBest, covBest);
-      if( ( chi2deviation < fChi2CutPreparation && chi2deviation >= 0 && fWeight[curTrack] > -1.f) || curTrack == bestTrack)
+      int &curTrack = (*notUsedTracksPtr)[iTr];
+      // the time is checked first, it is much cheaper than the chi2-deviation
+      const bool isTimeCompatible = IsTimeCompatible(curTrack, fTime[bestTrack], fTimeError[bestTrack]);
+      float chi2deviation = isTimeCompatible ? fParticles[curTrack].GetDeviationFromVertex(rBest, covBest) : -1.f;
+      if( ( isTimeCompatible && chi2deviation < fChi2CutPreparation && chi2deviation >= 0 && fWeight[curTrack] > -1.f) || curTrack == bestTrack)
       {
         for(int iP=0; iP<3; iP++)
           rVertex[iP] += fWeight[curTrack] * fParticles[curTrack].Parameters()[iP];
@@ -227,7 +262,7 @@ void KFParticlePVReconstructor::FindPrimaryClusters( int cutNDF )
       }
     }
     
-    vector<unsigned short int> *notUsedTracksPtrSave = notUsedTracksPtr;
+    vector<int> *notUsedTracksPtrSave = notUsedTracksPtr;
     notUsedTracksPtr = notUsedTracksNewPtr;
     notUsedTracksNewPtr = notUsedTracksPtrSave;
     
@@ -289,10 +324,13 @@ void KFParticlePVReconstructor::FindPrimaryClusters( int cutNDF )
         }
       }
       
-      for(unsigned short int iTr = 0; iTr < nNotUsedTracks; iTr++)
+      float clusterTime = 0.f, clusterTimeError = -1.f;
+      CalculateClusterTime(clearClusterInd, clusterTime, clusterTimeError);
+      
+      for(int iTr = 0; iTr < nNotUsedTracks; iTr++)
       {
-        unsigned short int &curTrack = (*notUsedTracksPtr)[iTr];
-        if( fParticles[curTrack].GetDeviationFromVertex(primVtx)<fChi2Cut )
+        int &curTrack = (*notUsedTracksPtr)[iTr];
+        if( IsTimeCompatible(curTrack, clusterTime, clusterTimeError) && fParticles[curTrack].GetDeviationFromVertex(primVtx)<fChi2Cut )
         {
           primVtx += fParticles[curTrack];
           clearClusterInd.push_back(curTrack);
@@ -319,7 +357,10 @@ void KFParticlePVReconstructor::FindPrimaryClusters( int cutNDF )
       if( primVtx.GetNDF() >= cutNDF)
 #endif
       {
+        CalculateClusterTime(cluster.fTracks, clusterTime, clusterTimeError);
         fPrimVertices.push_back(primVtx);
+        fPrimVertexTime.push_back(clusterTime);
+        fPrimVertexTimeError.push_back(clusterTimeError);
         fClusters.push_back(cluster);
       }
       
@@ -349,23 +390,75 @@ void KFParticlePVReconstructor::ReconstructPrimVertex()
     primVtx_tmp.SetChi2(-100);
 
     fPrimVertices.push_back(primVtx_tmp);
+    fPrimVertexTime.push_back(0.f);
+    fPrimVertexTimeError.push_back(-1.f);
     
     KFParticleCluster cluster;
     fClusters.push_back(cluster);
   }
 }
 
-void KFParticlePVReconstructor::AddPV(const KFVertex &pv, const vector<int> &tracks)
+void KFParticlePVReconstructor::CalculateClusterTime(const vector<int>& tracks, float& time, float& timeError) const
+{
+  /** Calculates the time of a cluster as the mean time of the tracks weighted with the inverse squared errors.
+   ** Tracks with the negative error of the time are not used. Tracks with the zero error have exact time and 
+   ** an infinite weight: if the cluster contains such tracks, the time is their mean time with the zero error
+   ** and other tracks are not used. If no track has defined time the negative error is returned.
+   ** \param[in] tracks - indices of the tracks of the cluster
+   ** \param[out] time - time of the cluster
+   ** \param[out] timeError - error of the time of the cluster
+   **/
+  time = 0.f;
+  timeError = -1.f;
+  
+  float sumWeight = 0.f;
+  float sumTime = 0.f;
+  float sumExactTime = 0.f;
+  int nTracksWithExactTime = 0;
+  for(unsigned int iTr=0; iTr<tracks.size(); iTr++)
+  {
+    const int iTrack = tracks[iTr];
+    if(fTimeError[iTrack] < 0.f) continue;
+    if(fTimeError[iTrack] > 0.f)
+    {
+      const float weight = 1.f/(fTimeError[iTrack]*fTimeError[iTrack]);
+      sumWeight += weight;
+      sumTime += weight*fTime[iTrack];
+    }
+    else
+    {
+      sumExactTime += fTime[iTrack];
+      nTracksWithExactTime++;
+    }
+  }
+  
+  if(nTracksWithExactTime > 0)
+  {
+    time = sumExactTime/float(nTracksWithExactTime);
+    timeError = 0.f;
+  }
+  else if(sumWeight > 0.f)
+  {
+    time = sumTime/sumWeight;
+    timeError = 1.f/sqrt(sumWeight);
+  }
+}
+
+void KFParticlePVReconstructor::AddPV(const KFVertex &pv, const vector<int> &tracks, float time, float timeError)
 { 
   fPrimVertices.push_back(pv);
+  fPrimVertexTime.push_back(time);
+  fPrimVertexTimeError.push_back(timeError);
   KFParticleCluster cluster;
   cluster.fTracks = tracks;
   fClusters.push_back(cluster);
 }
 
-void KFParticlePVReconstructor::AddPV(const KFVertex &pv)
+void KFParticlePVReconstructor::AddPV(const KFVertex &pv, float time, float timeError)
 {
   fPrimVertices.push_back(pv);
+  fPrimVertexTime.push_back(time);
+  fPrimVertexTimeError.push_back(timeError);
   KFParticleCluster cluster;
   fClusters.push_back(cluster);
 }
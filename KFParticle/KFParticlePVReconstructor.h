@@ -45,7 +45,8 @@ class KFPTrackVector;
 
 class KFParticlePVReconstructor{
  public:
-  KFParticlePVReconstructor():fParticles(0), fNParticles(0), fWeight(0.f), fBeamLine(), fIsBeamLine(0), fClusters(0), fPrimVertices(0), fChi2CutPreparation(100), fChi2Cut(16) {};
+  KFParticlePVReconstructor():fParticles(0), fNParticles(0), fWeight(0.f), fBeamLine(), fIsBeamLine(0), fClusters(0), fPrimVertices(0), fPrimVertexTime(0), fPrimVertexTimeError(0), fChi2CutPreparation(100), fChi2Cut(16),
+                               fTime(0), fTimeError(0), fTimeNSigmaCut(0.f) {};
   virtual ~KFParticlePVReconstructor(){};
   
   void Init(KFPTrackVector *tracks, int nParticles);
@@ -55,6 +56,9 @@ class KFParticlePVReconstructor{
   int NPrimaryVertices() const { return fPrimVertices.size(); } ///< Returns number of the found candidates for the primary vertex.
   KFParticle &GetPrimVertex(int iPV=0)   { return fPrimVertices[iPV]; } ///< Returns primary vertex candidate in KFParticle with index "iPV".
   KFVertex   &GetPrimKFVertex(int iPV=0)   { return fPrimVertices[iPV]; } ///< Returns primary vertex candidate in KFVertex with index "iPV".
+  float GetPrimVertexTime(int iPV=0) const { return fPrimVertexTime[iPV]; } ///< Returns time of the primary vertex candidate with index "iPV".
+  /** Returns error of the time of the primary vertex candidate with index "iPV", negative value means that the time is not defined. */
+  float GetPrimVertexTimeError(int iPV=0) const { return fPrimVertexTimeError[iPV]; }
   std::vector<int>& GetPVTrackIndexArray(int iPV=0) { return fClusters[iPV].fTracks; } ///< Returns vector with track indices from a cluster with index "iPV".
   KFParticle &GetParticle(int i){ assert( i < fNParticles ); return fParticles[i]; } ///< Returns input particle with index "i".
   
@@ -65,17 +69,27 @@ class KFParticlePVReconstructor{
    ** tracks from this vertex.
    ** \param[in] pv - external primary vertex
    ** \param[in] tracks - vector with indices of tracks associated with the provided primary vertex.
+   ** \param[in] time - time of the vertex
+   ** \param[in] timeError - error of the time of the vertex, negative value means that the time is not defined
    **/
-  void AddPV(const KFVertex &pv, const std::vector<int> &tracks);
+  void AddPV(const KFVertex &pv, const std::vector<int> &tracks, float time = 0.f, float timeError = -1.f);
   /** Adds externally found primary vertex to the list.
    ** \param[in] pv - external primary vertex
+   ** \param[in] time - time of the vertex
+   ** \param[in] timeError - error of the time of the vertex, negative value means that the time is not defined
    **/
-  void AddPV(const KFVertex &pv);
-  void CleanPV() { fClusters.clear(); fPrimVertices.clear(); } ///< Clean vectors with primary vertex candidates and corresponding clusters.
+  void AddPV(const KFVertex &pv, float time = 0.f, float timeError = -1.f);
+  /** Clean vectors with primary vertex candidates and corresponding clusters. */
+  void CleanPV() { fClusters.clear(); fPrimVertices.clear(); fPrimVertexTime.clear(); fPrimVertexTimeError.clear(); }
 
   /** \brief Sets cut fChi2Cut on chi2-deviation of primary tracks from the vertex candidate to "chi2"
    ** and a soft preparation cut fChi2CutPreparation to "10*chi2". */
   void SetChi2PrimaryCut(float chi2) { fChi2Cut = chi2; fChi2CutPreparation = chi2*5; }
+  /** Sets the cut on the time compatibility of tracks in a cluster in units of the error of the time difference. Tracks from different
+   ** collisions of the continuous readout are separated by time, so the clusters are effectively searched in (z, t).
+   ** "0" switches the cut off, which is the default. Tracks with the negative error of the time are compatible with any time. */
+  void SetTimeCompatibilityCut(float nSigma) { fTimeNSigmaCut = nSigma; }
+  float GetTimeCompatibilityCut() const { return fTimeNSigmaCut; } ///< Returns the cut on the time compatibility of tracks in a cluster.
   
   void SetTargetPosition(const std::array<float, 3> &target)
   {
@@ -87,6 +101,20 @@ class KFParticlePVReconstructor{
   KFParticlePVReconstructor(KFParticlePVReconstructor &); ///< Is not defined. Deny copying of the objects of this class.
 
   void FindPrimaryClusters( int cutNDF = 1);
+  void CalculateClusterTime(const std::vector<int>& tracks, float& time, float& timeError) const;
+  
+  bool IsTimeCompatible(const int iTr, const float time, const float timeError) const
+  {
+    /** Checks if the time of the track "iTr" is compatible with the provided time within KFParticlePVReconstructor::fTimeNSigmaCut.
+     ** \param[in] iTr - index of the input track
+     ** \param[in] time - time to be compared with
+     ** \param[in] timeError - error of the time, if negative the time is not defined and the track is compatible
+     **/
+    if(fTimeNSigmaCut <= 0.f) return true;
+    if(fTimeError[iTr] < 0.f || timeError < 0.f) return true;
+    const float dt = fTime[iTr] - time;
+    return dt*dt <= fTimeNSigmaCut*fTimeNSigmaCut*(fTimeError[iTr]*fTimeError[iTr] + timeError*timeError);
+  }
 
   std::vector<KFParticle> fParticles; ///< Array of the input particles constructed from tracks.
   int fNParticles;                    ///< Number of the input particles.
@@ -114,9 +142,15 @@ class KFParticlePVReconstructor{
 
   std::vector< KFParticleCluster > fClusters; ///< Vector with clusters to be used for fit of a primary vertex.
   std::vector<KFVertex> fPrimVertices;  ///< Vector with reconstructed candidates for a primary vertex.
+  std::vector<float> fPrimVertexTime;      ///< Time of the primary vertex candidates.
+  std::vector<float> fPrimVertexTimeError; ///< Error of the time of the primary vertex candidates, negative if the time is not defined.
   
   float fChi2CutPreparation; ///< A soft cut on the chi2-deviation which is used to form a cluster.
   float fChi2Cut;            ///< Cut on the chi2-deviation of the tracks to the primary vertex \see KFVertex::ConstructPrimaryVertex(), where it is used.
+  
+  std::vector<float> fTime;      ///< Time of the input particles.
+  std::vector<float> fTimeError; ///< Error of the time of the input particles.
+  float fTimeNSigmaCut;          ///< Cut on the time compatibility of the tracks in a cluster, "0" switches the cut off.
 }; // class KFParticlePVReconstructor
 
 
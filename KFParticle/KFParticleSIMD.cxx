@@ -23,6 +23,7 @@
 
 #include "KFParticleSIMD.h"
 #include "KFParticle.h"
+#include "KFPParticleVector.h"
 #include "KFParticleDatabase.h"
 
 #ifdef HomogeneousField
@@ -569,6 +570,36 @@ KFParticleSIMD::KFParticleSIMD(KFParticle* parts[], const int nPart): KFParticle
   }
 }
 
+void KFParticleSIMD::Load(const KFPParticleVector& particles, int index)
+{
+  /** Loads a set of consequetive candidates stored in the KFPParticleVector format starting from the index "index".
+   ** The index should be a multiple of the SIMD vector length, the vectors of the input set should be padded to
+   ** the multiple of the SIMD vector length. All daughter vectors of the set are loaded, unused daughter indices are "-1".
+   ** \param[in] particles - an array with candidates in the KFPParticleVector format
+   ** \param[in] index - index of the first candidate
+   **/
+  
+  for(int i=0; i<8; i++)
+    fP[i] = reinterpret_cast<const float_v&>(particles.Parameter(i)[index]);
+  for(int i=0; i<36; i++)
+    fC[i] = reinterpret_cast<const float_v&>(particles.Covariance(i)[index]);
+#ifdef NonhomogeneousField
+  for(int i=0; i<10; i++)
+    fField.fField[i] = reinterpret_cast<const float_v&>(particles.FieldCoefficient(i)[index]);
+#endif
+
+  fId   = reinterpret_cast<const int_v&>(particles.Id()[index]);
+  fPDG  = reinterpret_cast<const int_v&>(particles.PDG()[index]);
+  fQ    = reinterpret_cast<const int_v&>(particles.Q()[index]);
+  fNDF  = reinterpret_cast<const int_v&>(particles.NDF()[index]);
+  fChi2 = reinterpret_cast<const float_v&>(particles.Chi2()[index]);
+  fAtProductionVertex = particles.AtProductionVertex()[index];
+
+  fDaughterIds.resize(particles.NDaughterVectors());
+  for(int iD=0; iD<particles.NDaughterVectors(); iD++)
+    fDaughterIds[iD] = reinterpret_cast<const int_v&>(particles.DaughterIds(iD)[index]);
+}
+
 KFParticleSIMD::KFParticleSIMD( KFParticle &part): KFParticleBaseSIMD()
 #ifdef NonhomogeneousField
 , fField()
@@ -1044,3 +1075,97 @@ void KFParticleSIMD::GetKFParticle(KFParticle* Part, int nPart)
   for(int i=0; i<nPart; i++)
     GetKFParticle(Part[i],i);
 }
+
+int KFParticleSIMD::GetKFParticles(std::vector<KFParticle>& Particles, const float_m& mask)
+{
+  /** Appends all elements of the current vectorised particle selected by "mask" to the end of the array of scalar
+   ** KFParticle objects. The array is resized once for all selected elements, the elements are written directly
+   ** to the new particles. Returns the number of added particles.
+   ** \param[out] Particles - an output array of scalar particles
+   ** \param[in] mask - mask of the elements to be copied
+   **/
+  const int nActive = mask.count();
+  if(nActive == 0) return 0;
+
+  unsigned int iPart = Particles.size();
+  Particles.resize(iPart + nActive);
+
+  const int nDaughters = fDaughterIds.size();
+  for(int iV=0; iV<float_vLen; iV++)
+  {
+    if(!mask[iV]) continue;
+
+    KFParticle& Part = Particles[iPart++];
+    Part.SetId(static_cast<int>(fId[iV]));
+    Part.CleanDaughtersId();
+    for(int iD=0; iD<nDaughters; iD++)
+      Part.AddDaughterId(static_cast<int>(fDaughterIds[iD][iV]));
+    Part.SetPDG(static_cast<int>(fPDG[iV]));
+
+    float* partParameters = Part.Parameters();
+    for(int iP=0; iP<8; iP++)
+      partParameters[iP] = fP[iP][iV];
+    float* partCovariance = Part.CovarianceMatrix();
+    for(int iC=0; iC<36; iC++)
+      partCovariance[iC] = fC[iC][iV];
+
+    Part.NDF() = static_cast<int>(fNDF[iV]);
+    Part.Chi2() = fChi2[iV];
+    Part.Q() = fQ[iV];
+    Part.SetAtProductionVertex(fAtProductionVertex);
+#ifdef NonhomogeneousField
+    for(int iF=0; iF<10; iF++)
+      Part.SetFieldCoeff(fField.fField[iF][iV], iF);
+#endif
+  }
+  return nActive;
+}
+
+int KFParticleSIMD::GetKFParticles(KFPParticleVector& Particles, const float_m& mask)
+{
+  /** Appends all elements of the current vectorised particle selected by "mask" to the end of the columns of
+   ** KFPParticleVector. The positions of the selected elements in the output are calculated once, then each
+   ** parameter is written with one masked scatter of the SIMD vector, so that the selected elements are stored 
+   ** contiguously. Returns the number of added particles.
+   ** \param[out] Particles - an output vector of particles
+   ** \param[in] mask - mask of the elements to be copied
+   **/
+  const int nActive = mask.count();
+  if(nActive == 0) return 0;
+
+  const int offset = Particles.Size();
+  const int nDaughters = fDaughterIds.size();
+  Particles.SetNDaughterVectors(nDaughters);
+  Particles.Resize(offset + nActive);
+
+  // compressed positions of the selected elements
+  uint_v index(Vc::Zero);
+  int nStored = 0;
+  for(int iV=0; iV<float_vLen; iV++)
+  {
+    if(!mask[iV]) continue;
+    index[iV] = offset + nStored;
+    nStored++;
+  }
+  const int_m& maskInt = simd_cast<int_m>(mask);
+
+  for(int iP=0; iP<8; iP++)
+    Particles.SetParameter(fP[iP], iP, index, mask);
+  for(int iC=0; iC<36; iC++)
+    Particles.SetCovariance(fC[iC], iC, index, mask);
+#ifdef NonhomogeneousField
+  for(int iF=0; iF<10; iF++)
+    Particles.SetFieldCoefficient(fField.fField[iF], iF, index, mask);
+#endif
+  Particles.SetId(fId, index, maskInt);
+  Particles.SetPDG(fPDG, index, maskInt);
+  Particles.SetQ(fQ, index, maskInt);
+  Particles.SetNDF(fNDF, index, maskInt);
+  Particles.SetChi2(fChi2, index, mask);
+  Particles.SetAtProductionVertex(int_v(int(fAtProductionVertex)), index, maskInt);
+  Particles.SetNDaughters(int_v(nDaughters), index, maskInt);
+  for(int iD=0; iD<nDaughters; iD++)
+    Particles.SetDaughterId(fDaughterIds[iD], iD, index, maskInt);
+
+  return nActive;
+}
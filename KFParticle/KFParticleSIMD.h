@@ -38,6 +38,7 @@
 #endif
 
 class KFParticle;
+class KFPParticleVector;
 
 /** @class KFParticleSIMD
  ** @brief The main vectorised class of KF Particle pacakge, describes particle objects.
@@ -132,6 +133,7 @@ class KFParticleSIMD :public KFParticleBaseSIMD
   KFParticleSIMD( const KFPVertex &vertex );
   KFParticleSIMD( KFParticle* part[], const int nPart = 0 );
   KFParticleSIMD( KFParticle &part );
+  void Load( const KFPParticleVector& particles, int index );
 
   //*
   //*  ACCESSORS
@@ -243,6 +245,8 @@ class KFParticleSIMD :public KFParticleBaseSIMD
 
   void GetKFParticle( KFParticle &Part, int iPart = 0);
   void GetKFParticle( KFParticle *Part, int nPart = 0);
+  int GetKFParticles( std::vector<KFParticle>& Particles, const float_m& mask );
+  int GetKFParticles( KFPParticleVector& Particles, const float_m& mask );
 
   //* 
   //* CONSTRUCTION OF THE PARTICLE BY ITS DAUGHTERS AND MOTHER
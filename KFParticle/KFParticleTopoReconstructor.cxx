@@ -31,6 +31,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 #include "string"
 using std::string;
 using std::ofstream;
@@ -213,6 +214,7 @@ void KFParticleTopoReconstructor::Init(AliHLTTPCCAGBTracker* tracker, vector<int
         fTracks[arrayIndex].SetPDG(trackPDG, iOTr);
         fTracks[arrayIndex].SetQ(q, iOTr);
         fTracks[arrayIndex].SetPVIndex(-1, iOTr);
+        fTracks[arrayIndex].SetPIDMask(0, iOTr);
       }
     }
     if (!ok) continue;
@@ -260,6 +262,8 @@ void KFParticleTopoReconstructor::Init(vector<KFParticle> &particles, vector<int
   
   fParticles.clear();
   fPV.clear(); 
+  fPVTime.clear();
+  fPVTimeError.clear();
 
   int nTracks = particles.size();
   fTracks[0].Resize(nTracks);
@@ -291,6 +295,9 @@ void KFParticleTopoReconstructor::Init(vector<KFParticle> &particles, vector<int
     fTracks[0].SetQ(particles[iTr].Q(), iTr);
     fTracks[0].SetPVIndex(-1, iTr);
     fTracks[0].SetNPixelHits(npixelhits,iTr);
+    fTracks[0].SetPIDMask(0, iTr);
+    fTracks[0].SetT(0.f, iTr);
+    fTracks[0].SetTErr(-1.f, iTr);
   }
 
   fKFParticlePVReconstructor->Init( &fTracks[0], nTracks );
@@ -312,6 +319,8 @@ void KFParticleTopoReconstructor::Init(KFPTrackVector &tracks, KFPTrackVector &t
   
   fParticles.clear();
   fPV.clear(); 
+  fPVTime.clear();
+  fPVTimeError.clear();
   
   int nTracks = tracks.Size();
   fTracks[0].Resize(nTracks);
@@ -319,8 +328,14 @@ void KFParticleTopoReconstructor::Init(KFPTrackVector &tracks, KFPTrackVector &t
   fTracks[1].Resize(0);
   fTracks[2].Resize(0);
   fTracks[3].Resize(0);
-  fTracks[4].Resize(tracksAtLastPoint.Size());
-  fTracks[4].Set(tracksAtLastPoint, tracksAtLastPoint.Size(), 0);
+  // the tracks at the last hit are used only by the missing mass method, they are not copied if it is not run
+  if(fKFParticleFinder->IsLastHitTracksNeeded())
+  {
+    fTracks[4].Resize(tracksAtLastPoint.Size());
+    fTracks[4].Set(tracksAtLastPoint, tracksAtLastPoint.Size(), 0);
+  }
+  else
+    fTracks[4].Resize(0);
   fTracks[5].Resize(0);
   fTracks[6].Resize(0);
   fTracks[7].Resize(0);
@@ -339,6 +354,8 @@ void KFParticleTopoReconstructor::Init(const KFPTrackVector *particles, const ve
 #endif // USE_TIMERS
   fParticles.clear();
   fPV.clear(); 
+  fPVTime.clear();
+  fPVTimeError.clear();
 
   fTracks = const_cast< KFPTrackVector* >(particles);
   fChiToPrimVtx[0].resize(fTracks[0].Size());
@@ -347,6 +364,8 @@ void KFParticleTopoReconstructor::Init(const KFPTrackVector *particles, const ve
 
   for(unsigned int iPV=0; iPV<fPV.size(); iPV++)
     fPV[iPV] = KFParticleSIMD(const_cast<KFParticle&>(pv[iPV]));
+  fPVTime.assign(pv.size(), 0.f);
+  fPVTimeError.assign(pv.size(), -1.f);
 
 #ifdef USE_TIMERS
   timer.Stop();
@@ -365,6 +384,8 @@ void KFParticleTopoReconstructor::ReconstructPrimVertex(bool isHeavySystem)
   fKFParticlePVReconstructor->ReconstructPrimVertex();
   
   fPV.clear(); 
+  fPVTime.clear();
+  fPVTimeError.clear();
 
   int nPrimVtx = NPrimaryVertices();
   int nPV = 0;
@@ -384,12 +405,18 @@ void KFParticleTopoReconstructor::ReconstructPrimVertex(bool isHeavySystem)
     nPrimVtx = 1;
     fPV.resize(nPrimVtx);
     fPV[0] = GetPrimVertex(nPV);
+    fPVTime.push_back(fKFParticlePVReconstructor->GetPrimVertexTime(nPV));
+    fPVTimeError.push_back(fKFParticlePVReconstructor->GetPrimVertexTimeError(nPV));
   }
   else
   {
     fPV.resize(nPrimVtx);
     for(int iPV=0; iPV<nPrimVtx; iPV++)
+    {
       fPV[iPV] = GetPrimVertex(iPV);
+      fPVTime.push_back(fKFParticlePVReconstructor->GetPrimVertexTime(iPV));
+      fPVTimeError.push_back(fKFParticlePVReconstructor->GetPrimVertexTimeError(iPV));
+    }
   }
   
   for(int iPV=0; iPV<NPrimaryVertices(); iPV++)
@@ -412,7 +439,7 @@ void KFParticleTopoReconstructor::ReconstructPrimVertex(bool isHeavySystem)
     vector<int> pvTracks = fKFParticlePVReconstructor->GetPVTrackIndexArray(nPV);
     KFVertex pv = fKFParticlePVReconstructor->GetPrimKFVertex(nPV);
     fKFParticlePVReconstructor->CleanPV();
-    fKFParticlePVReconstructor->AddPV(pv, pvTracks);
+    fKFParticlePVReconstructor->AddPV(pv, pvTracks, fPVTime[0], fPVTimeError[0]);
   }
   
 #ifdef USE_TIMERS
@@ -436,6 +463,8 @@ void KFParticleTopoReconstructor::SortTracks()
    ** 7) primary negative at the last hit position. \n
    ** In each group they are sorted according to PDG: electrons, muons, pions, 
    ** tracks without PID, kaons, protons, deuterons, tritons, He3, He4.
+   ** The permutation is calculated once from the tracks at the first hit position and is applied also to the
+   ** tracks at the last hit position, if they were stored by KFParticleTopoReconstructor::Init().
    **/
 #ifdef USE_TIMERS
   timer.Start();
@@ -447,59 +476,59 @@ void KFParticleTopoReconstructor::SortTracks()
   if(fTracks[4].Size() == 0)
     nSets = 1;
   
-  for(int iSet=nSets-1; iSet>=0; iSet--)
+  // the permutation is defined by the tracks at the first hit and is applied to both sets
+  int Size = fTracks[0].Size();
+  
+  vector<KFPTrackIndex> sortedTracks(Size);
+  kfvector_uint trackIndex[4];
+  for(int iTV=0; iTV<4; iTV++)
+    trackIndex[iTV].resize(Size);
+  int nTracks[4] = {0,0,0,0};
+  
+  for(int iTr=0; iTr<Size; iTr++)
   {
-    int Size = fTracks[0].Size();
-    
-    vector<KFPTrackIndex> sortedTracks(Size);
-    kfvector_uint trackIndex[4];
-    for(int iTV=0; iTV<4; iTV++)
-      trackIndex[iTV].resize(Size);
-    int nTracks[4] = {0,0,0,0};
+    sortedTracks[iTr].fIndex = iTr;
+    sortedTracks[iTr].fPdg = fTracks[0].PDG()[iTr];
+  }
+  
+  std::sort(sortedTracks.begin(), sortedTracks.end(), KFPTrackIndex::Compare);
+  
+  for(int iTr=0; iTr<Size; iTr++)
+  {
+    int iTrSorted = sortedTracks[iTr].fIndex;
     
-    for(int iTr=0; iTr<Size; iTr++)
+    int q = fTracks[0].Q()[iTrSorted]; //take the charge at the first point to avoid ambiguities in array size
+    if(fTracks[0].PVIndex()[iTrSorted] < 0) //secondary track
     {
-      sortedTracks[iTr].fIndex = iTr;
-      sortedTracks[iTr].fPdg = fTracks[0].PDG()[iTr];
+
+      if(q<0) //secondary negative track
+      {
+        trackIndex[1][nTracks[1]] = iTrSorted;
+        nTracks[1]++;
+      }
+      else //secondary positive track
+      {
+        trackIndex[0][nTracks[0]] = iTrSorted;
+        nTracks[0]++;
+      }
     }
-    
-    std::sort(sortedTracks.begin(), sortedTracks.end(), KFPTrackIndex::Compare);
-    
-    for(int iTr=0; iTr<Size; iTr++)
+    else //primary track
     {
-      int iTrSorted = sortedTracks[iTr].fIndex;
-      
-      //int q = fTracks[offset[iSet]].Q()[iTrSorted];
-      int q = fTracks[0].Q()[iTrSorted]; //take the charge at the first point to avoid ambiguities in array size
-      if(fTracks[0].PVIndex()[iTrSorted] < 0) //secondary track
+      if(q<0) //primary negative track
       {
-
-        if(q<0) //secondary negative track
-        {
-          trackIndex[1][nTracks[1]] = iTrSorted;
-          nTracks[1]++;
-        }
-        else //secondary positive track
-        {
-          trackIndex[0][nTracks[0]] = iTrSorted;
-          nTracks[0]++;
-        }
+        trackIndex[3][nTracks[3]] = iTrSorted;
+        nTracks[3]++;
       }
-      else //primary track
+      else //primary positive track
       {
-        if(q<0) //primary negative track
-        {
-          trackIndex[3][nTracks[3]] = iTrSorted;
-          nTracks[3]++;
-        }
-        else //primary positive track
-        {
-          trackIndex[2][nTracks[2]] = iTrSorted;
-          nTracks[2]++;
-        }
+        trackIndex[2][nTracks[2]] = iTrSorted;
+        nTracks[2]++;
       }
     }
-    
+  }
+  
+  for(int iSet=nSets-1; iSet>=0; iSet--)
+  {
     for(int iTV=1; iTV<4; iTV++)  
       fTracks[iTV+offset[iSet]].SetTracks(fTracks[offset[iSet]], trackIndex[iTV], nTracks[iTV]);
       
@@ -510,27 +539,24 @@ void KFParticleTopoReconstructor::SortTracks()
       
     for(int iTV=0; iTV<4; iTV++)
       fTracks[iTV+offset[iSet]].RecalculateLastIndex();
-    
-    //correct index of tracks in primary clusters with respect to the sorted array 
-    if(iSet == 0)
+  }
+  
+  //correct index of tracks in primary clusters with respect to the sorted array 
+  vector<int> newIndex(Size);
+  int iCurrentTrack=0;
+  for(int iTC=0; iTC<4; iTC++)
+  {
+    for(int iTrackIndex=0; iTrackIndex<fTracks[iTC].Size(); iTrackIndex++)
     {
-      vector<int> newIndex(Size);
-      int iCurrentTrack=0;
-      for(int iTC=0; iTC<4; iTC++)
-      {
-        for(int iTrackIndex=0; iTrackIndex<fTracks[iTC].Size(); iTrackIndex++)
-        {
-          newIndex[trackIndex[iTC][iTrackIndex]] = iCurrentTrack;
-          iCurrentTrack++;
-        }
-      }
-      
-      for(int iPV=0; iPV<NPrimaryVertices(); iPV++)
-        for(unsigned int iTrack=0; iTrack<GetPVTrackIndexArray(iPV).size(); iTrack++)
-          fKFParticlePVReconstructor->GetPVTrackIndexArray(iPV)[iTrack] = newIndex[GetPVTrackIndexArray(iPV)[iTrack]];
+      newIndex[trackIndex[iTC][iTrackIndex]] = iCurrentTrack;
+      iCurrentTrack++;
     }
   }
   
+  for(int iPV=0; iPV<NPrimaryVertices(); iPV++)
+    for(unsigned int iTrack=0; iTrack<GetPVTrackIndexArray(iPV).size(); iTrack++)
+      fKFParticlePVReconstructor->GetPVTrackIndexArray(iPV)[iTrack] = newIndex[GetPVTrackIndexArray(iPV)[iTrack]];
+  
   fChiToPrimVtx[0].resize(fTracks[0].Size(), -1);
   fChiToPrimVtx[1].resize(fTracks[1].Size(), -1);
   
@@ -582,7 +608,9 @@ void KFParticleTopoReconstructor::TransportPVTracksToPrimVertex()
 void KFParticleTopoReconstructor::GetChiToPrimVertex(KFParticleSIMD* pv, const int nPV)
 { 
   /** Calculates the chi2-deviation from the primary vertex. If several primary vertices
-   ** are found the minimum value is stored.
+   ** are found the minimum value is stored. If KFParticleTopoReconstructor::fTimeNSigmaCut
+   ** is set, only primary vertices compatible with the track in time are considered, 
+   ** the track is not extrapolated to other vertices.
    ** \param[in] pv - pointer to the array with primary vertices
    ** \param[in] nPV - number of the primary vertices in the array
    **/
@@ -599,13 +627,25 @@ void KFParticleTopoReconstructor::GetChiToPrimVertex(KFParticleSIMD* pv, const i
       
       float_v& chi2 = reinterpret_cast<float_v&>(fChiToPrimVtx[iTV][iTr]);
       chi2(simd_cast<float_m>(trackIndex<NTr)) = 10000.f;
+      
+      const float_v& trackTime = reinterpret_cast<const float_v&>(fTracks[iTV].T()[iTr]);
+      const float_v& trackTimeError = reinterpret_cast<const float_v&>(fTracks[iTV].TErr()[iTr]);
 
       for(int iPV=0; iPV<nPV; iPV++)
       {
+        float_m isCompatible = simd_cast<float_m>(trackIndex<NTr);
+        if(fTimeNSigmaCut > 0.f && iPV < int(fPVTime.size()) && fPVTimeError[iPV] >= 0.f)
+        {
+          const float_v dt = trackTime - fPVTime[iPV];
+          isCompatible &= (trackTimeError < 0.f) || 
+            (dt*dt <= fTimeNSigmaCut*fTimeNSigmaCut*(trackTimeError*trackTimeError + fPVTimeError[iPV]*fPVTimeError[iPV]));
+          if(isCompatible.isEmpty()) continue;
+        }
+        
         const float_v point[3] = {pv[iPV].X(), pv[iPV].Y(), pv[iPV].Z()};
         tmpPart.TransportToPoint(point);
         const float_v& chiVec = tmpPart.GetDeviationFromVertex(pv[iPV]);
-        chi2( (chi2>chiVec) && simd_cast<float_m>(trackIndex<NTr) ) = chiVec;
+        chi2( (chi2>chiVec) && isCompatible ) = chiVec;
       }
     } 
   }
@@ -1020,12 +1060,21 @@ void KFParticleTopoReconstructor::ReconstructParticles()
    ** corresponding primary vertices for better precision,
    ** chi2-deviation of the secondary tracks to the primary vertex is 
    ** calculated, and than KFParticleFinder is run. Optionally cleanup of
-   ** the output array of particle candidates can be run.
+   ** the output array of particle candidates can be run. If the latency budget is set, 
+   ** it is counted from the start of the function.
    **/
 #ifdef USE_TIMERS
   timer.Start();
 #endif // USE_TIMERS
 
+  if(fLatencyBudget > 0.)
+  {
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    fKFParticleFinder->SetDeadline(startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(fLatencyBudget)));
+  }
+  else
+    fKFParticleFinder->ResetDeadline();
+
   fParticles.clear();
 
   if(fPV.size() < 1) return;
@@ -1050,6 +1099,279 @@ void KFParticleTopoReconstructor::ReconstructParticles()
 #endif // USE_TIMERS
 } // void KFParticleTopoReconstructor::ReconstructPrimVertex
 
+/** @class TrackTimeInfo
+ ** @brief Helper structure to sort tracks of the time frame according to their time.
+ ** @author  I.Kisel, M.Zyzak
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** The structure contains index of the track in the time frame and its time. Is used
+ ** in KFParticleTopoReconstructor::ProcessTimeFrame() to divide the time frame into slices.
+ **/
+struct TrackTimeInfo
+{
+  TrackTimeInfo():fIndex(-1),fTime(0.f) {};
+  /** \brief Constructor with all parameters initialised by user. */
+  TrackTimeInfo(int index, float time):fIndex(index),fTime(time) {};
+  
+  /** \brief Sorting function, returns true if the time of "a" is smaller then of "b". */
+  static bool Compare(const TrackTimeInfo& a, const TrackTimeInfo& b) { return (a.fTime < b.fTime); }
+  
+  int   fIndex; ///< Index of the track in the time frame.
+  float fTime;  ///< Time of the track.
+};
+
+void KFParticleTopoReconstructor::ProcessTimeFrame(const KFPTrackVector& tracks, const KFPTrackVector& tracksAtLastPoint)
+{
+  /** Reconstructs a time frame of the continuous readout, which contains tracks from many overlapping collisions.
+   ** Tracks should be provided with the time and its error, see KFPTrackVector::T() and KFPTrackVector::TErr(): \n
+   ** 1) tracks are sorted according to their time; \n
+   ** 2) the time frame is divided into slices of KFParticleTopoReconstructor::fTimeFrameSliceLength, each slice
+   ** is extended on both sides by KFParticleTopoReconstructor::fTimeFrameSliceOverlap; \n
+   ** 3) tracks of the extended slice are reconstructed as one event, if KFParticleTopoReconstructor::fTimeNSigmaCut
+   ** is set primary vertices are searched in (z, t), tracks are associated with primary vertices and are paired only
+   ** if they are compatible in time; \n
+   ** 4) primary vertices and particles with the time inside the slice itself are stored by
+   ** KFParticleTopoReconstructor::StoreTimeFrameSlice(), particles found in several slices are stored once. \n
+   ** Collisions at the slice boundaries are fully contained in the extended slice, while the combinatorics grows with the 
+   ** length of the time frame linearly. After reconstruction the particles and primary vertices of the whole time frame are
+   ** available with the usual getters. As for a single event, the output starts with the particles created from the tracks:
+   ** the particle with the index "i" corresponds to the track with the index "i" in the input vector "tracks", the reconstructed
+   ** short-lived particles follow them. Indices of tracks in the clusters of primary vertices correspond to the positions of
+   ** tracks in the input vector "tracks". The arrays with tracks KFParticleTopoReconstructor::fTracks contain the last slice.
+   ** \param[in] tracks - tracks of the time frame at the first hit position
+   ** \param[in] tracksAtLastPoint - tracks of the time frame at the last hit position, if the size differs from the size
+   ** of "tracks" the last hit position is not used
+   **/
+  fNTimeFrameSlices = 0;
+  
+  // the first entries are reserved for the tracks of the time frame, they are filled from the slice, where the track is found
+  vector<KFParticle> frameParticles(tracks.Size());
+  std::map<vector<int>, int> particleKeys;
+  vector<KFVertex> framePV;
+  vector< vector<int> > framePVTracks;
+  vector<float> framePVTime;
+  vector<float> framePVTimeError;
+  
+  const int nTracks = tracks.Size();
+  const bool useLastPoint = (tracksAtLastPoint.Size() == nTracks) && fKFParticleFinder->IsLastHitTracksNeeded();
+  
+  vector<TrackTimeInfo> sortedTracks(nTracks);
+  for(int iTr=0; iTr<nTracks; iTr++)
+    sortedTracks[iTr] = TrackTimeInfo(iTr, tracks.T()[iTr]);
+  std::sort(sortedTracks.begin(), sortedTracks.end(), TrackTimeInfo::Compare);
+  
+  float coreBegin = (nTracks > 0) ? sortedTracks[0].fTime : 0.f;
+  int firstTrack = 0;
+  int firstCoreTrack = 0;
+  
+  while(firstCoreTrack < nTracks)
+  {
+    const float coreEnd = coreBegin + fTimeFrameSliceLength;
+    const bool isLastSlice = (fTimeFrameSliceLength <= 0.f) || (sortedTracks[nTracks-1].fTime < coreEnd);
+    
+    // tracks are sorted, so the borders of the slices are only moved forward
+    while(firstTrack < nTracks && sortedTracks[firstTrack].fTime < coreBegin - fTimeFrameSliceOverlap)
+      firstTrack++;
+    int lastCoreTrack = firstCoreTrack;
+    while(lastCoreTrack < nTracks && (isLastSlice || sortedTracks[lastCoreTrack].fTime < coreEnd))
+      lastCoreTrack++;
+    int lastTrack = lastCoreTrack;
+    while(lastTrack < nTracks && sortedTracks[lastTrack].fTime < coreEnd + fTimeFrameSliceOverlap)
+      lastTrack++;
+    
+    if(lastCoreTrack > firstCoreTrack)
+    {
+      const int nSliceTracks = lastTrack - firstTrack;
+      kfvector_uint trackIndex(nSliceTracks + float_vLen, 0);
+      for(int iTr=0; iTr<nSliceTracks; iTr++)
+        trackIndex[iTr] = sortedTracks[firstTrack + iTr].fIndex;
+      
+      KFPTrackVector sliceTracks, sliceTracksAtLastPoint;
+      sliceTracks.SetTracks(tracks, trackIndex, nSliceTracks);
+      if(useLastPoint)
+        sliceTracksAtLastPoint.SetTracks(tracksAtLastPoint, trackIndex, nSliceTracks);
+      // Id of the track is replaced with its position in the time frame to identify it in the overlapping slices
+      for(int iTr=0; iTr<nSliceTracks; iTr++)
+      {
+        sliceTracks.SetId(trackIndex[iTr], iTr);
+        sliceTracks.SetPVIndex(-1, iTr);
+        if(useLastPoint)
+        {
+          sliceTracksAtLastPoint.SetId(trackIndex[iTr], iTr);
+          sliceTracksAtLastPoint.SetPVIndex(-1, iTr);
+        }
+      }
+      
+      Init(sliceTracks, sliceTracksAtLastPoint);
+      ReconstructPrimVertex(false);
+      SortTracks();
+      ReconstructParticles();
+      StoreTimeFrameSlice(tracks, coreBegin, coreEnd, isLastSlice, frameParticles, particleKeys,
+                          framePV, framePVTracks, framePVTime, framePVTimeError);
+      fNTimeFrameSlices++;
+    }
+    
+    firstCoreTrack = lastCoreTrack;
+    coreBegin = coreEnd;
+  }
+  
+  Clear();
+  fParticles.swap(frameParticles);
+  for(unsigned int iPV=0; iPV<framePV.size(); iPV++)
+    AddPV(framePV[iPV], framePVTracks[iPV], framePVTime[iPV], framePVTimeError[iPV]);
+} // void KFParticleTopoReconstructor::ProcessTimeFrame
+
+void KFParticleTopoReconstructor::StoreTimeFrameSlice(const KFPTrackVector& tracks, float coreBegin, float coreEnd, bool isLastSlice,
+                                                      vector<KFParticle>& particles, std::map<vector<int>, int>& particleKeys,
+                                                      vector<KFVertex>& pv, vector< vector<int> >& pvTracks,
+                                                      vector<float>& pvTime, vector<float>& pvTimeError)
+{
+  /** Stores primary vertices and particles of the current time slice to the output of the time frame. 
+   ** The time of a particle is the mean time of its daughter tracks. The particle is stored if its time is inside
+   ** the slice, daughters of the stored particles are stored as well. The particle is identified by its PDG code 
+   ** and the indices of its daughters in the time frame: if the same particle was already stored from one of the
+   ** previous slices, it is not copied again, the existing entry is used as a daughter. Particles without daughter
+   ** tracks, like gammas from the EMC clusters, are identified only by this key. Tracks are not identified by the key,
+   ** they are copied once to the position of the track in the time frame at the beginning of "particles". Primary
+   ** vertices are stored if their time is inside the slice.
+   ** \param[in] tracks - tracks of the time frame
+   ** \param[in] coreBegin - start of the slice
+   ** \param[in] coreEnd - end of the slice
+   ** \param[in] isLastSlice - if true, the slice is not limited from above
+   ** \param[in,out] particles - particles of the time frame
+   ** \param[in,out] particleKeys - keys of the particles of the time frame and their indices in "particles"
+   ** \param[in,out] pv - primary vertices of the time frame
+   ** \param[in,out] pvTracks - indices of tracks in the time frame for each primary vertex
+   ** \param[in,out] pvTime - time of the primary vertices
+   ** \param[in,out] pvTimeError - error of the time of the primary vertices
+   **/
+  const int nSliceTracks = fTracks[0].Size() + fTracks[1].Size() + fTracks[2].Size() + fTracks[3].Size();
+  const int nParticles = fParticles.size();
+  
+  // particles are always stored after their daughters
+  vector<float> sumTime(nParticles, 0.f);
+  vector<int> nTimeTracks(nParticles, 0);
+  vector<bool> isStored(nParticles, false);
+  for(int iParticle=0; iParticle<nParticles; iParticle++)
+  {
+    const KFParticle& particle = fParticles[iParticle];
+    if(iParticle < nSliceTracks)
+    {
+      sumTime[iParticle] = tracks.T()[particle.DaughterIds()[0]];
+      nTimeTracks[iParticle] = 1;
+    }
+    else if(particle.NDaughters() > 1)
+    {
+      for(int iD=0; iD<particle.NDaughters(); iD++)
+      {
+        sumTime[iParticle] += sumTime[particle.DaughterIds()[iD]];
+        nTimeTracks[iParticle] += nTimeTracks[particle.DaughterIds()[iD]];
+      }
+    }
+    
+    if(nTimeTracks[iParticle] == 0)
+    {
+      isStored[iParticle] = true;
+      continue;
+    }
+    const float time = sumTime[iParticle]/float(nTimeTracks[iParticle]);
+    isStored[iParticle] = (time >= coreBegin) && (isLastSlice || time < coreEnd);
+  }
+  
+  for(int iParticle=nParticles-1; iParticle>=nSliceTracks; iParticle--)
+  {
+    const KFParticle& particle = fParticles[iParticle];
+    if(!isStored[iParticle] || particle.NDaughters() < 2) continue;
+    for(int iD=0; iD<particle.NDaughters(); iD++)
+      isStored[particle.DaughterIds()[iD]] = true;
+  }
+  
+  // keys of the current slice are added at the end, only duplicates from the previous slices are removed
+  vector<int> frameIndex(nParticles, -1);
+  vector< std::pair<vector<int>, int> > sliceKeys;
+  vector<int> key;
+  for(int iParticle=0; iParticle<nParticles; iParticle++)
+  {
+    const KFParticle& particle = fParticles[iParticle];
+    if(iParticle < nSliceTracks)
+    {
+      // Id of the slice track is its position in the time frame
+      const int trackIndex = particle.DaughterIds()[0];
+      frameIndex[iParticle] = trackIndex;
+      if(particles[trackIndex].NDaughters() == 0)
+      {
+        particles[trackIndex] = particle;
+        particles[trackIndex].SetId(trackIndex);
+        particles[trackIndex].CleanDaughtersId();
+        particles[trackIndex].AddDaughterId(tracks.Id()[trackIndex]);
+      }
+      continue;
+    }
+    if(!isStored[iParticle]) continue;
+    
+    key.clear();
+    key.push_back(particle.GetPDG());
+    if(particle.NDaughters() < 2)
+    {
+      key.push_back(1);
+      key.push_back(particle.DaughterIds()[0]);
+    }
+    else
+    {
+      key.push_back(2);
+      for(int iD=0; iD<particle.NDaughters(); iD++)
+        key.push_back(frameIndex[particle.DaughterIds()[iD]]);
+      std::sort(key.begin()+2, key.end());
+    }
+    
+    std::map<vector<int>, int>::const_iterator storedParticle = particleKeys.find(key);
+    if(storedParticle != particleKeys.end())
+    {
+      frameIndex[iParticle] = storedParticle->second;
+      continue;
+    }
+    
+    KFParticle frameParticle = particle;
+    frameParticle.SetId(particles.size());
+    frameParticle.CleanDaughtersId();
+    if(particle.NDaughters() < 2)
+      frameParticle.AddDaughterId(particle.DaughterIds()[0]);
+    else
+      for(int iD=0; iD<particle.NDaughters(); iD++)
+        frameParticle.AddDaughterId(frameIndex[particle.DaughterIds()[iD]]);
+    
+    frameIndex[iParticle] = particles.size();
+    sliceKeys.push_back(std::make_pair(key, int(particles.size())));
+    particles.push_back(frameParticle);
+  }
+  particleKeys.insert(sliceKeys.begin(), sliceKeys.end());
+  
+  for(int iPV=0; iPV<NPrimaryVertices(); iPV++)
+  {
+    const vector<int>& clusterTracks = GetPVTrackIndexArray(iPV);
+    if(clusterTracks.size() == 0) continue;
+    
+    vector<int> frameTracks(clusterTracks.size());
+    float time = 0.f;
+    for(unsigned int iTr=0; iTr<clusterTracks.size(); iTr++)
+    {
+      frameTracks[iTr] = fParticles[clusterTracks[iTr]].DaughterIds()[0];
+      time += tracks.T()[frameTracks[iTr]];
+    }
+    time /= float(clusterTracks.size());
+    if(fPVTimeError[iPV] >= 0.f)
+      time = fPVTime[iPV];
+    
+    if( (time < coreBegin) || (!isLastSlice && time >= coreEnd) ) continue;
+    
+    pv.push_back(GetPrimKFVertex(iPV));
+    pvTracks.push_back(frameTracks);
+    pvTime.push_back(fPVTime[iPV]);
+    pvTimeError.push_back(fPVTimeError[iPV]);
+  }
+}
+
 #ifdef WITHSCIF
 void KFParticleTopoReconstructor::SendDataToXeonPhi( int iHLT, scif_epd_t& endpoint, void* buffer, off_t& offsetServer, off_t& offsetSender, float Bz)
 {
@@ -27,6 +27,7 @@
 
 #include <vector>
 #include <string>
+#include <map>
 
 #include "KFPTrackVector.h"
 #include "KFParticleSIMD.h"
@@ -59,11 +60,14 @@ class AliHLTTPCCAGBTracker;
  ** primary, each of these groups are subdivided into positive and negative tracks, then they are
  ** sorted according to the PDG hypothesis, short-lived particles are constructed, optionally competition
  ** between different particle hypothesis is run for the constructed candidates.
+ ** For the continuous readout the time frame with many collisions can be reconstructed in time slices
+ ** with KFParticleTopoReconstructor::ProcessTimeFrame().
  **/
 
 class KFParticleTopoReconstructor{
  public:
-  KFParticleTopoReconstructor():fKFParticlePVReconstructor(0),fKFParticleFinder(0),fTracks(0), fParticles(0), fPV(0), fNThreads(1)
+  KFParticleTopoReconstructor():fKFParticlePVReconstructor(0),fKFParticleFinder(0),fTracks(0), fParticles(0), fPV(0), fPVTime(0), fPVTimeError(0), fNThreads(1),
+    fTimeNSigmaCut(0.f), fTimeFrameSliceLength(0.f), fTimeFrameSliceOverlap(0.f), fNTimeFrameSlices(0), fLatencyBudget(0.)
 #ifdef USE_TIMERS
   ,fTime(0.),timer()
 #endif
@@ -126,12 +130,13 @@ class KFParticleTopoReconstructor{
   
   void DeInit() { fTracks = NULL; } ///< Sets a pointer to the input tracks KFParticleTopoReconstructor::fTracks to NULL.
   /** \brief Cleans all candidates for primary vertices and short-lived particles. */
-  void Clear() { fParticles.clear(); fPV.clear(); fKFParticlePVReconstructor->CleanPV(); }
+  void Clear() { fParticles.clear(); fPV.clear(); fPVTime.clear(); fPVTimeError.clear(); fKFParticlePVReconstructor->CleanPV(); }
   
   void ReconstructPrimVertex(bool isHeavySystem = 1); // find primary vertex
   void SortTracks(); //sort tracks according to the pdg hypothesis and pv index
   void ReconstructParticles(); //find short-lived particles 
   void SelectParticleCandidates(); //clean particle candidates: track can belong to only one particle
+  void ProcessTimeFrame(const KFPTrackVector& tracks, const KFPTrackVector& tracksAtLastPoint); //continuous readout: reconstruct the time frame in slices
 #ifdef WITHSCIF
   void SendDataToXeonPhi( int iHLT, scif_epd_t& endpoint, void* buffer, off_t& offsetServer, off_t& offsetSender, float Bz);
 #endif
@@ -146,6 +151,11 @@ class KFParticleTopoReconstructor{
   void RemoveParticle(const int iParticle) { if(iParticle>=0 && iParticle<int(fParticles.size())) fParticles[iParticle].SetPDG(-1); } 
   const KFPTrackVector* GetTracks() const { return fTracks; } ///< Returns a pointer to the arrays with tracks KFParticleTopoReconstructor::fTracks.
   const kfvector_float* GetChiPrim() const { return fChiToPrimVtx; } ///<Returns a pointer to the arrays with chi2-deviations KFParticleTopoReconstructor::fChiToPrimVtx.
+  /** Returns constant reference to the vector with primary vertex candidates KFParticleTopoReconstructor::fPV. */
+  const std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> >& GetPV() const { return fPV; }
+  float GetPVTime(int iPV=0) const { return fPVTime[iPV]; } ///< Returns time of the primary vertex candidate with index "iPV".
+  /** Returns error of the time of the primary vertex candidate with index "iPV", negative value means that the time is not defined. */
+  float GetPVTimeError(int iPV=0) const { return fPVTimeError[iPV]; }
   
   KFParticleFinder* GetKFParticleFinder() { return fKFParticleFinder; } ///< Returns a pointer to the KFParticleFinder object.
   const KFParticleFinder* GetKFParticleFinder() const { return fKFParticleFinder; } ///< Returns a constant pointer to the KFParticleFinder object.
@@ -154,24 +164,32 @@ class KFParticleTopoReconstructor{
     /** Cleans vectors with primary vertex candidates and corresponding clusters by calling KFParticlePVReconstructor::CleanPV(). */
     fKFParticlePVReconstructor->CleanPV();
   }
-  void AddPV(const KFVertex &pv, const std::vector<int> &tracks) { 
+  void AddPV(const KFVertex &pv, const std::vector<int> &tracks, float time = 0.f, float timeError = -1.f) { 
     /** Adds externally found primary vertex to the list together with the cluster of
      ** tracks from this vertex.
      ** \param[in] pv - external primary vertex
      ** \param[in] tracks - vector with indices of tracks associated with the provided primary vertex.
+     ** \param[in] time - time of the vertex
+     ** \param[in] timeError - error of the time of the vertex, negative value means that the time is not defined
      **/
-    fKFParticlePVReconstructor->AddPV(pv,tracks);
+    fKFParticlePVReconstructor->AddPV(pv,tracks,time,timeError);
     KFParticle pvPart=pv;
     fPV.push_back(pvPart);
+    fPVTime.push_back(time);
+    fPVTimeError.push_back(timeError);
     fKFParticleFinder->SetNPV(fPV.size());
   }
-  void AddPV(const KFVertex &pv) { 
+  void AddPV(const KFVertex &pv, float time = 0.f, float timeError = -1.f) { 
    /** Adds externally found primary vertex to the list.
     ** \param[in] pv - external primary vertex
+    ** \param[in] time - time of the vertex
+    ** \param[in] timeError - error of the time of the vertex, negative value means that the time is not defined
     **/
-    fKFParticlePVReconstructor->AddPV(pv);
+    fKFParticlePVReconstructor->AddPV(pv,time,timeError);
     KFParticle pvPart=pv;
     fPV.push_back(pvPart);
+    fPVTime.push_back(time);
+    fPVTimeError.push_back(timeError);
     fKFParticleFinder->SetNPV(fPV.size());
   }
   void FillPVIndices()
@@ -217,6 +235,29 @@ class KFParticleTopoReconstructor{
     fKFParticleFinder->SetChiPrimaryCut2D(chi);
   }
   
+  void SetTimeCompatibilityCut(float nSigma) {
+    /** Sets the cut on the time compatibility in units of the error of the time difference to the primary vertex finder,
+     ** to the association of tracks with primary vertices and to the pairing of tracks in KF Particle Finder.
+     ** Tracks should be provided with the time, see KFPTrackVector::T(). "0" switches the cut off, which is the default. */
+    fTimeNSigmaCut = nSigma;
+    fKFParticlePVReconstructor->SetTimeCompatibilityCut(nSigma);
+    fKFParticleFinder->SetTimeCompatibilityCut(nSigma);
+  }
+  float GetTimeCompatibilityCut() const { return fTimeNSigmaCut; } ///< Returns the cut on the time compatibility.
+  /** Sets the length of the time slices and the overlap between them for KFParticleTopoReconstructor::ProcessTimeFrame().
+   ** The overlap should be larger than the time spread of tracks from one collision. If the length is not positive
+   ** the whole time frame is reconstructed at once. */
+  void SetTimeFrameSlicing(float length, float overlap) { fTimeFrameSliceLength = length; fTimeFrameSliceOverlap = overlap; }
+  float GetTimeFrameSliceLength() const { return fTimeFrameSliceLength; } ///< Returns the length of the time slices.
+  float GetTimeFrameSliceOverlap() const { return fTimeFrameSliceOverlap; } ///< Returns the overlap between the time slices.
+  int GetNTimeFrameSlices() const { return fNTimeFrameSlices; } ///< Returns number of the time slices reconstructed in the last time frame.
+  /** Sets the latency budget in seconds for KFParticleTopoReconstructor::ReconstructParticles(). When it is exceeded the groups of channels 
+   ** with the low priority are skipped or truncated, see KFParticleFinder::SetChannelGroupPriority(). "0" switches the budget off, which is the default. */
+  void SetLatencyBudget(double seconds) { fLatencyBudget = seconds; }
+  double GetLatencyBudget() const { return fLatencyBudget; } ///< Returns the latency budget in seconds.
+  /** Returns true if some groups of channels were skipped or truncated in the last event because of the latency budget. */
+  bool IsPartiallyProcessed() const { return fKFParticleFinder->IsPartiallyProcessed(); }
+
   void GetListOfDaughterTracks(const KFParticle& particle, std::vector<int>& daughters);
   bool ParticleHasRepeatingDaughters(const KFParticle& particle);
 
@@ -228,12 +269,17 @@ class KFParticleTopoReconstructor{
     fTracks = 0;
     
     fNThreads = a.fNThreads;
+    fTimeNSigmaCut = a.fTimeNSigmaCut;
+    fTimeFrameSliceLength = a.fTimeFrameSliceLength;
+    fTimeFrameSliceOverlap = a.fTimeFrameSliceOverlap;
+    fLatencyBudget = a.fLatencyBudget;
     
     return *this;
   }
   
   /** \brief A copy constructor. All pointers are set to zero, other members are copied. **/
-  KFParticleTopoReconstructor(const KFParticleTopoReconstructor& a):fKFParticlePVReconstructor(0),fKFParticleFinder(0),fTracks(0), fParticles(), fPV(), fNThreads(a.fNThreads)
+  KFParticleTopoReconstructor(const KFParticleTopoReconstructor& a):fKFParticlePVReconstructor(0),fKFParticleFinder(0),fTracks(0), fParticles(), fPV(), fPVTime(), fPVTimeError(), fNThreads(a.fNThreads),
+    fTimeNSigmaCut(a.fTimeNSigmaCut), fTimeFrameSliceLength(a.fTimeFrameSliceLength), fTimeFrameSliceOverlap(a.fTimeFrameSliceOverlap), fNTimeFrameSlices(0), fLatencyBudget(a.fLatencyBudget)
 #ifdef USE_TIMERS
   ,fTime(0.),timer()
 #endif
@@ -246,6 +292,10 @@ class KFParticleTopoReconstructor{
 
   void GetChiToPrimVertex(KFParticleSIMD* pv, const int nPV);
   void TransportPVTracksToPrimVertex();
+  void StoreTimeFrameSlice(const KFPTrackVector& tracks, float coreBegin, float coreEnd, bool isLastSlice,
+                           std::vector<KFParticle>& particles, std::map<std::vector<int>, int>& particleKeys,
+                           std::vector<KFVertex>& pv, std::vector< std::vector<int> >& pvTracks,
+                           std::vector<float>& pvTime, std::vector<float>& pvTimeError);
   
   KFParticlePVReconstructor* fKFParticlePVReconstructor; ///< Pointer to the KFParticlePVReconstructor. Allocated in the constructor.
   KFParticleFinder* fKFParticleFinder; ///< Pointer to the KFParticleFinder object. Allocated in the constructor.
@@ -266,9 +316,17 @@ class KFParticleTopoReconstructor{
   kfvector_float fChiToPrimVtx[2]; ///< Chi2-deviation of the secondary tracks.
   std::vector<KFParticle> fParticles; ///< Vector of the reconstructed candidates of short-lived particles.
   std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> > fPV; ///< Vector of the reconstructed primary vertices.
+  std::vector<float> fPVTime;      ///< Time of the primary vertices.
+  std::vector<float> fPVTimeError; ///< Error of the time of the primary vertices, negative if the time is not defined.
     
   short int fNThreads; ///< Number of threads to be run in KFParticleFinder. Currently is not used.
   
+  float fTimeNSigmaCut;         ///< Cut on the time compatibility of tracks and primary vertices, "0" switches the cut off.
+  float fTimeFrameSliceLength;  ///< Length of the time slices of the time frame.
+  float fTimeFrameSliceOverlap; ///< Overlap between the neighbouring time slices.
+  int fNTimeFrameSlices;        ///< Number of the time slices reconstructed in the last time frame.
+  double fLatencyBudget;        ///< Latency budget of KFParticleTopoReconstructor::ReconstructParticles() in seconds, "0" - no budget.
+  
   //speed measurements
 #ifdef USE_TIMERS
   double fTime; ///< Total run time.
@@ -0,0 +1,251 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "KFPEventMixer.h"
+#include "KFParticleFinder.h"
+#include "KFParticleTopoReconstructor.h"
+#include "KFPHistogram/KFPHistogram.h"
+
+KFPEventMixer::KFPEventMixer(): fNZBins(10), fZMin(-10.f), fZMax(10.f), fNMultiplicityBins(10), fMinMultiplicity(0), fMaxMultiplicity(1000),
+  fPoolDepth(5), fMemoryLimit(1ul << 30), fMemoryUsage(0), fPool(), fNextSlot(), fKFParticleFinder(0), fMixedTracks(), fMixedChiPrim(),
+  fMixedPV(1), fMixedParticles(), fNMixedEvents(0), fNMixedCandidates(0)
+{
+  /** The default constructor. Creates the pool with 10 bins in the z-position of the primary vertex
+   ** in the range [-10, 10] cm, 10 bins in multiplicity in the range [0, 1000], 5 events per bin
+   ** and the memory limit of 1 GB. Allocates KFParticleFinder and switches it to the mixed event mode.
+   **/
+  fKFParticleFinder = new KFParticleFinder;
+  fKFParticleFinder->SetMixedEventAnalysis();
+
+  fPool.resize(NBins());
+  fNextSlot.resize(NBins(), 0);
+}
+
+KFPEventMixer::~KFPEventMixer()
+{
+  /** The destructor. Releases KFParticleFinder. */
+  if(fKFParticleFinder) delete fKFParticleFinder;
+}
+
+void KFPEventMixer::SetZBinning(int nBins, float zMin, float zMax)
+{
+  /** Sets binning in the z-position of the primary vertex. The pool is cleaned.
+   ** \param[in] nBins - number of bins
+   ** \param[in] zMin - lower edge of the range
+   ** \param[in] zMax - upper edge of the range
+   **/
+  fNZBins = nBins;
+  fZMin = zMin;
+  fZMax = zMax;
+  Clear();
+}
+
+void KFPEventMixer::SetMultiplicityBinning(int nBins, int minMultiplicity, int maxMultiplicity)
+{
+  /** Sets binning in the number of primary tracks. The pool is cleaned.
+   ** \param[in] nBins - number of bins
+   ** \param[in] minMultiplicity - lower edge of the range
+   ** \param[in] maxMultiplicity - upper edge of the range
+   **/
+  fNMultiplicityBins = nBins;
+  fMinMultiplicity = minMultiplicity;
+  fMaxMultiplicity = maxMultiplicity;
+  Clear();
+}
+
+void KFPEventMixer::CopyCuts(const KFParticleFinder* finder)
+{
+  /** Copies cuts from the given KFParticleFinder, so that the mixed candidates are selected the same way as the candidates
+   ** from the same event. The mixed event mode is kept switched on.
+   ** \param[in] finder - KFParticleFinder, which reconstructs the particles in the same event
+   **/
+  fKFParticleFinder->CopyCuts(finder);
+  fKFParticleFinder->SetReconstructionList(finder->GetReconstructionList());
+}
+
+void KFPEventMixer::Clear()
+{
+  /** Removes all events from the pool. */
+  fPool.clear();
+  fPool.resize(NBins());
+  fNextSlot.clear();
+  fNextSlot.resize(NBins(), 0);
+  fMemoryUsage = 0;
+}
+
+int KFPEventMixer::NPoolEvents() const
+{
+  /** Returns the total number of events stored in the pool. */
+  int nEvents = 0;
+  for(unsigned int iBin=0; iBin<fPool.size(); iBin++)
+    nEvents += fPool[iBin].size();
+  return nEvents;
+}
+
+int KFPEventMixer::GetBin(const float z, const int multiplicity) const
+{
+  /** Returns the index of the bin of the pool, "-1" if the event is outside the binning.
+   ** \param[in] z - z-position of the primary vertex
+   ** \param[in] multiplicity - number of primary tracks
+   **/
+  if( !(z >= fZMin && z < fZMax) ) return -1;
+  if( multiplicity < fMinMultiplicity || multiplicity >= fMaxMultiplicity ) return -1;
+
+  const int iZBin = int( (z - fZMin)/(fZMax - fZMin) * fNZBins );
+  const int iMultiplicityBin = int( float(multiplicity - fMinMultiplicity)/float(fMaxMultiplicity - fMinMultiplicity) * fNMultiplicityBins );
+  if(iZBin >= fNZBins || iMultiplicityBin >= fNMultiplicityBins) return -1;
+
+  return iZBin*fNMultiplicityBins + iMultiplicityBin;
+}
+
+void KFPEventMixer::FillPoolEvent(const KFParticleTopoReconstructor& topoReconstructor, KFPPoolEvent& event) const
+{
+  /** Copies the tracks of the event to the format of the pool. Only primary tracks of the first primary vertex are taken.
+   ** All tracks are shifted so that the first primary vertex is placed at the origin.
+   ** \param[in] topoReconstructor - KFParticleTopoReconstructor with the sorted tracks of the event
+   ** \param[out] event - event in the format of the pool
+   **/
+  const KFPTrackVector* tracks = topoReconstructor.GetTracks();
+  const kfvector_float* chiPrim = topoReconstructor.GetChiPrim();
+  const KFParticleSIMD& pv = topoReconstructor.GetPV()[0];
+  const float_v pvPosition[3] = { pv.X()[0], pv.Y()[0], pv.Z()[0] };
+
+  event.fMultiplicity = 0;
+  event.fMemory = sizeof(KFPPoolEvent);
+
+  for(int iSet=0; iSet<4; iSet++)
+  {
+    KFPTrackVector& eventTracks = event.fTracks[iSet];
+
+    if(iSet < 2)
+    {
+      eventTracks = tracks[iSet];
+
+      const int nTracks = tracks[iSet].Size();
+      event.fChiPrim[iSet].resize( (nTracks + float_vLen - 1)/float_vLen*float_vLen, 0.f );
+      for(int iTr=0; iTr<nTracks; iTr++)
+        event.fChiPrim[iSet][iTr] = chiPrim[iSet][iTr];
+      event.fMemory += event.fChiPrim[iSet].size()*sizeof(float);
+    }
+    else
+    {
+      kfvector_uint trackIndex(tracks[iSet].Size());
+      int nTracks = 0;
+      for(int iTr=0; iTr<tracks[iSet].Size(); iTr++)
+      {
+        if(tracks[iSet].PVIndex()[iTr] != 0) continue;
+        trackIndex[nTracks] = iTr;
+        nTracks++;
+      }
+      eventTracks.Resize(0);
+      eventTracks.SetTracks(tracks[iSet], trackIndex, nTracks);
+      eventTracks.RecalculateLastIndex();
+      event.fMultiplicity += nTracks;
+    }
+
+    for(int iTr=0; iTr<eventTracks.Size(); iTr += float_vLen)
+    {
+      for(int iP=0; iP<3; iP++)
+      {
+        const float_v& position = reinterpret_cast<const float_v&>(eventTracks.Parameter(iP)[iTr]);
+        eventTracks.SetParameter(position - pvPosition[iP], iP, iTr);
+      }
+    }
+
+    event.fMemory += eventTracks.DataSize()*sizeof(int);
+  }
+}
+
+void KFPEventMixer::Mix(const KFPPoolEvent& positiveEvent, const KFPPoolEvent& negativeEvent, KFPHistogram& histograms)
+{
+  /** Combines positive tracks of one event with negative tracks of another event by KFParticleFinder.
+   ** The obtained candidates are stored to the histograms.
+   ** \param[in] positiveEvent - event, which provides the positive tracks
+   ** \param[in] negativeEvent - event, which provides the negative tracks
+   ** \param[out] histograms - histograms with the mixed-event background
+   **/
+  fMixedTracks[0] = positiveEvent.fTracks[0];
+  fMixedTracks[1] = negativeEvent.fTracks[1];
+  fMixedTracks[2] = positiveEvent.fTracks[2];
+  fMixedTracks[3] = negativeEvent.fTracks[3];
+  fMixedChiPrim[0].assign(positiveEvent.fChiPrim[0].begin(), positiveEvent.fChiPrim[0].end());
+  fMixedChiPrim[1].assign(negativeEvent.fChiPrim[1].begin(), negativeEvent.fChiPrim[1].end());
+
+  int nTracks = 0;
+  for(int iSet=0; iSet<4; iSet++)
+    nTracks += fMixedTracks[iSet].Size();
+  if(nTracks == 0) return;
+
+  fMixedParticles.clear();
+  fKFParticleFinder->FindParticles(fMixedTracks, fMixedChiPrim, fMixedParticles, fMixedPV, 1);
+
+  for(unsigned int iParticle=nTracks; iParticle<fMixedParticles.size(); iParticle++)
+    histograms.Fill(fMixedParticles[iParticle]);
+
+  fNMixedEvents++;
+  fNMixedCandidates += fMixedParticles.size() - nTracks;
+}
+
+void KFPEventMixer::ProcessEvent(const KFParticleTopoReconstructor& topoReconstructor, KFPHistogram& histograms)
+{
+  /** Mixes the event with all events from the same bin of the pool and adds the event to the pool.
+   ** The event should be processed by KFParticleTopoReconstructor: tracks should be sorted and the primary vertex should be found.
+   ** Events without primary vertices or outside the binning are skipped. If the bin is full or the memory limit
+   ** is reached, the oldest event of the bin is replaced by the current one.
+   ** \param[in] topoReconstructor - KFParticleTopoReconstructor with the current event
+   ** \param[out] histograms - histograms with the mixed-event background
+   **/
+  if(topoReconstructor.GetPV().size() < 1 || !topoReconstructor.GetTracks()) return;
+
+  KFPPoolEvent currentEvent;
+  FillPoolEvent(topoReconstructor, currentEvent);
+
+  const int iBin = GetBin(topoReconstructor.GetPV()[0].Z()[0], currentEvent.fMultiplicity);
+  if(iBin < 0) return;
+
+  fMixedPV[0] = topoReconstructor.GetPV()[0];
+  fMixedPV[0].X() = 0.f;
+  fMixedPV[0].Y() = 0.f;
+  fMixedPV[0].Z() = 0.f;
+
+  std::vector<KFPPoolEvent>& binEvents = fPool[iBin];
+  for(unsigned int iEvent=0; iEvent<binEvents.size(); iEvent++)
+  {
+    Mix(currentEvent, binEvents[iEvent], histograms);
+    Mix(binEvents[iEvent], currentEvent, histograms);
+  }
+
+  if( (int(binEvents.size()) < fPoolDepth) && (fMemoryUsage + currentEvent.fMemory <= fMemoryLimit) )
+  {
+    binEvents.push_back(currentEvent);
+    fMemoryUsage += currentEvent.fMemory;
+  }
+  else if(!binEvents.empty())
+  {
+    KFPPoolEvent& oldestEvent = binEvents[fNextSlot[iBin]];
+    if(fMemoryUsage - oldestEvent.fMemory + currentEvent.fMemory <= fMemoryLimit)
+    {
+      fMemoryUsage = fMemoryUsage - oldestEvent.fMemory + currentEvent.fMemory;
+      oldestEvent.Set(currentEvent);
+      fNextSlot[iBin] = (fNextSlot[iBin] + 1) % binEvents.size();
+    }
+  }
+}
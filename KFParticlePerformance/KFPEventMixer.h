@@ -0,0 +1,134 @@
+/*
+ * This file is part of KFParticle package
+ * Copyright (C) 2007-2019 FIAS Frankfurt Institute for Advanced Studies
+ *               2007-2019 Goethe University of Frankfurt
+ *               2007-2019 Ivan Kisel <I.Kisel@compeng.uni-frankfurt.de>
+ *               2007-2019 Maksym Zyzak
+ *
+ * KFParticle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * KFParticle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef KFPEventMixer_H
+#define KFPEventMixer_H
+
+#include "KFPTrackVector.h"
+#include "KFParticleSIMD.h"
+#include "KFPSimdAllocator.h"
+
+#include <vector>
+
+class KFParticleFinder;
+class KFParticleTopoReconstructor;
+class KFPHistogram;
+
+/** @class KFPEventMixer
+ ** @brief Engine for the construction of the combinatorial background with the event mixing technique.
+ ** @author  M.Zyzak, I.Kisel
+ ** @date 05.02.2019
+ ** @version 1.0
+ **
+ ** The class keeps a pool of past events divided into bins according to the z-position of the
+ ** first primary vertex and the multiplicity of the primary tracks. Each event is stored in the same
+ ** "Structure Of Arrays" format as the input of KFParticleFinder: secondary and primary, positive and
+ ** negative tracks together with the chi2-deviations of the secondary tracks. Tracks are shifted
+ ** so that the primary vertex is placed at the origin. Each new event is mixed with all events
+ ** from the same bin: positive tracks of one event are combined with negative tracks of another
+ ** one by KFParticleFinder, that runs in the mixed event mode, the obtained candidates are
+ ** stored to KFPHistogram. After mixing the event is added to the pool. The number of events in each
+ ** bin and the total memory of the pool are limited. If the bin is full or the memory limit is reached,
+ ** the oldest event of the bin is replaced, so the result does not depend on anything but the order of
+ ** the input events.
+ **/
+
+class KFPEventMixer
+{
+ public:
+  KFPEventMixer();
+  ~KFPEventMixer();
+
+  /** Sets binning of the pool in the z-position of the primary vertex. Events outside the range are not mixed. Cleans the pool. */
+  void SetZBinning(int nBins, float zMin, float zMax);
+  /** Sets binning of the pool in the number of primary tracks. Events outside the range are not mixed. Cleans the pool. */
+  void SetMultiplicityBinning(int nBins, int minMultiplicity, int maxMultiplicity);
+  void SetPoolDepth(int depth) { fPoolDepth = depth; } ///< Sets the maximum number of events stored in each bin of the pool.
+  void SetMemoryLimit(unsigned long size) { fMemoryLimit = size; } ///< Sets the maximum memory in bytes occupied by all events in the pool.
+  void CopyCuts(const KFParticleFinder* finder);
+
+  KFParticleFinder* GetKFParticleFinder() { return fKFParticleFinder; } ///< Returns a pointer to KFParticleFinder, which constructs the mixed candidates.
+
+  void ProcessEvent(const KFParticleTopoReconstructor& topoReconstructor, KFPHistogram& histograms);
+  void Clear();
+
+  int NBins() const { return fNZBins*fNMultiplicityBins; } ///< Returns the total number of bins in the pool.
+  int NPoolEvents() const;
+  unsigned long MemoryUsage() const { return fMemoryUsage; } ///< Returns the memory in bytes occupied by the events in the pool.
+  unsigned long NMixedEvents() const { return fNMixedEvents; } ///< Returns the number of mixed pairs of events.
+  unsigned long NMixedCandidates() const { return fNMixedCandidates; } ///< Returns the number of candidates obtained from the mixed events.
+
+ private:
+
+  /** @brief An event stored in the pool. */
+  struct KFPPoolEvent
+  {
+    KFPPoolEvent(): fMultiplicity(0), fMemory(0) {}
+    KFPPoolEvent(const KFPPoolEvent& event): fMultiplicity(0), fMemory(0) { Set(event); } ///< Copies the event with KFPPoolEvent::Set().
+    
+    void Set(const KFPPoolEvent& event)
+    {
+      /** Copies the event to the current object: the tracks with the assignment operator of KFPTrackVector, the chi2-deviations element by element. */
+      for(int iSet=0; iSet<4; iSet++)
+        fTracks[iSet] = event.fTracks[iSet];
+      for(int iSet=0; iSet<2; iSet++)
+        fChiPrim[iSet].assign(event.fChiPrim[iSet].begin(), event.fChiPrim[iSet].end());
+      fMultiplicity = event.fMultiplicity;
+      fMemory = event.fMemory;
+    }
+    
+    KFPTrackVector fTracks[4]; ///< Secondary positive, secondary negative, primary positive and primary negative tracks.
+    kfvector_float fChiPrim[2]; ///< Chi2-deviations of the secondary positive and negative tracks from the primary vertex.
+    int fMultiplicity; ///< Number of the primary tracks.
+    unsigned long fMemory; ///< Memory in bytes occupied by the event.
+  };
+
+  int GetBin(const float z, const int multiplicity) const;
+  void FillPoolEvent(const KFParticleTopoReconstructor& topoReconstructor, KFPPoolEvent& event) const;
+  void Mix(const KFPPoolEvent& positiveEvent, const KFPPoolEvent& negativeEvent, KFPHistogram& histograms);
+
+  int fNZBins;       ///< Number of bins in the z-position of the primary vertex.
+  float fZMin;       ///< Lower edge of the z-binning.
+  float fZMax;       ///< Upper edge of the z-binning.
+  int fNMultiplicityBins;  ///< Number of bins in multiplicity.
+  int fMinMultiplicity;    ///< Lower edge of the multiplicity binning.
+  int fMaxMultiplicity;    ///< Upper edge of the multiplicity binning.
+  int fPoolDepth;    ///< Maximum number of events in each bin.
+  unsigned long fMemoryLimit; ///< Maximum memory in bytes of all events in the pool.
+  unsigned long fMemoryUsage; ///< Current memory in bytes of all events in the pool.
+
+  std::vector< std::vector<KFPPoolEvent> > fPool; ///< Events for each bin of the pool.
+  std::vector<int> fNextSlot; ///< Index of the event to be replaced next in each bin of the pool.
+
+  KFParticleFinder* fKFParticleFinder; ///< KFParticleFinder in the mixed event mode, allocated in the constructor.
+  KFPTrackVector fMixedTracks[8]; ///< Input tracks for KFParticleFinder prepared from a pair of events.
+  kfvector_float fMixedChiPrim[2]; ///< Chi2-deviations of the secondary tracks from a pair of events.
+  std::vector<KFParticleSIMD, KFPSimdAllocator<KFParticleSIMD> > fMixedPV; ///< Primary vertex of the current event shifted to the origin.
+  std::vector<KFParticle> fMixedParticles; ///< Output of KFParticleFinder for a pair of events.
+
+  unsigned long fNMixedEvents;     ///< Number of mixed pairs of events.
+  unsigned long fNMixedCandidates; ///< Number of candidates obtained from the mixed events.
+
+  KFPEventMixer(const KFPEventMixer&); ///< Copying is disabled for this class.
+  KFPEventMixer& operator=(const KFPEventMixer&); ///< Copying is disabled for this class.
+};
+
+#endif
@@ -90,6 +90,25 @@ class KFPHistogram
   KFPHistogramSet GetHistogramSet(int iSet)   const { return fKFPHistogramSet[iSet]; } ///< Returns set of histograms for the decay with index iSet.
   /** \brief Returns "iHistogram" histogram from the set of histograms for the decay with index "iSet". */
   KFPHistogram1D  GetHistogram(int iSet, int iHistogram) const { return fKFPHistogramSet[iSet].GetHistogram1D(iHistogram); }
+  /** \brief Returns the invariant mass histogram for the decay with the given PDG code. If the code is not known, a histogram without memory is returned. */
+  KFPHistogram1D  GetMassHistogram(int pdg) const
+  {
+    std::map<int, int>::const_iterator it = fPdgToIndex.find(pdg);
+    if(it != fPdgToIndex.end())
+      return fKFPHistogramSet[it->second].GetHistogram1D(0);
+    return KFPHistogram1D();
+  }
+  /** \brief Adds the invariant mass "mass" of the particles with the PDG codes "pdg" to the mass histograms of the corresponding decays, 
+   ** for example the background stored by KFParticleFinder::FillPrimaryBackground(). Particles with unknown codes are skipped. */
+  void FillMass(const std::vector<int>& pdg, const std::vector<float>& mass)
+  {
+    for(unsigned int iParticle=0; iParticle<pdg.size() && iParticle<mass.size(); iParticle++)
+    {
+      KFPHistogram1D histogram = GetMassHistogram(pdg[iParticle]);
+      if(histogram.GetHistogram())
+        histogram.Fill(mass[iParticle]);
+    }
+  }
   
   friend std::fstream & operator<<(std::fstream &strm, KFPHistogram &histograms)
   {
@@ -23,11 +23,32 @@
 #include "KFPTrack.h"
 #include "KFPVertex.h"
 #include "KFParticleSIMD.h"
+#include "KFPParticleVector.h"
+#include "KFPCovarianceCodec.h"
+#include "KFPCandidateWriter.h"
+#include "KFPCandidateReader.h"
+#include "KFPSharedMemoryRing.h"
+#include "KFPInputDataPrefetcher.h"
+#include "KFParticleTopoReconstructor.h"
 #include "KFParticleTest.h"
 
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <ctime>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <set>
+#include <tuple>
+#include <algorithm>
+#include <string>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #ifndef KFParticleStandalone
 ClassImp(KFParticleTest)
@@ -76,6 +97,21 @@ void KFParticleTest::RunTest()
   RunTestSIMD();
 }
 
+bool KFParticleTest::RunFinderTests()
+{
+  /** Runs the tests of KFParticleFinder and KFParticleTopoReconstructor with simulated events. Returns true if all of them pass. */
+  bool isPassed = true;
+  isPassed &= RunLatencyBudgetTest();
+  isPassed &= RunTriggerTest();
+  isPassed &= RunPIDHypothesesTest(10, 60);
+  isPassed &= RunTrackV0TilingBenchmark(2, 100);
+  isPassed &= RunNProngCharmBenchmark(2, 30);
+  isPassed &= RunSelectParticlesBenchmark(2, 50);
+  isPassed &= RunTimeFrameTest(10, 20);
+  std::cout << "KF Particle Finder tests " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
 void KFParticleTest::RunTestSingle()
 {
   std::cout.setf(std::ios::fixed);
@@ -214,6 +250,1470 @@ void KFParticleTest::RunTestSIMD()
 {
 }
 
+/** @brief Particle with the daughter indices in std::vector, as they were stored before KFPDaughterIds. The particle itself
+ ** has no daughters, so the copy of both members costs the same as the copy of KFParticle with the heap storage.
+ ** Is used as a reference in KFParticleTest::RunDaughterIdsBenchmark(). */
+struct KFParticleWithVectorIds
+{
+  KFParticle fParticle;          ///< Particle without daughter indices.
+  std::vector<int> fDaughterIds; ///< Indices of the daughters on the heap.
+};
+
+void KFParticleTest::RunDaughterIdsBenchmark(int nParticles, int nRepeat)
+{
+  /** Measures the time of copying of 2-daughter particles, which keep indices of daughters inline in KFPDaughterIds,
+   ** and of copying of the same particles with the indices stored in std::vector, as was done before, which requires 
+   ** an allocation for each copy. Both arrays contain the full particles, so only the storage of the indices differs.
+   ** \param[in] nParticles - number of particles in the copied array
+   ** \param[in] nRepeat - number of copies of the array
+   **/
+  std::vector<KFParticle> particles(nParticles);
+  std::vector<KFParticleWithVectorIds> vectorIdsParticles(nParticles);
+  for(int iP=0; iP<nParticles; iP++)
+  {
+    particles[iP].X() = float(iP);
+    particles[iP].AddDaughterId(2*iP);
+    particles[iP].AddDaughterId(2*iP+1);
+    vectorIdsParticles[iP].fParticle.X() = float(iP);
+    vectorIdsParticles[iP].fDaughterIds.push_back(2*iP);
+    vectorIdsParticles[iP].fDaughterIds.push_back(2*iP+1);
+  }
+
+  long checkSum = 0;
+  
+  std::clock_t start = std::clock();
+  for(int iRepeat=0; iRepeat<nRepeat; iRepeat++)
+  {
+    std::vector<KFParticle> copy(particles);
+    checkSum += copy[iRepeat % nParticles].DaughterIds()[1];
+  }
+  const double timeParticles = double(std::clock() - start)/CLOCKS_PER_SEC;
+
+  start = std::clock();
+  for(int iRepeat=0; iRepeat<nRepeat; iRepeat++)
+  {
+    std::vector<KFParticleWithVectorIds> copy(vectorIdsParticles);
+    checkSum += copy[iRepeat % nParticles].fDaughterIds[1];
+  }
+  const double timeVectors = double(std::clock() - start)/CLOCKS_PER_SEC;
+  
+  const double nCopies = double(nParticles)*double(nRepeat);
+  std::cout << "Copy of a particle with inline daughter ids:         " << timeParticles/nCopies*1.e9 << " ns" << std::endl
+            << "Copy of a particle with daughter ids in std::vector: " << timeVectors/nCopies*1.e9 << " ns, "
+            << nParticles*nRepeat << " allocations" << std::endl
+            << "Check sum: " << checkSum << std::endl;
+}
+
+void KFParticleTest::RunExportBenchmark(int nRepeat)
+{
+  /** Measures the time of export of the selected elements of KFParticleSIMD: element by element with KFParticleSIMD::GetKFParticle(),
+   ** with the bulk copy KFParticleSIMD::GetKFParticles() to std::vector<KFParticle> and to the columns of KFPParticleVector.
+   ** Every second element of the SIMD vector is selected.
+   ** \param[in] nRepeat - number of exported SIMD vectors
+   **/
+  KFParticle particles[float_vLen];
+  KFParticle* particlePointers[float_vLen];
+  for(int iV=0; iV<float_vLen; iV++)
+  {
+    for(int iP=0; iP<8; iP++)
+      particles[iV].Parameters()[iP] = iV + 0.1f*iP;
+    for(int iC=0; iC<36; iC++)
+      particles[iV].CovarianceMatrix()[iC] = 0.01f*iC;
+    particles[iV].AddDaughterId(2*iV);
+    particles[iV].AddDaughterId(2*iV+1);
+    particlePointers[iV] = &particles[iV];
+  }
+  KFParticleSIMD particleSIMD(particlePointers, float_vLen);
+  
+  float_m mask(false);
+  for(int iV=0; iV<float_vLen; iV+=2)
+    mask[iV] = true;
+  
+  const int nBuffer = 10000; //outputs are cleaned regularly to keep them in cache
+  std::vector<KFParticle> output;
+  output.reserve(nBuffer*float_vLen);
+  KFPParticleVector outputSoA;
+  KFParticle particle;
+  
+  std::clock_t start = std::clock();
+  for(int iRepeat=0; iRepeat<nRepeat; iRepeat++)
+  {
+    if(iRepeat % nBuffer == 0) output.clear();
+    for(int iV=0; iV<float_vLen; iV++)
+    {
+      if(!mask[iV]) continue;
+      particleSIMD.GetKFParticle(particle, iV);
+      output.push_back(particle);
+    }
+  }
+  const double timeLane = double(std::clock() - start)/CLOCKS_PER_SEC;
+  
+  start = std::clock();
+  for(int iRepeat=0; iRepeat<nRepeat; iRepeat++)
+  {
+    if(iRepeat % nBuffer == 0) output.clear();
+    particleSIMD.GetKFParticles(output, mask);
+  }
+  const double timeBulk = double(std::clock() - start)/CLOCKS_PER_SEC;
+  
+  start = std::clock();
+  for(int iRepeat=0; iRepeat<nRepeat; iRepeat++)
+  {
+    if(iRepeat % nBuffer == 0) outputSoA.Clear();
+    particleSIMD.GetKFParticles(outputSoA, mask);
+  }
+  const double timeSoA = double(std::clock() - start)/CLOCKS_PER_SEC;
+  
+  const double nExported = double(nRepeat)*double(mask.count());
+  std::cout << "Export of a particle with GetKFParticle():                 " << timeLane/nExported*1.e9 << " ns" << std::endl
+            << "Export of a particle with GetKFParticles() to KFParticle:  " << timeBulk/nExported*1.e9 << " ns" << std::endl
+            << "Export of a particle with GetKFParticles() to KFPParticleVector: " << timeSoA/nExported*1.e9 << " ns" << std::endl
+            << "Check: " << output.size() << " " << outputSoA.Size() << std::endl;
+}
+
+bool KFParticleTest::RunCovarianceCodecTest(int nMatrices)
+{
+  /** Checks KFPCovarianceCodec on random covariance matrices: the decoded matrices should be positive-definite, the relative
+   ** error of sigmas and the absolute error of the correlation coefficients should stay within the documented bounds.
+   ** Every second matrix is constructed with strongly correlated parameters to be close to singular. The time of encoding and 
+   ** decoding is measured. The test passes if all decoded matrices are positive-definite, the relative error of sigmas is below
+   ** 4e-4 and the error of the correlation coefficients is below 5e-4.
+   ** \param[in] nMatrices - number of tested matrices
+   **/
+  std::srand(1);
+  const int nVectors = (nMatrices + float_vLen - 1)/float_vLen;
+  std::vector<float_v, KFPSimdAllocator<float_v> > input(nVectors*36), output(nVectors*36);
+  std::vector<unsigned short> code(nVectors*float_vLen*KFPCovarianceCodec::fNWords);
+  
+  for(int iVector=0; iVector<nVectors; iVector++)
+  {
+    for(int iV=0; iV<float_vLen; iV++)
+    {
+      //C = A A^T, A is lower triangular with the scales of the parameters from 1e-4 to 1e2
+      const bool isCorrelated = ((iVector*float_vLen + iV) % 2 == 1);
+      double A[8][8];
+      for(int i=0; i<8; i++)
+      {
+        const double scale = pow(10., -4. + 6.*double(std::rand())/RAND_MAX);
+        for(int j=0; j<8; j++)
+          A[i][j] = (j > i) ? 0. : scale*(2.*double(std::rand())/RAND_MAX - 1.);
+        //the diagonal element is kept away from zero, otherwise the matrix is singular already in the float precision
+        A[i][i] = scale*(0.2 + 0.8*double(std::rand())/RAND_MAX);
+        if(isCorrelated && i > 0)
+        {
+          //the row is almost parallel to the previous one
+          double norm = 0.;
+          for(int j=0; j<i; j++)
+            norm += A[i-1][j]*A[i-1][j];
+          norm = sqrt(norm);
+          for(int j=0; j<i; j++)
+            A[i][j] = scale*A[i-1][j]/norm;
+          A[i][i] *= 0.1;
+        }
+      }
+      for(int i=0; i<8; i++)
+        for(int j=0; j<=i; j++)
+        {
+          double c = 0.;
+          for(int k=0; k<8; k++)
+            c += A[i][k]*A[j][k];
+          input[iVector*36 + i*(i+1)/2+j][iV] = c;
+        }
+    }
+  }
+  
+  std::clock_t start = std::clock();
+  for(int iVector=0; iVector<nVectors; iVector++)
+    KFPCovarianceCodec::Encode(&input[iVector*36], &code[iVector*float_vLen*KFPCovarianceCodec::fNWords]);
+  const double timeEncode = double(std::clock() - start)/CLOCKS_PER_SEC;
+  
+  start = std::clock();
+  for(int iVector=0; iVector<nVectors; iVector++)
+    KFPCovarianceCodec::Decode(&code[iVector*float_vLen*KFPCovarianceCodec::fNWords], &output[iVector*36]);
+  const double timeDecode = double(std::clock() - start)/CLOCKS_PER_SEC;
+  
+  int nNotPositiveDefinite = 0;
+  double maxSigmaError = 0.;
+  double maxCorrelationError = 0.;
+  for(int iVector=0; iVector<nVectors; iVector++)
+  {
+    for(int iV=0; iV<float_vLen; iV++)
+    {
+      double C[36], CIn[36];
+      for(int iC=0; iC<36; iC++)
+      {
+        C[iC] = output[iVector*36+iC][iV];
+        CIn[iC] = input[iVector*36+iC][iV];
+      }
+      
+      for(int i=0; i<8; i++)
+      {
+        const double sigma = sqrt(C[i*(i+3)/2]), sigmaIn = sqrt(CIn[i*(i+3)/2]);
+        if(sigmaIn > 0.)
+          maxSigmaError = std::max(maxSigmaError, fabs(sigma/sigmaIn - 1.));
+        for(int j=0; j<i; j++)
+        {
+          const double r = C[i*(i+1)/2+j]/sqrt(C[i*(i+3)/2]*C[j*(j+3)/2]);
+          const double rIn = CIn[i*(i+1)/2+j]/sqrt(CIn[i*(i+3)/2]*CIn[j*(j+3)/2]);
+          maxCorrelationError = std::max(maxCorrelationError, fabs(r - rIn));
+        }
+      }
+      
+      //Cholesky decomposition of the decoded matrix, all pivots should be positive
+      double L[36];
+      bool isPositiveDefinite = true;
+      for(int i=0; i<8 && isPositiveDefinite; i++)
+        for(int j=0; j<=i; j++)
+        {
+          double s = C[i*(i+1)/2+j];
+          for(int k=0; k<j; k++)
+            s -= L[i*(i+1)/2+k]*L[j*(j+1)/2+k];
+          if(j < i)
+            L[i*(i+1)/2+j] = s/L[j*(j+1)/2+j];
+          else if(s > 0.)
+            L[i*(i+1)/2+i] = sqrt(s);
+          else
+            isPositiveDefinite = false;
+        }
+      if(!isPositiveDefinite)
+        nNotPositiveDefinite++;
+    }
+  }
+  
+  const double nTested = double(nVectors)*double(float_vLen);
+  std::cout << "Covariance codec: " << nTested << " matrices, " << 36*sizeof(float) << " -> " 
+            << KFPCovarianceCodec::fNWords*sizeof(unsigned short) << " bytes per matrix" << std::endl
+            << "  not positive-definite after decoding: " << nNotPositiveDefinite << std::endl
+            << "  max relative error of sigma:          " << maxSigmaError << std::endl
+            << "  max error of correlation:             " << maxCorrelationError << std::endl
+            << "  encoding time per matrix:             " << timeEncode/nTested*1.e9 << " ns" << std::endl
+            << "  decoding time per matrix:             " << timeDecode/nTested*1.e9 << " ns" << std::endl;
+  
+  const bool isPassed = (nNotPositiveDefinite == 0) && (maxSigmaError < 4.e-4) && (maxCorrelationError < 5.e-4);
+  std::cout << "  " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
+static bool OpenCorruptedCandidateFile(const std::string& fileName, const std::vector<char>& bytes, KFPCandidateReader& reader)
+{
+  /** Writes a modified copy of the candidate file for KFParticleTest::RunCandidateFileTest() and opens it with "reader". */
+  {
+    std::ofstream out(fileName.data(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!bytes.empty())
+      out.write(&bytes[0], bytes.size());
+  }
+  return reader.Open(fileName);
+}
+
+bool KFParticleTest::RunCandidateFileTest(int nEvents, int nParticles)
+{
+  /** Checks the round trip of candidates through a file written by KFPCandidateWriter and mapped by KFPCandidateReader.
+   ** Each event contains "nParticles" random particles with 0 to 3 daughters, the blocks are kept small, so that events are
+   ** spread over several blocks. The stored columns are compared with the written particles, then the file is truncated and 
+   ** its footer and the index of the columns are corrupted. The test passes if all values are read back exactly, indices of 
+   ** blocks and columns out of range are rejected, truncated files and files with a corrupted footer can not be opened and 
+   ** columns with corrupted offsets or sizes are rejected without being read.
+   ** \param[in] nEvents - number of events in the file
+   ** \param[in] nParticles - number of particles in each event
+   **/
+  const std::string fileName = "KFPCandidateFileTest.data";
+  const std::string corruptedFileName = "KFPCandidateFileTest.corrupted.data";
+  
+  std::vector<KFParticle> written;
+  std::vector<int> writtenEvent;
+  KFPCandidateWriter writer;
+  writer.Open(fileName, 100);
+  for(int iEvent=0; iEvent<nEvents; iEvent++)
+  {
+    std::vector<KFParticle> particles(nParticles);
+    for(int iParticle=0; iParticle<nParticles; iParticle++)
+    {
+      KFParticle& particle = particles[iParticle];
+      for(int iP=0; iP<8; iP++)
+      {
+        particle.Parameter(iP) = -10. + 20.*double(std::rand())/RAND_MAX;
+        particle.Covariance(iP, iP) = 1.e-4 + double(std::rand())/RAND_MAX;
+      }
+      particle.Chi2() = 10.*double(std::rand())/RAND_MAX;
+      particle.NDF() = iParticle%5;
+      particle.SetPDG((iParticle%2 == 0) ? 310 : -3122);
+      particle.SetId(iParticle);
+      particle.CleanDaughtersId();
+      for(int iD=0; iD<iParticle%4; iD++)
+        particle.AddDaughterId(iParticle*10 + iD);
+      written.push_back(particle);
+      writtenEvent.push_back(iEvent);
+    }
+    writer.AddEvent(particles, std::vector<KFParticle>());
+  }
+  writer.Close();
+  
+  // round trip
+  int nWrong = 0;
+  int nRead = 0;
+  bool isRangeChecked = true;
+  KFPCandidateReader reader;
+  const bool isOpened = reader.Open(fileName);
+  for(int iBlock=0; iBlock<reader.GetNBlocks(); iBlock++)
+  {
+    std::vector<float> floatColumns[KFPCandidateWriter::kNColumns];
+    std::vector<int> intColumns[KFPCandidateWriter::kNColumns];
+    for(int iColumn=0; iColumn<KFPCandidateWriter::kNColumns; iColumn++)
+    {
+      if(!reader.ReadColumn(iBlock, iColumn, floatColumns[iColumn]) || !reader.ReadColumn(iBlock, iColumn, intColumns[iColumn]))
+        nWrong++;
+    }
+    
+    for(int iRow=0; iRow<reader.GetNRows(iBlock) && nRead<int(written.size()); iRow++, nRead++)
+    {
+      const KFParticle& particle = written[nRead];
+      bool isSame = (intColumns[KFPCandidateWriter::kPDG][iRow] == particle.GetPDG()) && 
+                    (intColumns[KFPCandidateWriter::kId][iRow] == particle.Id()) &&
+                    (intColumns[KFPCandidateWriter::kNDF][iRow] == particle.GetNDF()) &&
+                    (intColumns[KFPCandidateWriter::kEvent][iRow] == writtenEvent[nRead]) &&
+                    (intColumns[KFPCandidateWriter::kPVIndex][iRow] == -1) &&
+                    (floatColumns[KFPCandidateWriter::kChi2][iRow] == particle.GetChi2()) &&
+                    (intColumns[KFPCandidateWriter::kNDaughters][iRow] == particle.NDaughters());
+      for(int iP=0; iP<8 && isSame; iP++)
+        isSame = (floatColumns[KFPCandidateWriter::kX + iP][iRow] == particle.GetParameter(iP)) &&
+                 (floatColumns[KFPCandidateWriter::kC00 + iP][iRow] == particle.GetCovariance(iP, iP));
+      const int daughterOffset = intColumns[KFPCandidateWriter::kDaughterOffset][iRow];
+      for(int iD=0; iD<particle.NDaughters() && isSame; iD++)
+        isSame = (daughterOffset + iD < int(intColumns[KFPCandidateWriter::kDaughterIds].size())) &&
+                 (intColumns[KFPCandidateWriter::kDaughterIds][daughterOffset + iD] == particle.DaughterIds()[iD]);
+      if(!isSame)
+        nWrong++;
+    }
+  }
+  if(nRead != int(written.size()))
+    nWrong++;
+  
+  std::vector<float> values;
+  isRangeChecked &= !reader.ReadColumn(-1, 0, values) && !reader.ReadColumn(reader.GetNBlocks(), 0, values);
+  isRangeChecked &= !reader.ReadColumn(0, -1, values) && !reader.ReadColumn(0, KFPCandidateWriter::kNColumns, values);
+  isRangeChecked &= (reader.GetNRows(reader.GetNBlocks()) == -1);
+  reader.Close();
+  
+  // corrupted copies of the file
+  std::vector<char> bytes;
+  {
+    std::ifstream in(fileName.data(), std::ios::in | std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  std::remove(fileName.data());
+  
+  unsigned int trailer[3];
+  memcpy(trailer, &bytes[bytes.size() - sizeof(trailer)], sizeof(trailer));
+  const unsigned long long footerOffset = (static_cast<unsigned long long>(trailer[1]) << 32) | trailer[0];
+  
+  int nAccepted = 0;
+  std::vector<char> corrupted;
+  // truncated files
+  corrupted.assign(bytes.begin(), bytes.end() - 1);
+  nAccepted += OpenCorruptedCandidateFile(corruptedFileName, corrupted, reader);
+  corrupted.assign(bytes.begin(), bytes.begin() + bytes.size()/2);
+  nAccepted += OpenCorruptedCandidateFile(corruptedFileName, corrupted, reader);
+  corrupted.assign(bytes.begin(), bytes.begin() + 10);
+  nAccepted += OpenCorruptedCandidateFile(corruptedFileName, corrupted, reader);
+  // footer: number of columns and blocks, offset of the footer in the trailer
+  const unsigned int wrongValues[3] = {0xffffffffu, 1, 0};
+  for(int iField=0; iField<2; iField++)
+    for(int iValue=0; iValue<3; iValue++)
+    {
+      corrupted = bytes;
+      unsigned int value = (iValue < 2) ? wrongValues[iValue] : reinterpret_cast<const unsigned int*>(&bytes[footerOffset])[iField] + 1;
+      memcpy(&corrupted[footerOffset + 4*iField], &value, sizeof(value));
+      nAccepted += OpenCorruptedCandidateFile(corruptedFileName, corrupted, reader);
+    }
+  for(int iValue=0; iValue<2; iValue++)
+  {
+    corrupted = bytes;
+    const unsigned int value = (iValue == 0) ? trailer[0] + 4 : 0xfffffff0u;
+    memcpy(&corrupted[bytes.size() - sizeof(trailer)], &value, sizeof(value));
+    nAccepted += OpenCorruptedCandidateFile(corruptedFileName, corrupted, reader);
+  }
+  
+  // index of the first column of the first block: offset, compressed size and number of values
+  int nColumnsAccepted = 0;
+  const unsigned long long columnIndexOffset = footerOffset + 4*(2 + 3);
+  const unsigned int wrongIndex[3][2] = { {0, static_cast<unsigned int>(footerOffset + 4)}, {0xffffff00u, static_cast<unsigned int>(bytes.size())}, {0x7fffffffu, 0xffffffffu} };
+  for(int iField=0; iField<3; iField++)
+    for(int iValue=0; iValue<2; iValue++)
+    {
+      corrupted = bytes;
+      memcpy(&corrupted[columnIndexOffset + 4*(iField == 0 ? 0 : iField + 1)], &wrongIndex[iField][iValue], sizeof(unsigned int));
+      if(OpenCorruptedCandidateFile(corruptedFileName, corrupted, reader))
+        nColumnsAccepted += reader.ReadColumn(0, 0, values);
+      else
+        nColumnsAccepted++;
+      reader.Close();
+    }
+  std::remove(corruptedFileName.data());
+  
+  std::cout << "Candidate file: " << nEvents << " events with " << nParticles << " particles, " << bytes.size() << " bytes" << std::endl
+            << "  candidates read back: " << nRead << " of " << written.size() << ", different: " << nWrong << std::endl
+            << "  corrupted files opened: " << nAccepted << ", corrupted columns read: " << nColumnsAccepted << std::endl;
+  
+  const bool isPassed = isOpened && (nWrong == 0) && isRangeChecked && (nAccepted == 0) && (nColumnsAccepted == 0);
+  std::cout << "  " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
+void KFParticleTest::RunSharedMemoryRingTest(int nEvents, int nTracks)
+{
+  /** Checks the transport of events between two processes with KFPSharedMemoryRing. The parent process sends input data 
+   ** to the child process, the child process creates a particle for each track of the first set and sends particles back
+   ** through the result ring. The parent process checks that the content of all events is preserved and measures the rate.
+   ** \param[in] nEvents - number of events to be transported
+   ** \param[in] nTracks - number of tracks in each event
+   **/
+  const std::string inputName = "/kfparticle_test_input";
+  const std::string outputName = "/kfparticle_test_output";
+  
+  KFPInputData data;
+  data.GetTracks()[0].Resize(nTracks);
+  
+  KFPSharedMemoryRing input, output;
+  if(!input.Create(inputName, 16, data.DataSize(), true) || !output.Create(outputName, 16, 51*nTracks + 1, true))
+  {
+    std::cout << "Shared memory ring: can not create the shared memory segments" << std::endl;
+    return;
+  }
+  
+  const pid_t pid = fork();
+  if(pid < 0)
+  {
+    std::cout << "Shared memory ring: fork failed" << std::endl;
+    return;
+  }
+  
+  if(pid == 0)
+  {
+    //consumer: read input data, send a particle for each track back
+    KFPSharedMemoryRing consumerInput, consumerOutput;
+    while(!consumerInput.Attach(inputName)) { }
+    while(!consumerOutput.Attach(outputName)) { }
+    
+    KFPInputData event;
+    std::vector<KFParticle> particles;
+    for(int iEvent=0; iEvent<nEvents; iEvent++)
+    {
+      while(!consumerInput.Read(event)) { }
+      
+      const KFPTrackVector& tracks = event.GetTracks()[0];
+      particles.resize(tracks.Size());
+      for(int iTr=0; iTr<tracks.Size(); iTr++)
+      {
+        for(int iP=0; iP<6; iP++)
+          particles[iTr].Parameter(iP) = tracks.Parameter(iP)[iTr];
+        // the time of the track and its error are sent back in the last parameter and its covariance
+        particles[iTr].Parameter(7) = tracks.T()[iTr];
+        particles[iTr].Covariance(35) = tracks.TErr()[iTr];
+        particles[iTr].SetId(tracks.Id()[iTr]);
+        particles[iTr].SetPDG(tracks.PDG()[iTr]);
+        particles[iTr].CleanDaughtersId();
+        particles[iTr].AddDaughterId(iTr);
+      }
+      
+      while(!consumerOutput.Write(particles)) { }
+    }
+    _exit(0);
+  }
+  
+  //producer: send input data and collect the results
+  std::vector<KFParticle> particles;
+  int nErrors = 0;
+  int nSent = 0, nReceived = 0, nFilled = 0;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while(nReceived < nEvents)
+  {
+    if(nSent < nEvents)
+    {
+      if(nFilled == nSent)
+      {
+        KFPTrackVector& tracks = data.GetTracks()[0];
+        for(int iTr=0; iTr<nTracks; iTr++)
+        {
+          for(int iP=0; iP<6; iP++)
+            tracks.SetParameter(float(nSent) + 0.1f*iP, iP, iTr);
+          tracks.SetId(nSent*nTracks + iTr, iTr);
+          tracks.SetPDG(211, iTr);
+          tracks.SetT(float(nSent) + 0.6f, iTr);
+          tracks.SetTErr(0.7f, iTr);
+        }
+        nFilled++;
+      }
+      if(input.Write(data))
+        nSent++;
+    }
+    
+    if(output.Read(particles))
+    {
+      if(int(particles.size()) != nTracks)
+        nErrors++;
+      else
+        for(int iTr=0; iTr<nTracks; iTr++)
+          if(particles[iTr].Id() != nReceived*nTracks + iTr || particles[iTr].GetPDG() != 211 || 
+             particles[iTr].GetParameter(5) != float(nReceived) + 0.5f || particles[iTr].DaughterIds()[0] != iTr ||
+             particles[iTr].GetParameter(7) != float(nReceived) + 0.6f || particles[iTr].GetCovariance(35) != 0.7f)
+          {
+            nErrors++;
+            break;
+          }
+      nReceived++;
+    }
+  }
+  const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  int status = 0;
+  waitpid(pid, &status, 0);
+  
+  std::cout << "Shared memory ring: " << nEvents << " events with " << nTracks << " tracks, " 
+            << data.DataSize()*sizeof(int) << " bytes per event" << std::endl
+            << "  events with errors: " << nErrors << std::endl
+            << "  time per event:     " << time/nEvents*1.e6 << " us" << std::endl;
+}
+
+static double ProcessInputData(KFPInputData& data)
+{
+  /** Imitates reconstruction of the event for KFParticleTest::RunInputDataPrefetcherTest(), returns a checksum of the event. */
+  double sum = 0.;
+  for(int iSet=0; iSet<NInputSets; iSet++)
+  {
+    const KFPTrackVector& tracks = data.GetTracks()[iSet];
+    for(int iTr=0; iTr<tracks.Size(); iTr++)
+    {
+      double p2 = 0.;
+      for(int iP=3; iP<6; iP++)
+        p2 += tracks.Parameter(iP)[iTr]*tracks.Parameter(iP)[iTr];
+      for(int iRepeat=0; iRepeat<20; iRepeat++)
+        p2 = sqrt(p2 + 0.13957*0.13957);
+      sum += p2 + tracks.Id()[iTr];
+    }
+  }
+  return sum;
+}
+
+void KFParticleTest::RunInputDataPrefetcherTest(int nEvents, int nTracks)
+{
+  /** Compares the blocking reading of events from the binary file with KFPInputDataPrefetcher. The file is written
+   ** first, then it is processed in both modes with the same imitation of the reconstruction, the checksums of 
+   ** events and the total time are compared.
+   ** \param[in] nEvents - number of events in the file
+   ** \param[in] nTracks - number of tracks in each input set of each event
+   **/
+  const std::string fileName = "KFPInputDataPrefetcherTest.data";
+  {
+    std::ofstream out(fileName.data(), std::ios::out | std::ios::binary | std::ios::trunc);
+    KFPInputData data;
+    for(int iSet=0; iSet<NInputSets; iSet++)
+      data.GetTracks()[iSet].Resize(nTracks);
+    for(int iEvent=0; iEvent<nEvents; iEvent++)
+    {
+      for(int iSet=0; iSet<NInputSets; iSet++)
+        for(int iTr=0; iTr<nTracks; iTr++)
+        {
+          for(int iP=0; iP<6; iP++)
+            data.GetTracks()[iSet].SetParameter(double(std::rand())/RAND_MAX, iP, iTr);
+          data.GetTracks()[iSet].SetId(iEvent*nTracks + iTr, iTr);
+        }
+      KFPBinaryInputDataSource::WriteEvent(out, data);
+    }
+  }
+  
+  std::vector<double> checksumBlocking, checksumPrefetched;
+  
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    KFPBinaryInputDataSource source(fileName);
+    KFPInputData data;
+    while(source.ReadEvent(data))
+      checksumBlocking.push_back(ProcessInputData(data));
+  }
+  const double timeBlocking = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  start = std::chrono::steady_clock::now();
+  {
+    KFPBinaryInputDataSource source(fileName);
+    KFPInputDataPrefetcher prefetcher;
+    prefetcher.Start(&source, 4);
+    int iEvent = 0;
+    KFPInputData* data = 0;
+    while((data = prefetcher.GetNextEvent(iEvent)))
+    {
+      checksumPrefetched.push_back(ProcessInputData(*data));
+      prefetcher.ReleaseEvent(data);
+    }
+  }
+  const double timePrefetched = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  std::remove(fileName.data());
+  
+  // events in the layout of another version or truncated events should be rejected
+  bool isRejected = true;
+  {
+    KFPInputData data;
+    for(int iSet=0; iSet<NInputSets; iSet++)
+      data.GetTracks()[iSet].Resize(nTracks);
+    std::vector<int> buffer(data.DataSize());
+    int dataSize = 0;
+    data.SetDataToVector(&buffer[0], dataSize);
+    
+    KFPInputData readData;
+    isRejected &= !readData.ReadDataFromVector(&buffer[0], dataSize-1);
+    buffer[NInputSets+2]--;
+    isRejected &= !readData.ReadDataFromVector(&buffer[0], dataSize);
+  }
+  
+  const bool isConsistent = (checksumBlocking == checksumPrefetched) && (int(checksumBlocking.size()) == nEvents);
+  std::cout << "Input data prefetcher: " << nEvents << " events with " << NInputSets*nTracks << " tracks" << std::endl
+            << "  results are consistent: " << (isConsistent ? "yes" : "no") << std::endl
+            << "  other layouts rejected: " << (isRejected ? "yes" : "no") << std::endl
+            << "  blocking reading:       " << timeBlocking/nEvents*1.e3 << " ms per event" << std::endl
+            << "  prefetching reading:    " << timePrefetched/nEvents*1.e3 << " ms per event" << std::endl;
+}
+
+static void SetTestTrack(KFPTrackVector& tracks, int iTr, const float* r, const float* p, int q, int pdg, int pidMask, int id)
+{
+  /** Sets a track with the position "r", the momentum "p" and a diagonal covariance matrix for the tests with simulated decays. */
+  const int diagonal[6] = {0, 2, 5, 9, 14, 20};
+  for(int iC=0; iC<21; iC++)
+    tracks.SetCovariance(0.f, iC, iTr);
+  for(int i=0; i<3; i++)
+  {
+    tracks.SetParameter(r[i], i, iTr);
+    tracks.SetParameter(p[i], i+3, iTr);
+    tracks.SetCovariance(1.e-4f, diagonal[i], iTr);
+    tracks.SetCovariance(1.e-5f, diagonal[i+3], iTr);
+  }
+  tracks.SetId(id, iTr);
+  tracks.SetPDG(pdg, iTr);
+  tracks.SetQ(q, iTr);
+  tracks.SetPVIndex(-1, iTr);
+  tracks.SetNPixelHits(0, iTr);
+  tracks.SetPIDMask(pidMask, iTr);
+  tracks.SetT(0.f, iTr);
+  tracks.SetTErr(-1.f, iTr);
+}
+
+static double Random(double min, double max) { return min + (max - min)*double(std::rand())/RAND_MAX; } ///< Uniform random number for the tests.
+
+static void SimulateTwoBodyDecay(const float motherMass, const float* daughterMass, const float* origin, const float* pMother, float* r, float p[2][3])
+{
+  /** Simulates the isotropic two-body decay of the particle produced at the point "origin" with the momentum "pMother"
+   ** without magnetic field, returns the decay point "r" and the momenta of the daughters "p". */
+  const float pStar = sqrt((motherMass*motherMass - (daughterMass[0]+daughterMass[1])*(daughterMass[0]+daughterMass[1]))*
+                           (motherMass*motherMass - (daughterMass[0]-daughterMass[1])*(daughterMass[0]-daughterMass[1])))/(2.f*motherMass);
+  const float cosTheta = Random(-1., 1.);
+  const float phi = Random(0., 2.*M_PI);
+  const float n[3] = { float(sqrt(1.f - cosTheta*cosTheta)*cos(phi)), float(sqrt(1.f - cosTheta*cosTheta)*sin(phi)), cosTheta };
+  
+  //boost from the rest frame of the mother particle to the laboratory frame
+  const float pMotherAbs = sqrt(pMother[0]*pMother[0] + pMother[1]*pMother[1] + pMother[2]*pMother[2]);
+  const float eMother = sqrt(pMotherAbs*pMotherAbs + motherMass*motherMass);
+  const float gamma = eMother/motherMass;
+  const float beta = pMotherAbs/eMother;
+  const float decayLength = Random(2., 20.);
+  for(int i=0; i<3; i++)
+    r[i] = origin[i] + pMother[i]/pMotherAbs*decayLength;
+  for(int iD=0; iD<2; iD++)
+  {
+    const float sign = (iD == 0) ? 1.f : -1.f;
+    const float e = sqrt(pStar*pStar + daughterMass[iD]*daughterMass[iD]);
+    float pParallel = 0.f;
+    for(int i=0; i<3; i++)
+      pParallel += sign*pStar*n[i]*pMother[i]/pMotherAbs;
+    for(int i=0; i<3; i++)
+      p[iD][i] = sign*pStar*n[i] + ((gamma - 1.f)*pParallel + gamma*beta*e)*pMother[i]/pMotherAbs;
+  }
+}
+
+static float SwitchOffTestField()
+{
+  /** Switches off the magnetic field for the tests with decays simulated without magnetic field, returns the field to be 
+   ** restored with RestoreTestField(). */
+#ifdef HomogeneousField
+  const float xyz[3] = {0.f, 0.f, 0.f};
+  float field[3] = {0.f, 0.f, 0.f};
+  KFParticle().GetFieldValue(xyz, field);
+  KFParticle::SetField(0.f);
+  KFParticleSIMD::SetField(0.f);
+  return field[2];
+#else
+  return 0.f;
+#endif
+}
+
+static void RestoreTestField(const float field)
+{
+  /** Restores the magnetic field switched off by SwitchOffTestField(). */
+#ifdef HomogeneousField
+  KFParticle::SetField(field);
+  KFParticleSIMD::SetField(field);
+#else
+  (void)field;
+#endif
+}
+
+static void SmearTestTracks(KFPTrackVector& tracks)
+{
+  /** Smears positions of the simulated tracks within the errors, otherwise the true decays are fitted with zero chi2.
+   ** Tracks get consecutive Ids and 3 pixel hits. */
+  for(int iTr=0; iTr<tracks.Size(); iTr++)
+  {
+    for(int iP=0; iP<3; iP++)
+      tracks.SetParameter(tracks.Parameter(iP)[iTr] + Random(-0.01, 0.01), iP, iTr);
+    tracks.SetId(iTr, iTr);
+    tracks.SetNPixelHits(3, iTr);
+  }
+}
+
+static void InitTestEvent(KFParticleTopoReconstructor& topo, KFPTrackVector& tracks, const int nContributors)
+{
+  /** Initialises the topology reconstructor with simulated tracks and the primary vertex at the origin with "nContributors"
+   ** tracks, the tracks are sorted and the event is ready for KFParticleTopoReconstructor::ReconstructParticles(). */
+  topo.Init(tracks, tracks);
+  KFPVertex primVtx;
+  primVtx.SetXYZ(0.f, 0.f, 0.f);
+  primVtx.SetCovarianceMatrix(1.e-6f, 0.f, 1.e-6f, 0.f, 0.f, 1.e-6f);
+  primVtx.SetNContributors(nContributors);
+  primVtx.SetChi2(1.f);
+  topo.AddPV(KFVertex(primVtx));
+  topo.SortTracks();
+}
+
+bool KFParticleTest::RunLatencyBudgetTest(int nEvents, int nDecays)
+{
+  /** Checks that a mandatory group of channels gets its input candidates when the latency budget is exhausted, see
+   ** KFParticleTopoReconstructor::SetLatencyBudget(). Events with "nDecays" decays Xi*0 -> Xi- pi+, Xi- -> Lambda pi-,
+   ** Lambda -> p pi- are simulated without magnetic field and reconstructed without the budget and with the budget
+   ** of 1 ns, where the group of resonances is mandatory. The test passes if the same Xi*0 candidates are found in both
+   ** cases, the group of strange baryons is run as the prerequisite and the other groups are skipped.
+   ** \param[in] nEvents - number of events
+   ** \param[in] nDecays - number of Xi*0 decays in each event
+   **/
+  const float field = SwitchOffTestField();
+  
+  int nCandidates[2] = {0, 0};
+  bool isStatusCorrect = true;
+  for(int iEvent=0; iEvent<nEvents; iEvent++)
+  {
+    KFPTrackVector tracks;
+    tracks.Resize(4*nDecays);
+    for(int iDecay=0; iDecay<nDecays; iDecay++)
+    {
+      const float massXiStar[2] = {1.32171f, 0.13957f};
+      const float massXi[2] = {1.115683f, 0.13957f};
+      const float massLambda[2] = {0.938272f, 0.13957f};
+      const float origin[3] = {0.f, 0.f, 0.f};
+      const float pXiStar[3] = { float(Random(-0.5, 0.5)), float(Random(-0.5, 0.5)), float(Random(2., 6.)) };
+      float r[3], pXiStarDaughters[2][3], rXi[3], pXiDaughters[2][3], rLambda[3], pLambdaDaughters[2][3];
+      SimulateTwoBodyDecay(1.5318f, massXiStar, origin, pXiStar, r, pXiStarDaughters);
+      //Xi*0 is a resonance and decays at the primary vertex
+      SimulateTwoBodyDecay(1.32171f, massXi, origin, pXiStarDaughters[0], rXi, pXiDaughters);
+      SimulateTwoBodyDecay(1.115683f, massLambda, rXi, pXiDaughters[0], rLambda, pLambdaDaughters);
+      SetTestTrack(tracks, 4*iDecay,   rLambda, pLambdaDaughters[0],  1, 2212, 0, 0);
+      SetTestTrack(tracks, 4*iDecay+1, rLambda, pLambdaDaughters[1], -1, -211, 0, 0);
+      SetTestTrack(tracks, 4*iDecay+2, rXi,     pXiDaughters[1],     -1, -211, 0, 0);
+      SetTestTrack(tracks, 4*iDecay+3, origin,  pXiStarDaughters[1],  1,  211, 0, 0);
+    }
+    SmearTestTracks(tracks);
+    for(int iDecay=0; iDecay<nDecays; iDecay++)
+      tracks.SetPVIndex(0, 4*iDecay+3);
+    
+    for(int iMode=0; iMode<2; iMode++)
+    {
+      KFParticleTopoReconstructor topo;
+      KFParticleFinder* finder = topo.GetKFParticleFinder();
+      finder->AddDecayToReconstructionList(3122);
+      finder->AddDecayToReconstructionList(3312);
+      finder->AddDecayToReconstructionList(3324);
+      if(iMode == 1)
+      {
+        topo.SetLatencyBudget(1.e-9);
+        finder->SetChannelGroupPriority(KFParticleFinder::kResonances, finder->GetMandatoryChannelPriority());
+      }
+      InitTestEvent(topo, tracks, nDecays);
+      topo.ReconstructParticles();
+      
+      const std::vector<KFParticle>& particles = topo.GetParticles();
+      for(unsigned int iParticle=0; iParticle<particles.size(); iParticle++)
+        if(particles[iParticle].GetPDG() == 3324)
+          nCandidates[iMode]++;
+      
+      if(iMode == 1)
+        isStatusCorrect &= (finder->GetChannelGroupStatus(KFParticleFinder::kResonances) == KFParticleFinder::kChannelDone) &&
+                           (finder->GetChannelGroupStatus(KFParticleFinder::kStrangeBaryons) == KFParticleFinder::kChannelDone) &&
+                           (finder->GetChannelGroupStatus(KFParticleFinder::kCharm) == KFParticleFinder::kChannelSkipped);
+    }
+  }
+  
+  RestoreTestField(field);
+  
+  const bool isPassed = (nCandidates[0] > 0) && (nCandidates[0] == nCandidates[1]) && isStatusCorrect;
+  std::cout << "Latency budget: " << nEvents << " events with " << nDecays << " Xi*0 -> Xi- pi+ decays" << std::endl
+            << "  Xi*0 candidates without budget:       " << nCandidates[0] << std::endl
+            << "  Xi*0 candidates with exhausted budget: " << nCandidates[1] << std::endl
+            << "  status of the groups is correct:      " << (isStatusCorrect ? "yes" : "no") << std::endl
+            << "  " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
+bool KFParticleTest::RunTriggerTest(int nEvents, int nDecays)
+{
+  /** Checks the trigger mode with the D0 condition, see KFParticleFinder::AddTriggerCondition(). Events with "nDecays" decays 
+   ** D0 -> K- pi+ and events with "nDecays" decays K0s -> pi+ pi- are simulated without magnetic field. D0 candidates are stored only
+   ** by the open charm group of channels. The test passes if the trigger fires in all D0 events and in none of the K0s events.
+   ** \param[in] nEvents - number of events of each type
+   ** \param[in] nDecays - number of decays in each event
+   **/
+  const float field = SwitchOffTestField();
+  
+  int nFired[2] = {0, 0};
+  for(int iEvent=0; iEvent<2*nEvents; iEvent++)
+  {
+    const bool isD0 = (iEvent < nEvents);
+    KFPTrackVector tracks;
+    tracks.Resize(2*nDecays);
+    for(int iDecay=0; iDecay<nDecays; iDecay++)
+    {
+      const float motherMass = isD0 ? 1.86484f : 0.497611f;
+      const float daughterMass[2] = { isD0 ? 0.493677f : 0.13957f, 0.13957f };
+      const int daughterPDG[2] = { isD0 ? -321 : -211, 211 };
+      const float origin[3] = {0.f, 0.f, 0.f};
+      const float pMother[3] = { float(Random(-0.5, 0.5)), float(Random(-0.5, 0.5)), float(Random(2., 6.)) };
+      float r[3], p[2][3];
+      SimulateTwoBodyDecay(motherMass, daughterMass, origin, pMother, r, p);
+      SetTestTrack(tracks, 2*iDecay,   r, p[0], -1, daughterPDG[0], 0, 0);
+      SetTestTrack(tracks, 2*iDecay+1, r, p[1],  1, daughterPDG[1], 0, 0);
+    }
+    SmearTestTracks(tracks);
+    
+    KFParticleTopoReconstructor topo;
+    topo.GetKFParticleFinder()->AddTriggerCondition(421);
+    InitTestEvent(topo, tracks, tracks.Size());
+    topo.ReconstructParticles();
+    if(topo.GetKFParticleFinder()->IsTriggered())
+      nFired[isD0 ? 0 : 1]++;
+  }
+  
+  RestoreTestField(field);
+  
+  std::cout << "Trigger on D0: " << nEvents << " D0 -> K- pi+ and " << nEvents << " K0s -> pi+ pi- events with " << nDecays << " decays" << std::endl
+            << "  channel group of D0:       " << KFParticleFinder::GetChannelGroupOfPDG(421) << " (open charm: " << KFParticleFinder::kCharm << ")" << std::endl
+            << "  fired in D0 events:        " << nFired[0] << " of " << nEvents << std::endl
+            << "  fired in K0s events:       " << nFired[1] << " of " << nEvents << std::endl;
+  
+  const bool isPassed = (nFired[0] == nEvents) && (nFired[1] == 0);
+  std::cout << "  " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
+static std::tuple<int, int, int> GetCandidateTracks(const std::vector<KFParticle>& particles, const KFParticle& candidate)
+{
+  /** Returns sorted indices of the input tracks of the candidate with up to three daughter tracks, "-1" for missing tracks. */
+  int tracks[3] = {-1, -1, -1};
+  int nTracks = 0;
+  for(int iD=0; iD<candidate.NDaughters(); iD++)
+  {
+    const KFParticle& daughter = particles[candidate.DaughterIds()[iD]];
+    if(daughter.NDaughters() == 1)
+    {
+      if(nTracks < 3) tracks[nTracks] = daughter.DaughterIds()[0];
+      nTracks++;
+    }
+    else
+      for(int iDD=0; iDD<daughter.NDaughters(); iDD++)
+      {
+        if(nTracks < 3) tracks[nTracks] = particles[daughter.DaughterIds()[iDD]].DaughterIds()[0];
+        nTracks++;
+      }
+  }
+  std::sort(tracks, tracks + 3);
+  return std::make_tuple(tracks[0], tracks[1], tracks[2]);
+}
+
+bool KFParticleTest::RunPIDHypothesesTest(int nEvents, int nDecays)
+{
+  /** Compares reconstruction of K0s, Lambda and Xi- with the ambiguous PID of tracks provided in two ways: the tracks are 
+   ** physically duplicated for each PID hypothesis, or each track is stored once with the alternative hypotheses in 
+   ** KFPTrackVector::PIDMask(). Decays are simulated without magnetic field, half of pions are ambiguous with protons,
+   ** half of protons are ambiguous with pions, for half of the ambiguous tracks the true hypothesis is the alternative one.
+   ** Xi- is reconstructed from Lambda and the track, so the bachelor pion stored as an antiproton is found only if
+   ** the alternative hypotheses are taken into account besides the two-daughter channels. The test passes
+   ** if the candidates are found and the sets of candidates are the same in all events, the time is compared.
+   ** \param[in] nEvents - number of events
+   ** \param[in] nDecays - number of K0s, Lambda and Xi- decays in each event
+   **/
+  const float field = SwitchOffTestField();
+  
+  const int pidPion = 1 << KFPTrackVector::kPIDPion;
+  const int pidProton = 1 << KFPTrackVector::kPIDProton;
+  
+  int nDifferentEvents = 0;
+  int nTracksDuplicated = 0, nTracksMasked = 0;
+  int nCandidates = 0, nXiCandidates = 0;
+  double timeDuplicated = 0., timeMasked = 0.;
+  for(int iEvent=0; iEvent<nEvents; iEvent++)
+  {
+    KFPTrackVector tracksDuplicated, tracksMasked;
+    tracksDuplicated.Resize(6*nDecays);
+    tracksMasked.Resize(3*nDecays);
+    int nDuplicated = 0, nMasked = 0;
+    for(int iDecay=0; iDecay<nDecays; iDecay++)
+    {
+      const int decayType = iDecay%3; //0 - K0s, 1 - Lambda, 2 - Xi-
+      const float massXi[2] = {1.115683f, 0.13957f};
+      const float origin[3] = {0.f, 0.f, 0.f};
+      const float pMother[3] = { float(Random(-0.5, 0.5)), float(Random(-0.5, 0.5)), float(Random(0.5, 3.)) };
+      float rXi[3] = {0.f, 0.f, 0.f}, pXiDaughters[2][3];
+      const float* pV0 = pMother;
+      const float* originV0 = origin;
+      if(decayType == 2)
+      {
+        SimulateTwoBodyDecay(1.32171f, massXi, origin, pMother, rXi, pXiDaughters);
+        pV0 = pXiDaughters[0];
+        originV0 = rXi;
+      }
+      
+      const bool isK0 = (decayType == 0);
+      const float motherMass = isK0 ? 0.497611f : 1.115683f;
+      const float daughterMass[2] = { isK0 ? 0.13957f : 0.938272f, 0.13957f };
+      float r[3], p[3][3];
+      SimulateTwoBodyDecay(motherMass, daughterMass, originV0, pV0, r, p);
+      
+      const int nDaughters = (decayType == 2) ? 3 : 2;
+      const int daughterPDG[3] = { isK0 ? 211 : 2212, -211, -211 };
+      const int daughterQ[3] = { 1, -1, -1 };
+      const float* daughterR[3] = { r, r, rXi };
+      if(decayType == 2)
+        for(int iP=0; iP<3; iP++)
+          p[2][iP] = pXiDaughters[1][iP];
+      
+      for(int iD=0; iD<nDaughters; iD++)
+      {
+        const int id = nMasked++;
+        const int q = daughterQ[iD];
+        const bool isAmbiguous = (std::rand()%2 == 0);
+        const int alternativePDG = (abs(daughterPDG[iD]) == 211) ? 2212*q : 211*q;
+        const int alternativeMask = (abs(daughterPDG[iD]) == 211) ? pidProton : pidPion;
+        //the position is smeared within the errors once for all copies of the track, otherwise the decays are fitted with zero chi2
+        float rDaughter[3];
+        for(int iP=0; iP<3; iP++)
+          rDaughter[iP] = daughterR[iD][iP] + Random(-0.01, 0.01);
+        //the alternative hypothesis is the true one for half of the ambiguous tracks
+        const bool isSwapped = isAmbiguous && (std::rand()%2 == 0);
+        const int pdg = isSwapped ? alternativePDG : daughterPDG[iD];
+        const int pidMask = isAmbiguous ? (isSwapped ? ((abs(daughterPDG[iD]) == 211) ? pidPion : pidProton) : alternativeMask) : 0;
+        SetTestTrack(tracksMasked, id, rDaughter, p[iD], q, pdg, pidMask, id);
+        SetTestTrack(tracksDuplicated, nDuplicated++, rDaughter, p[iD], q, daughterPDG[iD], 0, id);
+        if(isAmbiguous)
+          SetTestTrack(tracksDuplicated, nDuplicated++, rDaughter, p[iD], q, alternativePDG, 0, id);
+      }
+    }
+    tracksDuplicated.Resize(nDuplicated);
+    tracksMasked.Resize(nMasked);
+    nTracksDuplicated += nDuplicated;
+    nTracksMasked += nMasked;
+    
+    std::set< std::pair<int, std::tuple<int, int, int> > > candidates[2];
+    for(int iMode=0; iMode<2; iMode++)
+    {
+      KFPTrackVector& tracks = (iMode == 0) ? tracksDuplicated : tracksMasked;
+      
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      KFParticleTopoReconstructor topo;
+      topo.GetKFParticleFinder()->AddDecayToReconstructionList(310);
+      topo.GetKFParticleFinder()->AddDecayToReconstructionList(3122);
+      topo.GetKFParticleFinder()->AddDecayToReconstructionList(3312);
+      InitTestEvent(topo, tracks, nMasked);
+      topo.ReconstructParticles();
+      ((iMode == 0) ? timeDuplicated : timeMasked) += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      
+      const std::vector<KFParticle>& particles = topo.GetParticles();
+      for(unsigned int iParticle=0; iParticle<particles.size(); iParticle++)
+      {
+        const KFParticle& particle = particles[iParticle];
+        if(particle.NDaughters() != 2 || (particle.GetPDG() != 310 && particle.GetPDG() != 3122 && particle.GetPDG() != 3312)) continue;
+        candidates[iMode].insert(std::make_pair(int(particle.GetPDG()), GetCandidateTracks(particles, particle)));
+      }
+    }
+    if(candidates[0] != candidates[1])
+      nDifferentEvents++;
+    nCandidates += candidates[1].size();
+    for(std::set< std::pair<int, std::tuple<int, int, int> > >::const_iterator it=candidates[1].begin(); it!=candidates[1].end(); it++)
+      if(it->first == 3312)
+        nXiCandidates++;
+  }
+  
+  RestoreTestField(field);
+  
+  const bool isPassed = (nXiCandidates > 0) && (nDifferentEvents == 0);
+  std::cout << "PID hypotheses: " << nEvents << " events with " << nDecays << " K0s, Lambda and Xi- decays" << std::endl
+            << "  tracks with duplicated hypotheses:  " << nTracksDuplicated << std::endl
+            << "  tracks with alternative hypotheses: " << nTracksMasked << std::endl
+            << "  reconstructed candidates:           " << nCandidates << std::endl
+            << "  reconstructed Xi- candidates:       " << nXiCandidates << std::endl
+            << "  events with different candidates:   " << nDifferentEvents << std::endl
+            << "  duplicated tracks:                  " << timeDuplicated/nEvents*1.e3 << " ms per event" << std::endl
+            << "  alternative hypotheses:             " << timeMasked/nEvents*1.e3 << " ms per event" << std::endl
+            << "  " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
+bool KFParticleTest::RunTrackV0TilingBenchmark(int nEvents, int nDecays)
+{
+  /** Measures the rate of particle-track combinations in KFParticleFinder::FindTrackV0Decay() without and with tiling,
+   ** see KFParticleFinder::SetTrackV0Tiling(). Each event contains "nDecays" decays Xi- -> Lambda pi-, Lambda -> p pi-
+   ** simulated without magnetic field, Lambda candidates are combined with all negative tracks. Candidates found with
+   ** tiling are compared with the ones found without tiling. Combinations of Lambda candidates with their own pi-
+   ** are excluded before the construction, their number is reported as well. The test passes if Xi- candidates are found and
+   ** all tilings give the same candidates as the loop without tiling.
+   ** \param[in] nEvents - number of events
+   ** \param[in] nDecays - number of Xi- decays in each event
+   **/
+  const float field = SwitchOffTestField();
+
+  std::vector<KFPTrackVector> events(nEvents);
+  for(int iEvent=0; iEvent<nEvents; iEvent++)
+  {
+    KFPTrackVector& tracks = events[iEvent];
+    tracks.Resize(3*nDecays);
+    for(int iDecay=0; iDecay<nDecays; iDecay++)
+    {
+      const float massXi[2] = {1.115683f, 0.13957f};
+      const float massLambda[2] = {0.938272f, 0.13957f};
+      const float origin[3] = {0.f, 0.f, 0.f};
+      const float pXi[3] = { float(Random(-0.5, 0.5)), float(Random(-0.5, 0.5)), float(Random(1., 5.)) };
+      float rXi[3], pXiDaughters[2][3], rLambda[3], pLambdaDaughters[2][3];
+      SimulateTwoBodyDecay(1.32171f, massXi, origin, pXi, rXi, pXiDaughters);
+      SimulateTwoBodyDecay(1.115683f, massLambda, rXi, pXiDaughters[0], rLambda, pLambdaDaughters);
+      SetTestTrack(tracks, 3*iDecay,   rLambda, pLambdaDaughters[0],  1, 2212, 0, 3*iDecay);
+      SetTestTrack(tracks, 3*iDecay+1, rLambda, pLambdaDaughters[1], -1, -211, 0, 3*iDecay+1);
+      SetTestTrack(tracks, 3*iDecay+2, rXi,     pXiDaughters[1],     -1, -211, 0, 3*iDecay+2);
+    }
+    SmearTestTracks(tracks);
+  }
+  
+  const int nTilings = 4;
+  const int tiling[nTilings][2] = { {0, 0}, {8, 64}, {32, 256}, {128, 1024} };
+  std::vector< std::set< std::tuple<int, int, int> > > reference(nEvents);
+  bool isPassed = true;
+  
+  std::cout << "Particle-track combinations: " << nEvents << " events with " << nDecays << " Xi- decays" << std::endl;
+  for(int iTiling=0; iTiling<nTilings; iTiling++)
+  {
+    unsigned long nCombinations = 0;
+    unsigned long nExcludedDaughters = 0;
+    double time = 0.;
+    int nCandidates = 0;
+    int nDifferentEvents = 0;
+    for(int iEvent=0; iEvent<nEvents; iEvent++)
+    {
+      KFParticleTopoReconstructor topo;
+      topo.GetKFParticleFinder()->AddDecayToReconstructionList(3122);
+      topo.GetKFParticleFinder()->AddDecayToReconstructionList(3312);
+      topo.GetKFParticleFinder()->SetTrackV0Tiling(tiling[iTiling][0], tiling[iTiling][1]);
+      InitTestEvent(topo, events[iEvent], 3*nDecays);
+      topo.ReconstructParticles();
+      
+      nCombinations += topo.GetKFParticleFinder()->GetNTrackV0Combinations();
+      time += topo.GetKFParticleFinder()->GetTrackV0Time();
+      nExcludedDaughters += topo.GetKFParticleFinder()->GetNTrackV0ExcludedDaughters(3122);
+      
+      std::set< std::tuple<int, int, int> > candidates;
+      const std::vector<KFParticle>& particles = topo.GetParticles();
+      for(unsigned int iParticle=0; iParticle<particles.size(); iParticle++)
+        if(particles[iParticle].GetPDG() == 3312)
+          candidates.insert(GetCandidateTracks(particles, particles[iParticle]));
+      nCandidates += candidates.size();
+      if(iTiling == 0)
+        reference[iEvent] = candidates;
+      else if(candidates != reference[iEvent])
+        nDifferentEvents++;
+    }
+    
+    if(iTiling == 0)
+      std::cout << "  no tiling:                 ";
+    else
+      std::cout << "  tiles of " << std::setw(3) << tiling[iTiling][0] << " x " << std::setw(4) << tiling[iTiling][1] << " tracks: ";
+    std::cout << nCombinations/nEvents << " combinations per event, " << (time > 0. ? nCombinations/time*1.e-6 : 0.) << " M combinations/s, "
+              << nExcludedDaughters/nEvents << " excluded Lambda daughters per event, " << nCandidates << " Xi- candidates";
+    if(iTiling > 0)
+      std::cout << ", events with different candidates: " << nDifferentEvents;
+    std::cout << std::endl;
+    isPassed &= (nCandidates > 0) && (nDifferentEvents == 0);
+  }
+  
+  RestoreTestField(field);
+  
+  std::cout << "  " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
+static std::vector<int> GetCandidateTrackSet(const std::vector<KFParticle>& particles, const KFParticle& candidate)
+{
+  /** Returns sorted indices of the input tracks of the candidate, daughters of the candidate should be tracks. */
+  std::vector<int> tracks;
+  for(int iD=0; iD<candidate.NDaughters(); iD++)
+    tracks.push_back(particles[candidate.DaughterIds()[iD]].DaughterIds()[0]);
+  std::sort(tracks.begin(), tracks.end());
+  return tracks;
+}
+
+bool KFParticleTest::RunNProngCharmBenchmark(int nEvents, int nDecays)
+{
+  /** Compares the sequential reconstruction of D+ -> K- pi+ pi+ and D0 -> K- pi+ pi+ pi- with the N-prong combiner, 
+   ** see KFParticleFinder::SetUseNProngCharm(). Each event contains "nDecays" decays D+ -> K*0_bar pi+ and "nDecays" decays 
+   ** D0 -> K*0_bar rho0 simulated without magnetic field, the resonances decay at the decay point of the D meson. Only the
+   ** channels needed by each mode are reconstructed. For both modes the number of the D+ and D0 candidates, the number of 
+   ** found simulated decays, the number of the tested combinations and the reconstruction time are reported. The test passes if 
+   ** simulated decays are found and every candidate of the N-prong combiner is also found by the sequential reconstruction.
+   ** \param[in] nEvents - number of events
+   ** \param[in] nDecays - number of decays of each type in each event
+   **/
+  const float field = SwitchOffTestField();
+
+  const float massD = 1.86966f, massD0 = 1.86484f, massKStar = 0.89555f, massRho = 0.77526f;
+  const float massK = 0.493677f, massPi = 0.13957f;
+  
+  std::vector<KFPTrackVector> events(nEvents);
+  std::vector< std::set< std::vector<int> > > simulated(nEvents);
+  for(int iEvent=0; iEvent<nEvents; iEvent++)
+  {
+    KFPTrackVector& tracks = events[iEvent];
+    tracks.Resize(7*nDecays);
+    int iTrack = 0;
+    for(int iDecay=0; iDecay<2*nDecays; iDecay++)
+    {
+      const bool isDPlus = (iDecay < nDecays);
+      const float origin[3] = {0.f, 0.f, 0.f};
+      const float pD[3] = { float(Random(-0.5, 0.5)), float(Random(-0.5, 0.5)), float(Random(2., 6.)) };
+      const float massesD[2] = {massKStar, isDPlus ? massPi : massRho};
+      const float massesKStar[2] = {massK, massPi};
+      const float massesRho[2] = {massPi, massPi};
+      float rD[3], pDDaughters[2][3], r[3], pKStarDaughters[2][3], pRhoDaughters[2][3];
+      SimulateTwoBodyDecay(isDPlus ? massD : massD0, massesD, origin, pD, rD, pDDaughters);
+      SimulateTwoBodyDecay(massKStar, massesKStar, rD, pDDaughters[0], r, pKStarDaughters);
+      
+      std::vector<int> decayTracks;
+      decayTracks.push_back(iTrack);
+      SetTestTrack(tracks, iTrack++, rD, pKStarDaughters[0], -1, -321, 0, 0);
+      decayTracks.push_back(iTrack);
+      SetTestTrack(tracks, iTrack++, rD, pKStarDaughters[1],  1,  211, 0, 0);
+      if(isDPlus)
+      {
+        decayTracks.push_back(iTrack);
+        SetTestTrack(tracks, iTrack++, rD, pDDaughters[1], 1, 211, 0, 0);
+      }
+      else
+      {
+        SimulateTwoBodyDecay(massRho, massesRho, rD, pDDaughters[1], r, pRhoDaughters);
+        decayTracks.push_back(iTrack);
+        SetTestTrack(tracks, iTrack++, rD, pRhoDaughters[0],  1,  211, 0, 0);
+        decayTracks.push_back(iTrack);
+        SetTestTrack(tracks, iTrack++, rD, pRhoDaughters[1], -1, -211, 0, 0);
+      }
+      simulated[iEvent].insert(decayTracks);
+    }
+    SmearTestTracks(tracks);
+  }
+  
+  std::vector< std::set< std::vector<int> > > sequential[2];
+  sequential[0].resize(nEvents);
+  sequential[1].resize(nEvents);
+  bool isPassed = true;
+  
+  std::cout << "Multi-prong open charm: " << nEvents << " events with " << nDecays << " D+ and " << nDecays << " D0 decays" << std::endl;
+  for(int iMode=0; iMode<2; iMode++)
+  {
+    const int motherPDG[2] = {411, 429};
+    int nCandidates[2] = {0, 0};
+    int nFound[2] = {0, 0};
+    int nNotSequential = 0;
+    unsigned long nCombinations = 0;
+    double time = 0.;
+    for(int iEvent=0; iEvent<nEvents; iEvent++)
+    {
+      KFParticleTopoReconstructor topo;
+      // the sequential reconstruction needs D0 -> K- pi+ as intermediate candidates
+      const int decays[6] = {411, -411, 429, -429, 421, -421};
+      for(int iDecay=0; iDecay<(iMode == 0 ? 6 : 4); iDecay++)
+        topo.GetKFParticleFinder()->AddDecayToReconstructionList(decays[iDecay]);
+      topo.GetKFParticleFinder()->SetUseNProngCharm(iMode == 1);
+      InitTestEvent(topo, events[iEvent], 7*nDecays);
+      
+      const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+      topo.ReconstructParticles();
+      time += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+      
+      if(iMode == 0)
+        nCombinations += topo.GetKFParticleFinder()->GetNTrackV0Combinations();
+      else
+        nCombinations += topo.GetKFParticleFinder()->GetNNProngTuples();
+      
+      const std::vector<KFParticle>& particles = topo.GetParticles();
+      for(int iType=0; iType<2; iType++)
+      {
+        std::set< std::vector<int> > candidates;
+        for(unsigned int iParticle=0; iParticle<particles.size(); iParticle++)
+          if(particles[iParticle].GetPDG() == motherPDG[iType])
+            candidates.insert(GetCandidateTrackSet(particles, particles[iParticle]));
+        nCandidates[iType] += candidates.size();
+        for(std::set< std::vector<int> >::const_iterator it=candidates.begin(); it!=candidates.end(); ++it)
+        {
+          if(simulated[iEvent].find(*it) != simulated[iEvent].end())
+            nFound[iType]++;
+          if( (iMode == 1) && (sequential[iType][iEvent].find(*it) == sequential[iType][iEvent].end()) )
+            nNotSequential++;
+        }
+        if(iMode == 0)
+          sequential[iType][iEvent] = candidates;
+      }
+    }
+    
+    std::cout << (iMode == 0 ? "  sequential: " : "  N-prong:    ")
+              << nCandidates[0] << " D+ candidates, " << nFound[0] << " D+ found, "
+              << nCandidates[1] << " D0 candidates, " << nFound[1] << " D0 found, "
+              << nCombinations/nEvents << (iMode == 0 ? " particle-track combinations" : " fitted tuples") << " per event, "
+              << time/nEvents*1.e3 << " ms per event" << std::endl;
+    if(iMode == 1)
+      std::cout << "  N-prong candidates not found sequentially: " << nNotSequential << std::endl;
+    isPassed &= (nFound[0] > 0) && (nFound[1] > 0) && (nNotSequential == 0);
+  }
+  
+  RestoreTestField(field);
+  
+  std::cout << "  " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
+bool KFParticleTest::RunSelectParticlesBenchmark(int nEvents, int nDecays)
+{
+  /** Compares the selection of the open charm candidates by KFParticleFinder::SelectParticles() in the SIMD form with the selection 
+   ** candidate by candidate, see KFParticleFinder::SetUseSIMDSelection(). Each event contains "nDecays" decays D0 -> K- pi+ and 
+   ** "nDecays" decays D+ -> K- pi+ pi+ together with the charge conjugated decays simulated without magnetic field, which gives 
+   ** a high multiplicity of D0 candidates. For both modes the number of selected candidates, the time spent in the selection
+   ** per event and per candidate are reported together with the number of output particles, which differ between the modes.
+   ** The ratio of the selection times depends on the width of the SIMD vectors of Vc, no gain is expected with scalar vectors.
+   ** The test passes if the modes give the same output: the PDG codes, indices, daughter indices and the flags "at production 
+   ** vertex" should coincide exactly, the parameters within the relative tolerance of 1e-4.
+   ** \param[in] nEvents - number of events
+   ** \param[in] nDecays - number of decays of each type in each event
+   **/
+  const float field = SwitchOffTestField();
+
+  const float massD = 1.86966f, massD0 = 1.86484f;
+  const float massK = 0.493677f, massPi = 0.13957f;
+  
+  std::vector<KFPTrackVector> events(nEvents);
+  for(int iEvent=0; iEvent<nEvents; iEvent++)
+  {
+    KFPTrackVector& tracks = events[iEvent];
+    tracks.Resize(5*nDecays);
+    int iTrack = 0;
+    for(int iDecay=0; iDecay<2*nDecays; iDecay++)
+    {
+      const bool isDPlus = (iDecay >= nDecays);
+      const int q = (iDecay%2 == 0) ? 1 : -1;
+      const float origin[3] = {0.f, 0.f, 0.f};
+      const float pD[3] = { float(Random(-0.5, 0.5)), float(Random(-0.5, 0.5)), float(Random(2., 6.)) };
+      float rD[3], pDDaughters[2][3];
+      if(isDPlus)
+      {
+        // the K- pi+ pair is produced at the decay point of D+ with the invariant mass of K*0_bar
+        const float massesD[2] = {0.89555f, massPi};
+        const float massesKStar[2] = {massK, massPi};
+        float r[3], pKStarDaughters[2][3];
+        SimulateTwoBodyDecay(massD, massesD, origin, pD, rD, pDDaughters);
+        SimulateTwoBodyDecay(0.89555f, massesKStar, rD, pDDaughters[0], r, pKStarDaughters);
+        SetTestTrack(tracks, iTrack++, rD, pKStarDaughters[0], -q, -q*321, 0, 0);
+        SetTestTrack(tracks, iTrack++, rD, pKStarDaughters[1],  q,  q*211, 0, 0);
+        SetTestTrack(tracks, iTrack++, rD, pDDaughters[1],       q,  q*211, 0, 0);
+      }
+      else
+      {
+        const float massesD0[2] = {massK, massPi};
+        SimulateTwoBodyDecay(massD0, massesD0, origin, pD, rD, pDDaughters);
+        SetTestTrack(tracks, iTrack++, rD, pDDaughters[0], -q, -q*321, 0, 0);
+        SetTestTrack(tracks, iTrack++, rD, pDDaughters[1],  q,  q*211, 0, 0);
+      }
+    }
+    SmearTestTracks(tracks);
+  }
+  
+  std::cout << "Selection of open charm candidates: " << nEvents << " events with " << nDecays << " D0 and " << nDecays << " D+ decays" << std::endl;
+  std::vector< std::vector<KFParticle> > output[2];
+  double selectionTime[2] = {0., 0.};
+  for(int iMode=0; iMode<2; iMode++)
+  {
+    unsigned long nSelected = 0;
+    unsigned long nParticles = 0;
+    for(int iEvent=0; iEvent<nEvents; iEvent++)
+    {
+      KFParticleTopoReconstructor topo;
+      const int decays[4] = {421, -421, 411, -411};
+      for(int iDecay=0; iDecay<4; iDecay++)
+        topo.GetKFParticleFinder()->AddDecayToReconstructionList(decays[iDecay]);
+      topo.GetKFParticleFinder()->SetUseSIMDSelection(iMode == 1);
+      InitTestEvent(topo, events[iEvent], 5*nDecays);
+      topo.ReconstructParticles();
+      
+      nSelected += topo.GetKFParticleFinder()->GetNSelectedCandidates();
+      selectionTime[iMode] += topo.GetKFParticleFinder()->GetSelectParticlesTime();
+      nParticles += topo.GetParticles().size();
+      output[iMode].push_back(topo.GetParticles());
+    }
+    
+    std::cout << (iMode == 0 ? "  per candidate: " : "  SIMD:          ")
+              << nSelected/nEvents << " candidates per event, " << nParticles/nEvents << " particles per event, "
+              << selectionTime[iMode]/nEvents*1.e3 << " ms per event, "
+              << ((nSelected > 0) ? selectionTime[iMode]/nSelected*1.e9 : 0.) << " ns per candidate" << std::endl;
+  }
+  
+  // the mass constraint is calculated in the SIMD form with a different order of operations, small deviations are expected
+  int nDifferent = 0;
+  for(int iEvent=0; iEvent<nEvents; iEvent++)
+  {
+    if(output[0][iEvent].size() != output[1][iEvent].size())
+    {
+      nDifferent += std::max(output[0][iEvent].size(), output[1][iEvent].size());
+      continue;
+    }
+    for(unsigned int iParticle=0; iParticle<output[0][iEvent].size(); iParticle++)
+    {
+      const KFParticle& particle0 = output[0][iEvent][iParticle];
+      const KFParticle& particle1 = output[1][iEvent][iParticle];
+      bool isSame = (particle0.GetPDG() == particle1.GetPDG()) && (particle0.Id() == particle1.Id()) &&
+                    (particle0.NDaughters() == particle1.NDaughters()) &&
+                    (particle0.GetAtProductionVertex() == particle1.GetAtProductionVertex());
+      for(int iD=0; iD<particle0.NDaughters() && isSame; iD++)
+        isSame = (particle0.DaughterIds()[iD] == particle1.DaughterIds()[iD]);
+      for(int iP=0; iP<8 && isSame; iP++)
+        isSame = fabs(particle0.GetParameter(iP) - particle1.GetParameter(iP)) <= 1.e-4f*(fabs(particle0.GetParameter(iP)) + 1.f);
+      if(!isSame)
+        nDifferent++;
+    }
+  }
+  std::cout << "  time ratio of the selection per candidate to the SIMD selection: " << ((selectionTime[1] > 0.) ? selectionTime[0]/selectionTime[1] : 0.)
+            << ", particles different between the modes: " << nDifferent << std::endl;
+  
+  RestoreTestField(field);
+  
+  const bool isPassed = (nDifferent == 0);
+  std::cout << "  " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
+bool KFParticleTest::RunTimeFrameTest(int nCollisions, int nDecays)
+{
+  /** Checks the assignment of primary vertices and particles to collisions in a time frame of the continuous readout, see
+   ** KFParticleTopoReconstructor::ProcessTimeFrame(). "nCollisions" collisions are placed 125 ns apart, each of them has 20 primary
+   ** pions and "nDecays" decays K0s -> pi+ pi- simulated without magnetic field, tracks have the time of the collision smeared 
+   ** within the error of 0.5 ns. The time frame is reconstructed in slices of 250 ns with the overlap of 20 ns, so that every 
+   ** second collision lies on the border between two slices. The test passes if the time frame is divided into several slices,
+   ** the output starts with the tracks of the time frame in the input order, each collision gets exactly one primary vertex 
+   ** with the majority of its primary tracks at the time of the collision, no primary vertex contains tracks from different 
+   ** collisions, K0s candidates are found, no candidate is stored twice and no candidate combines tracks from different collisions.
+   ** \param[in] nCollisions - number of collisions in the time frame
+   ** \param[in] nDecays - number of K0s decays in each collision
+   **/
+  const float field = SwitchOffTestField();
+  
+  const int nPrimaryTracks = 20;
+  const int nCollisionTracks = nPrimaryTracks + 2*nDecays;
+  const float collisionSpacing = 125.f;
+  KFPTrackVector tracks;
+  tracks.Resize(nCollisions*nCollisionTracks);
+  for(int iCollision=0; iCollision<nCollisions; iCollision++)
+  {
+    // neighbouring collisions are separated in space, so that decays are not associated with a wrong vertex
+    const float phi = 2.f*float(M_PI)*float(iCollision%3)/3.f;
+    const float origin[3] = {float(3.*cos(phi)), float(3.*sin(phi)), float(Random(-1., 1.))};
+    int iTrack = iCollision*nCollisionTracks;
+    for(int iPrimary=0; iPrimary<nPrimaryTracks; iPrimary++, iTrack++)
+    {
+      const float p[3] = { float(Random(-0.5, 0.5)), float(Random(-0.5, 0.5)), float(Random(1., 4.)) };
+      SetTestTrack(tracks, iTrack, origin, p, (iPrimary%2 == 0) ? 1 : -1, (iPrimary%2 == 0) ? 211 : -211, 0, 0);
+    }
+    for(int iDecay=0; iDecay<nDecays; iDecay++, iTrack+=2)
+    {
+      const float daughterMass[2] = {0.13957f, 0.13957f};
+      const float pMother[3] = { float(Random(-0.5, 0.5)), float(Random(-0.5, 0.5)), float(Random(2., 6.)) };
+      float r[3], p[2][3];
+      SimulateTwoBodyDecay(0.497611f, daughterMass, origin, pMother, r, p);
+      SetTestTrack(tracks, iTrack,   r, p[0], -1, -211, 0, 0);
+      SetTestTrack(tracks, iTrack+1, r, p[1],  1,  211, 0, 0);
+    }
+    for(iTrack=iCollision*nCollisionTracks; iTrack<(iCollision+1)*nCollisionTracks; iTrack++)
+    {
+      tracks.SetT(collisionSpacing*iCollision + Random(-0.5, 0.5), iTrack);
+      tracks.SetTErr(0.5f, iTrack);
+    }
+  }
+  SmearTestTracks(tracks);
+  
+  KFParticleTopoReconstructor topo;
+  topo.GetKFParticleFinder()->AddDecayToReconstructionList(310);
+  topo.SetTimeCompatibilityCut(3.f);
+  topo.SetTimeFrameSlicing(2.f*collisionSpacing, 20.f);
+  topo.ProcessTimeFrame(tracks, tracks);
+  
+  // primary vertices
+  std::vector<int> nCollisionPV(nCollisions, 0);
+  int nMixedPV = 0;
+  for(int iPV=0; iPV<topo.NPrimaryVertices(); iPV++)
+  {
+    const std::vector<int>& pvTracks = topo.GetPVTrackIndexArray(iPV);
+    if(pvTracks.empty()) continue;
+    const int iCollision = pvTracks[0]/nCollisionTracks;
+    int nPrimary = 0;
+    for(unsigned int iPVTrack=0; iPVTrack<pvTracks.size(); iPVTrack++)
+    {
+      if(pvTracks[iPVTrack]/nCollisionTracks != iCollision) nMixedPV++;
+      if(pvTracks[iPVTrack]%nCollisionTracks < nPrimaryTracks) nPrimary++;
+    }
+    if(2*nPrimary > nPrimaryTracks && fabs(topo.GetPVTime(iPV) - collisionSpacing*iCollision) < 1.f)
+      nCollisionPV[iCollision]++;
+  }
+  int nWrongPV = 0;
+  for(int iCollision=0; iCollision<nCollisions; iCollision++)
+    if(nCollisionPV[iCollision] != 1)
+      nWrongPV++;
+  
+  // particles
+  const std::vector<KFParticle>& particles = topo.GetParticles();
+  int nWrongTracks = 0, nDuplicates = 0, nMixedCollisions = 0;
+  for(int iTr=0; iTr<tracks.Size(); iTr++)
+    if(int(particles.size()) <= iTr || particles[iTr].NDaughters() != 1 || particles[iTr].DaughterIds()[0] != tracks.Id()[iTr])
+      nWrongTracks++;
+  std::set< std::vector<int> > candidates;
+  for(unsigned int iParticle=tracks.Size(); iParticle<particles.size(); iParticle++)
+  {
+    if(particles[iParticle].GetPDG() != 310) continue;
+    const std::vector<int> candidateTracks = GetCandidateTrackSet(particles, particles[iParticle]);
+    if(!candidates.insert(candidateTracks).second)
+      nDuplicates++;
+    if(candidateTracks.front()/nCollisionTracks != candidateTracks.back()/nCollisionTracks)
+      nMixedCollisions++;
+  }
+  
+  RestoreTestField(field);
+  
+  std::cout << "Time frame: " << nCollisions << " collisions with " << nDecays << " K0s decays, " 
+            << topo.GetNTimeFrameSlices() << " slices" << std::endl
+            << "  primary vertices:      " << topo.NPrimaryVertices() << ", collisions without exactly one vertex: " << nWrongPV
+            << ", tracks from other collisions in vertices: " << nMixedPV << std::endl
+            << "  K0s candidates:        " << candidates.size() << ", duplicated: " << nDuplicates 
+            << ", from different collisions: " << nMixedCollisions << std::endl
+            << "  misplaced tracks:      " << nWrongTracks << std::endl;
+  
+  const bool isPassed = (topo.GetNTimeFrameSlices() > 1) && (nWrongTracks == 0) && (nWrongPV == 0) && (nMixedPV == 0) && 
+                        !candidates.empty() && (nDuplicates == 0) && (nMixedCollisions == 0);
+  std::cout << "  " << (isPassed ? "passed" : "FAILED") << std::endl;
+  return isPassed;
+}
+
 void KFParticleTest::CompareSingleAndSIMDResults()
 {
 }
@@ -34,6 +34,20 @@ class KFParticleTest
   
   void PrintTutorial();
   void RunTest();
+  bool RunFinderTests();
+  void RunDaughterIdsBenchmark(int nParticles = 10000, int nRepeat = 100);
+  void RunExportBenchmark(int nRepeat = 1000000);
+  bool RunCovarianceCodecTest(int nMatrices = 100000);
+  bool RunCandidateFileTest(int nEvents = 100, int nParticles = 30);
+  void RunSharedMemoryRingTest(int nEvents = 10000, int nTracks = 500);
+  void RunInputDataPrefetcherTest(int nEvents = 200, int nTracks = 2000);
+  bool RunLatencyBudgetTest(int nEvents = 10, int nDecays = 20);
+  bool RunTriggerTest(int nEvents = 10, int nDecays = 20);
+  bool RunPIDHypothesesTest(int nEvents = 100, int nDecays = 50);
+  bool RunTrackV0TilingBenchmark(int nEvents = 10, int nDecays = 300);
+  bool RunNProngCharmBenchmark(int nEvents = 5, int nDecays = 50);
+  bool RunSelectParticlesBenchmark(int nEvents = 5, int nDecays = 200);
+  bool RunTimeFrameTest(int nCollisions = 10, int nDecays = 20);
   
  private:
    